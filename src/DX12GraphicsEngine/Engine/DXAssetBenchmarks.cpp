@@ -0,0 +1,2501 @@
+#include "stdafx.h"
+#include "DXAssetBenchmarks.h"
+#include "DXObjParser.h"
+#include "DXParallel.h"
+#include "DXMeshWelder.h"
+#include "DXMeshOptimizer.h"
+#include "DXVertexCompression.h"
+#include "DXMeshSimplifier.h"
+#include "DXMesh.h"
+#include "DXMemoryMappedFile.h"
+#include "DXMeshletBuilder.h"
+#include "DXMeshletCuller.h"
+#include "DXMeshletDAG.h"
+#include "DXMeshletCompression.h"
+#include "DXPlyParser.h"
+#include "DXPointSorter.h"
+#include "DXPointChunks.h"
+#include "DXPointOctree.h"
+#include "DXPointStreamer.h"
+#include "DXPointDownsample.h"
+#include "DXUploadPlanner.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <psapi.h>
+#include <fstream>
+#include <sstream>
+
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	const char* kRobotOBJFile = "./assets/models/androidRobot.obj";
+	const char* kTeapotOBJFile = "./assets/models/unitTeapot.obj";
+	const char* kModelDirectory = "./assets/models/";
+	const char* kMeshletDirectory = "./assets/meshlets/";
+	const size_t kSyntheticTriangleCount = 10000000;
+	const uint64_t kMeshletPackBytes = 1ull << 30;
+	const char* kMeshletReportFile = "./meshlet_report.json";
+	const char* kPointCloudDirectory = "./assets/pointclouds/";
+	const char* kTestPointCloudFile = "./assets/pointclouds/TestPointCloud_1.ply";
+	const size_t kSyntheticPointCount = 50000000;
+	const size_t kSyntheticAsciiPointCount = 20000000;
+	const size_t kSortPointCount = 1000000;
+	const size_t kChunkPointCount = 4000000;
+	const size_t kOctreePointCount = 20000000;
+	const size_t kStreamPointCount = 20000000;
+	const size_t kCompressionPointCount = 20000000;
+	const size_t kDownsamplePointCount = 10000000;
+	const size_t kUploadMeshCount = 1000;
+	const WeldOptions kExactWeld;
+
+	double GetElapsedMs(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	size_t GetPeakWorkingSetMB()
+	{
+		PROCESS_MEMORY_COUNTERS counters = {};
+		GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.PeakWorkingSetSize / (1024 * 1024);
+	}
+
+	double GetWorkingSetMB()
+	{
+		PROCESS_MEMORY_COUNTERS counters = {};
+		GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.WorkingSetSize / (1024.0 * 1024.0);
+	}
+
+	size_t GetFileSizeBytes(const char* path)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA data = {};
+		if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+			return 0;
+
+		return (static_cast<size_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+	}
+
+	template< typename T >
+	bool IsSameArray(const std::vector< T >& a, const std::vector< T >& b)
+	{
+		return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+	}
+
+	bool IsSameObjData(const ObjMeshData& a, const ObjMeshData& b)
+	{
+		return IsSameArray(a.positions, b.positions) && IsSameArray(a.uvs, b.uvs) &&
+			IsSameArray(a.normals, b.normals) && IsSameArray(a.corners, b.corners);
+	}
+
+	//The original ifstream + stringstream + getline + sscanf_s OBJ loader.  Kept as the baseline for the load time
+	//benchmark and to validate the output of DXObjParser.
+	bool ParseFileReference(const char* path,
+		std::vector< vec3 >& out_vertices,
+		std::vector< vec2 >& out_uvs,
+		std::vector< vec3 >& out_normals,
+		bool bFlipWinding)
+	{
+		std::vector< unsigned int > vertexIndices, uvIndices, normalIndices;
+		std::vector< vec3 > temp_vertices;
+		std::vector< vec2 > temp_uvs;
+		std::vector< vec3 > temp_normals;
+
+		// open the file and read it into char buffer
+		std::ifstream infile;
+		infile.open(path, std::ios::binary);
+		infile.seekg(0, std::ios::end);
+		size_t fileSize = infile.tellg();
+		std::vector< char > buffer; // used to store text data
+		buffer.resize(fileSize);
+		infile.seekg(0, std::ios::beg);
+		infile.read(&buffer[0], fileSize);
+
+		std::string strBuffer(buffer.data(), fileSize);
+		std::stringstream ss(strBuffer);
+
+		const int scanf_buffer_sz = 512; //hack since we switched from sscanf to sscanf_s
+		std::string strLine;
+		while (std::getline(ss, strLine, '\n'))
+		{
+			const char* lineHeader = strLine.c_str();
+			char firstWord[scanf_buffer_sz];
+			sscanf_s(lineHeader, "%s", firstWord, scanf_buffer_sz);
+
+			// get second word in string.  this is start of actual data
+			int    firstWordLength = static_cast<int>(strlen(firstWord));
+			char* it = const_cast<char*>(lineHeader) + firstWordLength;
+			while (*it == ' ' || *it == '\t' || *it == '\0')
+			{
+				it++;
+			}
+
+			char* secondWord = it;
+
+			if (strcmp(firstWord, "v") == 0)
+			{
+				vec3 vertex;
+				sscanf_s(secondWord, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
+				temp_vertices.push_back(vertex);
+			}
+			else if (strcmp(firstWord, "vt") == 0)
+			{
+				vec2 uv;
+				sscanf_s(secondWord, "%f %f\n", &uv.x, &uv.y);
+				temp_uvs.push_back(uv);
+			}
+			else if (strcmp(firstWord, "vn") == 0)
+			{
+				vec3 normal;
+				sscanf_s(secondWord, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
+				temp_normals.push_back(normal);
+			}
+			else if (strcmp(firstWord, "f") == 0)
+			{
+				unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
+				int matches = sscanf_s(secondWord,
+					"%d/%d/%d %d/%d/%d %d/%d/%d\n",
+					&vertexIndex[0],
+					&uvIndex[0],
+					&normalIndex[0],
+					&vertexIndex[1],
+					&uvIndex[1],
+					&normalIndex[1],
+					&vertexIndex[2],
+					&uvIndex[2],
+					&normalIndex[2]);
+				if (matches != 9)
+				{
+					printf("File can't be read by our simple parser :-( Try exporting with other options\n");
+					return false;
+				}
+				if (bFlipWinding)
+				{
+					vertexIndices.push_back(vertexIndex[0]);
+					vertexIndices.push_back(vertexIndex[2]);
+					vertexIndices.push_back(vertexIndex[1]);
+				}
+				else
+				{
+					vertexIndices.push_back(vertexIndex[0]);
+					vertexIndices.push_back(vertexIndex[1]);
+					vertexIndices.push_back(vertexIndex[2]);
+				}
+
+				uvIndices.push_back(uvIndex[0]);
+				uvIndices.push_back(uvIndex[1]);
+				uvIndices.push_back(uvIndex[2]);
+				normalIndices.push_back(normalIndex[0]);
+				normalIndices.push_back(normalIndex[1]);
+				normalIndices.push_back(normalIndex[2]);
+			}
+		}
+
+		// For each vertex of each triangle
+		int numIndices = static_cast<int>(vertexIndices.size());
+
+		for (int i = 0; i < numIndices; i++)
+		{
+			out_vertices.push_back(temp_vertices[vertexIndices[i] - 1]);
+			out_uvs.push_back(temp_uvs[uvIndices[i] - 1]);
+			out_normals.push_back(temp_normals[normalIndices[i] - 1]);
+		}
+
+		return true;
+	}
+
+	//full paths of the files with an extension (".obj") in a directory, the directory ends with a slash
+	std::vector< std::string > FindFiles(const char* directory, const char* extension)
+	{
+		std::vector< std::string > paths;
+
+		std::string pattern = std::string(directory) + "*" + extension;
+		WIN32_FIND_DATAA findData;
+		HANDLE hFind = FindFirstFileA(pattern.c_str(), &findData);
+		if (hFind != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				paths.push_back(std::string(directory) + findData.cFileName);
+			} while (FindNextFileA(hFind, &findData));
+
+			FindClose(hFind);
+		}
+
+		return paths;
+	}
+
+	std::vector< std::string > FindOBJFiles(const char* directory)
+	{
+		return FindFiles(directory, ".obj");
+	}
+
+	//every triangle of the index buffer is in exactly one meshlet, and no meshlet is over the limits
+	bool IsValidMeshletCover(const uint32_t* pIndices, size_t numIndices, const MeshletData& data, const MeshletBuildOptions& options)
+	{
+		std::vector< uint64_t > sourceTriangles;
+		std::vector< uint64_t > meshletTriangles;
+
+		auto makeKey = [](uint32_t a, uint32_t b, uint32_t c)
+		{
+			// rotate the smallest index to the front, the winding must be kept
+			if (b < a && b < c) { uint32_t t = a; a = b; b = c; c = t; }
+			else if (c < a && c < b) { uint32_t t = c; c = b; b = a; a = t; }
+			return (uint64_t(a) << 42) | (uint64_t(b) << 21) | uint64_t(c);
+		};
+
+		for (size_t i = 0; i + 2 < numIndices; i += 3)
+		{
+			sourceTriangles.push_back(makeKey(pIndices[i], pIndices[i + 1], pIndices[i + 2]));
+		}
+
+		for (const Meshlet& meshlet : data.meshlets)
+		{
+			if (meshlet.VertCount > options.maxVertices || meshlet.PrimCount > options.maxPrimitives)
+				return false;
+
+			for (uint32_t i = 0; i < meshlet.PrimCount; ++i)
+			{
+				const PackedTriangle& triangle = data.primitiveIndices[meshlet.PrimOffset + i];
+				const uint32_t* pVerts = &data.uniqueVertexIndices[meshlet.VertOffset];
+				meshletTriangles.push_back(makeKey(pVerts[triangle.i0], pVerts[triangle.i1], pVerts[triangle.i2]));
+			}
+		}
+
+		std::sort(sourceTriangles.begin(), sourceTriangles.end());
+		std::sort(meshletTriangles.begin(), meshletTriangles.end());
+		return sourceTriangles == meshletTriangles;
+	}
+
+	std::vector< uint32_t > ReadIndices(const uint8_t* pIndices, uint32_t indexSize, size_t count)
+	{
+		std::vector< uint32_t > indices(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			indices[i] = indexSize == 2 ? reinterpret_cast<const uint16_t*>(pIndices)[i] : reinterpret_cast<const uint32_t*>(pIndices)[i];
+		}
+		return indices;
+	}
+
+	//the meshlets of a loaded MSHL mesh as DXMeshletBuilder output, for recomputing their cull data
+	MeshletData GetMeshletData(const Mesh& mesh)
+	{
+		MeshletData data;
+		data.meshlets.assign(mesh.Meshlets.data(), mesh.Meshlets.data() + mesh.Meshlets.size());
+		data.primitiveIndices.assign(mesh.PrimitiveIndices.data(), mesh.PrimitiveIndices.data() + mesh.PrimitiveIndices.size());
+		data.meshletSubsets.assign(mesh.MeshletSubsets.data(), mesh.MeshletSubsets.data() + mesh.MeshletSubsets.size());
+		data.uniqueVertexIndices = ReadIndices(mesh.UniqueVertexIndices.data(), mesh.IndexSize, mesh.UniqueVertexIndices.size() / mesh.IndexSize);
+		return data;
+	}
+
+	//cull against views orbiting a sphere around the mesh, every other view looks past the mesh so the frustum
+	//test has work.  the SIMD culler runs once per view and is checked against the one meshlet reference.
+	MeshletCullStats CullOrbitViews(const std::vector< CullData >& cullData, const XMFLOAT3& center, float radius,
+		uint32_t flags, size_t& out_mismatches)
+	{
+		const int kNumViews = 64;
+
+		MeshletCullStats stats;
+		std::vector< uint32_t > visible;
+		out_mismatches = 0;
+
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, radius * 0.01f, radius * 10.0f);
+		XMVECTOR target = XMLoadFloat3(&center);
+
+		for (int v = 0; v < kNumViews; ++v)
+		{
+			float yaw = XM_2PI * v / kNumViews;
+			float pitch = 0.6f * std::sin(yaw * 3.0f);
+			XMVECTOR direction = XMVectorSet(std::cos(pitch) * std::cos(yaw), std::sin(pitch), std::cos(pitch) * std::sin(yaw), 0.0f);
+			XMVECTOR eye = XMVectorMultiplyAdd(direction, XMVectorReplicate(radius * 2.5f), target);
+			XMVECTOR lookAt = (v & 1) ? XMVectorAdd(target, XMVectorSet(radius * 0.6f, 0.0f, 0.0f, 0.0f)) : target;
+
+			MeshletCullView view = DXMeshletCuller::CreateCullView(XMMatrixIdentity(), XMMatrixLookAtLH(eye, lookAt, g_XMIdentityR1), proj);
+
+			visible.clear();
+			DXMeshletCuller::CullMeshlets(cullData.data(), cullData.size(), view, visible, 0, &stats, flags);
+
+			size_t next = 0;
+			for (uint32_t i = 0; i < cullData.size(); ++i)
+			{
+				bool bVisible = next < visible.size() && visible[next] == i;
+				next += bVisible ? 1 : 0;
+				out_mismatches += bVisible != DXMeshletCuller::IsMeshletVisible(cullData[i], view, flags) ? 1 : 0;
+			}
+		}
+
+		return stats;
+	}
+
+	void LogCullStats(const char* label, const MeshletCullStats& stats, size_t mismatches)
+	{
+		DXAssetBenchmarks::Log("    %-9s %5.1f%% visible  %5.1f%% frustum culled  %5.1f%% cone culled  %5.1f%% degenerate cones  %6.1f ns/meshlet%s\n",
+			label, stats.GetVisibleRate() * 100.0f, stats.GetFrustumCulledRate() * 100.0f, stats.GetConeCulledRate() * 100.0f,
+			stats.numMeshlets ? 100.0f * stats.numDegenerateCones / stats.numMeshlets : 0.0f,
+			stats.numMeshlets ? stats.cullMs * 1.0e6 / stats.numMeshlets : 0.0, mismatches ? "  MISMATCH" : "");
+	}
+
+	void LogMeshletStats(const char* label, const MeshletStats& stats)
+	{
+		DXAssetBenchmarks::Log("    %-9s %6zu meshlets  %5.1f%% vertex fill  %5.1f%% primitive fill  %.3f verts/tri\n", label,
+			stats.numMeshlets, stats.GetVertexFill() * 100.0f, stats.GetPrimitiveFill() * 100.0f, stats.GetVerticesPerTriangle());
+	}
+
+	//just enough json for the reports: objects and arrays written in order, the commas are added here
+	class JsonWriter
+	{
+	public:
+		void BeginObject(const char* key = nullptr) { WriteKey(key); m_Text += "{"; m_bFirst.push_back(true); }
+		void EndObject() { m_bFirst.pop_back(); m_Text += "}"; }
+		void BeginArray(const char* key) { WriteKey(key); m_Text += "["; m_bFirst.push_back(true); }
+		void EndArray() { m_bFirst.pop_back(); m_Text += "]"; }
+
+		void Write(const char* key, const char* value)
+		{
+			WriteKey(key);
+			WriteString(value);
+		}
+
+		//non finite numbers are not json, they are written as null
+		void Write(const char* key, double value)
+		{
+			char buffer[32];
+			snprintf(buffer, sizeof(buffer), "%.6g", value);
+			WriteKey(key);
+			m_Text += std::isfinite(value) ? buffer : "null";
+		}
+
+		void Write(const char* key, size_t value)
+		{
+			WriteKey(key);
+			m_Text += std::to_string(value);
+		}
+
+		bool SaveToFile(const char* path) const
+		{
+			std::ofstream file(path, std::ios::binary);
+			file << m_Text << "\n";
+			return file.good();
+		}
+
+	protected:
+		void WriteKey(const char* key)
+		{
+			if (!m_bFirst.empty())
+			{
+				if (!m_bFirst.back())
+					m_Text += ",";
+				m_bFirst.back() = false;
+			}
+
+			if (key)
+			{
+				WriteString(key);
+				m_Text += ":";
+			}
+		}
+
+		void WriteString(const char* value)
+		{
+			m_Text += "\"";
+			for (const char* c = value; *c; ++c)
+			{
+				if (*c == '"' || *c == '\\')
+					m_Text += '\\';
+				m_Text += *c;
+			}
+			m_Text += "\"";
+		}
+
+		std::string m_Text;
+		std::vector< bool > m_bFirst;
+	};
+
+	const int kNumConeBuckets = 7;      //half angles in 15 degree steps, the last bucket counts the degenerate cones
+
+	struct MeshletQuality
+	{
+		MeshletStats stats;
+		size_t numUniqueVertices = 0;   //vertices used by any meshlet
+		double sphereToBoxMean = 0.0;   //bounding sphere radius / half the diagonal of the meshlet bounding box
+		double sphereToBoxMax = 0.0;
+		size_t numOutsideSphere = 0;    //vertices outside the bounding sphere of their meshlet
+		size_t coneHistogram[kNumConeBuckets] = {};
+		MeshletCullStats cullStats;     //64 orbit views, frustum and cone culling
+	};
+
+	//meshlets with their cull data and the vertices they index
+	MeshletQuality MeasureMeshletQuality(const XMFLOAT3* pPositions, size_t positionStride, size_t numVertices,
+		const MeshletData& data, const MeshletBuildOptions& options)
+	{
+		MeshletQuality quality;
+		quality.stats.maxVertices = options.maxVertices;
+		quality.stats.maxPrimitives = options.maxPrimitives;
+		quality.stats.numMeshlets = data.meshlets.size();
+
+		std::vector< uint8_t > used(numVertices, 0);
+		XMFLOAT3 minCorner(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 maxCorner(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		for (size_t m = 0; m < data.meshlets.size(); ++m)
+		{
+			const Meshlet& meshlet = data.meshlets[m];
+			const CullData& cull = data.cullData[m];
+			quality.stats.numMeshletVertices += meshlet.VertCount;
+			quality.stats.numTriangles += meshlet.PrimCount;
+
+			XMFLOAT3 meshletMin(FLT_MAX, FLT_MAX, FLT_MAX);
+			XMFLOAT3 meshletMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			float radius = cull.BoundingSphere.w;
+
+			for (uint32_t i = 0; i < meshlet.VertCount; ++i)
+			{
+				uint32_t vertex = data.uniqueVertexIndices[meshlet.VertOffset + i];
+				const XMFLOAT3& p = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(pPositions) + vertex * positionStride);
+				used[vertex] = 1;
+
+				meshletMin = XMFLOAT3(std::min(meshletMin.x, p.x), std::min(meshletMin.y, p.y), std::min(meshletMin.z, p.z));
+				meshletMax = XMFLOAT3(std::max(meshletMax.x, p.x), std::max(meshletMax.y, p.y), std::max(meshletMax.z, p.z));
+
+				float dx = p.x - cull.BoundingSphere.x;
+				float dy = p.y - cull.BoundingSphere.y;
+				float dz = p.z - cull.BoundingSphere.z;
+				quality.numOutsideSphere += dx * dx + dy * dy + dz * dz > radius * radius * 1.0001f + 1e-12f ? 1 : 0;
+			}
+
+			if (meshlet.VertCount)
+			{
+				minCorner = XMFLOAT3(std::min(minCorner.x, meshletMin.x), std::min(minCorner.y, meshletMin.y), std::min(minCorner.z, meshletMin.z));
+				maxCorner = XMFLOAT3(std::max(maxCorner.x, meshletMax.x), std::max(maxCorner.y, meshletMax.y), std::max(maxCorner.z, meshletMax.z));
+
+				float dx = meshletMax.x - meshletMin.x;
+				float dy = meshletMax.y - meshletMin.y;
+				float dz = meshletMax.z - meshletMin.z;
+				float halfDiagonal = 0.5f * std::sqrt(dx * dx + dy * dy + dz * dz);
+				double ratio = halfDiagonal > 0.0f ? radius / halfDiagonal : 1.0;
+				quality.sphereToBoxMean += ratio;
+				quality.sphereToBoxMax = std::max(quality.sphereToBoxMax, ratio);
+			}
+
+			// the cone cutoff is sin of the half angle, see DXMeshletBuilder::ComputeCullData
+			if (DXMeshletCuller::IsConeDegenerate(cull))
+			{
+				quality.coneHistogram[kNumConeBuckets - 1]++;
+			}
+			else
+			{
+				float halfAngle = std::asin(std::min(cull.NormalCone[3] / 255.0f, 1.0f)) * 180.0f / XM_PI;
+				quality.coneHistogram[std::min(static_cast<int>(halfAngle / 15.0f), kNumConeBuckets - 2)]++;
+			}
+		}
+
+		quality.sphereToBoxMean = data.meshlets.empty() ? 0.0 : quality.sphereToBoxMean / data.meshlets.size();
+		for (uint8_t bUsed : used)
+		{
+			quality.numUniqueVertices += bUsed;
+		}
+
+		if (!data.meshlets.empty())
+		{
+			XMFLOAT3 center((minCorner.x + maxCorner.x) * 0.5f, (minCorner.y + maxCorner.y) * 0.5f, (minCorner.z + maxCorner.z) * 0.5f);
+			float dx = maxCorner.x - minCorner.x;
+			float dy = maxCorner.y - minCorner.y;
+			float dz = maxCorner.z - minCorner.z;
+			float radius = std::max(0.5f * std::sqrt(dx * dx + dy * dy + dz * dz), 1e-6f);
+
+			size_t mismatches = 0;
+			quality.cullStats = CullOrbitViews(data.cullData, center, radius, DXMeshletCuller::kCullAll, mismatches);
+		}
+
+		return quality;
+	}
+
+	void WriteMeshletQuality(JsonWriter& json, const char* key, const MeshletQuality& quality, double buildMs)
+	{
+		const MeshletStats& stats = quality.stats;
+
+		json.BeginObject(key);
+		json.Write("meshlets", stats.numMeshlets);
+		json.Write("triangles", stats.numTriangles);
+		json.Write("vertexFill", stats.GetVertexFill());
+		json.Write("primitiveFill", stats.GetPrimitiveFill());
+		json.Write("vertexDuplication", quality.numUniqueVertices ? double(stats.numMeshletVertices) / quality.numUniqueVertices : 0.0);
+		json.Write("sphereToBoxMean", quality.sphereToBoxMean);
+		json.Write("sphereToBoxMax", quality.sphereToBoxMax);
+		json.Write("verticesOutsideSphere", quality.numOutsideSphere);
+
+		json.BeginArray("coneHalfAngleHistogram");
+		for (int i = 0; i < kNumConeBuckets; ++i)
+		{
+			json.Write(nullptr, quality.coneHistogram[i]);
+		}
+		json.EndArray();
+
+		json.Write("visibleRate", quality.cullStats.GetVisibleRate());
+		json.Write("frustumCulledRate", quality.cullStats.GetFrustumCulledRate());
+		json.Write("coneCulledRate", quality.cullStats.GetConeCulledRate());
+		json.Write("cullNsPerMeshlet", quality.cullStats.numMeshlets ? quality.cullStats.cullMs * 1.0e6 / quality.cullStats.numMeshlets : 0.0);
+		if (buildMs >= 0.0)
+		{
+			json.Write("buildMs", buildMs);
+		}
+		json.EndObject();
+	}
+
+	void LogMeshletQuality(const char* label, const MeshletQuality& quality)
+	{
+		LogMeshletStats(label, quality.stats);
+		DXAssetBenchmarks::Log("              duplication %.2f  sphere / box %.3f (max %.3f)  %zu outside  cones",
+			quality.numUniqueVertices ? double(quality.stats.numMeshletVertices) / quality.numUniqueVertices : 0.0,
+			quality.sphereToBoxMean, quality.sphereToBoxMax, quality.numOutsideSphere);
+		for (int i = 0; i < kNumConeBuckets; ++i)
+		{
+			DXAssetBenchmarks::Log(" %zu", quality.coneHistogram[i]);
+		}
+		DXAssetBenchmarks::Log("  %.1f%% culled\n", 100.0f - quality.cullStats.GetVisibleRate() * 100.0f);
+	}
+
+	//point i of the synthetic cloud, the same every time so a loaded file can be checked without keeping the source
+	void GetSyntheticPoint(size_t i, vec3& out_position, vec4& out_color)
+	{
+		uint32_t hash = static_cast<uint32_t>(i) * 2654435761u ^ static_cast<uint32_t>(i >> 32);
+		hash ^= hash >> 15;
+		hash *= 2246822519u;
+		hash ^= hash >> 13;
+
+		out_position = vec3{ (hash & 0x3ff) * 0.01f, ((hash >> 10) & 0x3ff) * 0.01f, static_cast<float>(i) * 1.0e-6f };
+		out_color = vec4{ static_cast<float>(hash >> 24), static_cast<float>((hash >> 16) & 0xff), static_cast<float>(i & 0xff), 255.0f };
+	}
+
+	//point i of a synthetic terrain scan, a height field over a 100 x 100 square.  unlike GetSyntheticPoint the points
+	//lie on a surface, like the points of a scan.
+	DirectX::XMFLOAT3 GetSyntheticTerrainPoint(size_t i)
+	{
+		uint64_t hash = (static_cast<uint64_t>(i) + 1) * 0x9e3779b97f4a7c15ull;
+		hash ^= hash >> 31;
+		hash *= 0xbf58476d1ce4e5b9ull;
+		hash ^= hash >> 29;
+
+		float x = (hash & 0xffffff) * (100.0f / 16777216.0f);
+		float z = ((hash >> 24) & 0xffffff) * (100.0f / 16777216.0f);
+		float y = 3.0f * std::sin(x * 0.3f) * std::cos(z * 0.2f) + 0.5f * std::sin(x * 2.1f + z * 1.3f);
+		return DirectX::XMFLOAT3(x, y, z);
+	}
+
+	float GetDistanceSq(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		float x = a.x - b.x;
+		float y = a.y - b.y;
+		float z = a.z - b.z;
+		return x * x + y * y + z * z;
+	}
+
+	//points of order that are nearer to the eye than the next point, 0 for a back to front order
+	size_t CountDepthOrderErrors(const std::vector< CloudVertexPosColor >& points, const std::vector< uint32_t >& order,
+		const DirectX::XMFLOAT3& eye)
+	{
+		if (order.size() != points.size())
+			return points.size();
+
+		size_t errors = 0;
+		for (size_t i = 1; i < order.size(); ++i)
+		{
+			errors += GetDistanceSq(points[order[i - 1]].Pos, eye) < GetDistanceSq(points[order[i]].Pos, eye) ? 1 : 0;
+		}
+		return errors;
+	}
+
+	bool IsSamePlyData(const PlyPointData& a, const PlyPointData& b)
+	{
+		auto isSame = [](const auto& x, const auto& y)
+		{
+			return x.size() == y.size() && (x.empty() || memcmp(x.data(), y.data(), x.size() * sizeof(x[0])) == 0);
+		};
+		return isSame(a.positions, b.positions) && isSame(a.colors, b.colors) && isSame(a.normals, b.normals) &&
+			isSame(a.intensities, b.intensities);
+	}
+
+	size_t CountSyntheticMismatches(const PlyPointData& data, size_t numPoints)
+	{
+		if (data.GetPointCount() != numPoints)
+			return numPoints;
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			vec3 position;
+			vec4 color;
+			GetSyntheticPoint(i, position, color);
+
+			const vec3& p = data.positions[i];
+			const vec4& c = data.colors[i];
+			if (p.x != position.x || p.y != position.y || p.z != position.z ||
+				c.x != color.x || c.y != color.y || c.z != color.z || c.w != color.w)
+			{
+				mismatches++;
+			}
+		}
+		return mismatches;
+	}
+}
+
+namespace DXAssetBenchmarks
+{
+	void Log(const char* format, ...)
+	{
+		char buffer[1024];
+
+		va_list args;
+		va_start(args, format);
+		vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+
+		printf("%s", buffer);
+		OutputDebugStringA(buffer);
+	}
+
+	std::string GetScratchFilePath(const char* filename)
+	{
+		char tempPath[MAX_PATH];
+		DWORD length = GetTempPathA(MAX_PATH, tempPath);
+		if (length == 0 || length > MAX_PATH)
+			return filename;
+
+		return std::string(tempPath) + filename;
+	}
+
+	void RunAll()
+	{
+		Log("---- OBJ load benchmark ----\n");
+		BenchmarkOBJLoad(kRobotOBJFile, 10);
+
+		Log("---- Vertex welding ----\n");
+		BenchmarkWeld(kRobotOBJFile);
+
+		Log("---- Vertex cache optimization ----\n");
+		BenchmarkMeshOptimizer(kRobotOBJFile);
+		BenchmarkMeshOptimizer(kTeapotOBJFile);
+
+		Log("---- Mesh cache cold / warm ----\n");
+		BenchmarkMeshCache(kModelDirectory);
+
+		Log("---- Vertex compression ----\n");
+		BenchmarkVertexCompression(kModelDirectory);
+
+		Log("---- LOD chain simplification, triangles (error / extent) per level ----\n");
+		BenchmarkMeshSimplifier(kModelDirectory);
+
+		Log("---- Load scratch arena ----\n");
+		BenchmarkLoadArena(kModelDirectory);
+
+		Log("---- Meshlet builder (64 vertices, 126 primitives) ----\n");
+		BenchmarkMeshletBuilder(kMeshletDirectory, kModelDirectory);
+
+		Log("---- Meshlet culling, 64 orbit views ----\n");
+		BenchmarkMeshletCulling(kMeshletDirectory, kModelDirectory);
+
+		Log("---- Meshlet pack (MSHL version 2) ----\n");
+		BenchmarkMeshletPack(kMeshletDirectory, kMeshletPackBytes);
+
+		Log("---- Upload planner, 1 / 10 / %zu meshes on the null device ----\n", kUploadMeshCount);
+		BenchmarkUploadPlanner(kUploadMeshCount);
+
+		Log("---- Meshlet DAG, 1 pixel error at 1080p ----\n");
+		BenchmarkMeshletDAG(kModelDirectory);
+
+		Log("---- Meshlet vertex compression, position / normal bits ----\n");
+		BenchmarkMeshletCompression(kMeshletDirectory);
+
+		RunMeshletReport();
+
+		Log("---- PLY load, ascii / binary little and big endian ----\n");
+		BenchmarkPLYLoad(kPointCloudDirectory, kSyntheticPointCount);
+
+		Log("---- ASCII PLY parse thread scaling ----\n");
+		BenchmarkPLYParseScaling(kTestPointCloudFile);
+
+		Log("---- Point cloud depth sort ----\n");
+		BenchmarkPointSort(kSortPointCount);
+
+		Log("---- Point cloud chunk culling, %u points per chunk ----\n", DXPointChunks::kDefaultChunkSize);
+		BenchmarkPointChunkCulling(kTestPointCloudFile, kChunkPointCount);
+
+		Log("---- Point cloud LOD octree ----\n");
+		BenchmarkPointOctree(kOctreePointCount);
+
+		Log("---- Point cloud streaming, paged octree ----\n");
+		BenchmarkPointStreaming(kStreamPointCount);
+
+		Log("---- Point cloud vertex compression ----\n");
+		BenchmarkPointCompression(kCompressionPointCount);
+
+		Log("---- Point cloud downsampling ----\n");
+		BenchmarkPointDownsample(kDownsamplePointCount);
+
+		std::string syntheticCloudPath = GetScratchFilePath("dx12_synthetic_cloud.ply");
+		if (WriteSyntheticPLY(syntheticCloudPath.c_str(), kSyntheticAsciiPointCount, kPlyFormatAscii))
+		{
+			BenchmarkPLYParseScaling(syntheticCloudPath.c_str());
+			DeleteFileA(syntheticCloudPath.c_str());
+		}
+
+		std::string syntheticPath = GetScratchFilePath("dx12_synthetic_grid.obj");
+		if (WriteSyntheticGridOBJ(syntheticPath.c_str(), kSyntheticTriangleCount))
+		{
+			BenchmarkOBJLoad(syntheticPath.c_str(), 1);
+
+			Log("---- OBJ parse thread scaling ----\n");
+			BenchmarkOBJParseScaling(syntheticPath.c_str());
+
+			Log("---- Vertex welding ----\n");
+			BenchmarkWeld(syntheticPath.c_str());
+
+			Log("---- Vertex cache optimization ----\n");
+			BenchmarkMeshOptimizer(syntheticPath.c_str());
+			DeleteFileA(syntheticPath.c_str());
+		}
+	}
+
+	void RunMeshletReport()
+	{
+		Log("---- Meshlet quality report ----\n");
+		BenchmarkMeshletQuality(kMeshletDirectory, kModelDirectory, kMeshletReportFile);
+	}
+
+	void BenchmarkOBJLoad(const char* path, int numIterations)
+	{
+		Log("%s (%.1f MB)\n", path, GetFileSizeBytes(path) / (1024.0 * 1024.0));
+
+		// The fast path runs first so the peak working set it reports is not inflated by the reference loader.
+		double fastMs = 0.0;
+		size_t fastTriangles = 0;
+		std::vector< vec3 > fastVertices, fastNormals;
+		std::vector< vec2 > fastUVs;
+
+		for (int i = 0; i < numIterations; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+
+			ObjMeshData objData;
+			bool bLoaded = DXObjParser::ParseFile(path, objData, false, 1);
+			DXObjParser::ExpandCorners(objData, fastVertices, fastUVs, fastNormals);
+
+			fastMs += GetElapsedMs(start);
+			fastTriangles = objData.GetTriangleCount();
+
+			if (!bLoaded)
+			{
+				Log("  failed to parse %s\n", path);
+				return;
+			}
+		}
+		size_t fastPeakMB = GetPeakWorkingSetMB();
+
+		double referenceMs = 0.0;
+		std::vector< vec3 > refVertices, refNormals;
+		std::vector< vec2 > refUVs;
+
+		for (int i = 0; i < numIterations; ++i)
+		{
+			refVertices.clear(); refUVs.clear(); refNormals.clear();
+
+			auto start = std::chrono::high_resolution_clock::now();
+			ParseFileReference(path, refVertices, refUVs, refNormals, false);
+			referenceMs += GetElapsedMs(start);
+		}
+		size_t referencePeakMB = GetPeakWorkingSetMB();
+
+		// the reference loader only reads the first triangle of a polygon so only compare triangle meshes
+		bool bIdentical = refVertices.size() == fastVertices.size() &&
+			memcmp(refVertices.data(), fastVertices.data(), refVertices.size() * sizeof(vec3)) == 0 &&
+			memcmp(refUVs.data(), fastUVs.data(), refUVs.size() * sizeof(vec2)) == 0 &&
+			memcmp(refNormals.data(), fastNormals.data(), refNormals.size() * sizeof(vec3)) == 0;
+
+		fastMs /= numIterations;
+		referenceMs /= numIterations;
+
+		Log("  triangles %zu\n", fastTriangles);
+		Log("  sscanf_s reference  %10.2f ms  peak working set %zu MB\n", referenceMs, referencePeakMB);
+		Log("  memory mapped       %10.2f ms  peak working set %zu MB\n", fastMs, fastPeakMB);
+		Log("  speedup %.1fx  output %s\n", fastMs > 0.0 ? referenceMs / fastMs : 0.0, bIdentical ? "identical" : "DIFFERS");
+	}
+
+	void BenchmarkOBJParseScaling(const char* path)
+	{
+		DXMemoryMappedFile file;
+		if (!file.Open(path))
+		{
+			Log("  failed to open %s\n", path);
+			return;
+		}
+
+		// touch every page once so the first run does not pay for the page faults
+		volatile char touch = 0;
+		for (size_t i = 0; i < file.GetSize(); i += 4096)
+		{
+			touch += file.GetData()[i];
+		}
+
+		ObjMeshData serialData;
+		auto serialStart = std::chrono::high_resolution_clock::now();
+		DXObjParser::ParseBuffer(file.GetData(), file.GetEnd(), serialData, false, 1);
+		double serialMs = GetElapsedMs(serialStart);
+
+		Log("  threads %2u  %10.2f ms\n", 1, serialMs);
+
+		uint32_t maxThreads = std::max(DXParallel::GetWorkerCount(), 8u);
+		for (uint32_t numThreads = 2; numThreads <= maxThreads; numThreads *= 2)
+		{
+			ObjMeshData parallelData;
+			auto start = std::chrono::high_resolution_clock::now();
+			DXObjParser::ParseBuffer(file.GetData(), file.GetEnd(), parallelData, false, numThreads);
+			double parallelMs = GetElapsedMs(start);
+
+			bool bIdentical = IsSameObjData(serialData, parallelData);
+
+			Log("  threads %2u  %10.2f ms  speedup %.2fx  output %s\n", numThreads, parallelMs,
+				parallelMs > 0.0 ? serialMs / parallelMs : 0.0, bIdentical ? "identical" : "DIFFERS");
+		}
+	}
+
+	void BenchmarkWeld(const char* path)
+	{
+		ObjMeshData objData;
+		if (!DXObjParser::ParseFile(path, objData, false))
+		{
+			Log("  failed to parse %s\n", path);
+			return;
+		}
+
+		std::vector< MeshVertexPosNormUV0 > cornerVertices;
+		DXObjParser::ExpandCorners(objData, cornerVertices);
+
+		WeldOptions quantized;
+		quantized.positionEpsilon = 1e-5f;
+		quantized.normalEpsilon = 1e-3f;
+		quantized.uvEpsilon = 1e-5f;
+
+		const WeldOptions* options[] = { &kExactWeld, &quantized };
+		const char* names[] = { "exact", "quantized" };
+
+		for (int i = 0; i < 2; ++i)
+		{
+			std::vector< MeshVertexPosNormUV0 > vertices;
+			std::vector< uint32_t > indices;
+			WeldStats stats;
+			DXMeshWelder::WeldVertices(cornerVertices.data(), cornerVertices.size(), *options[i], vertices, indices, &stats);
+
+			size_t unindexedBytes = cornerVertices.size() * sizeof(MeshVertexPosNormUV0);
+			size_t indexedBytes = vertices.size() * sizeof(MeshVertexPosNormUV0) + indices.size() * sizeof(uint32_t);
+
+			Log("  %-9s %zu -> %zu vertices  ratio %.2fx  %8.2f ms  vb+ib %.1f MB -> %.1f MB\n", names[i],
+				stats.numInputVertices, stats.numOutputVertices, stats.GetReductionRatio(), stats.weldMs,
+				unindexedBytes / (1024.0 * 1024.0), indexedBytes / (1024.0 * 1024.0));
+		}
+	}
+
+	void BenchmarkMeshOptimizer(const char* path)
+	{
+		ObjMeshData objData;
+		if (!DXObjParser::ParseFile(path, objData, false))
+		{
+			Log("  failed to parse %s\n", path);
+			return;
+		}
+
+		std::vector< MeshVertexPosNormUV0 > cornerVertices;
+		DXObjParser::ExpandCorners(objData, cornerVertices);
+
+		std::vector< MeshVertexPosNormUV0 > vertices;
+		std::vector< uint32_t > indices;
+		DXMeshWelder::WeldVertices(cornerVertices.data(), cornerVertices.size(), kExactWeld, vertices, indices);
+
+		Log("%s  %zu triangles  %zu vertices\n", path, indices.size() / 3, vertices.size());
+
+		std::vector< uint32_t > cacheOrdered(indices.size());
+		auto start = std::chrono::high_resolution_clock::now();
+		DXMeshOptimizer::OptimizeVertexCache(cacheOrdered.data(), indices.data(), indices.size(), vertices.size());
+		double vertexCacheMs = GetElapsedMs(start);
+
+		std::vector< MeshVertexPosNormUV0 > optimizedVertices = vertices;
+		std::vector< uint32_t > optimizedIndices = indices;
+		MeshOptimizeStats stats;
+		DXMeshOptimizer::OptimizeMesh(optimizedVertices, optimizedIndices, &stats);
+
+		const std::vector< uint32_t >* orders[] = { &indices, &cacheOrdered, &optimizedIndices };
+		const char* names[] = { "source", "vertex cache", "+overdraw+fetch" };
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const std::vector< uint32_t >& order = *orders[i];
+
+			VertexCacheStats fifo16 = DXMeshOptimizer::AnalyzeVertexCache(order.data(), order.size(), vertices.size(), 16, kVertexCacheFIFO);
+			VertexCacheStats fifo32 = DXMeshOptimizer::AnalyzeVertexCache(order.data(), order.size(), vertices.size(), 32, kVertexCacheFIFO);
+			VertexCacheStats lru16 = DXMeshOptimizer::AnalyzeVertexCache(order.data(), order.size(), vertices.size(), 16, kVertexCacheLRU);
+
+			Log("  %-16s FIFO16 acmr %.3f atvr %.3f  FIFO32 acmr %.3f atvr %.3f  LRU16 acmr %.3f atvr %.3f\n", names[i],
+				fifo16.acmr, fifo16.atvr, fifo32.acmr, fifo32.atvr, lru16.acmr, lru16.atvr);
+		}
+
+		Log("  vertex cache pass %.2f ms, all passes %.2f ms\n", vertexCacheMs, stats.optimizeMs);
+	}
+
+	void BenchmarkMeshCache(const char* directory)
+	{
+		std::vector< std::string > paths = FindOBJFiles(directory);
+
+		double totalColdMs = 0.0;
+		double totalWarmMs = 0.0;
+
+		for (const std::string& path : paths)
+		{
+			DeleteFileA(DXMeshCache::GetCachePath(path.c_str()).c_str());
+
+			DXMesh coldMesh;
+			DXMeshData coldData;
+			auto coldStart = std::chrono::high_resolution_clock::now();
+			bool bLoaded = coldMesh.LoadMeshData(path.c_str(), false, coldData);
+			double coldMs = GetElapsedMs(coldStart);
+
+			if (!bLoaded)
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			DXMesh warmMesh;
+			DXMeshData warmData;
+			auto warmStart = std::chrono::high_resolution_clock::now();
+			warmMesh.LoadMeshData(path.c_str(), false, warmData);
+			double warmMs = GetElapsedMs(warmStart);
+
+			bool bIdentical = warmData.bFromCache &&
+				warmData.numVertices == coldData.numVertices && warmData.numIndices == coldData.numIndices &&
+				memcmp(warmData.pVertices, coldData.pVertices, coldData.numVertices * sizeof(MeshVertexPosNormUV0)) == 0 &&
+				memcmp(warmData.pIndices, coldData.pIndices, coldData.numIndices * sizeof(uint32_t)) == 0;
+
+			totalColdMs += coldMs;
+			totalWarmMs += warmMs;
+
+			Log("  %-28s %8zu tris  cold %9.2f ms  warm %8.2f ms  %6.1fx  %s\n", path.c_str() + strlen(directory),
+				coldData.numIndices / 3, coldMs, warmMs, warmMs > 0.0 ? coldMs / warmMs : 0.0,
+				bIdentical ? "identical" : (warmData.bFromCache ? "DIFFERS" : "NOT CACHED"));
+		}
+
+		Log("  total %zu files  cold %.2f ms  warm %.2f ms\n", paths.size(), totalColdMs, totalWarmMs);
+	}
+
+	void BenchmarkVertexCompression(const char* directory)
+	{
+		const MeshVertexFormat formats[] = { kMeshVertexFormatCompact16, kMeshVertexFormatCompact12 };
+
+		size_t totalSourceBytes = 0;
+		size_t totalCompressedBytes[2] = { 0, 0 };
+
+		for (const std::string& path : FindOBJFiles(directory))
+		{
+			DXMesh mesh;
+			DXMeshData meshData;
+			if (!mesh.LoadMeshData(path.c_str(), false, meshData))
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			VertexQuantization quantization = DXVertexCompression::ComputeQuantization(meshData.bounds);
+			totalSourceBytes += meshData.numVertices * sizeof(MeshVertexPosNormUV0);
+
+			Log("  %-28s %8zu verts  %10zu bytes\n", path.c_str() + strlen(directory), meshData.numVertices,
+				meshData.numVertices * sizeof(MeshVertexPosNormUV0));
+
+			for (int i = 0; i < 2; ++i)
+			{
+				std::vector< uint8_t > bytes;
+				VertexCompressionStats stats;
+				DXVertexCompression::EncodeVertices(meshData.pVertices, meshData.numVertices, formats[i], quantization, bytes, &stats);
+
+				totalCompressedBytes[i] += stats.compressedBytes;
+
+				// the position error is also given relative to the largest extent of the bounds
+				const XMFLOAT3& extent = quantization.positionScale;
+				float maxExtent = std::max(std::max(extent.x, extent.y), extent.z);
+
+				Log("    %2u byte  %10zu bytes  pos %.2e (%.2e of extent)  normal %6.3f deg  uv %.2e  encode %7.2f ms  decode %7.2f ms\n",
+					DXVertexCompression::GetVertexStride(formats[i]), stats.compressedBytes, stats.maxPositionError,
+					maxExtent > 0.0f ? stats.maxPositionError / maxExtent : 0.0f, stats.maxNormalErrorDegrees, stats.maxUVError,
+					stats.encodeMs, stats.decodeMs);
+			}
+		}
+
+		Log("  total  32 byte %zu bytes  16 byte %zu bytes  12 byte %zu bytes\n", totalSourceBytes,
+			totalCompressedBytes[0], totalCompressedBytes[1]);
+	}
+
+	void BenchmarkMeshSimplifier(const char* directory)
+	{
+		std::vector< std::string > paths = FindOBJFiles(directory);
+
+		// keep every mesh loaded, the jobs point into the mesh data
+		std::vector< DXMeshData > meshes(paths.size());
+		std::vector< LODChainJob > jobs;
+		std::vector< std::string > names;
+
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			DXMesh mesh;
+			if (!mesh.LoadMeshData(paths[i].c_str(), false, meshes[i]))
+			{
+				Log("  failed to load %s\n", paths[i].c_str());
+				continue;
+			}
+
+			LODChainJob job;
+			job.pVertices = meshes[i].pVertices;
+			job.numVertices = meshes[i].numVertices;
+			job.pIndices = meshes[i].pIndices;
+			job.numIndices = meshes[i].numIndices;
+			jobs.push_back(job);
+			names.push_back(paths[i].substr(strlen(directory)));
+		}
+
+		LODChainOptions options;
+		options.numLODs = DXMeshSimplifier::kMaxLODs;
+
+		auto serialStart = std::chrono::high_resolution_clock::now();
+		DXMeshSimplifier::BuildLODChains(jobs, options, 1);
+		double serialMs = GetElapsedMs(serialStart);
+
+		for (size_t i = 0; i < jobs.size(); ++i)
+		{
+			const LODChainJob& job = jobs[i];
+			const DXMeshData& mesh = meshes[i];
+
+			float extent = std::max(std::max(mesh.bounds.mMax.x - mesh.bounds.mMin.x, mesh.bounds.mMax.y - mesh.bounds.mMin.y),
+				mesh.bounds.mMax.z - mesh.bounds.mMin.z);
+
+			Log("  %-28s %7.2f ms ", names[i].c_str(), job.buildMs);
+			for (const MeshLODLevel& level : job.lods)
+			{
+				Log(" %7zu (%.4f)", level.indices.size() / 3, extent > 0.0f ? level.error / extent : 0.0f);
+			}
+			Log("\n");
+		}
+
+		uint32_t numThreads = DXParallel::GetWorkerCount();
+		auto parallelStart = std::chrono::high_resolution_clock::now();
+		DXMeshSimplifier::BuildLODChains(jobs, options, numThreads);
+		double parallelMs = GetElapsedMs(parallelStart);
+
+		Log("  %zu meshes  1 thread %.2f ms  %u threads %.2f ms  %.1fx\n", jobs.size(), serialMs, numThreads, parallelMs,
+			parallelMs > 0.0 ? serialMs / parallelMs : 0.0);
+	}
+
+	void BenchmarkLoadArena(const char* directory)
+	{
+		std::vector< std::string > paths = FindOBJFiles(directory);
+
+		for (const std::string& path : paths)
+		{
+			// cache off so every load parses and welds.  the first load sizes the arena block, the second reuses it.
+			DXLoadArenaStats loadStats[2];
+			double loadMs[2] = {};
+			bool bLoaded = true;
+
+			for (int i = 0; i < 2 && bLoaded; ++i)
+			{
+				DXMesh mesh;
+				mesh.SetUseMeshCache(false);
+				DXMeshData data;
+
+				auto start = std::chrono::high_resolution_clock::now();
+				bLoaded = mesh.LoadMeshData(path.c_str(), false, data);
+				loadMs[i] = GetElapsedMs(start);
+				loadStats[i] = mesh.GetLoadStats().scratchStats;
+			}
+
+			if (!bLoaded)
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			Log("  %-28s %6zu allocs %8.2f MB  first load %zu heap blocks %8.2f ms  second load %zu heap blocks %8.2f ms\n",
+				path.c_str() + strlen(directory), loadStats[1].numAllocations, loadStats[1].bytesAllocated / (1024.0 * 1024.0),
+				loadStats[0].numHeapAllocations, loadMs[0], loadStats[1].numHeapAllocations, loadMs[1]);
+		}
+
+		Log("  arena keeps %.2f MB between loads\n", DXLoadArena::GetThreadArena().GetBytesReserved() / (1024.0 * 1024.0));
+	}
+
+	void BenchmarkMeshletBuilder(const char* meshletDirectory, const char* objDirectory)
+	{
+		MeshletBuildOptions options;
+		uint32_t numThreads = DXParallel::GetWorkerCount();
+
+		// the shipped files keep their index and vertex buffers, so the same triangles can be meshletized again
+		for (const std::string& path : FindFiles(meshletDirectory, ".bin"))
+		{
+			MeshShaderModel model;
+			std::wstring widePath(path.begin(), path.end());
+			if (FAILED(model.LoadFromFile(widePath.c_str())))
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			for (uint32_t m = 0; m < model.GetMeshCount(); ++m)
+			{
+				const Mesh& mesh = model.GetMesh(m);
+				const DirectX::XMFLOAT3* pPositions;
+				size_t positionStride;
+				if (!DXMeshletBuilder::GetPositions(mesh, pPositions, positionStride))
+				{
+					Log("  %s mesh %u: no float3 position\n", path.c_str(), m);
+					continue;
+				}
+
+				std::vector< uint32_t > indices = ReadIndices(mesh.Indices.data(), mesh.IndexSize, mesh.IndexCount);
+
+				MeshletStats shipped;
+				shipped.maxVertices = options.maxVertices;
+				shipped.maxPrimitives = options.maxPrimitives;
+				shipped.numMeshlets = mesh.Meshlets.size();
+				for (uint32_t i = 0; i < mesh.Meshlets.size(); ++i)
+				{
+					shipped.numMeshletVertices += mesh.Meshlets[i].VertCount;
+					shipped.numTriangles += mesh.Meshlets[i].PrimCount;
+				}
+
+				std::vector< Subset > indexSubsets(mesh.IndexSubsets.data(), mesh.IndexSubsets.data() + mesh.IndexSubsets.size());
+
+				MeshletData data;
+				MeshletStats built;
+				DXMeshletBuilder::BuildMeshlets(pPositions, positionStride, mesh.VertexCount, indices.data(),
+					indices.size(), indexSubsets, options, data, &built);
+
+				Log("  %-16s mesh %u  %zu triangles  built in %.2f ms%s\n", path.c_str() + strlen(meshletDirectory), m,
+					indices.size() / 3, built.buildMs, IsValidMeshletCover(indices.data(), indices.size(), data, options) ? "" : "  INVALID");
+				LogMeshletStats("shipped", shipped);
+				LogMeshletStats("built", built);
+			}
+		}
+
+		// the obj models have no reference meshlets, they show the build time on one thread and on all cores
+		for (const std::string& path : FindOBJFiles(objDirectory))
+		{
+			DXMesh mesh;
+			mesh.SetOptimizeMesh(true);
+			DXMeshData meshData;
+			if (!mesh.LoadMeshData(path.c_str(), false, meshData))
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			std::vector< Subset > indexSubsets;
+			for (const MeshCacheSubmesh& submesh : meshData.submeshes)
+			{
+				indexSubsets.push_back({ submesh.startIndex, submesh.indexCount });
+			}
+
+			MeshletData data;
+			MeshletStats serial, parallel;
+			DXMeshletBuilder::BuildMeshlets(&meshData.pVertices[0].position, sizeof(MeshVertexPosNormUV0), meshData.numVertices,
+				meshData.pIndices, meshData.numIndices, indexSubsets, options, data, &serial, 1);
+			DXMeshletBuilder::BuildMeshlets(&meshData.pVertices[0].position, sizeof(MeshVertexPosNormUV0), meshData.numVertices,
+				meshData.pIndices, meshData.numIndices, indexSubsets, options, data, &parallel, numThreads);
+
+			Log("  %-28s %8zu triangles %3zu subsets  1 thread %8.2f ms  %u threads %8.2f ms%s\n", path.c_str() + strlen(objDirectory),
+				meshData.numIndices / 3, indexSubsets.size(), serial.buildMs, numThreads, parallel.buildMs,
+				IsValidMeshletCover(meshData.pIndices, meshData.numIndices, data, options) ? "" : "  INVALID");
+			LogMeshletStats("built", parallel);
+		}
+	}
+
+	void BenchmarkMeshletCulling(const char* meshletDirectory, const char* objDirectory)
+	{
+		size_t mismatches = 0;
+
+		for (const std::string& path : FindFiles(meshletDirectory, ".bin"))
+		{
+			MeshShaderModel model;
+			std::wstring widePath(path.begin(), path.end());
+			if (FAILED(model.LoadFromFile(widePath.c_str())))
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			for (uint32_t m = 0; m < model.GetMeshCount(); ++m)
+			{
+				const Mesh& mesh = model.GetMesh(m);
+				const DirectX::XMFLOAT3* pPositions;
+				size_t positionStride;
+				if (!DXMeshletBuilder::GetPositions(mesh, pPositions, positionStride))
+					continue;
+
+				// the cull data of the converter against the cull data generated here for the same meshlets
+				std::vector< CullData > shipped(mesh.CullingData.data(), mesh.CullingData.data() + mesh.CullingData.size());
+				std::vector< CullData > generated;
+
+				auto start = std::chrono::high_resolution_clock::now();
+				DXMeshletBuilder::ComputeCullData(pPositions, positionStride, GetMeshletData(mesh), generated);
+				double generateMs = GetElapsedMs(start);
+
+				double shippedRadius = 0.0;
+				double generatedRadius = 0.0;
+				for (size_t i = 0; i < shipped.size(); ++i)
+				{
+					shippedRadius += shipped[i].BoundingSphere.w;
+					generatedRadius += generated[i].BoundingSphere.w;
+				}
+
+				Log("  %-16s mesh %u  %zu meshlets  cull data in %.2f ms  sphere radius %.3f of the shipped\n",
+					path.c_str() + strlen(meshletDirectory), m, shipped.size(), generateMs,
+					shippedRadius > 0.0 ? generatedRadius / shippedRadius : 0.0);
+
+				XMFLOAT3 center(mesh.BoundingSphere.Center.x, mesh.BoundingSphere.Center.y, mesh.BoundingSphere.Center.z);
+				MeshletCullStats stats = CullOrbitViews(shipped, center, mesh.BoundingSphere.Radius, DXMeshletCuller::kCullAll, mismatches);
+				LogCullStats("shipped", stats, mismatches);
+				stats = CullOrbitViews(generated, center, mesh.BoundingSphere.Radius, DXMeshletCuller::kCullAll, mismatches);
+				LogCullStats("generated", stats, mismatches);
+			}
+		}
+
+		for (const std::string& path : FindOBJFiles(objDirectory))
+		{
+			DXMesh mesh;
+			mesh.SetOptimizeMesh(true);
+			DXMeshData meshData;
+			if (!mesh.LoadMeshData(path.c_str(), false, meshData))
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			std::vector< Subset > indexSubsets;
+			for (const MeshCacheSubmesh& submesh : meshData.submeshes)
+			{
+				indexSubsets.push_back({ submesh.startIndex, submesh.indexCount });
+			}
+
+			MeshletData data;
+			DXMeshletBuilder::BuildMeshlets(&meshData.pVertices[0].position, sizeof(MeshVertexPosNormUV0), meshData.numVertices,
+				meshData.pIndices, meshData.numIndices, indexSubsets, MeshletBuildOptions(), data);
+
+			XMFLOAT3 center((meshData.bounds.mMin.x + meshData.bounds.mMax.x) * 0.5f, (meshData.bounds.mMin.y + meshData.bounds.mMax.y) * 0.5f,
+				(meshData.bounds.mMin.z + meshData.bounds.mMax.z) * 0.5f);
+			float radius = 0.0f;
+			for (const CullData& cull : data.cullData)
+			{
+				float dx = cull.BoundingSphere.x - center.x;
+				float dy = cull.BoundingSphere.y - center.y;
+				float dz = cull.BoundingSphere.z - center.z;
+				radius = std::max(radius, std::sqrt(dx * dx + dy * dy + dz * dz) + cull.BoundingSphere.w);
+			}
+
+			Log("  %-28s %zu meshlets\n", path.c_str() + strlen(objDirectory), data.meshlets.size());
+			MeshletCullStats stats = CullOrbitViews(data.cullData, center, radius, DXMeshletCuller::kCullFrustum, mismatches);
+			LogCullStats("frustum", stats, mismatches);
+			stats = CullOrbitViews(data.cullData, center, radius, DXMeshletCuller::kCullAll, mismatches);
+			LogCullStats("all", stats, mismatches);
+		}
+	}
+
+	void BenchmarkMeshletPack(const char* meshletDirectory, uint64_t packBytes)
+	{
+		// every mesh of the shipped files as a version 2 block, repeated until the pack has the requested size
+		std::vector< std::vector< uint8_t > > blocks;
+		std::vector< MeshletFile::MeshEntry > blockEntries;
+
+		for (const std::string& path : FindFiles(meshletDirectory, ".bin"))
+		{
+			DXMemoryMappedFile mapped;
+			if (!mapped.Open(path.c_str()))
+				continue;
+
+			std::vector< uint8_t > file(mapped.GetData(), mapped.GetEnd());
+			MeshletFile::FileHeader header;
+			memcpy(&header, file.data(), std::min(sizeof(header), file.size()));
+
+			for (uint32_t m = 0; file.size() >= sizeof(header) && m < header.MeshCount; ++m)
+			{
+				std::vector< uint8_t > block;
+				MeshletFile::MeshEntry entry;
+				if (DXMeshletBuilder::ExtractMeshBlock(file, m, block, entry))
+				{
+					blocks.push_back(std::move(block));
+					blockEntries.push_back(entry);
+				}
+			}
+		}
+
+		if (blocks.empty())
+		{
+			Log("  no meshes in %s\n", meshletDirectory);
+			return;
+		}
+
+		std::vector< uint32_t > blockIndices;
+		for (uint64_t size = 0; size < packBytes; )
+		{
+			uint32_t block = static_cast<uint32_t>(blockIndices.size() % blocks.size());
+			blockIndices.push_back(block);
+			size += (blockEntries[block].Size + MeshletFile::c_meshAlignment - 1) / MeshletFile::c_meshAlignment * MeshletFile::c_meshAlignment;
+		}
+
+		std::string packPath = GetScratchFilePath("dx12_meshlet_pack.bin");
+		auto writeStart = std::chrono::high_resolution_clock::now();
+		if (!DXMeshletBuilder::WriteMeshPack(packPath.c_str(), blocks, blockEntries, blockIndices))
+		{
+			Log("  failed to write %s\n", packPath.c_str());
+			return;
+		}
+		double writeMs = GetElapsedMs(writeStart);
+		double packMB = GetFileSizeBytes(packPath.c_str()) / (1024.0 * 1024.0);
+
+		Log("  %zu meshes  %.0f MB  written in %.0f ms\n", blockIndices.size(), packMB, writeMs);
+
+		// the old loader read the whole file into memory before looking at it
+		{
+			double workingSetBefore = GetWorkingSetMB();
+			auto readStart = std::chrono::high_resolution_clock::now();
+			std::ifstream stream(packPath, std::ios::binary | std::ios::ate);
+			std::vector< uint8_t > file(static_cast<size_t>(stream.tellg()));
+			stream.seekg(0, std::ios::beg);
+			stream.read(reinterpret_cast<char*>(file.data()), file.size());
+			Log("  read into memory   %8.2f ms  working set +%.0f MB\n", GetElapsedMs(readStart), GetWorkingSetMB() - workingSetBefore);
+		}
+
+		{
+			double workingSetBefore = GetWorkingSetMB();
+			MeshShaderModel model;
+			std::wstring widePackPath(packPath.begin(), packPath.end());
+
+			auto loadStart = std::chrono::high_resolution_clock::now();
+			HRESULT hr = model.LoadFromFile(widePackPath.c_str());
+			double loadMs = GetElapsedMs(loadStart);
+			if (FAILED(hr))
+			{
+				Log("  failed to load %s\n", packPath.c_str());
+			}
+			else
+			{
+				Log("  mapped             %8.2f ms  working set +%.0f MB  bounds radius %.2f\n", loadMs,
+					GetWorkingSetMB() - workingSetBefore, model.GetBoundingSphere().Radius);
+
+				// use one mesh in a hundred, touching every byte of it the way an upload would
+				size_t touchedBytes = 0;
+				uint32_t checksum = 0;
+				auto touchStart = std::chrono::high_resolution_clock::now();
+				for (uint32_t i = 0; i < model.GetMeshCount(); i += 100)
+				{
+					Mesh& mesh = model.GetMesh(i);
+					for (auto& vertices : mesh.Vertices)
+					{
+						for (size_t b = 0; b < vertices.size(); b += 64)
+						{
+							checksum += vertices[static_cast<uint32_t>(b)];
+						}
+						touchedBytes += vertices.size();
+					}
+					for (size_t m = 0; m < mesh.Meshlets.size(); ++m)
+					{
+						checksum += mesh.Meshlets[static_cast<uint32_t>(m)].PrimCount;
+					}
+					touchedBytes += mesh.Meshlets.size() * sizeof(Meshlet) + mesh.Indices.size() + mesh.PrimitiveIndices.size() * sizeof(PackedTriangle);
+				}
+
+				Log("  1%% of the meshes  %8.2f ms  working set +%.0f MB  (%.1f MB of mesh data, checksum %u)\n",
+					GetElapsedMs(touchStart), GetWorkingSetMB() - workingSetBefore, touchedBytes / (1024.0 * 1024.0), checksum);
+			}
+		}
+
+		DeleteFileA(packPath.c_str());
+	}
+
+	void BenchmarkUploadPlanner(size_t maxMeshes)
+	{
+		// the buffers of a meshlet mesh: indices, meshlets, cull data, unique vertex indices, primitives, the constant
+		// buffer of its MeshInfo and one vertex stream, a few KB to a few hundred KB each
+		const uint64_t kMeshBufferSizes[] = { 24 * 1024, 4 * 1024, 4 * 1024, 12 * 1024, 16 * 1024, 16, 96 * 1024 };
+		const size_t kMeshInfoBuffer = 5;
+		uint64_t maxMeshBytes = 0;
+		for (uint64_t size : kMeshBufferSizes)
+		{
+			maxMeshBytes += size + DXUploadPlanner::kConstantBufferAlignment;
+		}
+		std::vector< uint8_t > source(static_cast<size_t>(maxMeshBytes));
+		for (size_t i = 0; i < source.size(); ++i)
+		{
+			source[i] = static_cast<uint8_t>(i * 31);
+		}
+
+		struct UploadCase
+		{
+			size_t numMeshes;
+			uint64_t maxRingSize;
+		};
+		const UploadCase cases[] =
+		{
+			{ 1, DXUploadPlanner::kDefaultRingSize },
+			{ 10, DXUploadPlanner::kDefaultRingSize },
+			{ maxMeshes, DXUploadPlanner::kDefaultRingSize },
+			{ maxMeshes, 4ull << 20 },     //smaller than the data, split into batches
+		};
+
+		for (const UploadCase& uploadCase : cases)
+		{
+			DXUploadPlanner planner(uploadCase.maxRingSize);
+			for (size_t m = 0; m < uploadCase.numMeshes; ++m)
+			{
+				// sizes vary a little from mesh to mesh so the alignment padding differs
+				for (size_t b = 0; b < _countof(kMeshBufferSizes); ++b)
+				{
+					bool bMeshInfo = b == kMeshInfoBuffer;
+					uint64_t size = bMeshInfo ? kMeshBufferSizes[b] : kMeshBufferSizes[b] - (m * 4 + b) % 1024;
+					planner.AddBuffer(source.data(), size,
+						bMeshInfo ? D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER : D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+						bMeshInfo ? DXUploadPlanner::kConstantBufferAlignment : DXUploadPlanner::kDefaultAlignment);
+				}
+			}
+
+			auto planStart = std::chrono::high_resolution_clock::now();
+			planner.Plan();
+			double planMs = GetElapsedMs(planStart);
+
+			DXNullUploadDevice device;
+			auto executeStart = std::chrono::high_resolution_clock::now();
+			bool bExecuted = planner.Execute(device);
+			double executeMs = GetElapsedMs(executeStart);
+
+			// one submit (and one wait for the GPU) and one barrier call per batch, every byte copied once
+			bool bValid = bExecuted && device.IsValid() &&
+				device.numSubmits == planner.GetNumBatches() &&
+				device.numBarrierCalls == planner.GetNumBatches() &&
+				device.bytesCopied == planner.GetNumBytes() &&
+				device.numDestinations == planner.GetNumBuffers();
+
+			Log("  %5zu meshes  ring %4.0f MB max  %6zu buffers  %7.2f MB  %3u batches  %3zu submits  %3zu barrier calls  %s\n",
+				uploadCase.numMeshes, uploadCase.maxRingSize / (1024.0 * 1024.0), planner.GetNumBuffers(),
+				planner.GetNumBytes() / (1024.0 * 1024.0), planner.GetNumBatches(), device.numSubmits, device.numBarrierCalls,
+				bValid ? "valid" : "INVALID");
+			Log("    plan %8.3f ms  execute %8.3f ms  per mesh %.4f ms\n", planMs, executeMs,
+				(planMs + executeMs) / uploadCase.numMeshes);
+		}
+	}
+
+	void BenchmarkMeshletDAG(const char* directory)
+	{
+		const float kDistances[] = { 0.5f, 2.0f, 8.0f, 32.0f, 128.0f, 1024.0f };
+		uint32_t numThreads = DXParallel::GetWorkerCount();
+
+		for (const std::string& path : FindOBJFiles(directory))
+		{
+			DXMesh mesh;
+			mesh.SetOptimizeMesh(true);
+			DXMeshData meshData;
+			if (!mesh.LoadMeshData(path.c_str(), false, meshData))
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			MeshletDAGOptions options;
+			MeshletDAG dag;
+			MeshletDAGStats stats;
+			DXMeshletDAG::Build(meshData.pVertices, meshData.numVertices, meshData.pIndices, meshData.numIndices, options, dag,
+				&stats, numThreads);
+
+			Log("  %-28s %7.2f ms  %zu clusters  %zu groups  %zu roots  %u levels  %s\n", path.substr(strlen(directory)).c_str(),
+				stats.buildMs, stats.numClusters, stats.numGroups, stats.numRoots, dag.GetNumLevels(),
+				DXMeshletDAG::CheckDAG(dag) ? "valid" : "INVALID");
+
+			Log("   triangles per level");
+			for (size_t triangles : stats.levelTriangles)
+			{
+				Log(" %zu", triangles);
+			}
+			Log("\n");
+
+			// views along -z at multiples of the mesh extent
+			DirectX::XMFLOAT3 center((meshData.bounds.mMin.x + meshData.bounds.mMax.x) * 0.5f,
+				(meshData.bounds.mMin.y + meshData.bounds.mMax.y) * 0.5f,
+				(meshData.bounds.mMin.z + meshData.bounds.mMax.z) * 0.5f);
+			float extent = std::max(std::max(meshData.bounds.mMax.x - meshData.bounds.mMin.x, meshData.bounds.mMax.y - meshData.bounds.mMin.y),
+				meshData.bounds.mMax.z - meshData.bounds.mMin.z);
+
+			std::vector< uint32_t > selected;
+			for (float distance : kDistances)
+			{
+				DirectX::XMFLOAT3 eye(center.x, center.y, center.z - distance * extent);
+				MeshletLODView view = DXMeshletDAG::CreateLODView(eye, DirectX::XM_PIDIV4, 1080.0f, 1.0f);
+
+				selected.clear();
+				MeshletLODSelectStats selectStats;
+				DXMeshletDAG::SelectClusters(dag, view, selected, &selectStats);
+				MeshletDAGCutCheck check = DXMeshletDAG::CheckCut(dag, selected);
+
+				Log("   distance %7.1f  %6zu clusters  %9zu triangles  %.3f ms  %zu crack edges  %zu overlap edges\n", distance,
+					selectStats.numClusters, selectStats.numTriangles, selectStats.selectMs, check.numCrackEdges, check.numOverlapEdges);
+			}
+		}
+	}
+
+	void BenchmarkMeshletCompression(const char* meshletDirectory)
+	{
+		const uint32_t kBits[][2] = { { 16, 16 }, { 14, 12 }, { 12, 10 }, { 10, 8 } };
+		const size_t kNumSettings = sizeof(kBits) / sizeof(kBits[0]);
+
+		size_t totalSourceBytes = 0;
+		size_t totalCompressedBytes[kNumSettings] = {};
+		size_t exceeded = 0;
+
+		for (const std::string& path : FindFiles(meshletDirectory, ".bin"))
+		{
+			MeshShaderModel model;
+			std::wstring widePath(path.begin(), path.end());
+			if (FAILED(model.LoadFromFile(widePath.c_str())))
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			for (uint32_t m = 0; m < model.GetMeshCount(); ++m)
+			{
+				const Mesh& mesh = model.GetMesh(m);
+				MeshletVertexAttributes attributes;
+				if (!DXMeshletCompression::GetVertexAttributes(mesh, attributes))
+					continue;
+
+				// the compressed vertices replace the full precision attributes and the unique vertex indices
+				size_t sourceBytes = mesh.VertexCount * (sizeof(XMFLOAT3) + (attributes.pNormals ? sizeof(XMFLOAT3) : 0) +
+					(attributes.pUVs ? sizeof(XMFLOAT2) : 0)) + mesh.UniqueVertexIndices.size();
+				totalSourceBytes += sourceBytes;
+
+				MeshletData data = GetMeshletData(mesh);
+				Log("  %s mesh %u: %u vertices, %zu meshlet vertices, %zu bytes\n", path.substr(strlen(meshletDirectory)).c_str(), m,
+					mesh.VertexCount, data.uniqueVertexIndices.size(), sourceBytes);
+
+				for (size_t i = 0; i < kNumSettings; ++i)
+				{
+					MeshletCompressionOptions options;
+					options.positionBits = kBits[i][0];
+					options.normalBits = kBits[i][1];
+
+					CompressedMeshletVertices compressed;
+					MeshletCompressionStats stats;
+					DXMeshletCompression::EncodeVertices(attributes, data, options, compressed, &stats);
+
+					bool bWithinBound = stats.maxPositionError <= stats.positionErrorBound;
+					exceeded += bWithinBound ? 0 : 1;
+					totalCompressedBytes[i] += stats.compressedBytes;
+
+					Log("   %2u / %2u  %3u bits  %8zu bytes  %.2fx  position %.2e (bound %.2e%s)  normal %.3f deg  uv %.2e  encode %.2f ms\n",
+						kBits[i][0], kBits[i][1], compressed.vertexBits, stats.compressedBytes,
+						stats.compressedBytes ? double(sourceBytes) / stats.compressedBytes : 0.0, stats.maxPositionError,
+						stats.positionErrorBound, bWithinBound ? "" : " EXCEEDED", stats.maxNormalErrorDegrees, stats.maxUVError, stats.encodeMs);
+				}
+			}
+		}
+
+		for (size_t i = 0; i < kNumSettings; ++i)
+		{
+			Log("  %2u / %2u bits: %zu -> %zu bytes, %.2fx\n", kBits[i][0], kBits[i][1], totalSourceBytes, totalCompressedBytes[i],
+				totalCompressedBytes[i] ? double(totalSourceBytes) / totalCompressedBytes[i] : 0.0);
+		}
+		Log("  %zu encodings over the error bound\n", exceeded);
+	}
+
+	void BenchmarkMeshletQuality(const char* meshletDirectory, const char* objDirectory, const char* jsonPath)
+	{
+		MeshletBuildOptions options;
+		uint32_t numThreads = DXParallel::GetWorkerCount();
+
+		JsonWriter json;
+		json.BeginObject();
+		json.Write("maxVertices", static_cast<size_t>(options.maxVertices));
+		json.Write("maxPrimitives", static_cast<size_t>(options.maxPrimitives));
+		json.Write("threads", static_cast<size_t>(numThreads));
+		json.BeginArray("meshes");
+
+		// the shipped meshlets and the ones DXMeshletBuilder makes out of the same index buffer
+		for (const std::string& path : FindFiles(meshletDirectory, ".bin"))
+		{
+			MeshShaderModel model;
+			std::wstring widePath(path.begin(), path.end());
+
+			auto loadStart = std::chrono::high_resolution_clock::now();
+			HRESULT hr = model.LoadFromFile(widePath.c_str());
+			double loadMs = GetElapsedMs(loadStart);
+
+			if (FAILED(hr))
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			for (uint32_t m = 0; m < model.GetMeshCount(); ++m)
+			{
+				const Mesh& mesh = model.GetMesh(m);
+				MeshletVertexAttributes attributes;
+				if (!DXMeshletCompression::GetVertexAttributes(mesh, attributes))
+					continue;
+
+				MeshletData shipped = GetMeshletData(mesh);
+				shipped.cullData.assign(mesh.CullingData.data(), mesh.CullingData.data() + mesh.CullingData.size());
+
+				std::vector< uint32_t > indices = ReadIndices(mesh.Indices.data(), mesh.IndexSize, mesh.IndexCount);
+				std::vector< Subset > indexSubsets(mesh.IndexSubsets.data(), mesh.IndexSubsets.data() + mesh.IndexSubsets.size());
+
+				MeshletData built;
+				MeshletStats buildStats;
+				DXMeshletBuilder::BuildMeshlets(attributes.pPositions, attributes.positionStride, mesh.VertexCount, indices.data(),
+					indices.size(), indexSubsets, options, built, &buildStats, numThreads);
+
+				MeshletQuality shippedQuality = MeasureMeshletQuality(attributes.pPositions, attributes.positionStride, mesh.VertexCount, shipped, options);
+				MeshletQuality builtQuality = MeasureMeshletQuality(attributes.pPositions, attributes.positionStride, mesh.VertexCount, built, options);
+
+				std::string name = path.substr(strlen(meshletDirectory)) + "#" + std::to_string(m);
+				Log("  %-28s load %.2f ms  build %.2f ms\n", name.c_str(), loadMs, buildStats.buildMs);
+				LogMeshletQuality("shipped", shippedQuality);
+				LogMeshletQuality("built", builtQuality);
+
+				json.BeginObject();
+				json.Write("name", name.c_str());
+				json.Write("source", "mshl");
+				json.Write("vertices", static_cast<size_t>(mesh.VertexCount));
+				json.Write("fileLoadMs", loadMs);
+				WriteMeshletQuality(json, "shipped", shippedQuality, -1.0);
+				WriteMeshletQuality(json, "built", builtQuality, buildStats.buildMs);
+				json.EndObject();
+			}
+		}
+
+		// the load time of an obj is DXMesh::LoadMeshData, a warm load when the mesh cache has the file
+		for (const std::string& path : FindOBJFiles(objDirectory))
+		{
+			DXMesh mesh;
+			mesh.SetOptimizeMesh(true);
+			DXMeshData meshData;
+
+			auto loadStart = std::chrono::high_resolution_clock::now();
+			bool bLoaded = mesh.LoadMeshData(path.c_str(), false, meshData);
+			double loadMs = GetElapsedMs(loadStart);
+
+			if (!bLoaded)
+			{
+				Log("  failed to load %s\n", path.c_str());
+				continue;
+			}
+
+			std::vector< Subset > indexSubsets;
+			for (const MeshCacheSubmesh& submesh : meshData.submeshes)
+			{
+				indexSubsets.push_back({ submesh.startIndex, submesh.indexCount });
+			}
+
+			MeshletData built;
+			MeshletStats buildStats;
+			DXMeshletBuilder::BuildMeshlets(&meshData.pVertices[0].position, sizeof(MeshVertexPosNormUV0), meshData.numVertices,
+				meshData.pIndices, meshData.numIndices, indexSubsets, options, built, &buildStats, numThreads);
+
+			MeshletQuality builtQuality = MeasureMeshletQuality(&meshData.pVertices[0].position, sizeof(MeshVertexPosNormUV0),
+				meshData.numVertices, built, options);
+
+			std::string name = path.substr(strlen(objDirectory));
+			Log("  %-28s load %.2f ms  build %.2f ms\n", name.c_str(), loadMs, buildStats.buildMs);
+			LogMeshletQuality("built", builtQuality);
+
+			json.BeginObject();
+			json.Write("name", name.c_str());
+			json.Write("source", "obj");
+			json.Write("vertices", meshData.numVertices);
+			json.Write("loadMs", loadMs);
+			WriteMeshletQuality(json, "built", builtQuality, buildStats.buildMs);
+			json.EndObject();
+		}
+
+		json.EndArray();
+		json.EndObject();
+
+		if (json.SaveToFile(jsonPath))
+		{
+			Log("  report written to %s\n", jsonPath);
+		}
+		else
+		{
+			Log("  failed to write %s\n", jsonPath);
+		}
+	}
+
+	void BenchmarkPLYLoad(const char* directory, size_t numPoints)
+	{
+		uint32_t numThreads = DXParallel::GetWorkerCount();
+
+		for (const std::string& path : FindFiles(directory, ".ply"))
+		{
+			PlyPointData data;
+			auto start = std::chrono::high_resolution_clock::now();
+			bool bLoaded = DXPlyParser::ParseFile(path.c_str(), data);
+			double loadMs = GetElapsedMs(start);
+
+			Log("  %-36s %9zu points  %8.2f ms  %7.1f MB/s%s\n", path.substr(strlen(directory)).c_str(), data.GetPointCount(), loadMs,
+				GetFileSizeBytes(path.c_str()) / (1024.0 * 1024.0) / (loadMs / 1000.0), bLoaded ? "" : "  FAILED");
+		}
+
+		// the synthetic cloud in every format.  ascii is ten times smaller, it is too slow to write at full size.
+		struct SyntheticFile
+		{
+			const char* name;
+			PlyFormat format;
+			size_t numPoints;
+		};
+		const SyntheticFile kFiles[] =
+		{
+			{ "dx12_synthetic_cloud_le.ply", kPlyFormatBinaryLittleEndian, numPoints },
+			{ "dx12_synthetic_cloud_be.ply", kPlyFormatBinaryBigEndian, numPoints },
+			{ "dx12_synthetic_cloud_ascii.ply", kPlyFormatAscii, numPoints / 10 },
+		};
+
+		std::vector< std::string > paths;
+		for (const SyntheticFile& file : kFiles)
+		{
+			paths.push_back(GetScratchFilePath(file.name));
+			if (!WriteSyntheticPLY(paths.back().c_str(), file.numPoints, file.format))
+			{
+				Log("  failed to write %s\n", paths.back().c_str());
+				paths.pop_back();
+				break;
+			}
+		}
+
+		for (size_t f = 0; f < paths.size(); ++f)
+		{
+			const char* path = paths[f].c_str();
+			double fileMB = GetFileSizeBytes(path) / (1024.0 * 1024.0);
+			Log("  %s  %zu points  %.0f MB\n", kFiles[f].name, kFiles[f].numPoints, fileMB);
+
+			// the bandwidth the parser could reach: touch every page of the mapped file
+			{
+				DXMemoryMappedFile mapped;
+				auto start = std::chrono::high_resolution_clock::now();
+				uint32_t checksum = 0;
+				if (mapped.Open(path))
+				{
+					for (const char* p = mapped.GetData(); p < mapped.GetEnd(); p += 4096)
+					{
+						checksum += static_cast<uint8_t>(*p);
+					}
+				}
+				double readMs = GetElapsedMs(start);
+				Log("   mapped read        %9.2f ms  %7.1f MB/s  (checksum %u)\n", readMs, fileMB / (readMs / 1000.0), checksum);
+			}
+
+			for (uint32_t threads : { 1u, numThreads })
+			{
+				PlyPointData data;
+				auto start = std::chrono::high_resolution_clock::now();
+				bool bLoaded = DXPlyParser::ParseFile(path, data, threads);
+				double loadMs = GetElapsedMs(start);
+
+				Log("   parse %2u threads   %9.2f ms  %7.1f MB/s  %zu mismatches%s\n", threads, loadMs, fileMB / (loadMs / 1000.0),
+					CountSyntheticMismatches(data, kFiles[f].numPoints), bLoaded ? "" : "  FAILED");
+			}
+
+			DeleteFileA(path);
+		}
+	}
+
+	void BenchmarkPLYParseScaling(const char* path)
+	{
+		DXMemoryMappedFile file;
+		if (!file.Open(path))
+		{
+			Log("  failed to open %s\n", path);
+			return;
+		}
+
+		Log("  %s (%.1f MB)\n", path, file.GetSize() / (1024.0 * 1024.0));
+
+		// touch every page once so the first run does not pay for the page faults
+		volatile char touch = 0;
+		for (size_t i = 0; i < file.GetSize(); i += 4096)
+		{
+			touch += file.GetData()[i];
+		}
+
+		PlyPointData serialData;
+		auto serialStart = std::chrono::high_resolution_clock::now();
+		DXPlyParser::ParseBuffer(file.GetData(), file.GetEnd(), serialData, 1);
+		double serialMs = GetElapsedMs(serialStart);
+
+		Log("  threads %2u  %10.2f ms  %zu points\n", 1, serialMs, serialData.GetPointCount());
+
+		uint32_t maxThreads = std::max(DXParallel::GetWorkerCount(), 8u);
+		for (uint32_t numThreads = 2; numThreads <= maxThreads; numThreads *= 2)
+		{
+			PlyPointData parallelData;
+			auto start = std::chrono::high_resolution_clock::now();
+			DXPlyParser::ParseBuffer(file.GetData(), file.GetEnd(), parallelData, numThreads);
+			double parallelMs = GetElapsedMs(start);
+
+			Log("  threads %2u  %10.2f ms  speedup %.2fx  output %s\n", numThreads, parallelMs,
+				parallelMs > 0.0 ? serialMs / parallelMs : 0.0, IsSamePlyData(serialData, parallelData) ? "identical" : "DIFFERS");
+		}
+	}
+
+	void BenchmarkPointSort(size_t numPoints)
+	{
+		std::vector< CloudVertexPosColor > points(numPoints);
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			vec3 position;
+			vec4 color;
+			GetSyntheticPoint(i, position, color);
+			points[i].Pos = DirectX::XMFLOAT3(position.x, position.y, position.z);
+			points[i].Color = DirectX::XMFLOAT4(color.x / 255.0f, color.y / 255.0f, color.z / 255.0f, color.w / 255.0f);
+		}
+
+		const DirectX::XMFLOAT3 center(5.0f, 5.0f, numPoints * 0.5e-6f);
+		auto getEye = [&](int frame)
+		{
+			float angle = frame * 0.2f * DirectX::XM_PI / 180.0f;
+			return DirectX::XMFLOAT3(center.x + 20.0f * std::sin(angle), center.y + 5.0f, center.z - 20.0f * std::cos(angle));
+		};
+
+		// the old sort, a comparator that computes both distances with a square root
+		{
+			DirectX::XMFLOAT3 eye = getEye(0);
+			std::vector< uint32_t > order(numPoints);
+			for (size_t i = 0; i < numPoints; ++i)
+			{
+				order[i] = static_cast<uint32_t>(i);
+			}
+
+			auto start = std::chrono::high_resolution_clock::now();
+			std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+			{
+				return std::sqrt(GetDistanceSq(points[a].Pos, eye)) > std::sqrt(GetDistanceSq(points[b].Pos, eye));
+			});
+			Log("  %zu points  std::sort with distances  %9.2f ms\n", numPoints, GetElapsedMs(start));
+		}
+
+		uint32_t maxThreads = std::max(DXParallel::GetWorkerCount(), 8u);
+		for (uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+		{
+			DXPointSorter sorter;
+			DirectX::XMFLOAT3 eye = getEye(0);
+			sorter.Sort(&points[0].Pos, sizeof(CloudVertexPosColor), numPoints, eye, numThreads);
+			const PointSortStats& stats = sorter.GetStats();
+
+			Log("  threads %2u  radix keys %7.2f ms  sort %7.2f ms  %u passes  %zu order errors\n", numThreads, stats.keyMs, stats.sortMs,
+				stats.numRadixPasses, CountDepthOrderErrors(points, sorter.GetOrder(), eye));
+		}
+
+		// an orbiting camera, 0.2 degrees per frame, sorted from scratch and from last frame's order
+		const int kNumFrames = 32;
+		for (bool bTemporal : { false, true })
+		{
+			DXPointSorter sorter;
+			sorter.SetUseTemporalCoherence(bTemporal);
+
+			double totalMs = 0.0;
+			size_t numAdaptive = 0;
+			size_t moves = 0;
+			size_t errors = 0;
+			for (int frame = 0; frame <= kNumFrames; ++frame)
+			{
+				DirectX::XMFLOAT3 eye = getEye(frame);
+				sorter.Sort(&points[0].Pos, sizeof(CloudVertexPosColor), numPoints, eye);
+
+				// the first frame has no previous order
+				if (frame > 0)
+				{
+					const PointSortStats& stats = sorter.GetStats();
+					totalMs += stats.keyMs + stats.sortMs;
+					numAdaptive += stats.bUsedPreviousOrder ? 1 : 0;
+					moves += stats.numMoves;
+					errors += CountDepthOrderErrors(points, sorter.GetOrder(), eye);
+				}
+			}
+
+			Log("  %-9s %d frames  %7.2f ms per frame  %2zu adaptive  %.2f moves per point  %zu order errors\n",
+				bTemporal ? "temporal" : "radix", kNumFrames, totalMs / kNumFrames, numAdaptive, double(moves) / (double(numPoints) * kNumFrames),
+				errors);
+		}
+	}
+
+	void BenchmarkPointChunkCulling(const char* path, size_t numPoints)
+	{
+		struct Cloud
+		{
+			std::string name;
+			std::vector< DirectX::XMFLOAT3 > positions;
+		};
+		std::vector< Cloud > clouds(1);
+
+		clouds[0].name = "synthetic";
+		clouds[0].positions.resize(numPoints);
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			vec3 position;
+			vec4 color;
+			GetSyntheticPoint(i, position, color);
+			clouds[0].positions[i] = DirectX::XMFLOAT3(position.x, position.y, position.z);
+		}
+
+		PlyPointData data;
+		if (DXPlyParser::ParseFile(path, data) && data.GetPointCount() > 0)
+		{
+			Cloud cloud;
+			cloud.name = path;
+			cloud.positions.resize(data.GetPointCount());
+			for (size_t i = 0; i < data.GetPointCount(); ++i)
+			{
+				cloud.positions[i] = DirectX::XMFLOAT3(data.positions[i].x, data.positions[i].y, data.positions[i].z);
+			}
+			clouds.push_back(std::move(cloud));
+		}
+		else
+		{
+			Log("  %s could not be loaded, only the synthetic cloud is culled\n", path);
+		}
+
+		const int kNumViews = 64;
+		const char* kPathNames[] = { "orbit", "fly in", "close up" };
+
+		for (const Cloud& cloud : clouds)
+		{
+			size_t numCloudPoints = cloud.positions.size();
+
+			auto sortStart = std::chrono::high_resolution_clock::now();
+			std::vector< uint32_t > order;
+			DXPointChunks::SortByMortonCode(cloud.positions.data(), sizeof(DirectX::XMFLOAT3), numCloudPoints, order);
+			double sortMs = GetElapsedMs(sortStart);
+
+			std::vector< DirectX::XMFLOAT3 > mortonPositions(numCloudPoints);
+			for (size_t i = 0; i < numCloudPoints; ++i)
+			{
+				mortonPositions[i] = cloud.positions[order[i]];
+			}
+
+			std::vector< PointChunk > fileChunks;
+			std::vector< PointChunk > mortonChunks;
+			DXPointChunks::BuildChunks(cloud.positions.data(), sizeof(DirectX::XMFLOAT3), numCloudPoints, DXPointChunks::kDefaultChunkSize,
+				fileChunks);
+			auto buildStart = std::chrono::high_resolution_clock::now();
+			DXPointChunks::BuildChunks(mortonPositions.data(), sizeof(DirectX::XMFLOAT3), numCloudPoints, DXPointChunks::kDefaultChunkSize,
+				mortonChunks);
+			double buildMs = GetElapsedMs(buildStart);
+
+			Log("  %s  %zu points  %zu chunks  Morton order %.2f ms  chunk bounds %.2f ms\n", cloud.name.c_str(), numCloudPoints,
+				mortonChunks.size(), sortMs, buildMs);
+
+			// the bounds of the whole cloud are the bounds of its chunks
+			XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+			for (const PointChunk& chunk : mortonChunks)
+			{
+				boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&chunk.boundsMin));
+				boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&chunk.boundsMax));
+			}
+			XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+			float radius = std::max(0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, boundsMin))), 1.0e-3f);
+
+			XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, radius * 0.001f, radius * 10.0f);
+
+			// views of the scripted camera paths, t goes from 0 to 1 along a path
+			auto getView = [&](int cameraPath, float t)
+			{
+				XMVECTOR eye;
+				XMVECTOR target;
+				if (cameraPath == 0)
+				{
+					// around the cloud, always looking at its center
+					float yaw = XM_2PI * t;
+					eye = XMVectorAdd(center, XMVectorSet(2.5f * radius * std::cos(yaw), 0.5f * radius, 2.5f * radius * std::sin(yaw), 0.0f));
+					target = center;
+				}
+				else if (cameraPath == 1)
+				{
+					// from outside the cloud to next to its center
+					float distance = radius * (3.0f - 2.9f * t);
+					eye = XMVectorAdd(center, XMVectorSet(0.0f, 0.2f * distance, -distance, 0.0f));
+					target = center;
+				}
+				else
+				{
+					// inside the cloud, turning around once while moving along x
+					float yaw = XM_2PI * t;
+					eye = XMVectorAdd(center, XMVectorSet(radius * (0.6f * t - 0.3f), 0.05f * radius, 0.0f, 0.0f));
+					target = XMVectorAdd(eye, XMVectorSet(std::cos(yaw), -0.2f, std::sin(yaw), 0.0f));
+				}
+				return XMMatrixLookAtLH(eye, target, g_XMIdentityR1);
+			};
+
+			for (int cameraPath = 0; cameraPath < 3; ++cameraPath)
+			{
+				for (bool bMorton : { false, true })
+				{
+					const std::vector< PointChunk >& chunks = bMorton ? mortonChunks : fileChunks;
+
+					PointChunkCullStats stats;
+					std::vector< PointDrawRange > ranges;
+					size_t mismatches = 0;
+					for (int v = 0; v < kNumViews; ++v)
+					{
+						MeshletCullView view = DXMeshletCuller::CreateCullView(XMMatrixIdentity(), getView(cameraPath, float(v) / (kNumViews - 1)), proj);
+						DXPointChunks::CullChunks(chunks.data(), chunks.size(), view, ranges, &stats);
+
+						// a chunk is visible when its first point is drawn, the ranges are in buffer order
+						size_t next = 0;
+						for (const PointChunk& chunk : chunks)
+						{
+							while (next < ranges.size() && ranges[next].firstPoint + ranges[next].numPoints <= chunk.firstPoint)
+							{
+								++next;
+							}
+							bool bVisible = next < ranges.size() && ranges[next].firstPoint <= chunk.firstPoint;
+							mismatches += bVisible != DXPointChunks::IsChunkVisible(chunk, view) ? 1 : 0;
+						}
+					}
+
+					Log("    %-9s %-6s %5.1f%% points culled  %5.1f%% chunks visible  %7.1f draw ranges  %8.2f us per view%s\n",
+						kPathNames[cameraPath], bMorton ? "Morton" : "file", stats.GetCulledPointRate() * 100.0f,
+						stats.numChunks ? 100.0f * stats.numVisibleChunks / stats.numChunks : 0.0f, double(stats.numDrawRanges) / kNumViews,
+						stats.cullMs * 1000.0 / kNumViews, mismatches ? "  MISMATCH" : "");
+				}
+			}
+		}
+	}
+
+	void BenchmarkPointOctree(size_t numPoints)
+	{
+		std::vector< DirectX::XMFLOAT3 > positions(numPoints);
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			positions[i] = GetSyntheticTerrainPoint(i);
+		}
+
+		PointOctree octree;
+		std::vector< uint32_t > order;
+		PointOctreeBuildStats buildStats;
+		DXPointOctree::Build(positions.data(), sizeof(DirectX::XMFLOAT3), numPoints, PointOctreeOptions(), octree, order, &buildStats, 1);
+
+		Log("  threads %2u  morton %8.2f ms  subsample %8.2f ms  %zu nodes  %zu leaves  %u levels  %s\n", 1, buildStats.mortonMs,
+			buildStats.buildMs, buildStats.numNodes, buildStats.numLeaves, octree.numLevels,
+			DXPointOctree::CheckOctree(octree, positions.data(), sizeof(DirectX::XMFLOAT3), order) ? "valid" : "INVALID");
+
+		uint32_t maxThreads = std::max(DXParallel::GetWorkerCount(), 8u);
+		for (uint32_t numThreads = 2; numThreads <= maxThreads; numThreads *= 2)
+		{
+			PointOctree parallelOctree;
+			std::vector< uint32_t > parallelOrder;
+			PointOctreeBuildStats stats;
+			DXPointOctree::Build(positions.data(), sizeof(DirectX::XMFLOAT3), numPoints, PointOctreeOptions(), parallelOctree, parallelOrder,
+				&stats, numThreads);
+
+			double serialMs = buildStats.mortonMs + buildStats.buildMs;
+			double parallelMs = stats.mortonMs + stats.buildMs;
+			Log("  threads %2u  morton %8.2f ms  subsample %8.2f ms  speedup %.2fx  order %s\n", numThreads, stats.mortonMs, stats.buildMs,
+				parallelMs > 0.0 ? serialMs / parallelMs : 0.0, parallelOrder == order ? "identical" : "DIFFERS");
+		}
+
+		std::string levels;
+		for (size_t level = 0; level < buildStats.levelPoints.size(); ++level)
+		{
+			levels += "  " + std::to_string(buildStats.levelPoints[level]);
+		}
+		Log("  points per level%s\n", levels.c_str());
+
+		const PointOctreeNode& root = octree.nodes[0];
+		XMVECTOR center = XMLoadFloat3(&root.center);
+		float radius = root.halfSize * 1.7320508f;
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, radius * 0.001f, radius * 10.0f);
+
+		const int kNumViews = 64;
+		auto getView = [&](int cameraPath, float t)
+		{
+			if (cameraPath == 0)
+			{
+				float yaw = XM_2PI * t;
+				XMVECTOR eye = XMVectorAdd(center, XMVectorSet(2.0f * radius * std::cos(yaw), 0.5f * radius, 2.0f * radius * std::sin(yaw), 0.0f));
+				return XMMatrixLookAtLH(eye, center, g_XMIdentityR1);
+			}
+
+			float distance = radius * (3.0f - 2.9f * t);
+			XMVECTOR eye = XMVectorAdd(center, XMVectorSet(0.0f, 0.2f * distance, -distance, 0.0f));
+			return XMMatrixLookAtLH(eye, center, g_XMIdentityR1);
+		};
+
+		const char* kPathNames[] = { "orbit", "fly in" };
+		const size_t kBudgets[] = { 500000, 1000000, 2000000, 5000000 };
+		std::vector< PointLODDraw > draws;
+
+		for (int cameraPath = 0; cameraPath < 2; ++cameraPath)
+		{
+			for (size_t budget : kBudgets)
+			{
+				for (uint32_t numThreads : { 1u, maxThreads })
+				{
+					PointLODSelectStats stats;
+					size_t overBudget = 0;
+					for (int v = 0; v < kNumViews; ++v)
+					{
+						XMMATRIX wvp = XMMatrixMultiply(getView(cameraPath, float(v) / (kNumViews - 1)), proj);
+						PointLODView view = DXPointOctree::CreateLODView(wvp, XM_PIDIV4, 1080.0f, budget);
+
+						size_t pointsBefore = stats.numPoints;
+						DXPointOctree::SelectNodes(octree, view, draws, &stats, numThreads);
+						overBudget += stats.numPoints - pointsBefore > budget ? 1 : 0;
+					}
+
+					Log("    %-6s budget %8zu  threads %2u  %10.0f points  %7.1f nodes  %7.1f draws  score %7.3f ms  select %7.3f ms%s\n",
+						kPathNames[cameraPath], budget, numThreads, double(stats.numPoints) / kNumViews, double(stats.numSelectedNodes) / kNumViews,
+						double(stats.numDraws) / kNumViews, stats.scoreMs / kNumViews, stats.selectMs / kNumViews,
+						overBudget ? "  OVER BUDGET" : "");
+				}
+			}
+		}
+	}
+
+	void BenchmarkPointStreaming(size_t numPoints)
+	{
+		std::string path = GetScratchFilePath("dx12_synthetic_scan.dxpoints");
+
+		// the points only exist while the file is written, everything after it reads the file
+		{
+			std::vector< CloudVertexPosColor > points(numPoints);
+			for (size_t i = 0; i < numPoints; ++i)
+			{
+				points[i].Pos = GetSyntheticTerrainPoint(i);
+				float height = (points[i].Pos.y + 3.5f) / 7.0f;
+				points[i].Color = DirectX::XMFLOAT4(height, 0.5f, 1.0f - height, 1.0f);
+			}
+
+			auto writeStart = std::chrono::high_resolution_clock::now();
+			PointOctreeBuildStats buildStats;
+			if (!DXPointPages::WritePageFile(path.c_str(), points.data(), numPoints, PointOctreeOptions(), &buildStats))
+			{
+				Log("  could not write %s\n", path.c_str());
+				return;
+			}
+
+			Log("  %zu points  %zu nodes  %.1f MB  written in %.2f ms (octree %.2f ms)\n", numPoints, buildStats.numNodes,
+				GetFileSizeBytes(path.c_str()) / (1024.0 * 1024.0), GetElapsedMs(writeStart), buildStats.mortonMs + buildStats.buildMs);
+		}
+
+		DXPointPageFile file;
+		if (!file.Open(path.c_str()) || file.GetOctree().IsEmpty())
+		{
+			Log("  could not open %s\n", path.c_str());
+			DeleteFileA(path.c_str());
+			return;
+		}
+
+		const PointOctreeNode& root = file.GetOctree().nodes[0];
+		XMVECTOR center = XMLoadFloat3(&root.center);
+		float radius = root.halfSize * 1.7320508f;
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, radius * 0.001f, radius * 10.0f);
+		file.Close();
+
+		const int kNumViews = 64;
+		const size_t kPointBudget = 2000000;
+		auto getView = [&](int cameraPath, float t)
+		{
+			XMMATRIX view;
+			if (cameraPath == 0)
+			{
+				float yaw = XM_2PI * t;
+				XMVECTOR eye = XMVectorAdd(center, XMVectorSet(2.0f * radius * std::cos(yaw), 0.5f * radius, 2.0f * radius * std::sin(yaw), 0.0f));
+				view = XMMatrixLookAtLH(eye, center, g_XMIdentityR1);
+			}
+			else
+			{
+				float distance = radius * (3.0f - 2.9f * t);
+				XMVECTOR eye = XMVectorAdd(center, XMVectorSet(0.0f, 0.2f * distance, -distance, 0.0f));
+				view = XMMatrixLookAtLH(eye, center, g_XMIdentityR1);
+			}
+			return DXPointOctree::CreateLODView(XMMatrixMultiply(view, proj), XM_PIDIV4, 1080.0f, kPointBudget);
+		};
+
+		// the file was just written, so the reads mostly come from the OS file cache
+		const char* kPathNames[] = { "orbit", "fly in" };
+		const uint64_t kCacheBudgets[] = { 32ull << 20, 128ull << 20, 512ull << 20 };
+		std::vector< PointStreamDraw > draws;
+
+		for (int cameraPath = 0; cameraPath < 2; ++cameraPath)
+		{
+			for (uint64_t cacheBudget : kCacheBudgets)
+			{
+				PointStreamOptions options;
+				options.cacheBudget = cacheBudget;
+
+				DXPointStreamer streamer;
+				if (!streamer.Open(path.c_str(), options))
+				{
+					Log("  could not open %s\n", path.c_str());
+					break;
+				}
+
+				// cold cache, the first view until the whole selection is resident or nothing more fits
+				const int kMaxColdUpdates = 1000;
+				PointLODView firstView = getView(cameraPath, 0.0f);
+				for (int update = 0; update < kMaxColdUpdates && streamer.GetStats().fullDetailMs < 0.0; ++update)
+				{
+					streamer.Update(firstView, draws);
+					streamer.WaitForReads();
+				}
+				double fullDetailMs = streamer.GetStats().fullDetailMs;
+
+				// every drawn point must come from the resident node it was drawn from
+				size_t badDraws = 0;
+				size_t drawnPoints = 0;
+				for (int v = 0; v < kNumViews; ++v)
+				{
+					streamer.Update(getView(cameraPath, float(v) / (kNumViews - 1)), draws);
+
+					for (const PointStreamDraw& draw : draws)
+					{
+						const CloudVertexPosColor* pPoints = streamer.GetNodePoints(draw.node);
+						const PointOctreeNode& node = streamer.GetFile().GetNode(draw.node).node;
+						float limit = node.halfSize * 1.0001f;
+						bool bInside = pPoints && draw.firstPoint + draw.numPoints <= node.numPoints;
+						for (uint32_t i = draw.firstPoint; bInside && i < draw.firstPoint + draw.numPoints; ++i)
+						{
+							const DirectX::XMFLOAT3& p = pPoints[i].Pos;
+							bInside = std::fabs(p.x - node.center.x) <= limit && std::fabs(p.y - node.center.y) <= limit &&
+								std::fabs(p.z - node.center.z) <= limit;
+						}
+						badDraws += bInside ? 0 : 1;
+						drawnPoints += draw.numPoints;
+					}
+
+					streamer.WaitForReads();
+				}
+
+				const PointStreamStats& stats = streamer.GetStats();
+				char fullDetail[32] = "never";
+				if (fullDetailMs >= 0.0)
+				{
+					snprintf(fullDetail, sizeof(fullDetail), "%.2f", fullDetailMs);
+				}
+
+				Log("    %-6s cache %4llu MB  full detail %10s ms  hit rate %5.1f%%  %7.0f points drawn  %6zu reads  %6zu evictions  "
+					"%8.1f MB read  %8.1f MB/s streamed  %8.1f MB/s per I/O thread  resident %6.1f MB%s\n",
+					kPathNames[cameraPath], static_cast<unsigned long long>(cacheBudget >> 20), fullDetail, 100.0f * stats.GetHitRate(),
+					double(drawnPoints) / kNumViews, stats.numReads, stats.numEvictions, stats.bytesRead / (1024.0 * 1024.0),
+					stats.GetBytesPerSecond() / (1024.0 * 1024.0), stats.GetReadBytesPerSecond() / (1024.0 * 1024.0),
+					streamer.GetResidentBytes() / (1024.0 * 1024.0), badDraws ? "  BAD DRAWS" : "");
+			}
+		}
+
+		DeleteFileA(path.c_str());
+	}
+
+	void BenchmarkPointCompression(size_t numPoints)
+	{
+		std::vector< vec3 > positions(numPoints);
+		std::vector< vec4 > colors(numPoints);
+		DXGraphicsUtilities::BoundingBox bounds;
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			DirectX::XMFLOAT3 p = GetSyntheticTerrainPoint(i);
+			positions[i] = { p.x, p.y, p.z };
+
+			// whole 0..255 values like the uchar colors of a scan, shaded by height
+			float shade = std::floor(std::min(std::max((p.y + 4.0f) * 32.0f, 0.0f), 255.0f));
+			colors[i] = { shade, std::floor(p.x * 2.55f), std::floor(p.z * 2.55f), 255.0f };
+
+			bounds.mMin = i ? DirectX::XMFLOAT3(std::min(bounds.mMin.x, p.x), std::min(bounds.mMin.y, p.y), std::min(bounds.mMin.z, p.z)) : p;
+			bounds.mMax = i ? DirectX::XMFLOAT3(std::max(bounds.mMax.x, p.x), std::max(bounds.mMax.y, p.y), std::max(bounds.mMax.z, p.z)) : p;
+		}
+
+		VertexQuantization quantization = DXVertexCompression::ComputeQuantization(bounds);
+		const DirectX::XMFLOAT3& extent = quantization.positionScale;
+		float maxExtent = std::max(std::max(extent.x, extent.y), extent.z);
+
+		const PointVertexFormat formats[] = { kPointVertexFormatFull, kPointVertexFormatCompact12, kPointVertexFormatCompact8 };
+		size_t fullBytes = numPoints * sizeof(CloudVertexPosColor);
+
+		// the copy stands in for the write into the mapped upload heap, its time scales with the bytes per point
+		std::vector< uint8_t > uploadBuffer(fullBytes);
+
+		// the full points are what a .dxpoints page holds, a paged cloud encodes them into its pool
+		std::vector< uint8_t > pageBytes;
+
+		for (PointVertexFormat format : formats)
+		{
+			std::vector< uint8_t > bytes;
+			PointCompressionStats stats;
+			DXVertexCompression::EncodePoints(positions.data(), colors.data(), numPoints, format,
+				format == kPointVertexFormatFull ? VertexQuantization() : quantization, bytes, &stats);
+
+			auto copyStart = std::chrono::high_resolution_clock::now();
+			memcpy(uploadBuffer.data(), bytes.data(), bytes.size());
+			double copyMs = GetElapsedMs(copyStart);
+
+			if (format == kPointVertexFormatFull)
+			{
+				pageBytes = bytes;
+			}
+
+			// the page encode has to write the same bytes, the colors of the page are the 0..255 colors divided down
+			auto pageStart = std::chrono::high_resolution_clock::now();
+			DXVertexCompression::EncodePoints(reinterpret_cast<const CloudVertexPosColor*>(pageBytes.data()), numPoints, format,
+				format == kPointVertexFormatFull ? VertexQuantization() : quantization, uploadBuffer.data());
+			double pageMs = GetElapsedMs(pageStart);
+			bool bPageMatches = memcmp(uploadBuffer.data(), bytes.data(), bytes.size()) == 0;
+
+			Log("  %2u byte  %11zu bytes  %.2fx smaller  pos %.2e (%.2e of extent)  color %.2f  encode %8.2f ms  decode %8.2f ms  copy %7.2f ms  page encode %8.2f ms%s\n",
+				DXVertexCompression::GetPointStride(format), stats.compressedBytes,
+				stats.compressedBytes ? double(fullBytes) / stats.compressedBytes : 0.0, stats.maxPositionError,
+				maxExtent > 0.0f ? stats.maxPositionError / maxExtent : 0.0f, stats.maxColorError, stats.encodeMs, stats.decodeMs, copyMs,
+				pageMs, bPageMatches ? "" : "  MISMATCH");
+		}
+	}
+
+	void BenchmarkPointDownsample(size_t numPoints)
+	{
+		// every fourth point is followed by a copy of itself, like the overlapping passes of a phone scan
+		std::vector< vec3 > positions;
+		std::vector< vec4 > colors;
+		positions.reserve(numPoints);
+		colors.reserve(numPoints);
+		for (size_t i = 0; positions.size() < numPoints; ++i)
+		{
+			DirectX::XMFLOAT3 p = GetSyntheticTerrainPoint(i);
+			vec4 color = { std::floor(std::min(std::max((p.y + 4.0f) * 32.0f, 0.0f), 255.0f)), std::floor(p.x * 2.55f),
+				std::floor(p.z * 2.55f), 255.0f };
+
+			for (size_t copy = 0; copy < ((i % 4) == 0 ? 2u : 1u) && positions.size() < numPoints; ++copy)
+			{
+				positions.push_back({ p.x, p.y, p.z });
+				colors.push_back(color);
+			}
+		}
+
+		struct DownsampleCase
+		{
+			const char* name;
+			float voxelSize;
+			VoxelPointMode pointMode;
+		};
+		const DownsampleCase cases[] =
+		{
+			{ "duplicates", 0.0f, kVoxelPointCentroid },
+			{ "voxel 0.02 centroid", 0.02f, kVoxelPointCentroid },
+			{ "voxel 0.05 centroid", 0.05f, kVoxelPointCentroid },
+			{ "voxel 0.05 first", 0.05f, kVoxelPointFirst },
+			{ "voxel 0.2 centroid", 0.2f, kVoxelPointCentroid },
+		};
+
+		std::vector< vec3 > outPositions(numPoints);
+		std::vector< vec4 > outColors(numPoints);
+		std::vector< vec3 > parallelPositions(numPoints);
+		std::vector< vec4 > parallelColors(numPoints);
+
+		uint32_t maxThreads = std::max(DXParallel::GetWorkerCount(), 8u);
+		for (const DownsampleCase& downsampleCase : cases)
+		{
+			PointDownsampleOptions options;
+			options.voxelSize = downsampleCase.voxelSize;
+			options.pointMode = downsampleCase.pointMode;
+
+			PointDownsampleStats stats;
+			size_t numOut = DXPointDownsample::Downsample(positions.data(), colors.data(), numPoints, options, outPositions.data(),
+				outColors.data(), &stats, 1);
+
+			bool bValid = DXPointDownsample::CheckDownsample(positions.data(), colors.data(), numPoints, options, stats.voxelSize,
+				outPositions.data(), outColors.data(), numOut);
+
+			Log("  %-20s %10zu -> %10zu points  %.2fx  %zu duplicates  %s\n", downsampleCase.name, stats.numInputPoints,
+				stats.numOutputPoints, stats.GetReduction(), stats.numDuplicates, bValid ? "valid" : "INVALID");
+			Log("    threads %2u  %8.2f ms  duplicates %8.2f ms  voxels %8.2f ms\n", 1, stats.totalMs, stats.duplicateMs, stats.voxelMs);
+
+			for (uint32_t numThreads = 2; numThreads <= maxThreads; numThreads *= 2)
+			{
+				PointDownsampleStats parallelStats;
+				size_t numParallel = DXPointDownsample::Downsample(positions.data(), colors.data(), numPoints, options,
+					parallelPositions.data(), parallelColors.data(), &parallelStats, numThreads);
+
+				bool bIdentical = numParallel == numOut &&
+					memcmp(parallelPositions.data(), outPositions.data(), numOut * sizeof(vec3)) == 0 &&
+					memcmp(parallelColors.data(), outColors.data(), numOut * sizeof(vec4)) == 0;
+
+				Log("    threads %2u  %8.2f ms  speedup %.2fx  %s\n", numThreads, parallelStats.totalMs,
+					parallelStats.totalMs > 0.0 ? stats.totalMs / parallelStats.totalMs : 0.0, bIdentical ? "identical" : "DIFFERS");
+			}
+		}
+	}
+
+	bool WriteSyntheticPLY(const char* path, size_t numPoints, PlyFormat format)
+	{
+		std::vector< vec3 > positions(numPoints);
+		std::vector< vec4 > colors(numPoints);
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			GetSyntheticPoint(i, positions[i], colors[i]);
+		}
+
+		return DXPlyParser::WriteFile(path, positions.data(), colors.data(), numPoints, format);
+	}
+
+	bool WriteSyntheticGridOBJ(const char* path, size_t numTriangles)
+	{
+		FILE* pFile = nullptr;
+		if (fopen_s(&pFile, path, "wb") != 0 || pFile == nullptr)
+			return false;
+
+		// a gridSize x gridSize quad grid holds 2 * gridSize^2 triangles
+		size_t gridSize = static_cast<size_t>(std::ceil(std::sqrt(numTriangles / 2.0)));
+		size_t rowVerts = gridSize + 1;
+		float step = 1.0f / static_cast<float>(gridSize);
+
+		fprintf(pFile, "# synthetic %zu x %zu grid\n", gridSize, gridSize);
+
+		for (size_t y = 0; y < rowVerts; ++y)
+		{
+			for (size_t x = 0; x < rowVerts; ++x)
+			{
+				float fx = x * step;
+				float fy = y * step;
+				fprintf(pFile, "v %f %f %f\n", fx - 0.5f, 0.05f * std::sin(fx * 40.0f) * std::cos(fy * 40.0f), fy - 0.5f);
+			}
+		}
+
+		for (size_t y = 0; y < rowVerts; ++y)
+		{
+			for (size_t x = 0; x < rowVerts; ++x)
+			{
+				fprintf(pFile, "vt %f %f\n", x * step, y * step);
+			}
+		}
+
+		fprintf(pFile, "vn 0.000000 1.000000 0.000000\n");
+
+		for (size_t y = 0; y < gridSize; ++y)
+		{
+			for (size_t x = 0; x < gridSize; ++x)
+			{
+				size_t i0 = y * rowVerts + x + 1;
+				size_t i1 = i0 + 1;
+				size_t i2 = i0 + rowVerts;
+				size_t i3 = i2 + 1;
+
+				fprintf(pFile, "f %zu/%zu/1 %zu/%zu/1 %zu/%zu/1\n", i0, i0, i2, i2, i1, i1);
+				fprintf(pFile, "f %zu/%zu/1 %zu/%zu/1 %zu/%zu/1\n", i1, i1, i2, i2, i3, i3);
+			}
+		}
+
+		fclose(pFile);
+		return true;
+	}
+}
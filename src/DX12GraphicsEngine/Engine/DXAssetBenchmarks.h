@@ -0,0 +1,126 @@
+#pragma once
+
+#include "DXPlyParser.h"
+#include <string>
+
+//CPU side load and processing benchmarks for the asset pipeline.  None of these need a D3D device, they are run
+//from WinMain instead of a sample app (see bRunAssetBenchmarks in Main.cpp).  Results are printed and also sent
+//to the debugger output window.
+namespace DXAssetBenchmarks
+{
+	void RunAll();
+
+	//only BenchmarkMeshletQuality with the shipped assets, writes meshlet_report.json to the working directory
+	void RunMeshletReport();
+
+	//time the single threaded memory mapped obj parser against the reference getline/sscanf_s loader
+	void BenchmarkOBJLoad(const char* path, int numIterations);
+
+	//parse the same file with 1, 2, 4, 8.. threads and check that every run matches the serial result
+	void BenchmarkOBJParseScaling(const char* path);
+
+	//weld the triangle corners of an obj file exactly and with small epsilons.  reports the vertex reduction.
+	void BenchmarkWeld(const char* path);
+
+	//ACMR / ATVR of the welded mesh for FIFO and LRU caches before and after DXMeshOptimizer, plus the time it took
+	void BenchmarkMeshOptimizer(const char* path);
+
+	//cold (parse, weld, write .dxmesh) versus warm (hash source, map .dxmesh) DXMesh::LoadMeshData for every obj in
+	//a directory.  the cache files are left behind for the next run of the samples.
+	void BenchmarkMeshCache(const char* directory);
+
+	//encode the welded vertices of every obj in a directory to the 16 and 12 byte layouts of DXVertexCompression.
+	//reports the vertex buffer size, the largest position / normal / uv error and the encode and decode times.
+	void BenchmarkVertexCompression(const char* directory);
+
+	//build the DXMeshSimplifier lod chain of every obj in a directory on one thread and on all cores.  reports the
+	//triangles and the error (relative to the mesh extent) of each level.
+	void BenchmarkMeshSimplifier(const char* directory);
+
+	//load every obj in a directory twice without the mesh cache.  reports the scratch allocations the load made in
+	//its DXLoadArena and how many of them reached the heap, which should be none on the second load.
+	void BenchmarkLoadArena(const char* directory);
+
+	//meshletize the index buffers of the converted .bin files again with DXMeshletBuilder and compare the meshlet
+	//count and fill with the shipped meshlets.  then build the meshlets of every obj on one thread and on all cores.
+	//every build is checked to cover each triangle exactly once.
+	void BenchmarkMeshletBuilder(const char* meshletDirectory, const char* objDirectory);
+
+	//generate the cull data of the shipped meshlets again and cull both against views orbiting the mesh, then the
+	//meshlets built from every obj.  reports the visible, frustum and cone culled rates and the DXMeshletCuller time,
+	//and flags any meshlet where the SIMD culler and the one meshlet reference disagree.
+	void BenchmarkMeshletCulling(const char* meshletDirectory, const char* objDirectory);
+
+	//write a version 2 meshlet pack of about packBytes out of the shipped meshes, then compare reading it into memory
+	//with mapping it through MeshShaderModel::LoadFromFile, and the working set after using 1% of its meshes
+	void BenchmarkMeshletPack(const char* meshletDirectory, uint64_t packBytes);
+
+	//plan and execute the uploads of 1, 10 and maxMeshes synthetic meshlet meshes against DXNullUploadDevice, the last
+	//again with a ring smaller than the data.  every plan is checked to submit and barrier once per batch and copy
+	//every byte once, and plan and execute are timed against the mesh count.
+	void BenchmarkUploadPlanner(size_t maxMeshes);
+
+	//build the meshlet DAG of every obj and select a cut from views at multiples of the mesh extent.  reports the
+	//build time, the triangles of each level and for each view the clusters and triangles drawn, the selection time
+	//and the crack and overlap edges of the cut.
+	void BenchmarkMeshletDAG(const char* directory);
+
+	//encode the vertices of the shipped meshlets with DXMeshletCompression at several bit counts.  reports the size
+	//against the full precision position, normal and uv streams plus the unique vertex indices they replace, and the
+	//largest position, normal and uv errors.  every position error is checked against the bound of its encoding.
+	void BenchmarkMeshletCompression(const char* meshletDirectory);
+
+	//quality numbers of the shipped meshlets, of DXMeshletBuilder on the same index buffers and on every obj: count,
+	//vertex and primitive fill, vertex duplication (meshlet vertices per used vertex), bounding sphere radius against
+	//half the meshlet box diagonal, a histogram of the normal cone half angles in 15 degree steps (the last bucket is
+	//the degenerate cones) and the culled rate over 64 orbit views, plus the load and build times.  the numbers are
+	//also written to jsonPath so they can be compared between runs.
+	void BenchmarkMeshletQuality(const char* meshletDirectory, const char* objDirectory, const char* jsonPath);
+
+	//load every ply in a directory, then a synthetic cloud of numPoints points written as binary little endian, binary
+	//big endian and (a tenth of it) ascii.  each synthetic file is compared with touching every page of it mapped,
+	//the parse is timed on one thread and on all cores and checked point by point against the source.
+	void BenchmarkPLYLoad(const char* directory, size_t numPoints);
+
+	//parse the same ply file with 1, 2, 4, 8.. threads and check that every run matches the serial result
+	void BenchmarkPLYParseScaling(const char* path);
+
+	//write a grid shaped obj file with at least numTriangles triangles.  used for the large mesh benchmarks.
+	bool WriteSyntheticGridOBJ(const char* path, size_t numTriangles);
+
+	//sort a synthetic cloud back to front with the old std::sort comparator and with DXPointSorter on 1, 2, 4, 8..
+	//threads, then follow a camera orbiting it 0.2 degrees per frame with and without temporal coherence.  every
+	//order is checked to be back to front.
+	void BenchmarkPointSort(size_t numPoints);
+
+	//chunk a synthetic cloud of numPoints points and the ply file at path in file order and in Morton order, then
+	//frustum cull the chunks along an orbit, a fly in and a close up pan.  logs the culled points, the draw ranges
+	//left and the cull time per view, and checks the four chunk SIMD test against the one chunk test.
+	void BenchmarkPointChunkCulling(const char* path, size_t numPoints);
+
+	//build the LOD octree of a synthetic terrain scan of numPoints points on 1, 2, 4, 8.. threads and check it, then select
+	//nodes along an orbit and a fly in for several point budgets on one thread and on all cores
+	void BenchmarkPointOctree(size_t numPoints);
+
+	//write a synthetic terrain scan of numPoints points as a paged file, free the points and stream the file along an
+	//orbit and a fly in through caches of several sizes.  logs the time to full detail from a cold cache, the hit
+	//rate and the bytes streamed per second.
+	void BenchmarkPointStreaming(size_t numPoints);
+
+	//encode a synthetic terrain scan of numPoints points with uchar colors in every PointVertexFormat.  logs the
+	//bytes per point, the largest position and color error and the encode, decode and vertex buffer copy times.
+	void BenchmarkPointCompression(size_t numPoints);
+
+	//downsample a synthetic terrain scan of numPoints points where every fourth point is stored twice: duplicate
+	//removal alone, then voxel grids of several sizes with centroids and first points, on 1, 2, 4, 8.. threads.  every
+	//result is checked against the serial reference and the thread counts against each other.
+	void BenchmarkPointDownsample(size_t numPoints);
+
+	//write a ply file of numPoints points with float positions and uchar colors, the same points on every call
+	bool WriteSyntheticPLY(const char* path, size_t numPoints, PlyFormat format);
+
+	//full path of a scratch file in the user's temp directory
+	std::string GetScratchFilePath(const char* filename);
+
+	void Log(const char* format, ...);
+}
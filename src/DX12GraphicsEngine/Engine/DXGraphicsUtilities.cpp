@@ -16,12 +16,40 @@ namespace DXGraphicsUtilities
 
 	void CreateD3DMesh(std::shared_ptr<DXMesh> pDXMesh, D3DMesh* pD3DMesh)
 	{
+		//the DXR shaders read the index buffer as 32 bit words
+		assert(pDXMesh->GetIndexBufferView().Format == DXGI_FORMAT_R32_UINT && "DXR meshes need 32 bit indices");
+
 		(*pD3DMesh).m_pVertexBuffer = pDXMesh->GetVertexBuffer();
 		(*pD3DMesh).m_vertexBufferView = pDXMesh->GetVertexBufferView();
 		(*pD3DMesh).m_pIndexBuffer = pDXMesh->GetIndexBuffer();
 		(*pD3DMesh).m_indexBufferView = pDXMesh->GetIndexBufferView();
 		(*pD3DMesh).vertices = pDXMesh->GetVertices();
-		(*pD3DMesh).indices = pDXMesh->GetIndices32Bit();
+
+		//the simplified levels follow level 0 in the index buffer, DXR only traces the full detail level
+		const std::vector< uint32_t >& indices = pDXMesh->GetIndices32Bit();
+		size_t numIndices = pDXMesh->GetLODs().empty() ? indices.size() : pDXMesh->GetLODs()[0].indexCount;
+		assert(numIndices <= indices.size() && (pDXMesh->GetLODs().empty() || pDXMesh->GetLODs()[0].startIndex == 0));
+		(*pD3DMesh).indices.assign(indices.begin(), indices.begin() + numIndices);
+
+		(*pD3DMesh).m_VertexFormat = pDXMesh->GetVertexFormat();
+		(*pD3DMesh).m_VertexStride = pDXMesh->GetVertexStride();
+		(*pD3DMesh).m_PositionOffset = pDXMesh->GetVertexQuantization().positionOffset;
+		(*pD3DMesh).m_PositionScale = pDXMesh->GetVertexQuantization().positionScale;
+
+		//one BLAS geometry per material subset of the full detail level
+		(*pD3DMesh).m_Subsets.clear();
+		if (pDXMesh->GetLODs().empty() == false)
+		{
+			for (const DXMeshSubset& subset : pDXMesh->GetLODs()[0].subsets)
+			{
+				D3DMeshSubset d3dSubset;
+				d3dSubset.m_StartIndex = subset.startIndex;
+				d3dSubset.m_IndexCount = subset.indexCount;
+				d3dSubset.m_MaterialIndex = subset.materialIndex;
+				d3dSubset.m_DiffuseTexIndex = (*pD3DMesh).m_DiffuseTexIndex;
+				(*pD3DMesh).m_Subsets.push_back(d3dSubset);
+			}
+		}
 	}
 
 	void WaitForGpu(ComPtr<ID3D12Device> &dx_device,
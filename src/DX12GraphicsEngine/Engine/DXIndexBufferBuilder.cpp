@@ -0,0 +1,139 @@
+#include "stdafx.h"
+#include "DXIndexBufferBuilder.h"
+
+#include <algorithm>
+
+namespace
+{
+	const uint32_t kMax16BitIndex = 0xffff;
+
+	uint32_t GetMaxIndex(const uint32_t* pIndices, size_t numIndices)
+	{
+		uint32_t maxIndex = 0;
+		for (size_t i = 0; i < numIndices; ++i)
+		{
+			maxIndex = std::max(maxIndex, pIndices[i]);
+		}
+		return maxIndex;
+	}
+
+	void Encode32Bit(const uint32_t* pIndices, size_t numIndices, IndexBufferData& out)
+	{
+		out.format = DXGI_FORMAT_R32_UINT;
+		out.bytes.resize(numIndices * sizeof(uint32_t));
+		memcpy(out.bytes.data(), pIndices, numIndices * sizeof(uint32_t));
+
+		IndexDrawRange range = { 0, static_cast<UINT>(numIndices), 0 };
+		out.ranges.assign(1, range);
+	}
+
+	//write every range relative to its base vertex
+	void Encode16Bit(const uint32_t* pIndices, const std::vector< IndexDrawRange >& ranges, size_t numIndices, IndexBufferData& out)
+	{
+		out.format = DXGI_FORMAT_R16_UINT;
+		out.bytes.resize(numIndices * sizeof(uint16_t));
+		out.ranges = ranges;
+
+		uint16_t* pOut = reinterpret_cast<uint16_t*>(out.bytes.data());
+		for (const IndexDrawRange& range : ranges)
+		{
+			for (UINT i = range.startIndex; i < range.startIndex + range.indexCount; ++i)
+			{
+				pOut[i] = static_cast<uint16_t>(pIndices[i] - range.baseVertex);
+			}
+		}
+	}
+}
+
+namespace DXIndexBufferBuilder
+{
+	bool SplitInto16BitRanges(const uint32_t* pIndices,
+		size_t numIndices,
+		UINT primitiveSize,
+		std::vector< IndexDrawRange >& out_ranges)
+	{
+		out_ranges.clear();
+
+		IndexDrawRange range = { 0, 0, 0 };
+		uint32_t rangeMin = 0xffffffff;
+		uint32_t rangeMax = 0;
+
+		for (size_t first = 0; first + primitiveSize <= numIndices; first += primitiveSize)
+		{
+			uint32_t primitiveMin = pIndices[first];
+			uint32_t primitiveMax = pIndices[first];
+			for (UINT i = 1; i < primitiveSize; ++i)
+			{
+				primitiveMin = std::min(primitiveMin, pIndices[first + i]);
+				primitiveMax = std::max(primitiveMax, pIndices[first + i]);
+			}
+
+			if (primitiveMax - primitiveMin > kMax16BitIndex)
+				return false;
+
+			uint32_t newMin = std::min(rangeMin, primitiveMin);
+			uint32_t newMax = std::max(rangeMax, primitiveMax);
+
+			// close the current range when this primitive would stretch it past 64K vertices
+			if (range.indexCount > 0 && newMax - newMin > kMax16BitIndex)
+			{
+				range.baseVertex = static_cast<INT>(rangeMin);
+				out_ranges.push_back(range);
+
+				range.startIndex = static_cast<UINT>(first);
+				range.indexCount = 0;
+				newMin = primitiveMin;
+				newMax = primitiveMax;
+			}
+
+			rangeMin = newMin;
+			rangeMax = newMax;
+			range.indexCount += primitiveSize;
+		}
+
+		if (range.indexCount > 0)
+		{
+			range.baseVertex = static_cast<INT>(rangeMin);
+			out_ranges.push_back(range);
+		}
+
+		return true;
+	}
+
+	void BuildIndexBufferData(const uint32_t* pIndices,
+		size_t numIndices,
+		UINT primitiveSize,
+		IndexFormatRequest request,
+		IndexBufferData& out)
+	{
+		out.ranges.clear();
+		out.bytes.clear();
+
+		if (request == kIndexFormat32Bit)
+		{
+			Encode32Bit(pIndices, numIndices, out);
+			return;
+		}
+
+		if (GetMaxIndex(pIndices, numIndices) <= kMax16BitIndex)
+		{
+			IndexDrawRange range = { 0, static_cast<UINT>(numIndices), 0 };
+			Encode16Bit(pIndices, std::vector< IndexDrawRange >(1, range), numIndices, out);
+			return;
+		}
+
+		std::vector< IndexDrawRange > ranges;
+		if (request == kIndexFormat16Bit && SplitInto16BitRanges(pIndices, numIndices, primitiveSize, ranges))
+		{
+			Encode16Bit(pIndices, ranges, numIndices, out);
+			return;
+		}
+
+		if (request == kIndexFormat16Bit)
+		{
+			printf("A primitive spans more than 64K vertices, using 32 bit indices\n");
+		}
+
+		Encode32Bit(pIndices, numIndices, out);
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+//Index width the caller wants for a mesh.
+enum IndexFormatRequest
+{
+	kIndexFormatAuto,  //16 bit when every index fits, 32 bit otherwise
+	kIndexFormat16Bit, //16 bit.  larger meshes are split into ranges of at most 64K vertices with a base vertex each
+	kIndexFormat32Bit  //always 32 bit, e.g. for shaders that read the index buffer as 32 bit words
+};
+
+//One DrawIndexedInstanced call.  The indices of the range are relative to baseVertex.
+struct IndexDrawRange
+{
+	UINT startIndex;
+	UINT indexCount;
+	INT baseVertex;
+};
+
+//CPU side contents of an index buffer, ready to be copied into a D3D resource
+struct IndexBufferData
+{
+	DXGI_FORMAT format = DXGI_FORMAT_R32_UINT;
+	std::vector< uint8_t > bytes;
+	std::vector< IndexDrawRange > ranges;
+
+	UINT GetIndexSize() const { return format == DXGI_FORMAT_R16_UINT ? 2 : 4; }
+	size_t GetNumIndices() const { return bytes.size() / GetIndexSize(); }
+};
+
+namespace DXIndexBufferBuilder
+{
+	//Pick the index width for a list of 32 bit indices and encode them.  primitiveSize is the number of indices per
+	//primitive (3 for triangle lists, 1 for point lists).  Ranges never split a primitive.  If a 16 bit split is
+	//impossible because a single primitive spans more than 64K vertices the indices stay 32 bit.
+	void BuildIndexBufferData(const uint32_t* pIndices,
+		size_t numIndices,
+		UINT primitiveSize,
+		IndexFormatRequest request,
+		IndexBufferData& out);
+
+	//greedy split of the primitive list into ranges whose vertices fit in a 64K window.  returns false if some
+	//primitive can not be placed in any range.
+	bool SplitInto16BitRanges(const uint32_t* pIndices,
+		size_t numIndices,
+		UINT primitiveSize,
+		std::vector< IndexDrawRange >& out_ranges);
+}
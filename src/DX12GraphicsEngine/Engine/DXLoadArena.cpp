@@ -0,0 +1,146 @@
+#include "stdafx.h"
+#include "DXLoadArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	const size_t kBlockAlignment = 64;
+
+	inline char* AlignUp(char* p, size_t alignment)
+	{
+		uintptr_t address = reinterpret_cast<uintptr_t>(p);
+		return reinterpret_cast<char*>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+	}
+}
+
+DXLoadArena::DXLoadArena(size_t blockSize, std::pmr::memory_resource* pUpstream) :
+	m_pUpstream(pUpstream)
+	, m_MinBlockSize(std::max< size_t >(blockSize, kBlockAlignment))
+	, m_BlockSize(m_MinBlockSize)
+	, m_UsedInFullBlocks(0)
+	, m_pCurrent(nullptr)
+	, m_pEnd(nullptr)
+{
+
+}
+
+DXLoadArena::~DXLoadArena()
+{
+	Release();
+}
+
+DXLoadArena& DXLoadArena::GetThreadArena()
+{
+	thread_local DXLoadArena arena;
+	return arena;
+}
+
+void* DXLoadArena::do_allocate(size_t bytes, size_t alignment)
+{
+	char* p = AlignUp(m_pCurrent, alignment);
+	if (!m_pCurrent || p + bytes > m_pEnd)
+	{
+		AddBlock(bytes + alignment);
+		p = AlignUp(m_pCurrent, alignment);
+	}
+
+	m_pCurrent = p + bytes;
+
+	m_Stats.numAllocations++;
+	m_Stats.bytesAllocated += bytes;
+	m_Stats.peakBytes = std::max(m_Stats.peakBytes, GetBytesInUse());
+	return p;
+}
+
+void DXLoadArena::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+	// freed all at once by Reset
+}
+
+bool DXLoadArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+void DXLoadArena::AddBlock(size_t minSize)
+{
+	if (!m_Blocks.empty())
+	{
+		m_UsedInFullBlocks += m_pCurrent - m_Blocks.back().pData;
+	}
+
+	// a block that is too small for the request only wastes its tail, the next one is at least twice as large
+	size_t size = std::max(m_BlockSize, minSize);
+	Block block = { static_cast<char*>(m_pUpstream->allocate(size, kBlockAlignment)), size };
+	m_Blocks.push_back(block);
+
+	m_BlockSize = std::max(m_BlockSize, size) * 2;
+	m_pCurrent = block.pData;
+	m_pEnd = block.pData + size;
+
+	m_Stats.numHeapAllocations++;
+}
+
+size_t DXLoadArena::GetBytesInUse() const
+{
+	return m_Blocks.empty() ? 0 : m_UsedInFullBlocks + (m_pCurrent - m_Blocks.back().pData);
+}
+
+size_t DXLoadArena::GetBytesReserved() const
+{
+	size_t size = 0;
+	for (const Block& block : m_Blocks)
+	{
+		size += block.size;
+	}
+	return size;
+}
+
+void DXLoadArena::Reserve(size_t numBytes)
+{
+	if (!m_pCurrent || static_cast<size_t>(m_pEnd - m_pCurrent) < numBytes)
+	{
+		AddBlock(numBytes + kBlockAlignment);
+	}
+}
+
+void DXLoadArena::Reset()
+{
+	// one block is kept for the next load.  after a load that needed several blocks they are replaced by one
+	// block a little larger than the peak, taken on the first allocation of the next load.
+	size_t peakBytes = m_Stats.peakBytes;
+
+	if (m_Blocks.size() > 1 || GetBytesReserved() > kMaxRetainedBytes)
+	{
+		Release();
+
+		if (peakBytes <= kMaxRetainedBytes)
+		{
+			m_BlockSize = std::max(m_MinBlockSize, peakBytes + peakBytes / 8);
+		}
+	}
+
+	if (!m_Blocks.empty())
+	{
+		m_pCurrent = m_Blocks.back().pData;
+	}
+
+	m_UsedInFullBlocks = 0;
+	m_Stats = DXLoadArenaStats();
+}
+
+void DXLoadArena::Release()
+{
+	for (const Block& block : m_Blocks)
+	{
+		m_pUpstream->deallocate(block.pData, block.size, kBlockAlignment);
+	}
+
+	m_Blocks.clear();
+	m_BlockSize = m_MinBlockSize;
+	m_UsedInFullBlocks = 0;
+	m_pCurrent = nullptr;
+	m_pEnd = nullptr;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+//Counters of one DXLoadArena since the last Reset
+struct DXLoadArenaStats
+{
+	size_t numAllocations = 0;       //allocate calls served by the arena
+	size_t bytesAllocated = 0;       //sum of their sizes, padding not included
+	size_t peakBytes = 0;            //largest amount of block memory in use at once, padding included
+	size_t numHeapAllocations = 0;   //blocks taken from the upstream resource, the real heap allocations
+};
+
+//Linear allocator for load time scratch memory.  Allocations bump a pointer in the current block and are never
+//freed one by one, deallocate does nothing.  Reset() hands everything back at once when a load is done and keeps
+//one block large enough for the last load, so loading assets of similar size takes no heap allocation at all.
+//Derives from std::pmr::memory_resource so the loaders can put std::pmr::vector temporaries in it.
+//Not thread safe, every loading thread has its own arena (GetThreadArena).
+class DXLoadArena : public std::pmr::memory_resource
+{
+public:
+	static const size_t kDefaultBlockSize = 1 << 20;
+	static const size_t kMaxRetainedBytes = 64 << 20; //Reset frees larger blocks instead of keeping them around
+
+	explicit DXLoadArena(size_t blockSize = kDefaultBlockSize,
+		std::pmr::memory_resource* pUpstream = std::pmr::new_delete_resource());
+	~DXLoadArena();
+
+	DXLoadArena(const DXLoadArena&) = delete;
+	DXLoadArena& operator=(const DXLoadArena&) = delete;
+
+	//the arena of the calling thread, created on first use
+	static DXLoadArena& GetThreadArena();
+
+	//make sure the next numBytes can be allocated without another heap allocation
+	void Reserve(size_t numBytes);
+
+	//invalidate all allocations and clear the counters.  call it at the start of a load.
+	void Reset();
+
+	//return every block to the upstream resource
+	void Release();
+
+	const DXLoadArenaStats& GetStats() const { return m_Stats; }
+	size_t GetBytesReserved() const;
+
+	//uninitialized array of count Ts, the usual way to get a scratch buffer that is not a vector
+	template< typename T >
+	T* AllocateArray(size_t count) { return static_cast<T*>(allocate(count * sizeof(T), alignof(T))); }
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+	struct Block
+	{
+		char* pData;
+		size_t size;
+	};
+
+	void AddBlock(size_t minSize);
+	size_t GetBytesInUse() const;
+
+	std::pmr::memory_resource* m_pUpstream;
+	std::vector< Block > m_Blocks;   //the last one is the current block
+	size_t m_MinBlockSize;
+	size_t m_BlockSize;              //size of the next block, doubles with every block
+	size_t m_UsedInFullBlocks;       //bytes used in the blocks before the current one
+	char* m_pCurrent;
+	char* m_pEnd;
+	DXLoadArenaStats m_Stats;
+};
@@ -0,0 +1,94 @@
+#include "stdafx.h"
+#include "DXMemoryMappedFile.h"
+
+DXMemoryMappedFile::DXMemoryMappedFile() :
+	m_hFile(INVALID_HANDLE_VALUE)
+	, m_hMapping(nullptr)
+	, m_pData(nullptr)
+	, m_Size(0)
+{
+
+}
+
+DXMemoryMappedFile::~DXMemoryMappedFile()
+{
+	Close();
+}
+
+bool DXMemoryMappedFile::Open(const char* path)
+{
+	Close();
+
+	m_hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	return MapOpenedFile();
+}
+
+bool DXMemoryMappedFile::Open(const wchar_t* path)
+{
+	Close();
+
+	m_hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	return MapOpenedFile();
+}
+
+bool DXMemoryMappedFile::MapOpenedFile()
+{
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(m_hFile, &fileSize))
+	{
+		Close();
+		return false;
+	}
+
+	m_Size = static_cast<size_t>(fileSize.QuadPart);
+
+	//a zero length file cannot be mapped.  leave the file open with an empty view so callers see 0 bytes.
+	if (m_Size == 0)
+		return true;
+
+	m_hMapping = CreateFileMapping(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_hMapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_pData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void DXMemoryMappedFile::Close()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+		m_pData = nullptr;
+	}
+
+	if (m_hMapping)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+
+	m_Size = 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+//Read only view of an entire file mapped into the address space of the process.  The OS pages the file in
+//on demand, so nothing is copied into a heap buffer and the parsers can tokenize straight out of the mapping.
+//The view stays valid until Close() is called or the object is destroyed.
+class DXMemoryMappedFile
+{
+public:
+	DXMemoryMappedFile();
+	~DXMemoryMappedFile();
+
+	DXMemoryMappedFile(const DXMemoryMappedFile&) = delete;
+	DXMemoryMappedFile& operator=(const DXMemoryMappedFile&) = delete;
+
+	bool Open(const char* path);
+	bool Open(const wchar_t* path);
+	void Close();
+
+	bool IsOpen() const { return m_hFile != INVALID_HANDLE_VALUE; }
+
+	const char* GetData() const { return m_pData; }
+	const char* GetEnd() const { return m_pData + m_Size; }
+	size_t GetSize() const { return m_Size; }
+
+protected:
+	bool MapOpenedFile();
+
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+	const char* m_pData;
+	size_t m_Size;
+};
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "DXMesh.h"
 #include "DXCamera.h"
+#include "DXObjParser.h"
 
 #include <stdio.h>
 #include <string>
@@ -10,6 +11,7 @@
 
 #include <assert.h>
 #include <sstream>
+#include <chrono>
 
 
 using namespace std;
@@ -20,10 +22,17 @@ using namespace DirectX;
 
 // constructor
 DXMesh::DXMesh() :
-	m_cbDescriptorIndex(0)
+	m_unVertexCount(0)
+	, mNumIndices(0)
+	, m_cbDescriptorIndex(0)
 	, m_pConstantBufferData(nullptr)
 	, m_ModelID(0)
 	, m_bReceiveShadow(false)
+	, m_bOptimizeMesh(false)
+	, m_bUseMeshCache(true)
+	, m_VertexFormat(kMeshVertexFormatFull)
+	, m_LODCount(1)
+	, m_CurrentLOD(0)
 	, m_pDXCamera(nullptr)
 {
 	
@@ -40,325 +49,544 @@ DXMesh::~DXMesh()
 
 bool DXMesh::LoadOBJ(
     const char *                           path,
-    std::vector< DXGraphicsUtilities::vec3 > & out_vertices,
-    std::vector< DXGraphicsUtilities::vec2 > & out_uvs,
-    std::vector< DXGraphicsUtilities::vec3 > & out_normals,
+    DXMeshData &                           out_data,
     bool                                   bFlipWinding
     )
 {
+    std::vector< DXGraphicsUtilities::MeshVertexPosNormUV0 > & out_vertices = out_data.vertices;
+    std::vector< uint32_t > & out_indices = out_data.indices;
+
     printf( "Loading OBJ file %s...\n", path );
 
-    std::vector< unsigned int > vertexIndices, uvIndices, normalIndices;
-    std::vector< DXGraphicsUtilities::vec3 > temp_vertices;
-    std::vector< DXGraphicsUtilities::vec2 > temp_uvs;
-    std::vector< DXGraphicsUtilities::vec3 > temp_normals;
-
-    // open the file and read it into char buffer
-    std::ifstream infile;
-    infile.open( path, std::ios::binary );
-    infile.seekg( 0, std::ios::end );
-    size_t fileSize = infile.tellg();
-    std::vector< char > buffer; // used to store text data
-    buffer.resize( fileSize );
-    infile.seekg( 0, std::ios::beg );
-    infile.read( &buffer[0], fileSize );
-
-    std::string strBuffer( buffer.data(), fileSize );
-    std::stringstream ss( strBuffer );
-
-	const int scanf_buffer_sz = 512; //hack since we switched from sscanf to sscanf_s
-    std::string strLine;
-    while ( std::getline( ss, strLine, '\n' ) )
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // tokenize the memory mapped file into indexed positions, uvs and normals
+    ObjMeshData objData;
+    if ( !DXObjParser::ParseFile( path, objData, bFlipWinding ) )
     {
-        const char * lineHeader = strLine.c_str();
-        char firstWord[scanf_buffer_sz];
-        sscanf_s( lineHeader, "%s", firstWord, scanf_buffer_sz);
-
-        // get second word in string.  this is start of actual data
-        int    firstWordLength = static_cast< int >( strlen( firstWord ) );
-        char * it              = const_cast< char * >( lineHeader ) + firstWordLength;
-        while ( *it == ' ' || *it == '\t' || *it == '\0' )
-        {
-            it++;
-        }
+        return false;
+    }
 
-        char * secondWord = it;
+    // For each vertex of each triangle put the attributes in a scratch buffer, it is only needed by the weld
+    DXLoadArena& arena = DXLoadArena::GetThreadArena();
+    size_t numCorners = objData.corners.size();
+    DXGraphicsUtilities::MeshVertexPosNormUV0* pCornerVertices = arena.AllocateArray< DXGraphicsUtilities::MeshVertexPosNormUV0 >( numCorners );
+    DXObjParser::ExpandCorners( objData, pCornerVertices );
 
-        if ( strcmp( firstWord, "v" ) == 0 )
-        {
-            DXGraphicsUtilities::vec3 vertex;
-            sscanf_s( secondWord, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-            temp_vertices.push_back( vertex );
-        }
-        else if ( strcmp( firstWord, "vt" ) == 0 )
-        {
-            DXGraphicsUtilities::vec2 uv;
-            sscanf_s( secondWord, "%f %f\n", &uv.x, &uv.y);
-            // uv.y = -uv.y; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if
-            // you want to use TGA or BMP loaders.
-            temp_uvs.push_back( uv );
-        }
-        else if ( strcmp( firstWord, "vn" ) == 0 )
-        {
-            DXGraphicsUtilities::vec3 normal;
-            sscanf_s( secondWord, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-            temp_normals.push_back( normal );
-        }
-        else if ( strcmp( firstWord, "f" ) == 0 )
-        {
-            std::string  vertex1, vertex2, vertex3;
-            unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-			int matches = sscanf_s(secondWord,
-				"%d/%d/%d %d/%d/%d %d/%d/%d\n",
-				&vertexIndex[0],
-				&uvIndex[0],
-				&normalIndex[0],
-				&vertexIndex[1],
-				&uvIndex[1],
-				&normalIndex[1],
-				&vertexIndex[2],
-				&uvIndex[2],
-				&normalIndex[2]);
-            if ( matches != 9 )
-            {
-                printf( "File can't be read by our simple parser :-( Try exporting with other options\n" );
-                return false;
-            }
-            if ( bFlipWinding )
-            {
-                vertexIndices.push_back( vertexIndex[0] );
-                vertexIndices.push_back( vertexIndex[2] );
-                vertexIndices.push_back( vertexIndex[1] );
-            }
-            else
-            {
-                vertexIndices.push_back( vertexIndex[0] );
-                vertexIndices.push_back( vertexIndex[1] );
-                vertexIndices.push_back( vertexIndex[2] );
-            }
-
-            uvIndices.push_back( uvIndex[0] );
-            uvIndices.push_back( uvIndex[1] );
-            uvIndices.push_back( uvIndex[2] );
-            normalIndices.push_back( normalIndex[0] );
-            normalIndices.push_back( normalIndex[1] );
-            normalIndices.push_back( normalIndex[2] );
-        }
-        else
-        {
-            // Probably a comment, eat up the rest of the line
-            // char stupidBuffer[1000];
-            // fgets(stupidBuffer, 1000, file);
-        }
+    std::chrono::duration<double, std::milli> parseTime = std::chrono::high_resolution_clock::now() - start;
+
+    // merge the corners that share position, normal and uv
+    WeldStats weldStats;
+    DXMeshWelder::WeldVertices( pCornerVertices, numCorners, m_WeldOptions, out_vertices, out_indices, &weldStats, &arena );
+
+    m_LoadStats.numTriangles = objData.GetTriangleCount();
+    m_LoadStats.numSourceVertices = weldStats.numInputVertices;
+    m_LoadStats.numVertices = weldStats.numOutputVertices;
+    m_LoadStats.parseMs = parseTime.count();
+    m_LoadStats.weldMs = weldStats.weldMs;
+
+    printf( "  %zu triangles, welded %zu -> %zu vertices (%.2fx) in %.2f ms\n", m_LoadStats.numTriangles,
+        weldStats.numInputVertices, weldStats.numOutputVertices, weldStats.GetReductionRatio(), weldStats.weldMs );
+
+    // one contiguous range of triangles per usemtl material
+    std::vector< ObjSubset > subsets;
+    DXObjParser::SortByMaterial( objData, out_indices, subsets );
+
+    std::vector< size_t > subsetStarts;
+    out_data.submeshes.clear();
+    for ( const ObjSubset& subset : subsets )
+    {
+        MeshCacheSubmesh submesh = { subset.startIndex, subset.indexCount, subset.material, 0 };
+        out_data.submeshes.push_back( submesh );
+        subsetStarts.push_back( subset.startIndex );
     }
 
+    out_data.materialLibrary = objData.materialLibrary;
+    out_data.materialNames = objData.materials;
 
-    // For each vertex of each triangle
-    int numIndices = static_cast< int >( vertexIndices.size() );
+    if ( subsets.size() > 1 )
+    {
+        printf( "  %zu material subsets\n", subsets.size() );
+    }
 
-    for ( int i = 0; i < numIndices; i++ )
+    m_LoadStats.bOptimized = m_bOptimizeMesh;
+    if ( m_bOptimizeMesh )
     {
-        // Get the indices of its attributes
-        unsigned int vertexIndex = vertexIndices[i];
-        unsigned int uvIndex     = uvIndices[i];
-        unsigned int normalIndex = normalIndices[i];
-
-        // Get the attributes thanks to the index
-        DXGraphicsUtilities::vec3 vertex = temp_vertices[vertexIndex - 1];
-        DXGraphicsUtilities::vec2 uv     = temp_uvs[uvIndex - 1];
-        DXGraphicsUtilities::vec3 normal = temp_normals[normalIndex - 1];
-
-        // Put the attributes in buffers
-        out_vertices.push_back( vertex );
-        out_uvs.push_back( uv );
-        out_normals.push_back( normal );
+        // triangles stay inside their subset, the vertices are shared by all of them
+        MeshOptimizeStats& optimizeStats = m_LoadStats.optimizeStats;
+        DXMeshOptimizer::OptimizeMesh( out_vertices, out_indices, subsetStarts, &optimizeStats );
+
+        printf( "  optimized in %.2f ms, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (FIFO %u)\n", optimizeStats.optimizeMs,
+            optimizeStats.before.acmr, optimizeStats.after.acmr, optimizeStats.before.atvr, optimizeStats.after.atvr,
+            DXMeshOptimizer::kDefaultCacheSize );
     }
 
     return true;
 }
 
-HRESULT DXMesh::LoadModelFromFile(const char* filename, ID3D12Device* pd3dDevice)
+HRESULT DXMesh::LoadModelFromFile(const char* filename, ID3D12Device* pd3dDevice, IndexFormatRequest indexFormat)
 {
     mpd3dDevice = pd3dDevice;
 
-    std::vector< DXGraphicsUtilities::vec3 >* out_vertices = new std::vector< DXGraphicsUtilities::vec3 >();
-    std::vector< DXGraphicsUtilities::vec2 >* out_uvs = new std::vector< DXGraphicsUtilities::vec2 >();
-    std::vector< DXGraphicsUtilities::vec3 >* out_normals = new std::vector< DXGraphicsUtilities::vec3 >();
-
     bool bFlipWinding = false;
 
-    // load data for the vertex position, normals, and uvs into speparate vectors
-    bool bLoaded = LoadOBJ(
+    // load the welded vertices and the index list
+    DXMeshData meshData;
+    bool bLoaded = LoadMeshData(
         filename,
-        *out_vertices,
-        *out_uvs,
-        *out_normals,
-        bFlipWinding);
+        bFlipWinding,
+        meshData);
 
     assert(bLoaded && "Failed to load obj file\n");
-    assert(out_vertices->size() == out_uvs->size());
 
-    int numberOfVertices = static_cast<int>(out_vertices->size());
-    int numberOfIndices = numberOfVertices;
+    // the materials of the subsets, DXModel loads their textures and Render binds them per subset
+    LoadMaterials(filename, meshData);
+
+    //create vertex buffer, index buffer, vertexbuffer 
+    m_LODs.clear();
+    m_CurrentLOD = 0;
+    CreateVertexAndIndexBuffers(pd3dDevice, meshData.pVertices, meshData.numVertices, meshData.pIndices, meshData.numIndices, indexFormat);
+    m_Bounds = meshData.bounds;
+
+    return S_OK;
+}
 
+bool DXMesh::LoadMeshData(const char* filename, bool bFlipWinding, DXMeshData& out_data)
+{
+    m_LoadStats = DXMeshLoadStats();
 
-    int triangleCount = numberOfIndices / 3;
+    // everything the load allocates in the arena is released by the next load on this thread
+    DXLoadArena& arena = DXLoadArena::GetThreadArena();
+    arena.Reset();
 
-    // create an index array.  vertices are in the vector in proper order already
+    MeshCacheOptions cacheOptions;
+    cacheOptions.weldOptions = m_WeldOptions;
+    cacheOptions.bFlipWinding = bFlipWinding;
+    cacheOptions.bOptimize = m_bOptimizeMesh;
+    uint64_t optionsHash = DXMeshCache::HashOptions(cacheOptions);
 
-    std::vector<UINT> meshIndicesVector;
+    std::string cachePath = DXMeshCache::GetCachePath(filename);
+    uint64_t sourceHash = 0;
+    uint64_t sourceSize = 0;
+    bool bSourceHashed = false;
 
-    int i = 0;
-    for (i = 0; i < numberOfIndices; ++i)
+    if (m_bUseMeshCache)
     {
-        meshIndicesVector.push_back(i);
-        m_Indices.push_back(i);
-		m_Indices32bit.push_back(i);
+        auto start = std::chrono::high_resolution_clock::now();
+
+        bSourceHashed = DXMeshCache::HashFile(filename, sourceHash, sourceSize);
+        if (bSourceHashed && out_data.cacheFile.Open(cachePath.c_str(), sourceHash, optionsHash))
+        {
+            out_data.UseCacheFile();
+
+            std::chrono::duration<double, std::milli> cacheTime = std::chrono::high_resolution_clock::now() - start;
+            m_LoadStats.numTriangles = out_data.numIndices / 3;
+            m_LoadStats.numVertices = out_data.numVertices;
+            m_LoadStats.bOptimized = m_bOptimizeMesh;
+            m_LoadStats.bFromCache = true;
+            m_LoadStats.cacheMs = cacheTime.count();
+
+            printf( "Loaded cached mesh %s: %zu triangles, %zu vertices in %.2f ms\n", cachePath.c_str(),
+                m_LoadStats.numTriangles, m_LoadStats.numVertices, m_LoadStats.cacheMs );
+            return true;
+        }
     }
 
-    mNumIndices = numberOfIndices;
+    if ( !LoadOBJ( filename, out_data, bFlipWinding ) )
+    {
+        return false;
+    }
+    out_data.UseVectors();
 
-    //create vertex buffer, index buffer, vertexbuffer 
-    CreateVertexAndIndexBuffers(pd3dDevice, *out_vertices, *out_uvs, *out_normals, meshIndicesVector);
+    m_LoadStats.scratchStats = arena.GetStats();
+    printf( "  scratch %.2f MB in %zu allocations, %zu heap blocks\n", m_LoadStats.scratchStats.bytesAllocated / (1024.0 * 1024.0),
+        m_LoadStats.scratchStats.numAllocations, m_LoadStats.scratchStats.numHeapAllocations );
 
-    // delete the vectors
-    delete  out_vertices;
-    delete  out_uvs;
-    delete  out_normals;
+    if (bSourceHashed)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
 
-    return S_OK;
+        // missing or stale, write a new one for the next run
+        if (!DXMeshCache::WriteCacheFile(cachePath.c_str(), sourceHash, sourceSize, optionsHash,
+            out_data.pVertices, out_data.numVertices, out_data.pIndices, out_data.numIndices,
+            out_data.submeshes.data(), out_data.submeshes.size(), out_data.materialLibrary, out_data.materialNames))
+        {
+            printf( "  could not write mesh cache %s\n", cachePath.c_str() );
+        }
+
+        std::chrono::duration<double, std::milli> cacheTime = std::chrono::high_resolution_clock::now() - start;
+        m_LoadStats.cacheMs = cacheTime.count();
+    }
+
+    return true;
 }
 
 bool DXMesh::CreateVertexAndIndexBuffers(ID3D12Device  *pd3dDevice,
-    const std::vector< DXGraphicsUtilities::vec3 >& vertices,
-    const std::vector< DXGraphicsUtilities::vec2 >& uvs,
-    const std::vector< DXGraphicsUtilities::vec3 >& normals,
-    const std::vector<UINT>& meshIndices)
+    const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+    size_t numVertices,
+    const UINT* pMeshIndices,
+    size_t numIndices,
+    IndexFormatRequest indexFormat)
+{
+	// keep a copy of the vertices for the DXR scene
+	m_Vertices.assign(pVertices, pVertices + numVertices);
+
+	// Create and populate the vertex buffer
+	CreateVertexBuffer(pd3dDevice, pVertices, numVertices);
+
+	// Create and populate the index buffer
+	CreateIndexBuffer(pd3dDevice, pMeshIndices, numIndices, 3, indexFormat);
+
+	m_unVertexCount = numVertices;
+
+    return true;
+
+}
+
+void DXMesh::BuildLODs(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+	size_t numVertices,
+	const UINT* pMeshIndices,
+	size_t numIndices,
+	float scale,
+	std::vector< uint32_t >& out_indices)
 {
-	int numVerts = (int)vertices.size();
-	int sizeOfVert = sizeof(DXGraphicsUtilities::MeshVertexPosNormUV0);
-	void* vertexData = (void*)vertices.data();
-	int numTris = numVerts / 3;
-	void* indexData = (void*)meshIndices.data(); //data is WORD ie 16 bit int
+	auto start = std::chrono::high_resolution_clock::now();
 
-	// create a vertex array
-	DXGraphicsUtilities::MeshVertexPosNormUV0* verts = new DXGraphicsUtilities::MeshVertexPosNormUV0[numVerts];
+	LODChainOptions options;
+	options.numLODs = m_LODCount;
 
-	// create an array of vertices.  we will submit this to D3D to create a D3D vertex buffer resource
-	for (int i = 0; i < numVerts; ++i)
+	// the subsets are simplified on their own so no triangle changes its material.  positions used by more than one
+	// subset stay put so the subsets do not crack apart.
+	std::vector< uint8_t > sharedVertices;
+	if (m_Subsets.size() > 1)
 	{
-		DXGraphicsUtilities::MeshVertexPosNormUV0 v =
-		{ XMFLOAT3(vertices[i].x ,   vertices[i].y , vertices[i].z ),
-			XMFLOAT3(normals[i].x, normals[i].y, normals[i].z),
-			XMFLOAT2(uvs[i].x, uvs[i].y) };
+		std::vector< size_t > subsetStarts;
+		for (const MeshCacheSubmesh& subset : m_Subsets)
+		{
+			subsetStarts.push_back(subset.startIndex);
+		}
+		DXMeshSimplifier::FindSharedVertices(pVertices, numVertices, pMeshIndices, subsetStarts, numIndices, sharedVertices);
+	}
 
-		verts[i] = v;
-		m_Vertices.push_back(v);
+	std::vector< LODChainJob > jobs(m_Subsets.size());
+	for (size_t i = 0; i < m_Subsets.size(); ++i)
+	{
+		jobs[i].pVertices = pVertices;
+		jobs[i].numVertices = numVertices;
+		jobs[i].pIndices = pMeshIndices + m_Subsets[i].startIndex;
+		jobs[i].numIndices = m_Subsets[i].indexCount;
+		jobs[i].pLockedVertices = sharedVertices.empty() ? nullptr : sharedVertices.data();
 	}
 
-	// Create and populate the vertex buffer
+	DXMeshSimplifier::BuildLODChains(jobs, options);
+
+	size_t numLevels = 0;
+	for (const LODChainJob& job : jobs)
 	{
-		pd3dDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(numVerts * sizeOfVert),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_pVertexBuffer));
+		numLevels = std::max(numLevels, job.lods.size());
+	}
 
-		UINT8* pMappedBuffer;
-		CD3DX12_RANGE readRange(0, 0);
-		m_pVertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMappedBuffer));
-		memcpy(pMappedBuffer, verts, numVerts * sizeOfVert);
-		m_pVertexBuffer->Unmap(0, nullptr);
+	m_LODs.clear();
+	out_indices.clear();
 
-		m_vertexBufferView.BufferLocation = m_pVertexBuffer->GetGPUVirtualAddress();
-		m_vertexBufferView.StrideInBytes = sizeOfVert;
-		m_vertexBufferView.SizeInBytes = numVerts * sizeOfVert;
+	for (size_t level = 0; level < numLevels; ++level)
+	{
+		DXMeshLOD lod;
+		lod.startIndex = static_cast<UINT>(out_indices.size());
+
+		for (size_t i = 0; i < jobs.size(); ++i)
+		{
+			const LODChainJob& job = jobs[i];
+
+			DXMeshSubset subset;
+			subset.materialIndex = m_Subsets[i].materialIndex;
+
+			if (level < job.lods.size())
+			{
+				subset.startIndex = static_cast<UINT>(out_indices.size());
+				subset.indexCount = static_cast<UINT>(job.lods[level].indices.size());
+				out_indices.insert(out_indices.end(), job.lods[level].indices.begin(), job.lods[level].indices.end());
+				lod.error = std::max(lod.error, job.lods[level].error * scale);
+			}
+			else
+			{
+				// the chain of this subset ended, keep drawing its last level
+				subset.startIndex = m_LODs.back().subsets[i].startIndex;
+				subset.indexCount = m_LODs.back().subsets[i].indexCount;
+				lod.error = std::max(lod.error, job.lods.back().error * scale);
+			}
+
+			lod.subsets.push_back(subset);
+		}
+
+		lod.indexCount = static_cast<UINT>(out_indices.size()) - lod.startIndex;
+		m_LODs.push_back(lod);
+
+		UINT numLODTriangles = 0;
+		for (const DXMeshSubset& subset : lod.subsets)
+		{
+			numLODTriangles += subset.indexCount / 3;
+		}
+
+		printf("  lod %zu: %u triangles, error %g\n", level, numLODTriangles, lod.error);
 	}
 
-	// Create and populate the index buffer
+	std::chrono::duration<double, std::milli> lodTime = std::chrono::high_resolution_clock::now() - start;
+	m_LoadStats.numLODs = m_LODs.size();
+	m_LoadStats.lodMs = lodTime.count();
+}
+
+void DXMesh::LoadMaterials(const char* filename, const DXMeshData& meshData)
+{
+	m_Subsets = meshData.submeshes;
+	m_Materials.clear();
+
+	// mtllib and map_Kd paths are relative to the obj file
+	std::string directory(filename);
+	size_t separator = directory.find_last_of("/\\");
+	directory = separator == std::string::npos ? std::string() : directory.substr(0, separator + 1);
+
+	std::vector< ObjMaterial > libraryMaterials;
+	if (!meshData.materialLibrary.empty() &&
+		!DXObjParser::ParseMaterialLibrary((directory + meshData.materialLibrary).c_str(), libraryMaterials))
 	{
-		pd3dDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint32_t) * numTris * 3),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_pIndexBuffer));
+		printf("  could not open material library %s\n", (directory + meshData.materialLibrary).c_str());
+	}
 
-		UINT8* pMappedBuffer;
-		CD3DX12_RANGE readRange(0, 0);
-		m_pIndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMappedBuffer));
-		memcpy(pMappedBuffer, indexData, sizeof(uint32_t) * numTris * 3);
-		m_pIndexBuffer->Unmap(0, nullptr);
+	// a usemtl name missing from the library keeps the default material
+	size_t numMaterials = std::max< size_t >(meshData.materialNames.size(), 1);
+	for (size_t i = 0; i < numMaterials; ++i)
+	{
+		ObjMaterial material;
+		if (i < meshData.materialNames.size())
+		{
+			material.name = meshData.materialNames[i];
+		}
+
+		for (const ObjMaterial& libraryMaterial : libraryMaterials)
+		{
+			if (libraryMaterial.name == material.name)
+			{
+				material = libraryMaterial;
+				break;
+			}
+		}
+
+		if (!material.diffuseTexture.empty())
+		{
+			material.diffuseTexture = directory + material.diffuseTexture;
+		}
+
+		m_Materials.push_back(material);
+	}
 
-		m_indexBufferView.BufferLocation = m_pIndexBuffer->GetGPUVirtualAddress();
-		m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
-		m_indexBufferView.SizeInBytes = sizeof(uint32_t) * numTris * 3;
+	m_MaterialTextureHandles.clear();
+	m_LoadStats.numSubsets = m_Subsets.size();
+	m_LoadStats.numMaterials = m_Materials.size();
+}
+
+bool DXMesh::CreateVertexBuffer(ID3D12Device* pd3dDevice,
+	const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+	size_t numVertices)
+{
+	UINT sizeOfVert = DXVertexCompression::GetVertexStride(m_VertexFormat);
+	UINT vertexBufferSize = static_cast<UINT>(numVertices) * sizeOfVert;
+
+	m_VertexQuantization = VertexQuantization();
+	m_LoadStats.vertexFormat = m_VertexFormat;
+	m_LoadStats.compressionStats = VertexCompressionStats();
+
+	const void* pVertexData = pVertices;
+	std::vector< uint8_t > compactVertices;
+
+	if (m_VertexFormat != kMeshVertexFormatFull)
+	{
+		//quantize positions against the bounds of this mesh, the renderer undoes it with GetDequantizationMatrix
+		m_VertexQuantization = DXVertexCompression::ComputeQuantization(DXMeshCache::ComputeBounds(pVertices, numVertices));
+
+		VertexCompressionStats& stats = m_LoadStats.compressionStats;
+		DXVertexCompression::EncodeVertices(pVertices, numVertices, m_VertexFormat, m_VertexQuantization, compactVertices, &stats);
+		pVertexData = compactVertices.data();
+
+		printf("  %u byte vertices: %zu -> %zu bytes, max error position %g normal %.3f deg uv %g\n", sizeOfVert,
+			stats.sourceBytes, stats.compressedBytes, stats.maxPositionError, stats.maxNormalErrorDegrees, stats.maxUVError);
 	}
 
-    return true;
+	pd3dDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_pVertexBuffer));
 
+	UINT8* pMappedBuffer;
+	CD3DX12_RANGE readRange(0, 0);
+	m_pVertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMappedBuffer));
+	memcpy(pMappedBuffer, pVertexData, vertexBufferSize);
+	m_pVertexBuffer->Unmap(0, nullptr);
+
+	m_vertexBufferView.BufferLocation = m_pVertexBuffer->GetGPUVirtualAddress();
+	m_vertexBufferView.StrideInBytes = sizeOfVert;
+	m_vertexBufferView.SizeInBytes = vertexBufferSize;
+
+	return true;
+}
+
+XMMATRIX DXMesh::GetDequantizationMatrix()
+{
+	if (m_VertexFormat == kMeshVertexFormatFull)
+		return XMMatrixIdentity();
+
+	const XMFLOAT3& offset = m_VertexQuantization.positionOffset;
+	const XMFLOAT3& scale = m_VertexQuantization.positionScale;
+	return XMMatrixScaling(scale.x, scale.y, scale.z) * XMMatrixTranslation(offset.x, offset.y, offset.z);
+}
+
+bool DXMesh::CreateIndexBuffer(ID3D12Device* pd3dDevice,
+	const UINT* pMeshIndices,
+	size_t numIndices,
+	UINT primitiveSize,
+	IndexFormatRequest indexFormat)
+{
+	IndexBufferData indexData;
+	DXIndexBufferBuilder::BuildIndexBufferData(pMeshIndices, numIndices, primitiveSize, indexFormat, indexData);
+
+	UINT indexBufferSize = static_cast<UINT>(indexData.bytes.size());
+
+	pd3dDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_pIndexBuffer));
+
+	UINT8* pMappedBuffer;
+	CD3DX12_RANGE readRange(0, 0);
+	m_pIndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMappedBuffer));
+	memcpy(pMappedBuffer, indexData.bytes.data(), indexBufferSize);
+	m_pIndexBuffer->Unmap(0, nullptr);
+
+	m_indexBufferView.BufferLocation = m_pIndexBuffer->GetGPUVirtualAddress();
+	m_indexBufferView.Format = indexData.format;
+	m_indexBufferView.SizeInBytes = indexBufferSize;
+
+	m_IndexRanges = indexData.ranges;
+	mNumIndices = numIndices;
+
+	// without simplified levels the whole index buffer is level 0 and holds the subsets.  each subset draws the
+	// part of the index buffer ranges that falls inside it, a 16 bit range may be shared by two subsets or levels.
+	if (m_LODs.empty())
+	{
+		DXMeshLOD lod;
+		lod.indexCount = static_cast<UINT>(numIndices);
+
+		for (const MeshCacheSubmesh& submesh : m_Subsets)
+		{
+			DXMeshSubset subset;
+			subset.startIndex = submesh.startIndex;
+			subset.indexCount = submesh.indexCount;
+			subset.materialIndex = submesh.materialIndex;
+			lod.subsets.push_back(subset);
+		}
+
+		if (lod.subsets.empty())
+		{
+			DXMeshSubset subset;
+			subset.indexCount = static_cast<UINT>(numIndices);
+			lod.subsets.push_back(subset);
+		}
+
+		m_LODs.push_back(lod);
+	}
+
+	for (DXMeshLOD& lod : m_LODs)
+	{
+		for (DXMeshSubset& subset : lod.subsets)
+		{
+			subset.ranges.clear();
+			for (const IndexDrawRange& range : m_IndexRanges)
+			{
+				UINT begin = std::max(range.startIndex, subset.startIndex);
+				UINT end = std::min(range.startIndex + range.indexCount, subset.startIndex + subset.indexCount);
+				if (begin < end)
+				{
+					IndexDrawRange clipped = { begin, end - begin, range.baseVertex };
+					subset.ranges.push_back(clipped);
+				}
+			}
+		}
+	}
+
+	//store the indices for debugging and the DXR scene
+	m_Indices32bit.assign(pMeshIndices, pMeshIndices + numIndices);
+	if (indexData.format == DXGI_FORMAT_R16_UINT)
+	{
+		const uint16_t* pIndices16 = reinterpret_cast<const uint16_t*>(indexData.bytes.data());
+		m_Indices.assign(pIndices16, pIndices16 + mNumIndices);
+	}
+	else
+	{
+		m_Indices.clear();
+	}
+
+	m_LoadStats.numIndices = mNumIndices;
+	m_LoadStats.indexSize = indexData.GetIndexSize();
+	m_LoadStats.numDrawRanges = m_IndexRanges.size();
+	m_LoadStats.indexBufferBytes = indexBufferSize;
+	m_LoadStats.indexBytesSaved = mNumIndices * sizeof(uint32_t) - indexBufferSize;
+
+	printf("  %zu indices, %u bit, %zu draw range(s), index buffer %zu bytes (saved %zu bytes)\n", mNumIndices,
+		m_LoadStats.indexSize * 8, m_LoadStats.numDrawRanges, m_LoadStats.indexBufferBytes, m_LoadStats.indexBytesSaved);
+
+	return true;
 }
 
 HRESULT DXMesh::LoadModelFromFile( const char *          filename,
 								   ComPtr<ID3D12Device>        pd3dDevice,
 								   ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
 								   int cbDescriptorIndex,
-                                   float                 scale )
+                                   float                 scale,
+                                   IndexFormatRequest    indexFormat )
 {
     mpd3dDevice        = pd3dDevice;
 	m_pCBVSRVHeap = pCBVSRVHeap;
 	m_cbDescriptorIndex = cbDescriptorIndex;
 
-    std::vector< DXGraphicsUtilities::vec3 > * out_vertices = new std::vector< DXGraphicsUtilities::vec3 >();
-    std::vector< DXGraphicsUtilities::vec2 > * out_uvs      = new std::vector< DXGraphicsUtilities::vec2 >();
-    std::vector< DXGraphicsUtilities::vec3 > * out_normals  = new std::vector< DXGraphicsUtilities::vec3 >();
-
-
     bool bFlipWinding = false;
 
-    // load data for the vertex position, normals, and uvs into speparate vectors
-    bool bLoaded = LoadOBJ(
+    // load the welded vertices and the index list
+    DXMeshData meshData;
+    bool bLoaded = LoadMeshData(
         filename,
-        *out_vertices,
-        *out_uvs,
-        *out_normals,
-        bFlipWinding );
+        bFlipWinding,
+        meshData );
 
     assert( bLoaded && "Failed to load obj file\n" );
-    assert( out_vertices->size() == out_uvs->size() );
-
-    int numberOfVertices = static_cast< int >( out_vertices->size() );
-    int numberOfIndices  = numberOfVertices;
-
-
-    int triangleCount = numberOfIndices / 3;
 
-    // create an index array.  vertices are in the vector in proper order already
-   
-	std::vector<WORD> meshIndicesVector;
+	LoadMaterials(filename, meshData);
 
-    int i = 0;
-    for ( i = 0; i < numberOfIndices; ++i )
-    {
-		meshIndicesVector.push_back(i);
-        m_Indices.push_back(i);
-		m_Indices32bit.push_back(i);
-    }
+	// the simplified levels go after the full mesh in the same index buffer
+	std::vector< uint32_t > lodIndices;
+	const UINT* pIndices = meshData.pIndices;
+	size_t numIndices = meshData.numIndices;
 
-    mNumIndices = numberOfIndices;
+	m_LODs.clear();
+	m_CurrentLOD = 0;
+	if (m_LODCount > 1)
+	{
+		BuildLODs(meshData.pVertices, meshData.numVertices, meshData.pIndices, meshData.numIndices, scale, lodIndices);
+		pIndices = lodIndices.data();
+		numIndices = lodIndices.size();
+	}
 
-   
 	//create vertex buffer, index buffer, vertexbuffer  view, index buffer view, constant buffer view
-	CreateD3DResources(pd3dDevice, pCBVSRVHeap, m_cbDescriptorIndex, *out_vertices, *out_uvs, *out_normals, meshIndicesVector, scale);
-	
-
-    // delete the vectors
-    delete  out_vertices;
-    delete  out_uvs;
-    delete  out_normals;
+	CreateD3DResources(pd3dDevice, pCBVSRVHeap, m_cbDescriptorIndex, meshData.pVertices, meshData.numVertices,
+		pIndices, numIndices, indexFormat, scale);
 
- 
+	m_Bounds = meshData.bounds;
+	m_Bounds.mMin = XMFLOAT3(m_Bounds.mMin.x * scale, m_Bounds.mMin.y * scale, m_Bounds.mMin.z * scale);
+	m_Bounds.mMax = XMFLOAT3(m_Bounds.mMax.x * scale, m_Bounds.mMax.y * scale, m_Bounds.mMax.z * scale);
+	
 
 	return S_OK;
 }
@@ -366,76 +594,28 @@ HRESULT DXMesh::LoadModelFromFile( const char *          filename,
 bool DXMesh::CreateD3DResources(ComPtr<ID3D12Device>        pDevice,
 	ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
 	int cbDescriptorIndex,
-	const std::vector< DXGraphicsUtilities::vec3 > &vertices,
-	const std::vector< DXGraphicsUtilities::vec2 > & uvs,
-	const std::vector< DXGraphicsUtilities::vec3 > & normals,
-	const std::vector<WORD> & meshIndices,
+	const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+	size_t numVertices,
+	const UINT* pMeshIndices,
+	size_t numIndices,
+	IndexFormatRequest indexFormat,
 	float scale)
 {
 	m_cbDescriptorIndex = cbDescriptorIndex;
 	m_pCBVSRVHeap = pCBVSRVHeap;
 
-	int numVerts = (int)vertices.size();
-	int sizeOfVert = sizeof(DXGraphicsUtilities::MeshVertexPosNormUV0);
-	void *vertexData = (void*)vertices.data();
-	int numTris = numVerts/3;
-	void *indexData = (void*)meshIndices.data(); //data is WORD ie 16 bit int
-
-												 // create a vertex array
-	DXGraphicsUtilities::MeshVertexPosNormUV0 * verts = new DXGraphicsUtilities::MeshVertexPosNormUV0[numVerts];
-
-	
-	// create an array of vertices.  we will submit this to D3D to create a D3D vertex buffer resource
-	for (int i = 0; i < numVerts; ++i)
+	// scale the vertices.  we will submit this to D3D to create a D3D vertex buffer resource
+	m_Vertices.assign(pVertices, pVertices + numVertices);
+	for (DXGraphicsUtilities::MeshVertexPosNormUV0& v : m_Vertices)
 	{
-		DXGraphicsUtilities::MeshVertexPosNormUV0 v =
-		{ XMFLOAT3(vertices[i].x * scale,   vertices[i].y * scale, vertices[i].z * scale),
-			XMFLOAT3(normals[i].x, normals[i].y, normals[i].z),
-			XMFLOAT2(uvs[i].x, uvs[i].y) };
-
-		verts[i] = v;
-        m_Vertices.push_back(v);
+		v.position = XMFLOAT3(v.position.x * scale, v.position.y * scale, v.position.z * scale);
 	}
 
 	// Create and populate the vertex buffer
-	{
-		pDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(numVerts *sizeOfVert),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_pVertexBuffer));
-
-		UINT8 *pMappedBuffer;
-		CD3DX12_RANGE readRange(0, 0);
-		m_pVertexBuffer->Map(0, &readRange, reinterpret_cast< void** >(&pMappedBuffer));
-		memcpy(pMappedBuffer, verts, numVerts *sizeOfVert);
-		m_pVertexBuffer->Unmap(0, nullptr);
-
-		m_vertexBufferView.BufferLocation = m_pVertexBuffer->GetGPUVirtualAddress();
-		m_vertexBufferView.StrideInBytes = sizeOfVert;
-		m_vertexBufferView.SizeInBytes = numVerts *sizeOfVert;
-	}
+	CreateVertexBuffer(pDevice.Get(), m_Vertices.data(), m_Vertices.size());
 
 	// Create and populate the index buffer
-	{
-		pDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint16_t) * numTris * 3),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_pIndexBuffer));
-
-		UINT8 *pMappedBuffer;
-		CD3DX12_RANGE readRange(0, 0);
-		m_pIndexBuffer->Map(0, &readRange, reinterpret_cast< void** >(&pMappedBuffer));
-		memcpy(pMappedBuffer, indexData, sizeof(uint16_t) * numTris * 3);
-		m_pIndexBuffer->Unmap(0, nullptr);
-
-		m_indexBufferView.BufferLocation = m_pIndexBuffer->GetGPUVirtualAddress();
-		m_indexBufferView.Format = DXGI_FORMAT_R16_UINT;
-		m_indexBufferView.SizeInBytes = sizeof(uint16_t) * numTris * 3;
-	}
+	CreateIndexBuffer(pDevice.Get(), pMeshIndices, numIndices, 3, indexFormat);
 
 
 
@@ -466,7 +646,7 @@ bool DXMesh::CreateD3DResources(ComPtr<ID3D12Device>        pDevice,
 
 	}
 
-	m_unVertexCount = numTris * 3;
+	m_unVertexCount = numVertices;
 
 	
 	return true;
@@ -476,9 +656,9 @@ void DXMesh::Render(ComPtr<ID3D12GraphicsCommandList> & pCommandList, const XMMA
 {
 	UINT nCBVSRVDescriptorSize = mpd3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);;
 	
-	//copy mvp matrix data into the constant buffer
+	//copy mvp matrix data into the constant buffer.  compact vertices are dequantized by the same matrix
 	DirectX::XMFLOAT4X4 mvp4x4;
-	XMStoreFloat4x4(&mvp4x4, XMMatrixTranspose(matMVP));
+	XMStoreFloat4x4(&mvp4x4, XMMatrixTranspose(GetDequantizationMatrix() * matMVP));
 	memcpy(m_pConstantBufferData, &mvp4x4, sizeof(mvp4x4));
 
 
@@ -496,23 +676,21 @@ void DXMesh::Render(ComPtr<ID3D12GraphicsCommandList> & pCommandList, const XMMA
 //	srvHandle.Offset(m_unTextureIndex, nCBVSRVDescriptorSize);
 //	pCommandList->SetGraphicsRootDescriptorTable(1, srvHandle);
 
-	// Bind the VB/IB and draw
-	pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	pCommandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-	pCommandList->IASetIndexBuffer(&m_indexBufferView);
-	pCommandList->DrawIndexedInstanced((UINT)m_unVertexCount, 1, 0, 0, 0);
+	DrawSubsets(pCommandList);
 }
 
 void DXMesh::Render(ComPtr<ID3D12GraphicsCommandList>& pCommandList, const XMMATRIX& matWorld, const XMMATRIX& matMVP)
 {
 	UINT nCBVSRVDescriptorSize = mpd3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);;
 
-	//copy mvp matrix data into the constant buffer
+	//copy mvp matrix data into the constant buffer.  compact vertices are dequantized by the same matrices
+	XMMATRIX matDequantize = GetDequantizationMatrix();
+
 	DirectX::XMFLOAT4X4 mvp4x4;
-	XMStoreFloat4x4(&mvp4x4, XMMatrixTranspose(matMVP));
+	XMStoreFloat4x4(&mvp4x4, XMMatrixTranspose(matDequantize * matMVP));
 
 	DirectX::XMFLOAT4X4 world4x4;
-	XMStoreFloat4x4(&world4x4, XMMatrixTranspose(matWorld));
+	XMStoreFloat4x4(&world4x4, XMMatrixTranspose(matDequantize * matWorld));
 
 	struct ObjectConstantBufferInShader
 	{
@@ -539,9 +717,27 @@ void DXMesh::Render(ComPtr<ID3D12GraphicsCommandList>& pCommandList, const XMMAT
 	int cb_root_parameter = 1;
 	pCommandList->SetGraphicsRootDescriptorTable(cb_root_parameter, cbvHandle);
 
-	// Bind the VB/IB and draw
+	DrawSubsets(pCommandList);
+}
+
+void DXMesh::DrawSubsets(ComPtr<ID3D12GraphicsCommandList>& pCommandList)
+{
+	// Bind the VB/IB once, the subsets only differ in their index ranges and textures
 	pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	pCommandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
 	pCommandList->IASetIndexBuffer(&m_indexBufferView);
-	pCommandList->DrawIndexedInstanced((UINT)m_unVertexCount, 1, 0, 0, 0);
+
+	for (const DXMeshSubset& subset : m_LODs[m_CurrentLOD].subsets)
+	{
+		//texture descriptor is the first parameter of the root
+		if (subset.materialIndex < m_MaterialTextureHandles.size())
+		{
+			pCommandList->SetGraphicsRootDescriptorTable(0, m_MaterialTextureHandles[subset.materialIndex]);
+		}
+
+		for (const IndexDrawRange& range : subset.ranges)
+		{
+			pCommandList->DrawIndexedInstanced(range.indexCount, 1, range.startIndex, range.baseVertex, 0);
+		}
+	}
 }
\ No newline at end of file
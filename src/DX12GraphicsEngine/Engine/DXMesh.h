@@ -1,13 +1,75 @@
 #pragma once
 #include "DXGraphicsUtilities.h"
+#include "DXMeshWelder.h"
+#include "DXIndexBufferBuilder.h"
+#include "DXMeshOptimizer.h"
+#include "DXMeshCache.h"
+#include "DXVertexCompression.h"
+#include "DXMeshSimplifier.h"
+#include "DXObjParser.h"
+#include "DXLoadArena.h"
 using namespace DirectX;
 
 using Microsoft::WRL::ComPtr;
 
 #include <vector>
+#include <algorithm>
 
 class DXCamera;
 
+//What the obj loader did for this mesh.  Filled in by LoadModelFromFile.
+struct DXMeshLoadStats
+{
+	size_t numTriangles = 0;
+	size_t numSourceVertices = 0; //one per triangle corner, the unindexed vertex count
+	size_t numVertices = 0;       //after welding
+	double parseMs = 0.0;
+	double weldMs = 0.0;
+
+	size_t numIndices = 0;
+	UINT indexSize = 0;           //bytes per index, 2 or 4
+	size_t numDrawRanges = 0;     //more than 1 when a 16 bit mesh was split
+	size_t indexBufferBytes = 0;
+	size_t indexBytesSaved = 0;   //compared to a 32 bit index buffer
+
+	bool bOptimized = false;      //vertex cache / overdraw / vertex fetch reordering ran, see SetOptimizeMesh
+	MeshOptimizeStats optimizeStats;
+
+	bool bFromCache = false;      //loaded from the .dxmesh file, the obj was not parsed
+	double cacheMs = 0.0;         //hashing the source plus opening or writing the cache file
+
+	MeshVertexFormat vertexFormat = kMeshVertexFormatFull;
+	VertexCompressionStats compressionStats; //only filled in for the compact formats
+
+	size_t numLODs = 1;
+	double lodMs = 0.0;           //building the simplified levels
+
+	size_t numSubsets = 1;        //material subsets, one draw (per 16 bit range) each
+	size_t numMaterials = 1;
+
+	DXLoadArenaStats scratchStats; //temporaries of the load in the thread's DXLoadArena
+};
+
+//The triangles of one material inside a level of detail
+struct DXMeshSubset
+{
+	UINT startIndex = 0;
+	UINT indexCount = 0;
+	UINT materialIndex = 0;               //into GetMaterials()
+	std::vector< IndexDrawRange > ranges; //the draws of this subset, clipped from the index buffer ranges
+};
+
+//A level of detail inside the index buffer.  All levels share the vertex buffer, the simplified levels are stored
+//after the full resolution indices.  Every material subset is simplified on its own, a subset that can't be
+//simplified any further reuses the indices of its previous level.
+struct DXMeshLOD
+{
+	UINT startIndex = 0;
+	UINT indexCount = 0;
+	float error = 0.0f;                   //object space, see DXMeshSimplifier
+	std::vector< DXMeshSubset > subsets;  //in material order
+};
+
 class DXMesh
 {
 public:
@@ -17,17 +79,21 @@ public:
 	void Render(ComPtr<ID3D12GraphicsCommandList> & pCommandList, const XMMATRIX &matMVP);
 	void Render(ComPtr<ID3D12GraphicsCommandList>& pCommandList, const XMMATRIX& matWorld, const XMMATRIX& matMVP);
 
+	//used by the DXR samples.  the hit shaders read the index buffer as 32 bit words so that is the default.
 	HRESULT LoadModelFromFile(const char *          filename,
-		ID3D12Device* pd3dDevice);
+		ID3D12Device* pd3dDevice,
+		IndexFormatRequest indexFormat = kIndexFormat32Bit);
 
 	HRESULT LoadModelFromFile(const char* filename,
 		ComPtr<ID3D12Device>        pd3dDevice,
 		ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
 		int cbDescriptorIndex,
-		float                 scale);
+		float                 scale,
+		IndexFormatRequest indexFormat = kIndexFormatAuto);
 
 
-	//get indices
+	//get indices.  the 16 bit copy matches the index buffer (relative to the range base vertex) and is empty
+	//when the mesh uses 32 bit indices.  the 32 bit copy always holds the full index list.
 	std::vector< uint16_t >& GetIndices() { return m_Indices; }
 	std::vector< uint32_t >& GetIndices32Bit() { return m_Indices32bit; }
 
@@ -39,6 +105,7 @@ public:
 
 	D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() { return m_vertexBufferView; }
 	D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView() { return m_indexBufferView; }
+	const std::vector< IndexDrawRange >& GetIndexRanges() { return m_IndexRanges; }
 
 	void SetModelId(uint32_t modelId) { m_ModelID = modelId; }
 	uint32_t GetModelId() { return m_ModelID; }
@@ -48,29 +115,111 @@ public:
 
 	void SetCamera(DXCamera* pCamera) { m_pDXCamera = pCamera;  }
 
+	//welding tolerances used by the next LoadModelFromFile call.  the default only welds exact duplicates.
+	void SetWeldOptions(const WeldOptions& options) { m_WeldOptions = options; }
+
+	//reorder triangles and vertices with DXMeshOptimizer on the next LoadModelFromFile call.  off by default.
+	void SetOptimizeMesh(bool bOptimize) { m_bOptimizeMesh = bOptimize; }
+	bool GetOptimizeMesh() { return m_bOptimizeMesh; }
+
+	//read and write the cooked .dxmesh file next to the obj (see DXMeshCache.h).  on by default.
+	void SetUseMeshCache(bool bUseCache) { m_bUseMeshCache = bUseCache; }
+	bool GetUseMeshCache() { return m_bUseMeshCache; }
+
+	//layout of the vertex buffer created by the next LoadModelFromFile call.  the compact formats need the matching
+	//input layout (see DXModel) and are dequantized with GetDequantizationMatrix.  full 32 byte vertices by default.
+	void SetVertexFormat(MeshVertexFormat format) { m_VertexFormat = format; }
+	MeshVertexFormat GetVertexFormat() { return m_VertexFormat; }
+	UINT GetVertexStride() { return DXVertexCompression::GetVertexStride(m_VertexFormat); }
+	const VertexQuantization& GetVertexQuantization() { return m_VertexQuantization; }
+
+	//maps the unorm positions of the vertex buffer back to object space, identity for kMeshVertexFormatFull
+	XMMATRIX GetDequantizationMatrix();
+
+	//number of levels of detail (including the full mesh) LoadModelFromFile builds with DXMeshSimplifier.  1, the
+	//default, only keeps the full mesh.  not used by the DXR load path, the acceleration structures need one mesh.
+	void SetLODCount(UINT numLODs) { m_LODCount = numLODs; }
+	UINT GetLODCount() { return m_LODCount; }
+
+	//the levels that were built, level 0 is the full mesh.  Render draws the current level.
+	const std::vector< DXMeshLOD >& GetLODs() { return m_LODs; }
+	void SetCurrentLOD(UINT lod) { m_CurrentLOD = m_LODs.empty() ? 0 : std::min< UINT >(lod, static_cast<UINT>(m_LODs.size()) - 1); }
+	UINT GetCurrentLOD() { return m_CurrentLOD; }
+
+	//the material subsets of the full resolution mesh (startIndex, indexCount, materialIndex).  the obj triangles
+	//are grouped by usemtl so every material is one contiguous range of the index buffer.
+	const std::vector< MeshCacheSubmesh >& GetSubsets() { return m_Subsets; }
+
+	//one entry per material index.  the names come from usemtl, the rest from the mtllib file if it was found.
+	//diffuseTexture is the full path (relative to the obj directory).
+	const std::vector< ObjMaterial >& GetMaterials() { return m_Materials; }
+
+	//srv table bound to root parameter 0 before the draws of each subset, indexed by material.  empty (the default)
+	//leaves the texture the caller bound for the whole mesh.
+	void SetMaterialTextureHandles(const std::vector< D3D12_GPU_DESCRIPTOR_HANDLE >& handles) { m_MaterialTextureHandles = handles; }
+
+	const DXMeshLoadStats& GetLoadStats() { return m_LoadStats; }
+
+	//object space bounds of the loaded vertices, after scaling
+	const DXGraphicsUtilities::BoundingBox& GetBounds() { return m_Bounds; }
+
+	//the welded (and optimized) mesh from the .dxmesh cache if it is up to date, otherwise from the obj, in which
+	//case the cache is rewritten.  no D3D calls, the benchmarks use this directly.
+	bool LoadMeshData(const char* filename, bool bFlipWinding, DXMeshData& out_data);
+
 protected:
+	//load an obj file and weld the triangle corners into unique vertices plus an index list grouped by material.
+	//fills the vectors, the submeshes and the material names of out_data.
     bool LoadOBJ( const char *                           path,
-                  std::vector< DXGraphicsUtilities::vec3 > & out_vertices,
-                  std::vector< DXGraphicsUtilities::vec2 > & out_uvs,
-                  std::vector< DXGraphicsUtilities::vec3 > & out_normals,
+                  DXMeshData &                           out_data,
                   bool                                   bFlipWinding );
 
+	//take the subsets of meshData and look up its materials in the mtllib file next to filename
+	void LoadMaterials(const char* filename, const DXMeshData& meshData);
+
+	//bind the material of each subset of the current level and draw its ranges.  the vb and ib are bound once.
+	void DrawSubsets(ComPtr<ID3D12GraphicsCommandList>& pCommandList);
+
 	//create vertex buffer, index buffer, vertexbuffer  view, index buffer view, constant buffer view
 	bool CreateD3DResources(ComPtr<ID3D12Device>        pd3dDevice,
 		ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
 		int cbDescriptorIndex,
-		const std::vector< DXGraphicsUtilities::vec3 > &vertices,
-		const std::vector< DXGraphicsUtilities::vec2 > & uvs,
-		const std::vector< DXGraphicsUtilities::vec3 > & normals,
-		const std::vector<WORD> & meshIndices,
+		const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const UINT* pMeshIndices,
+		size_t numIndices,
+		IndexFormatRequest indexFormat,
 		float scale);
 
-	//Create index and vertex buffers.  Note: USES 32 bit UINT INDICES !
+	//Create index and vertex buffers
 	bool CreateVertexAndIndexBuffers(ID3D12Device* pd3dDevice,
-		const std::vector< DXGraphicsUtilities::vec3 >& vertices,
-		const std::vector< DXGraphicsUtilities::vec2 >& uvs,
-		const std::vector< DXGraphicsUtilities::vec3 >& normals,
-		const std::vector<UINT>& meshIndices);
+		const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const UINT* pMeshIndices,
+		size_t numIndices,
+		IndexFormatRequest indexFormat);
+
+	//Simplify every subset of the mesh into m_LODCount levels, the subsets are spread over all cores.  fills m_LODs
+	//and returns all levels as one index list.  scale is applied to the errors.
+	void BuildLODs(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const UINT* pMeshIndices,
+		size_t numIndices,
+		float scale,
+		std::vector< uint32_t >& out_indices);
+
+	//Create the vertex buffer and its view in m_VertexFormat.  the compact formats are encoded here.
+	bool CreateVertexBuffer(ID3D12Device* pd3dDevice,
+		const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices);
+
+	//Create the index buffer and its view with the index width picked by DXIndexBufferBuilder.  Fills m_IndexRanges,
+	//the debug copies of the indices and the index entries of m_LoadStats.
+	bool CreateIndexBuffer(ID3D12Device* pd3dDevice,
+		const UINT* pMeshIndices,
+		size_t numIndices,
+		UINT primitiveSize,
+		IndexFormatRequest indexFormat);
 
 
     // the device 
@@ -80,6 +229,13 @@ protected:
 	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
 	ComPtr< ID3D12Resource > m_pIndexBuffer;
 	D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
+	std::vector< IndexDrawRange > m_IndexRanges; //one draw per range
+	std::vector< DXMeshLOD > m_LODs;
+	std::vector< MeshCacheSubmesh > m_Subsets;
+	std::vector< ObjMaterial > m_Materials;
+	std::vector< D3D12_GPU_DESCRIPTOR_HANDLE > m_MaterialTextureHandles;
+	UINT m_LODCount;
+	UINT m_CurrentLOD;
 
 	ComPtr< ID3D12Resource > m_pConstantBuffer;
 	UINT8 *m_pConstantBufferData; 
@@ -95,8 +251,16 @@ protected:
 	std::vector< uint32_t > m_Indices32bit;
 	std::vector< DXGraphicsUtilities::MeshVertexPosNormUV0 > m_Vertices;
 
+	WeldOptions m_WeldOptions;
+	DXMeshLoadStats m_LoadStats;
+	DXGraphicsUtilities::BoundingBox m_Bounds;
+	MeshVertexFormat m_VertexFormat;
+	VertexQuantization m_VertexQuantization;
+
 	uint32_t m_ModelID;
 	bool m_bReceiveShadow;
+	bool m_bOptimizeMesh;
+	bool m_bUseMeshCache;
 	DXCamera* m_pDXCamera;
 };
 
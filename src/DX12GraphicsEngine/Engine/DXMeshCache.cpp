@@ -0,0 +1,340 @@
+#include "stdafx.h"
+#include "DXMeshCache.h"
+
+#include <cfloat>
+#include <cstring>
+
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	const uint64_t kSectionAlignment = 16;
+	const uint64_t kHashMultiplier = 0x9e3779b97f4a7c15ull;
+
+	inline uint64_t AlignUp(uint64_t value)
+	{
+		return (value + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+	}
+
+	inline uint64_t Mix(uint64_t hash)
+	{
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	inline uint64_t ReadWord(const uint8_t* pBytes)
+	{
+		uint64_t word;
+		memcpy(&word, pBytes, sizeof(word));
+		return word;
+	}
+
+	inline uint64_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	bool WriteSection(FILE* pFile, const void* pData, size_t size)
+	{
+		static const uint8_t padding[kSectionAlignment] = {};
+
+		if (size > 0 && fwrite(pData, 1, size, pFile) != size)
+			return false;
+
+		size_t paddingSize = static_cast<size_t>(AlignUp(size) - size);
+		return paddingSize == 0 || fwrite(padding, 1, paddingSize, pFile) == paddingSize;
+	}
+}
+
+DXMeshCacheFile::DXMeshCacheFile() :
+	m_pHeader(nullptr)
+{
+}
+
+bool DXMeshCacheFile::Open(const char* path, uint64_t sourceHash, uint64_t optionsHash)
+{
+	Close();
+
+	if (!m_File.Open(path))
+		return false;
+
+	const MeshCacheHeader* pHeader = reinterpret_cast<const MeshCacheHeader*>(m_File.GetData());
+	size_t fileSize = m_File.GetSize();
+
+	bool bValid = fileSize >= sizeof(MeshCacheHeader) &&
+		pHeader->magic == kMeshCacheMagic &&
+		pHeader->version == kMeshCacheVersion &&
+		pHeader->sourceHash == sourceHash &&
+		pHeader->optionsHash == optionsHash &&
+		pHeader->vertexStride == sizeof(MeshVertexPosNormUV0) &&
+		pHeader->fileSize == fileSize;
+
+	// the sections must lie inside the file, a truncated or hand edited file is treated as stale
+	bValid = bValid &&
+		pHeader->vertexOffset + uint64_t(pHeader->numVertices) * pHeader->vertexStride <= fileSize &&
+		pHeader->indexOffset + uint64_t(pHeader->numIndices) * sizeof(uint32_t) <= fileSize &&
+		pHeader->submeshOffset + uint64_t(pHeader->numSubmeshes) * sizeof(MeshCacheSubmesh) <= fileSize &&
+		pHeader->materialOffset + pHeader->materialSize <= fileSize;
+
+	// the names must be terminated, GetMaterials reads them as c strings
+	bValid = bValid && (pHeader->materialSize == 0 || m_File.GetData()[pHeader->materialOffset + pHeader->materialSize - 1] == '\0');
+
+	if (!bValid)
+	{
+		m_File.Close();
+		return false;
+	}
+
+	// indices must reference existing vertices, this is what the upload path trusts
+	const uint32_t* pIndices = reinterpret_cast<const uint32_t*>(m_File.GetData() + pHeader->indexOffset);
+	for (uint32_t i = 0; i < pHeader->numIndices; ++i)
+	{
+		if (pIndices[i] >= pHeader->numVertices)
+		{
+			m_File.Close();
+			return false;
+		}
+	}
+
+	// subsets must lie inside the index list
+	const MeshCacheSubmesh* pSubmeshes = reinterpret_cast<const MeshCacheSubmesh*>(m_File.GetData() + pHeader->submeshOffset);
+	for (uint32_t i = 0; i < pHeader->numSubmeshes; ++i)
+	{
+		if (uint64_t(pSubmeshes[i].startIndex) + pSubmeshes[i].indexCount > pHeader->numIndices)
+		{
+			m_File.Close();
+			return false;
+		}
+	}
+
+	m_pHeader = pHeader;
+	return true;
+}
+
+void DXMeshCacheFile::Close()
+{
+	m_pHeader = nullptr;
+	m_File.Close();
+}
+
+const MeshVertexPosNormUV0* DXMeshCacheFile::GetVertices() const
+{
+	return reinterpret_cast<const MeshVertexPosNormUV0*>(m_File.GetData() + m_pHeader->vertexOffset);
+}
+
+const uint32_t* DXMeshCacheFile::GetIndices() const
+{
+	return reinterpret_cast<const uint32_t*>(m_File.GetData() + m_pHeader->indexOffset);
+}
+
+const MeshCacheSubmesh* DXMeshCacheFile::GetSubmeshes() const
+{
+	return reinterpret_cast<const MeshCacheSubmesh*>(m_File.GetData() + m_pHeader->submeshOffset);
+}
+
+std::string DXMeshCacheFile::GetMaterials(std::vector< std::string >& out_materialNames) const
+{
+	out_materialNames.clear();
+
+	const char* pNames = m_File.GetData() + m_pHeader->materialOffset;
+	const char* pEnd = pNames + m_pHeader->materialSize;
+	if (pNames == pEnd)
+		return std::string();
+
+	std::string materialLibrary(pNames);
+	for (const char* p = pNames + materialLibrary.size() + 1; p < pEnd; p += strlen(p) + 1)
+	{
+		out_materialNames.push_back(p);
+	}
+
+	return materialLibrary;
+}
+
+void DXMeshData::UseCacheFile()
+{
+	const MeshCacheHeader& header = cacheFile.GetHeader();
+
+	pVertices = cacheFile.GetVertices();
+	numVertices = header.numVertices;
+	pIndices = cacheFile.GetIndices();
+	numIndices = header.numIndices;
+
+	submeshes.assign(cacheFile.GetSubmeshes(), cacheFile.GetSubmeshes() + header.numSubmeshes);
+	materialLibrary = cacheFile.GetMaterials(materialNames);
+	bounds.mMin = header.boundsMin;
+	bounds.mMax = header.boundsMax;
+	bFromCache = true;
+}
+
+void DXMeshData::UseVectors()
+{
+	pVertices = vertices.data();
+	numVertices = vertices.size();
+	pIndices = indices.data();
+	numIndices = indices.size();
+
+	if (submeshes.empty())
+	{
+		MeshCacheSubmesh submesh = { 0, static_cast<uint32_t>(indices.size()), 0, 0 };
+		submeshes.assign(1, submesh);
+	}
+	bounds = DXMeshCache::ComputeBounds(vertices.data(), vertices.size());
+	bFromCache = false;
+}
+
+namespace DXMeshCache
+{
+	uint64_t HashBytes(const void* pData, size_t size, uint64_t seed)
+	{
+		const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+
+		// 4 independent lanes of 8 bytes so the multiplies overlap
+		uint64_t lanes[4] = { seed, seed + kHashMultiplier, seed ^ 0x2545f4914f6cdd1dull, seed - kHashMultiplier };
+
+		size_t offset = 0;
+		for (; offset + 32 <= size; offset += 32)
+		{
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				lanes[lane] = (lanes[lane] ^ ReadWord(pBytes + offset + lane * 8)) * kHashMultiplier;
+				lanes[lane] ^= lanes[lane] >> 29;
+			}
+		}
+
+		uint64_t hash = size;
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			hash = (hash ^ Mix(lanes[lane])) * kHashMultiplier;
+		}
+
+		for (; offset < size; ++offset)
+		{
+			hash = (hash ^ pBytes[offset]) * kHashMultiplier;
+		}
+
+		return Mix(hash);
+	}
+
+	bool HashFile(const char* path, uint64_t& out_hash, uint64_t& out_size)
+	{
+		DXMemoryMappedFile file;
+		if (!file.Open(path))
+			return false;
+
+		out_hash = HashBytes(file.GetData(), file.GetSize());
+		out_size = file.GetSize();
+		return true;
+	}
+
+	uint64_t HashOptions(const MeshCacheOptions& options)
+	{
+		// hash the fields one by one, the struct has padding
+		uint64_t words[] = {
+			FloatBits(options.weldOptions.positionEpsilon),
+			FloatBits(options.weldOptions.normalEpsilon),
+			FloatBits(options.weldOptions.uvEpsilon),
+			options.bFlipWinding ? 1ull : 0ull,
+			options.bOptimize ? 1ull : 0ull,
+			sizeof(MeshVertexPosNormUV0)
+		};
+
+		return HashBytes(words, sizeof(words), kMeshCacheVersion);
+	}
+
+	std::string GetCachePath(const char* sourcePath)
+	{
+		return std::string(sourcePath) + ".dxmesh";
+	}
+
+	bool WriteCacheFile(const char* path,
+		uint64_t sourceHash,
+		uint64_t sourceSize,
+		uint64_t optionsHash,
+		const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const MeshCacheSubmesh* pSubmeshes,
+		size_t numSubmeshes,
+		const std::string& materialLibrary,
+		const std::vector< std::string >& materialNames)
+	{
+		BoundingBox bounds = ComputeBounds(pVertices, numVertices);
+
+		std::string materialSection;
+		if (!materialLibrary.empty() || !materialNames.empty())
+		{
+			materialSection.append(materialLibrary).push_back('\0');
+			for (const std::string& name : materialNames)
+			{
+				materialSection.append(name).push_back('\0');
+			}
+		}
+
+		MeshCacheHeader header = {};
+		header.magic = kMeshCacheMagic;
+		header.version = kMeshCacheVersion;
+		header.sourceHash = sourceHash;
+		header.sourceSize = sourceSize;
+		header.optionsHash = optionsHash;
+		header.vertexStride = sizeof(MeshVertexPosNormUV0);
+		header.numVertices = static_cast<uint32_t>(numVertices);
+		header.numIndices = static_cast<uint32_t>(numIndices);
+		header.numSubmeshes = static_cast<uint32_t>(numSubmeshes);
+		header.vertexOffset = AlignUp(sizeof(MeshCacheHeader));
+		header.indexOffset = header.vertexOffset + AlignUp(numVertices * sizeof(MeshVertexPosNormUV0));
+		header.submeshOffset = header.indexOffset + AlignUp(numIndices * sizeof(uint32_t));
+		header.materialOffset = header.submeshOffset + AlignUp(numSubmeshes * sizeof(MeshCacheSubmesh));
+		header.materialSize = materialSection.size();
+		header.fileSize = header.materialOffset + AlignUp(materialSection.size());
+		header.boundsMin = bounds.mMin;
+		header.boundsMax = bounds.mMax;
+
+		std::string tempPath = std::string(path) + ".tmp";
+
+		FILE* pFile = nullptr;
+		if (fopen_s(&pFile, tempPath.c_str(), "wb") != 0 || pFile == nullptr)
+			return false;
+
+		bool bWritten = WriteSection(pFile, &header, sizeof(header)) &&
+			WriteSection(pFile, pVertices, numVertices * sizeof(MeshVertexPosNormUV0)) &&
+			WriteSection(pFile, pIndices, numIndices * sizeof(uint32_t)) &&
+			WriteSection(pFile, pSubmeshes, numSubmeshes * sizeof(MeshCacheSubmesh)) &&
+			WriteSection(pFile, materialSection.data(), materialSection.size());
+
+		bWritten = (fclose(pFile) == 0) && bWritten;
+
+		if (!bWritten || !MoveFileExA(tempPath.c_str(), path, MOVEFILE_REPLACE_EXISTING))
+		{
+			DeleteFileA(tempPath.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	BoundingBox ComputeBounds(const MeshVertexPosNormUV0* pVertices, size_t numVertices)
+	{
+		BoundingBox bounds;
+		if (numVertices == 0)
+			return bounds;
+
+		bounds.mMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		bounds.mMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			const XMFLOAT3& p = pVertices[i].position;
+			bounds.mMin = XMFLOAT3(std::min(bounds.mMin.x, p.x), std::min(bounds.mMin.y, p.y), std::min(bounds.mMin.z, p.z));
+			bounds.mMax = XMFLOAT3(std::max(bounds.mMax.x, p.x), std::max(bounds.mMax.y, p.y), std::max(bounds.mMax.z, p.z));
+		}
+
+		return bounds;
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include "DXMemoryMappedFile.h"
+#include "DXMeshWelder.h"
+#include <string>
+#include <vector>
+
+//Cooked mesh cache (.dxmesh).  Holds the welded and optimized vertices and indices of a source file so later runs
+//skip parsing.  The file is memory mapped and its sections are used in place.
+//
+//  MeshCacheHeader | vertices | uint32 indices | MeshCacheSubmesh[] | material names     (each section 16 byte aligned)
+//
+//The material section holds the mtllib file name followed by one usemtl name per material index, each terminated
+//by a '\0'.
+//
+//A cache file belongs to one source file content and one set of loader options.  Both are hashed into the header
+//and a mismatch (or a different kMeshCacheVersion) makes the file stale.
+const uint32_t kMeshCacheMagic = 0x48534d44; //"DMSH"
+const uint32_t kMeshCacheVersion = 2;
+
+struct MeshCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	uint64_t optionsHash;
+
+	uint32_t vertexStride;
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t numSubmeshes;
+
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t submeshOffset;
+	uint64_t materialOffset;
+	uint64_t materialSize;
+	uint64_t fileSize;
+
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+};
+
+//a range of the index list drawn with one material
+struct MeshCacheSubmesh
+{
+	uint32_t startIndex;
+	uint32_t indexCount;
+	uint32_t materialIndex;
+	uint32_t reserved;
+};
+
+//everything that changes the cooked output for the same source file
+struct MeshCacheOptions
+{
+	WeldOptions weldOptions;
+	bool bFlipWinding = false;
+	bool bOptimize = false;
+};
+
+//Read only view of a .dxmesh file
+class DXMeshCacheFile
+{
+public:
+	DXMeshCacheFile();
+
+	//map the file and check it against the expected hashes.  returns false (and stays closed) if the file is
+	//missing, truncated, from another version or stale.
+	bool Open(const char* path, uint64_t sourceHash, uint64_t optionsHash);
+	void Close();
+
+	bool IsOpen() const { return m_pHeader != nullptr; }
+
+	const MeshCacheHeader& GetHeader() const { return *m_pHeader; }
+	const DXGraphicsUtilities::MeshVertexPosNormUV0* GetVertices() const;
+	const uint32_t* GetIndices() const;
+	const MeshCacheSubmesh* GetSubmeshes() const;
+
+	//split the material section, returns the mtllib file name
+	std::string GetMaterials(std::vector< std::string >& out_materialNames) const;
+
+protected:
+	DXMemoryMappedFile m_File;
+	const MeshCacheHeader* m_pHeader;
+};
+
+//CPU side mesh ready for upload.  The pointers either point into a mapped cache file or into the vectors filled by
+//the obj loader when no usable cache exists.
+struct DXMeshData
+{
+	DXMeshCacheFile cacheFile;
+	std::vector< DXGraphicsUtilities::MeshVertexPosNormUV0 > vertices;
+	std::vector< uint32_t > indices;
+
+	const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices = nullptr;
+	size_t numVertices = 0;
+	const uint32_t* pIndices = nullptr;
+	size_t numIndices = 0;
+
+	std::vector< MeshCacheSubmesh > submeshes;   //material subsets, contiguous and in material order
+	std::string materialLibrary;
+	std::vector< std::string > materialNames;    //indexed by MeshCacheSubmesh::materialIndex, may be empty
+	DXGraphicsUtilities::BoundingBox bounds;
+	bool bFromCache = false;
+
+	//point at the opened cache file
+	void UseCacheFile();
+	//point at the vectors, bounds from the vertices.  without submeshes one submesh covers all indices.
+	void UseVectors();
+};
+
+namespace DXMeshCache
+{
+	//64 bit hash of a byte range.  not cryptographic, only used to detect changed sources.
+	uint64_t HashBytes(const void* pData, size_t size, uint64_t seed = 0);
+
+	bool HashFile(const char* path, uint64_t& out_hash, uint64_t& out_size);
+
+	uint64_t HashOptions(const MeshCacheOptions& options);
+
+	//the cache file lives next to the source, e.g. models/cube.obj -> models/cube.obj.dxmesh
+	std::string GetCachePath(const char* sourcePath);
+
+	//write to a temporary file first and rename it over the old cache so a reader never sees a partial file
+	bool WriteCacheFile(const char* path,
+		uint64_t sourceHash,
+		uint64_t sourceSize,
+		uint64_t optionsHash,
+		const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const MeshCacheSubmesh* pSubmeshes,
+		size_t numSubmeshes,
+		const std::string& materialLibrary,
+		const std::vector< std::string >& materialNames);
+
+	DXGraphicsUtilities::BoundingBox ComputeBounds(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices, size_t numVertices);
+}
@@ -0,0 +1,448 @@
+#include "stdafx.h"
+#include "DXMeshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	const uint32_t kInvalidIndex = 0xffffffff;
+
+	//triangles that use each vertex, stored as one flat array with per vertex offsets
+	struct VertexTriangleAdjacency
+	{
+		std::vector< uint32_t > offsets;   //numVertices + 1 entries
+		std::vector< uint32_t > triangles;
+
+		void Build(const uint32_t* pIndices, size_t numIndices, size_t numVertices)
+		{
+			offsets.assign(numVertices + 1, 0);
+			for (size_t i = 0; i < numIndices; ++i)
+			{
+				offsets[pIndices[i] + 1]++;
+			}
+
+			for (size_t v = 0; v < numVertices; ++v)
+			{
+				offsets[v + 1] += offsets[v];
+			}
+
+			triangles.resize(numIndices);
+			std::vector< uint32_t > fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < numIndices; ++i)
+			{
+				triangles[fill[pIndices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+	};
+
+	//FIFO cache model used by the optimizers.  A vertex is in the cache if it was transformed within the last
+	//cacheSize misses.
+	struct FIFOCache
+	{
+		std::vector< uint32_t > timestamps;
+		uint32_t time;
+		UINT cacheSize;
+
+		FIFOCache(size_t numVertices, UINT size) : timestamps(numVertices, 0), time(size + 1), cacheSize(size) {}
+
+		void Reset() { time += cacheSize + 1; }
+
+		//returns 1 on a miss
+		uint32_t Access(uint32_t vertex)
+		{
+			if (time - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = time++;
+				return 1;
+			}
+			return 0;
+		}
+	};
+
+	//return the next vertex to fan around when the candidates are all dead or too old
+	uint32_t SkipDeadEnd(const std::vector< uint32_t >& liveTriangles, std::vector< uint32_t >& deadEndStack,
+		uint32_t& cursor, size_t numVertices)
+	{
+		while (!deadEndStack.empty())
+		{
+			uint32_t vertex = deadEndStack.back();
+			deadEndStack.pop_back();
+
+			if (liveTriangles[vertex] > 0)
+				return vertex;
+		}
+
+		while (cursor < numVertices)
+		{
+			if (liveTriangles[cursor] > 0)
+				return cursor;
+
+			cursor++;
+		}
+
+		return kInvalidIndex;
+	}
+
+	//the candidate that will still be in the cache after its remaining triangles are emitted, preferring the oldest
+	uint32_t GetNextVertex(const std::vector< uint32_t >& candidates, const std::vector< uint32_t >& liveTriangles,
+		const std::vector< uint32_t >& cacheTime, uint32_t timestamp, UINT cacheSize)
+	{
+		uint32_t bestVertex = kInvalidIndex;
+		int bestPriority = -1;
+
+		for (uint32_t vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			if (timestamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+			{
+				priority = static_cast<int>(timestamp - cacheTime[vertex]);
+			}
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = vertex;
+			}
+		}
+
+		return bestVertex;
+	}
+
+	struct OverdrawCluster
+	{
+		size_t firstTriangle;
+		size_t numTriangles;
+		float sortKey;
+	};
+
+	//cut the triangle list into clusters.  hard cuts where tipsify restarted (all 3 vertices missed), soft cuts
+	//inside a hard cluster once the running miss ratio is close to the cluster's.
+	void BuildOverdrawClusters(const uint32_t* pIndices, size_t numTriangles, size_t numVertices, UINT cacheSize,
+		float threshold, std::vector< OverdrawCluster >& clusters)
+	{
+		FIFOCache cache(numVertices, cacheSize);
+
+		std::vector< size_t > hardBoundaries;
+		for (size_t t = 0; t < numTriangles; ++t)
+		{
+			uint32_t misses = cache.Access(pIndices[t * 3 + 0]) + cache.Access(pIndices[t * 3 + 1]) + cache.Access(pIndices[t * 3 + 2]);
+			if (t == 0 || misses == 3)
+			{
+				hardBoundaries.push_back(t);
+			}
+		}
+		hardBoundaries.push_back(numTriangles);
+
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+		{
+			size_t start = hardBoundaries[h];
+			size_t end = hardBoundaries[h + 1];
+
+			cache.Reset();
+			uint32_t clusterMisses = 0;
+			for (size_t t = start; t < end; ++t)
+			{
+				clusterMisses += cache.Access(pIndices[t * 3 + 0]) + cache.Access(pIndices[t * 3 + 1]) + cache.Access(pIndices[t * 3 + 2]);
+			}
+			float clusterThreshold = threshold * float(clusterMisses) / float(end - start);
+
+			cache.Reset();
+			uint32_t runningMisses = 0;
+			size_t clusterStart = start;
+			for (size_t t = start; t < end; ++t)
+			{
+				runningMisses += cache.Access(pIndices[t * 3 + 0]) + cache.Access(pIndices[t * 3 + 1]) + cache.Access(pIndices[t * 3 + 2]);
+
+				if (float(runningMisses) / float(t - clusterStart + 1) <= clusterThreshold && t + 1 < end)
+				{
+					OverdrawCluster cluster = { clusterStart, t + 1 - clusterStart, 0.0f };
+					clusters.push_back(cluster);
+
+					clusterStart = t + 1;
+					runningMisses = 0;
+					cache.Reset();
+				}
+			}
+
+			OverdrawCluster cluster = { clusterStart, end - clusterStart, 0.0f };
+			clusters.push_back(cluster);
+		}
+	}
+}
+
+namespace DXMeshOptimizer
+{
+	VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices,
+		size_t numIndices,
+		size_t numVertices,
+		UINT cacheSize,
+		VertexCacheModel model)
+	{
+		VertexCacheStats stats;
+		stats.numTriangles = numIndices / 3;
+
+		std::vector< bool > bReferenced(numVertices, false);
+
+		if (model == kVertexCacheFIFO)
+		{
+			FIFOCache cache(numVertices, cacheSize);
+			for (size_t i = 0; i < numIndices; ++i)
+			{
+				stats.numTransformed += cache.Access(pIndices[i]);
+				bReferenced[pIndices[i]] = true;
+			}
+		}
+		else
+		{
+			// cache[0] is the most recently used entry
+			std::vector< uint32_t > cache;
+			cache.reserve(cacheSize + 1);
+
+			for (size_t i = 0; i < numIndices; ++i)
+			{
+				uint32_t vertex = pIndices[i];
+				bReferenced[vertex] = true;
+
+				std::vector< uint32_t >::iterator it = std::find(cache.begin(), cache.end(), vertex);
+				if (it == cache.end())
+				{
+					stats.numTransformed++;
+					cache.insert(cache.begin(), vertex);
+					if (cache.size() > cacheSize)
+					{
+						cache.pop_back();
+					}
+				}
+				else
+				{
+					std::rotate(cache.begin(), it, it + 1);
+				}
+			}
+		}
+
+		stats.numVertices = std::count(bReferenced.begin(), bReferenced.end(), true);
+		stats.acmr = stats.numTriangles ? float(stats.numTransformed) / float(stats.numTriangles) : 0.0f;
+		stats.atvr = stats.numVertices ? float(stats.numTransformed) / float(stats.numVertices) : 0.0f;
+
+		return stats;
+	}
+
+	void OptimizeVertexCache(uint32_t* pDestination,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		size_t numVertices,
+		UINT cacheSize)
+	{
+		assert(pDestination != pIndices);
+
+		const size_t numTriangles = numIndices / 3;
+		if (numTriangles == 0)
+			return;
+
+		VertexTriangleAdjacency adjacency;
+		adjacency.Build(pIndices, numTriangles * 3, numVertices);
+
+		std::vector< uint32_t > liveTriangles(numVertices);
+		for (size_t v = 0; v < numVertices; ++v)
+		{
+			liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+		}
+
+		std::vector< uint32_t > cacheTime(numVertices, 0);
+		std::vector< bool > bEmitted(numTriangles, false);
+		std::vector< uint32_t > deadEndStack;
+		std::vector< uint32_t > candidates;
+		deadEndStack.reserve(numIndices);
+		candidates.reserve(64);
+
+		uint32_t timestamp = cacheSize + 1;
+		uint32_t cursor = 1;
+		size_t numOutput = 0;
+
+		uint32_t fanVertex = 0;
+		while (liveTriangles[fanVertex] == 0 && fanVertex + 1 < numVertices)
+		{
+			fanVertex++;
+		}
+
+		while (fanVertex != kInvalidIndex)
+		{
+			candidates.clear();
+
+			// emit every remaining triangle around the fan vertex
+			for (uint32_t a = adjacency.offsets[fanVertex]; a < adjacency.offsets[fanVertex + 1]; ++a)
+			{
+				uint32_t triangle = adjacency.triangles[a];
+				if (bEmitted[triangle])
+					continue;
+
+				bEmitted[triangle] = true;
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					uint32_t vertex = pIndices[triangle * 3 + corner];
+					pDestination[numOutput++] = vertex;
+
+					deadEndStack.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+
+					if (timestamp - cacheTime[vertex] > cacheSize)
+					{
+						cacheTime[vertex] = timestamp++;
+					}
+				}
+			}
+
+			fanVertex = GetNextVertex(candidates, liveTriangles, cacheTime, timestamp, cacheSize);
+			if (fanVertex == kInvalidIndex)
+			{
+				fanVertex = SkipDeadEnd(liveTriangles, deadEndStack, cursor, numVertices);
+			}
+		}
+
+		assert(numOutput == numTriangles * 3);
+	}
+
+	void OptimizeOverdraw(uint32_t* pDestination,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		UINT cacheSize,
+		float threshold)
+	{
+		assert(pDestination != pIndices);
+
+		const size_t numTriangles = numIndices / 3;
+		if (numTriangles == 0)
+			return;
+
+		std::vector< OverdrawCluster > clusters;
+		BuildOverdrawClusters(pIndices, numTriangles, numVertices, cacheSize, threshold, clusters);
+
+		// area weighted mesh centroid
+		XMVECTOR meshCentroid = XMVectorZero();
+		float meshArea = 0.0f;
+		for (size_t t = 0; t < numTriangles; ++t)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&pVertices[pIndices[t * 3 + 0]].position);
+			XMVECTOR p1 = XMLoadFloat3(&pVertices[pIndices[t * 3 + 1]].position);
+			XMVECTOR p2 = XMLoadFloat3(&pVertices[pIndices[t * 3 + 2]].position);
+
+			float area = XMVectorGetX(XMVector3Length(XMVector3Cross(p1 - p0, p2 - p0)));
+			meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+			meshArea += area;
+		}
+		meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+		// clusters that face away from the center are likely to be in front of the rest of the mesh
+		for (OverdrawCluster& cluster : clusters)
+		{
+			XMVECTOR centroid = XMVectorZero();
+			XMVECTOR normal = XMVectorZero();
+			float area = 0.0f;
+
+			for (size_t t = cluster.firstTriangle; t < cluster.firstTriangle + cluster.numTriangles; ++t)
+			{
+				XMVECTOR p0 = XMLoadFloat3(&pVertices[pIndices[t * 3 + 0]].position);
+				XMVECTOR p1 = XMLoadFloat3(&pVertices[pIndices[t * 3 + 1]].position);
+				XMVECTOR p2 = XMLoadFloat3(&pVertices[pIndices[t * 3 + 2]].position);
+
+				XMVECTOR faceNormal = XMVector3Cross(p1 - p0, p2 - p0); //length is twice the area
+				float faceArea = XMVectorGetX(XMVector3Length(faceNormal));
+
+				centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+				normal += faceNormal;
+				area += faceArea;
+			}
+
+			centroid = area > 0.0f ? centroid / area : centroid;
+			cluster.sortKey = XMVectorGetX(XMVector3Dot(centroid - meshCentroid, XMVector3Normalize(normal)));
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(),
+			[](const OverdrawCluster& a, const OverdrawCluster& b) { return a.sortKey > b.sortKey; });
+
+		size_t numOutput = 0;
+		for (const OverdrawCluster& cluster : clusters)
+		{
+			memcpy(pDestination + numOutput, pIndices + cluster.firstTriangle * 3, cluster.numTriangles * 3 * sizeof(uint32_t));
+			numOutput += cluster.numTriangles * 3;
+		}
+	}
+
+	void OptimizeVertexFetch(std::vector< MeshVertexPosNormUV0 >& vertices, std::vector< uint32_t >& indices)
+	{
+		std::vector< uint32_t > remap(vertices.size(), kInvalidIndex);
+		std::vector< MeshVertexPosNormUV0 > fetchOrdered;
+		fetchOrdered.reserve(vertices.size());
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == kInvalidIndex)
+			{
+				remap[index] = static_cast<uint32_t>(fetchOrdered.size());
+				fetchOrdered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		vertices.swap(fetchOrdered);
+	}
+
+	void OptimizeMesh(std::vector< MeshVertexPosNormUV0 >& vertices,
+		std::vector< uint32_t >& indices,
+		MeshOptimizeStats* pStats)
+	{
+		OptimizeMesh(vertices, indices, std::vector< size_t >(1, 0), pStats);
+	}
+
+	void OptimizeMesh(std::vector< MeshVertexPosNormUV0 >& vertices,
+		std::vector< uint32_t >& indices,
+		const std::vector< size_t >& subsetStarts,
+		MeshOptimizeStats* pStats)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		VertexCacheStats before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+		std::vector< uint32_t > cacheOrdered(indices.size());
+		for (size_t subset = 0; subset < subsetStarts.size(); ++subset)
+		{
+			size_t subsetStart = subsetStarts[subset];
+			size_t subsetEnd = subset + 1 < subsetStarts.size() ? subsetStarts[subset + 1] : indices.size();
+
+			const uint32_t* pSource = indices.data() + subsetStart;
+			uint32_t* pOrdered = cacheOrdered.data() + subsetStart;
+			size_t numSubsetIndices = subsetEnd - subsetStart;
+
+			OptimizeVertexCache(pOrdered, pSource, numSubsetIndices, vertices.size());
+
+			// some exporters already write a good order (e.g. strip ordered patches), keep it when tipsify can't beat it
+			if (AnalyzeVertexCache(pOrdered, numSubsetIndices, vertices.size()).acmr >=
+				AnalyzeVertexCache(pSource, numSubsetIndices, vertices.size()).acmr)
+			{
+				std::copy(pSource, pSource + numSubsetIndices, pOrdered);
+			}
+
+			OptimizeOverdraw(indices.data() + subsetStart, pOrdered, numSubsetIndices, vertices.data(), vertices.size());
+		}
+
+		OptimizeVertexFetch(vertices, indices);
+
+		if (pStats)
+		{
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+			pStats->optimizeMs = elapsed.count();
+			pStats->before = before;
+			pStats->after = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include <vector>
+
+//Result of running an index buffer through a simulated post transform vertex cache
+struct VertexCacheStats
+{
+	size_t numTriangles = 0;
+	size_t numVertices = 0;       //distinct vertices referenced by the indices
+	size_t numTransformed = 0;    //cache misses
+	float acmr = 0.0f;            //average cache miss ratio, transformed vertices per triangle (0.5 is ideal for a large grid)
+	float atvr = 0.0f;            //average transformed vertex ratio, transformed vertices per vertex (1.0 is ideal)
+};
+
+enum VertexCacheModel
+{
+	kVertexCacheFIFO,
+	kVertexCacheLRU
+};
+
+struct MeshOptimizeStats
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+	double optimizeMs = 0.0;
+};
+
+//Index and vertex buffer reordering for the post transform vertex cache, overdraw and vertex fetch.  All of this is
+//plain CPU code on 32 bit index lists so it can be checked without a device.
+namespace DXMeshOptimizer
+{
+	const UINT kDefaultCacheSize = 16;
+
+	//simulate a FIFO or LRU cache of cacheSize entries
+	VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices,
+		size_t numIndices,
+		size_t numVertices,
+		UINT cacheSize = kDefaultCacheSize,
+		VertexCacheModel model = kVertexCacheFIFO);
+
+	//Tipsify (Sander, Nehab, Barczak 2007).  Reorders triangles so vertices are reused while they are still in a
+	//FIFO cache of cacheSize entries.  Triangle winding is kept.  pDestination must not alias pIndices.
+	void OptimizeVertexCache(uint32_t* pDestination,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		size_t numVertices,
+		UINT cacheSize = kDefaultCacheSize);
+
+	//View independent overdraw reordering.  Splits an already cache optimized list into clusters and draws the
+	//clusters that face away from the mesh center first, so they tend to occlude the rest.  Clusters are only cut
+	//where the cache miss ratio stays below threshold times that of the whole cluster.
+	void OptimizeOverdraw(uint32_t* pDestination,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		UINT cacheSize = kDefaultCacheSize,
+		float threshold = 1.05f);
+
+	//Reorder the vertices in the order the index buffer first uses them and rewrite the indices.  Vertices no index
+	//refers to are dropped.
+	void OptimizeVertexFetch(std::vector< DXGraphicsUtilities::MeshVertexPosNormUV0 >& vertices,
+		std::vector< uint32_t >& indices);
+
+	//vertex cache, overdraw and vertex fetch passes in that order.  the source triangle order is kept if the vertex
+	//cache pass does not improve it.
+	void OptimizeMesh(std::vector< DXGraphicsUtilities::MeshVertexPosNormUV0 >& vertices,
+		std::vector< uint32_t >& indices,
+		MeshOptimizeStats* pStats = nullptr);
+
+	//same as above for a mesh made of material subsets.  triangles are only reordered inside the index ranges that
+	//start at subsetStarts (ascending, the first one 0) so every subset keeps its range.
+	void OptimizeMesh(std::vector< DXGraphicsUtilities::MeshVertexPosNormUV0 >& vertices,
+		std::vector< uint32_t >& indices,
+		const std::vector< size_t >& subsetStarts,
+		MeshOptimizeStats* pStats = nullptr);
+}
@@ -5,6 +5,7 @@
 #include "DXTexture.h"
 #include "DXDescriptorHeap.h"
 #include "DXCamera.h"
+#include "DXMeshletBuilder.h"
 
 #include "./DXR/DXShaderUtilities.h"
 #include "./DXR/DXD3DUtilities.h"
@@ -408,6 +409,10 @@ void DXMeshShader::RenderMeshlets(ComPtr<ID3D12GraphicsCommandList>& pGraphicsCo
 	//iterate through MeshShaderModel::m_meshes
 	for (auto& mesh : m_Model)
 	{
+		//meshes that were not uploaded (see MeshShaderModel::UploadGpuResources) are not drawn
+		if (!mesh.IndexResource)
+			continue;
+
 		//Note: register b1 is set with two seperate 32 bit constants via SetGraphicsRoot32BitConstant(0, data, offset)
 		pCommandList->SetGraphicsRoot32BitConstant(1, mesh.IndexSize, 0); //b1 at offset 0.   mesh.IndexSize is number of bytes to store vertex index ie 4
 
@@ -478,6 +483,10 @@ void DXMeshShader::RenderMeshletsWithAS(ComPtr<ID3D12GraphicsCommandList>& pGrap
 	//iterate through MeshShaderModel::m_meshes
 	for (auto& mesh : m_Model)
 	{
+		//meshes that were not uploaded (see MeshShaderModel::UploadGpuResources) are not drawn
+		if (!mesh.IndexResource)
+			continue;
+
 		//Note: register b1 is set with two seperate 32 bit constants via SetGraphicsRoot32BitConstant(0, data, offset)
 		pCommandList->SetGraphicsRoot32BitConstant(1, mesh.IndexSize, 0); //b1 at offset 0.   mesh.IndexSize is number of bytes to store vertex index ie 4
 
@@ -518,8 +527,27 @@ void  DXMeshShader::CreateMeshlets(ComPtr<ID3D12CommandQueue>& commandQueue)
 	ThrowIfFailed(m_pd3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, cmdAlloc, nullptr, IID_PPV_ARGS(&cmdList)));
 
 
-	m_Model.LoadFromFile(m_MeshletFilename.c_str());
-	m_Model.UploadGpuResources(m_pd3dDevice.Get(), commandQueue.Get(), cmdAlloc, cmdList);
+	// obj files are meshletized here, .bin files come from the offline converter
+	size_t extension = m_MeshletFilename.find_last_of(L'.');
+	if (extension != std::wstring::npos && _wcsicmp(m_MeshletFilename.c_str() + extension, L".obj") == 0)
+	{
+		// the obj loader opens ansi paths
+		int length = WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, m_MeshletFilename.c_str(), -1, nullptr, 0, nullptr, nullptr);
+		if (length <= 0)
+		{
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		}
+		std::string objFilename(length, '\0');
+		WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, m_MeshletFilename.c_str(), -1, &objFilename[0], length, nullptr, nullptr);
+		ThrowIfFailed(m_Model.LoadFromOBJ(objFilename.c_str(), MeshletBuildOptions()));
+	}
+	else
+	{
+		m_Model.LoadFromFile(m_MeshletFilename.c_str());
+	}
+	// the sample draws every mesh, the meshes of a version 2 file are only read from the mapping on use
+	ThrowIfFailed(m_Model.LoadAllMeshes());
+	ThrowIfFailed(m_Model.UploadGpuResources(m_pd3dDevice.Get(), commandQueue.Get(), cmdAlloc, cmdList));
 
 #ifdef _DEBUG
 	// Mesh shader file expects a certain vertex layout; assert our mesh conforms to that layout.
@@ -0,0 +1,813 @@
+#include "stdafx.h"
+#include "DXMeshSimplifier.h"
+#include "DXMeshOptimizer.h"
+#include "DXParallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	const uint32_t kNoEdge = 0xffffffff;
+	const uint32_t kManyEdges = 0xfffffffe;
+
+	//open edges get an extra plane perpendicular to the triangle so borders and seams keep their shape
+	const double kEdgeWeight = 10.0;
+
+	enum VertexKind : uint8_t
+	{
+		kVertexManifold,  //closed fan, may move onto any neighbour
+		kVertexBorder,    //on one open border, only moves along it
+		kVertexSeam,      //two wedges (same position, other attributes) on one seam, only moves along it
+		kVertexLocked     //anything else, never moves
+	};
+
+	//kCanCollapse[from][to]
+	const bool kCanCollapse[4][4] =
+	{
+		{ true,  true,  true,  true  },
+		{ false, true,  false, false },
+		{ false, false, true,  false },
+		{ false, false, false, false },
+	};
+
+	struct Vec3
+	{
+		double x, y, z;
+	};
+
+	inline Vec3 Sub(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	inline Vec3 Cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	inline double Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline double Length(const Vec3& a) { return std::sqrt(Dot(a, a)); }
+
+	//symmetric 4x4 matrix of the summed squared plane distances, w is the summed plane weight
+	struct Quadric
+	{
+		double a00, a11, a22, a10, a20, a21;
+		double b0, b1, b2;
+		double c;
+		double w;
+	};
+
+	void AddPlane(Quadric& q, const Vec3& n, double d, double weight)
+	{
+		q.a00 += n.x * n.x * weight;
+		q.a11 += n.y * n.y * weight;
+		q.a22 += n.z * n.z * weight;
+		q.a10 += n.y * n.x * weight;
+		q.a20 += n.z * n.x * weight;
+		q.a21 += n.z * n.y * weight;
+		q.b0 += n.x * d * weight;
+		q.b1 += n.y * d * weight;
+		q.b2 += n.z * d * weight;
+		q.c += d * d * weight;
+		q.w += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& r)
+	{
+		q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+		q.a10 += r.a10; q.a20 += r.a20; q.a21 += r.a21;
+		q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+		q.c += r.c;
+		q.w += r.w;
+	}
+
+	//weighted mean squared distance of p to the planes of q
+	double QuadricError(const Quadric& q, const Vec3& p)
+	{
+		double rx = q.b0 + q.a00 * p.x + q.a10 * p.y + q.a20 * p.z;
+		double ry = q.b1 + q.a10 * p.x + q.a11 * p.y + q.a21 * p.z;
+		double rz = q.b2 + q.a20 * p.x + q.a21 * p.y + q.a22 * p.z;
+
+		double r = q.c + 2.0 * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) +
+			(rx - q.b0) * p.x + (ry - q.b1) * p.y + (rz - q.b2) * p.z;
+
+		return q.w > 0.0 ? std::fabs(r) / q.w : 0.0;
+	}
+
+	//half edges of an index list grouped by their start vertex
+	struct EdgeAdjacency
+	{
+		std::vector< uint32_t > offsets;
+		std::vector< uint32_t > targets;
+
+		void Build(const std::vector< uint32_t >& indices, size_t numVertices)
+		{
+			offsets.assign(numVertices + 1, 0);
+			for (uint32_t index : indices)
+			{
+				offsets[index + 1]++;
+			}
+			for (size_t i = 0; i < numVertices; ++i)
+			{
+				offsets[i + 1] += offsets[i];
+			}
+
+			targets.resize(indices.size());
+			std::vector< uint32_t > fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					uint32_t a = indices[i + e];
+					uint32_t b = indices[i + (e + 1) % 3];
+					targets[fill[a]++] = b;
+				}
+			}
+		}
+
+		bool HasEdge(uint32_t a, uint32_t b) const
+		{
+			for (uint32_t i = offsets[a]; i < offsets[a + 1]; ++i)
+			{
+				if (targets[i] == b)
+					return true;
+			}
+			return false;
+		}
+	};
+
+	//remap[v] is the first vertex with the same position, wedge[] links the vertices of a position into a ring
+	void BuildPositionGroups(const std::vector< Vec3 >& positions, std::vector< uint32_t >& remap, std::vector< uint32_t >& wedge)
+	{
+		size_t numVertices = positions.size();
+
+		std::vector< uint32_t > order(numVertices);
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			order[i] = static_cast<uint32_t>(i);
+		}
+
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+		{
+			const Vec3& pa = positions[a];
+			const Vec3& pb = positions[b];
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		});
+
+		remap.resize(numVertices);
+		wedge.resize(numVertices);
+
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			uint32_t v = order[i];
+			remap[v] = v;
+			wedge[v] = v;
+
+			if (i > 0)
+			{
+				uint32_t previous = order[i - 1];
+				const Vec3& p = positions[v];
+				const Vec3& q = positions[previous];
+				if (p.x == q.x && p.y == q.y && p.z == q.z)
+				{
+					uint32_t first = remap[previous];
+					remap[v] = first;
+					wedge[v] = wedge[first];
+					wedge[first] = v;
+				}
+			}
+		}
+	}
+
+	//the single open half edge leaving / entering each vertex, kNoEdge or kManyEdges otherwise
+	void FindOpenEdges(const EdgeAdjacency& adjacency, size_t numVertices, std::vector< uint32_t >& openOut, std::vector< uint32_t >& openIn)
+	{
+		openOut.assign(numVertices, kNoEdge);
+		openIn.assign(numVertices, kNoEdge);
+
+		for (uint32_t a = 0; a < numVertices; ++a)
+		{
+			for (uint32_t i = adjacency.offsets[a]; i < adjacency.offsets[a + 1]; ++i)
+			{
+				uint32_t b = adjacency.targets[i];
+				if (adjacency.HasEdge(b, a))
+					continue;
+
+				openOut[a] = (openOut[a] == kNoEdge) ? b : kManyEdges;
+				openIn[b] = (openIn[b] == kNoEdge) ? a : kManyEdges;
+			}
+		}
+	}
+
+	inline bool IsSingleEdge(uint32_t edge)
+	{
+		return edge != kNoEdge && edge != kManyEdges;
+	}
+
+	//is there a half edge from any wedge of position a to any wedge of position b
+	bool HasPositionEdge(const EdgeAdjacency& adjacency, const std::vector< uint32_t >& remap, const std::vector< uint32_t >& wedge,
+		uint32_t a, uint32_t b)
+	{
+		uint32_t v = a;
+		do
+		{
+			for (uint32_t i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; ++i)
+			{
+				if (remap[adjacency.targets[i]] == remap[b])
+					return true;
+			}
+			v = wedge[v];
+		} while (v != a);
+
+		return false;
+	}
+
+	void ClassifyVertices(const EdgeAdjacency& adjacency,
+		const std::vector< uint32_t >& remap,
+		const std::vector< uint32_t >& wedge,
+		const std::vector< uint32_t >& openOut,
+		const std::vector< uint32_t >& openIn,
+		std::vector< uint8_t >& kinds)
+	{
+		size_t numVertices = remap.size();
+		kinds.assign(numVertices, kVertexLocked);
+
+		for (uint32_t v = 0; v < numVertices; ++v)
+		{
+			if (remap[v] != v)
+				continue;
+
+			uint32_t sibling = wedge[v];
+
+			if (sibling == v)
+			{
+				if (openOut[v] == kNoEdge && openIn[v] == kNoEdge)
+				{
+					kinds[v] = kVertexManifold;
+				}
+				else if (IsSingleEdge(openOut[v]) && IsSingleEdge(openIn[v]))
+				{
+					kinds[v] = kVertexBorder;
+				}
+			}
+			else if (wedge[sibling] == v)
+			{
+				// two wedges: a seam if both sides have one open edge in and out and the edges are closed when only
+				// positions are compared.  open in position space would be a border that also has a seam.
+				bool bSeam = IsSingleEdge(openOut[v]) && IsSingleEdge(openIn[v]) &&
+					IsSingleEdge(openOut[sibling]) && IsSingleEdge(openIn[sibling]) &&
+					HasPositionEdge(adjacency, remap, wedge, openOut[v], v) &&
+					HasPositionEdge(adjacency, remap, wedge, v, openIn[v]);
+
+				if (bSeam)
+				{
+					kinds[v] = kVertexSeam;
+					kinds[sibling] = kVertexSeam;
+				}
+			}
+		}
+	}
+
+	struct Collapse
+	{
+		uint32_t v0;  //moves onto v1
+		uint32_t v1;
+		double error;
+	};
+
+	bool CanCollapse(uint32_t v0, uint32_t v1, const std::vector< uint8_t >& kinds, const std::vector< uint32_t >& openOut,
+		const std::vector< uint32_t >& openIn)
+	{
+		uint8_t kind = kinds[v0];
+		if (!kCanCollapse[kind][kinds[v1]])
+			return false;
+
+		// border and seam vertices stay on their edge loop
+		if (kind == kVertexBorder || kind == kVertexSeam)
+			return openOut[v0] == v1 || openIn[v0] == v1;
+
+		return true;
+	}
+
+	//would moving position group r0 onto the position of v1 turn any of the remaining triangles around r0 over
+	bool HasTriangleFlip(const std::vector< Vec3 >& positions,
+		const std::vector< uint32_t >& indices,
+		const std::vector< uint32_t >& triangleOffsets,
+		const std::vector< uint32_t >& triangles,
+		const std::vector< uint32_t >& remap,
+		const std::vector< uint32_t >& collapseRemap,
+		uint32_t r0,
+		uint32_t v1)
+	{
+		uint32_t r1 = remap[v1];
+
+		for (uint32_t i = triangleOffsets[r0]; i < triangleOffsets[r0 + 1]; ++i)
+		{
+			const uint32_t* pTriangle = &indices[triangles[i] * 3];
+
+			uint32_t corners[3];
+			int moving = -1;
+			bool bDegenerate = false;
+
+			for (int c = 0; c < 3; ++c)
+			{
+				corners[c] = collapseRemap[pTriangle[c]];
+				uint32_t group = remap[corners[c]];
+
+				if (group == r0)
+					moving = c;
+				else if (group == r1)
+					bDegenerate = true;
+			}
+
+			// triangles on the collapsed edge disappear
+			if (bDegenerate || moving < 0)
+				continue;
+
+			const Vec3& a = positions[corners[(moving + 1) % 3]];
+			const Vec3& b = positions[corners[(moving + 2) % 3]];
+
+			Vec3 before = Cross(Sub(a, positions[corners[moving]]), Sub(b, positions[corners[moving]]));
+			Vec3 after = Cross(Sub(a, positions[v1]), Sub(b, positions[v1]));
+
+			if (Dot(before, after) <= 0.0)
+				return true;
+		}
+
+		return false;
+	}
+
+	//the position groups next to r, and how many of the triangles around r contain other.  collapses of this pass
+	//are applied, triangles they made degenerate are skipped.
+	size_t GetNeighbourGroups(const std::vector< uint32_t >& indices,
+		const std::vector< uint32_t >& triangleOffsets,
+		const std::vector< uint32_t >& triangles,
+		const std::vector< uint32_t >& remap,
+		const std::vector< uint32_t >& collapseRemap,
+		uint32_t r,
+		uint32_t other,
+		std::vector< uint32_t >& out_neighbours)
+	{
+		out_neighbours.clear();
+		size_t numSharedTriangles = 0;
+
+		for (uint32_t i = triangleOffsets[r]; i < triangleOffsets[r + 1]; ++i)
+		{
+			const uint32_t* pTriangle = &indices[triangles[i] * 3];
+			uint32_t groups[3] = { remap[collapseRemap[pTriangle[0]]], remap[collapseRemap[pTriangle[1]]], remap[collapseRemap[pTriangle[2]]] };
+			if (groups[0] == groups[1] || groups[1] == groups[2] || groups[2] == groups[0])
+				continue;
+
+			bool bShared = false;
+			for (int c = 0; c < 3; ++c)
+			{
+				if (groups[c] == other)
+					bShared = true;
+				else if (groups[c] != r)
+					out_neighbours.push_back(groups[c]);
+			}
+			numSharedTriangles += bShared ? 1 : 0;
+		}
+
+		std::sort(out_neighbours.begin(), out_neighbours.end());
+		out_neighbours.erase(std::unique(out_neighbours.begin(), out_neighbours.end()), out_neighbours.end());
+		return numSharedTriangles;
+	}
+
+	//the link condition: the only positions next to both r0 and r1 are the third corners of the triangles on the
+	//edge.  any other common neighbour would end up with two edges to r1 and the surface pinched there.
+	bool BreaksLinkCondition(const std::vector< uint32_t >& indices,
+		const std::vector< uint32_t >& triangleOffsets,
+		const std::vector< uint32_t >& triangles,
+		const std::vector< uint32_t >& remap,
+		const std::vector< uint32_t >& collapseRemap,
+		uint32_t r0,
+		uint32_t r1,
+		std::vector< uint32_t >& scratch0,
+		std::vector< uint32_t >& scratch1)
+	{
+		size_t numEdgeTriangles = GetNeighbourGroups(indices, triangleOffsets, triangles, remap, collapseRemap, r0, r1, scratch0);
+		GetNeighbourGroups(indices, triangleOffsets, triangles, remap, collapseRemap, r1, r0, scratch1);
+
+		size_t numCommon = 0;
+		for (size_t i = 0, j = 0; i < scratch0.size() && j < scratch1.size();)
+		{
+			if (scratch0[i] < scratch1[j])
+				i++;
+			else if (scratch1[j] < scratch0[i])
+				j++;
+			else
+			{
+				numCommon++;
+				i++;
+				j++;
+			}
+		}
+
+		return numCommon > numEdgeTriangles;
+	}
+
+	double GetElapsedMs(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+}
+
+namespace DXMeshSimplifier
+{
+	size_t Simplify(const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		size_t targetIndexCount,
+		float maxError,
+		std::vector< uint32_t >& out_indices,
+		float* out_error,
+		const uint8_t* pLockedVertices)
+	{
+		out_indices.assign(pIndices, pIndices + numIndices);
+		if (out_error)
+		{
+			*out_error = 0.0f;
+		}
+
+		if (numIndices <= targetIndexCount || numVertices == 0)
+			return out_indices.size();
+
+		// work in a unit cube so the error limit and the plane weights do not depend on the mesh size
+		XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			const XMFLOAT3& p = pVertices[i].position;
+			boundsMin = XMFLOAT3(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+			boundsMax = XMFLOAT3(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+		}
+
+		double extent = std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y), boundsMax.z - boundsMin.z);
+		if (extent <= 0.0)
+		{
+			extent = 1.0;
+		}
+
+		std::vector< Vec3 > positions(numVertices);
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			const XMFLOAT3& p = pVertices[i].position;
+			positions[i] = { (p.x - boundsMin.x) / extent, (p.y - boundsMin.y) / extent, (p.z - boundsMin.z) / extent };
+		}
+
+		std::vector< uint32_t > remap, wedge;
+		BuildPositionGroups(positions, remap, wedge);
+
+		EdgeAdjacency adjacency;
+		adjacency.Build(out_indices, numVertices);
+
+		std::vector< uint32_t > openOut, openIn;
+		FindOpenEdges(adjacency, numVertices, openOut, openIn);
+
+		std::vector< uint8_t > kinds;
+		ClassifyVertices(adjacency, remap, wedge, openOut, openIn, kinds);
+
+		// a locked wedge locks its whole position group
+		if (pLockedVertices)
+		{
+			for (uint32_t v = 0; v < numVertices; ++v)
+			{
+				if (pLockedVertices[v])
+				{
+					kinds[remap[v]] = kVertexLocked;
+				}
+			}
+			for (uint32_t v = 0; v < numVertices; ++v)
+			{
+				if (kinds[remap[v]] == kVertexLocked)
+				{
+					kinds[v] = kVertexLocked;
+				}
+			}
+		}
+
+		// one quadric per position: the planes of the surrounding triangles plus the planes along open edges
+		std::vector< Quadric > quadrics(numVertices, Quadric());
+		for (size_t i = 0; i < out_indices.size(); i += 3)
+		{
+			const uint32_t* pTriangle = &out_indices[i];
+
+			Vec3 normal = Cross(Sub(positions[pTriangle[1]], positions[pTriangle[0]]), Sub(positions[pTriangle[2]], positions[pTriangle[0]]));
+			double area = Length(normal);
+			if (area > 0.0)
+			{
+				normal = { normal.x / area, normal.y / area, normal.z / area };
+				double d = -Dot(normal, positions[pTriangle[0]]);
+
+				for (int c = 0; c < 3; ++c)
+				{
+					AddPlane(quadrics[remap[pTriangle[c]]], normal, d, area);
+				}
+			}
+
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t a = pTriangle[e];
+				uint32_t b = pTriangle[(e + 1) % 3];
+				uint32_t c = pTriangle[(e + 2) % 3];
+
+				if (adjacency.HasEdge(b, a))
+					continue;
+
+				Vec3 edge = Sub(positions[b], positions[a]);
+				double length = Length(edge);
+				if (length <= 0.0)
+					continue;
+
+				edge = { edge.x / length, edge.y / length, edge.z / length };
+
+				// the plane contains the edge and is perpendicular to the triangle
+				Vec3 toC = Sub(positions[c], positions[a]);
+				double along = Dot(toC, edge);
+				Vec3 perpendicular = { toC.x - edge.x * along, toC.y - edge.y * along, toC.z - edge.z * along };
+				double perpendicularLength = Length(perpendicular);
+				if (perpendicularLength <= 0.0)
+					continue;
+
+				perpendicular = { perpendicular.x / perpendicularLength, perpendicular.y / perpendicularLength, perpendicular.z / perpendicularLength };
+				double d = -Dot(perpendicular, positions[a]);
+
+				AddPlane(quadrics[remap[a]], perpendicular, d, length * length * kEdgeWeight);
+				AddPlane(quadrics[remap[b]], perpendicular, d, length * length * kEdgeWeight);
+			}
+		}
+
+		double relativeMaxError = maxError / extent;
+		double errorLimit = relativeMaxError * relativeMaxError;
+		double resultError = 0.0;
+
+		size_t targetTriangles = targetIndexCount / 3;
+
+		std::vector< Collapse > collapses;
+		std::vector< uint32_t > collapseRemap(numVertices);
+		std::vector< uint8_t > collapseLocked(numVertices);
+		std::vector< uint32_t > triangleOffsets;
+		std::vector< uint32_t > triangles;
+		std::vector< uint32_t > neighbours0, neighbours1;
+
+		while (out_indices.size() / 3 > targetTriangles)
+		{
+			size_t numTriangles = out_indices.size() / 3;
+
+			adjacency.Build(out_indices, numVertices);
+			FindOpenEdges(adjacency, numVertices, openOut, openIn);
+
+			// every edge once, in the direction with the lower error
+			collapses.clear();
+			for (size_t i = 0; i < out_indices.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					uint32_t a = out_indices[i + e];
+					uint32_t b = out_indices[i + (e + 1) % 3];
+
+					if (remap[a] == remap[b])
+						continue;
+
+					if (a > b && adjacency.HasEdge(b, a))
+						continue;
+
+					bool bAB = CanCollapse(a, b, kinds, openOut, openIn);
+					bool bBA = CanCollapse(b, a, kinds, openOut, openIn);
+					if (!bAB && !bBA)
+						continue;
+
+					double errorAB = bAB ? QuadricError(quadrics[remap[a]], positions[b]) : DBL_MAX;
+					double errorBA = bBA ? QuadricError(quadrics[remap[b]], positions[a]) : DBL_MAX;
+
+					Collapse collapse;
+					collapse.v0 = errorAB <= errorBA ? a : b;
+					collapse.v1 = errorAB <= errorBA ? b : a;
+					collapse.error = std::min(errorAB, errorBA);
+
+					if (collapse.error <= errorLimit)
+					{
+						collapses.push_back(collapse);
+					}
+				}
+			}
+
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			// triangles around each position for the flip test
+			triangleOffsets.assign(numVertices + 1, 0);
+			for (uint32_t index : out_indices)
+			{
+				triangleOffsets[remap[index] + 1]++;
+			}
+			for (size_t i = 0; i < numVertices; ++i)
+			{
+				triangleOffsets[i + 1] += triangleOffsets[i];
+			}
+			triangles.resize(out_indices.size());
+			std::vector< uint32_t > fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < out_indices.size(); ++i)
+			{
+				triangles[fill[remap[out_indices[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			for (size_t i = 0; i < numVertices; ++i)
+			{
+				collapseRemap[i] = static_cast<uint32_t>(i);
+			}
+			std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+
+			// a vertex takes part in at most one collapse per pass so the quadrics and the flip test stay valid
+			size_t triangleGoal = numTriangles - targetTriangles;
+			size_t trianglesRemoved = 0;
+			size_t numCollapsed = 0;
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (trianglesRemoved >= triangleGoal)
+					break;
+
+				uint32_t v0 = collapse.v0;
+				uint32_t v1 = collapse.v1;
+				uint32_t r0 = remap[v0];
+				uint32_t r1 = remap[v1];
+
+				if (collapseLocked[r0] || collapseLocked[r1])
+					continue;
+
+				// a seam vertex moves together with its twin on the other side of the seam
+				uint32_t s0 = v0;
+				uint32_t s1 = v1;
+				if (kinds[v0] == kVertexSeam)
+				{
+					s0 = wedge[v0];
+					s1 = (openOut[v0] == v1) ? openIn[s0] : openOut[s0];
+
+					if (!IsSingleEdge(s1) || remap[s1] != r1 || s1 == v1 || kinds[s1] != kVertexSeam)
+						continue;
+				}
+
+				if (HasTriangleFlip(positions, out_indices, triangleOffsets, triangles, remap, collapseRemap, r0, v1))
+					continue;
+
+				if (BreaksLinkCondition(out_indices, triangleOffsets, triangles, remap, collapseRemap, r0, r1, neighbours0, neighbours1))
+					continue;
+
+				collapseRemap[v0] = v1;
+				collapseRemap[s0] = s1;
+				AddQuadric(quadrics[r1], quadrics[r0]);
+
+				collapseLocked[r0] = 1;
+				collapseLocked[r1] = 1;
+
+				trianglesRemoved += (kinds[v0] == kVertexBorder) ? 1 : 2;
+				resultError = std::max(resultError, collapse.error);
+				numCollapsed++;
+			}
+
+			if (numCollapsed == 0)
+				break;
+
+			// move the indices and drop the triangles that lost their area
+			size_t write = 0;
+			for (size_t i = 0; i < out_indices.size(); i += 3)
+			{
+				uint32_t a = collapseRemap[out_indices[i + 0]];
+				uint32_t b = collapseRemap[out_indices[i + 1]];
+				uint32_t c = collapseRemap[out_indices[i + 2]];
+
+				if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a])
+					continue;
+
+				out_indices[write + 0] = a;
+				out_indices[write + 1] = b;
+				out_indices[write + 2] = c;
+				write += 3;
+			}
+			out_indices.resize(write);
+		}
+
+		if (out_error)
+		{
+			*out_error = static_cast<float>(std::sqrt(resultError) * extent);
+		}
+
+		return out_indices.size();
+	}
+
+	void BuildLODChain(const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const LODChainOptions& options,
+		std::vector< MeshLODLevel >& out_lods,
+		const uint8_t* pLockedVertices)
+	{
+		out_lods.assign(1, MeshLODLevel());
+		out_lods[0].indices.assign(pIndices, pIndices + numIndices);
+
+		BoundingBox bounds;
+		bounds.mMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		bounds.mMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			const XMFLOAT3& p = pVertices[i].position;
+			bounds.mMin = XMFLOAT3(std::min(bounds.mMin.x, p.x), std::min(bounds.mMin.y, p.y), std::min(bounds.mMin.z, p.z));
+			bounds.mMax = XMFLOAT3(std::max(bounds.mMax.x, p.x), std::max(bounds.mMax.y, p.y), std::max(bounds.mMax.z, p.z));
+		}
+
+		float extent = std::max(std::max(bounds.mMax.x - bounds.mMin.x, bounds.mMax.y - bounds.mMin.y), bounds.mMax.z - bounds.mMin.z);
+		float maxError = options.maxRelativeError * extent;
+
+		UINT numLODs = std::min(options.numLODs, kMaxLODs);
+
+		for (UINT lod = 1; lod < numLODs; ++lod)
+		{
+			const MeshLODLevel& previous = out_lods.back();
+
+			size_t target = static_cast<size_t>(previous.indices.size() / 3 * options.reductionPerLOD) * 3;
+
+			// each level starts from the previous one, its error adds to the error of the previous level
+			MeshLODLevel level;
+			float error = 0.0f;
+			Simplify(pVertices, numVertices, previous.indices.data(), previous.indices.size(), target,
+				maxError - previous.error, level.indices, &error, pLockedVertices);
+
+			if (level.indices.empty() || level.indices.size() > previous.indices.size() * 9 / 10)
+				break;
+
+			level.error = previous.error + error;
+
+			std::vector< uint32_t > optimized(level.indices.size());
+			DXMeshOptimizer::OptimizeVertexCache(optimized.data(), level.indices.data(), level.indices.size(), numVertices);
+			level.indices.swap(optimized);
+
+			out_lods.push_back(std::move(level));
+		}
+	}
+
+	void FindSharedVertices(const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		const std::vector< size_t >& rangeStarts,
+		size_t numIndices,
+		std::vector< uint8_t >& out_shared)
+	{
+		out_shared.assign(numVertices, 0);
+
+		std::vector< Vec3 > positions(numVertices);
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			const XMFLOAT3& p = pVertices[i].position;
+			positions[i] = { p.x, p.y, p.z };
+		}
+
+		std::vector< uint32_t > remap, wedge;
+		BuildPositionGroups(positions, remap, wedge);
+
+		// first range that uses each position group, a second range marks the group as shared
+		const uint32_t kNoRange = 0xffffffff;
+		std::vector< uint32_t > owner(numVertices, kNoRange);
+		std::vector< uint8_t > sharedGroup(numVertices, 0);
+
+		for (size_t r = 0; r < rangeStarts.size(); ++r)
+		{
+			size_t end = (r + 1 < rangeStarts.size()) ? rangeStarts[r + 1] : numIndices;
+			for (size_t i = rangeStarts[r]; i < end; ++i)
+			{
+				uint32_t group = remap[pIndices[i]];
+				if (owner[group] == kNoRange)
+				{
+					owner[group] = static_cast<uint32_t>(r);
+				}
+				else if (owner[group] != r)
+				{
+					sharedGroup[group] = 1;
+				}
+			}
+		}
+
+		for (size_t v = 0; v < numVertices; ++v)
+		{
+			out_shared[v] = sharedGroup[remap[v]];
+		}
+	}
+
+	void BuildLODChains(std::vector< LODChainJob >& jobs, const LODChainOptions& options, uint32_t numThreads)
+	{
+		DXParallel::ParallelFor(jobs.size(), [&](size_t i)
+		{
+			LODChainJob& job = jobs[i];
+
+			auto start = std::chrono::high_resolution_clock::now();
+			BuildLODChain(job.pVertices, job.numVertices, job.pIndices, job.numIndices, options, job.lods, job.pLockedVertices);
+			job.buildMs = GetElapsedMs(start);
+		}, numThreads);
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include <vector>
+
+//One level of detail.  The indices reference the vertices of the full resolution mesh.
+struct MeshLODLevel
+{
+	std::vector< uint32_t > indices;
+	float error = 0.0f;  //object space distance the level may deviate from the full resolution mesh
+};
+
+struct LODChainOptions
+{
+	UINT numLODs = 4;                //including the full resolution mesh, at most kMaxLODs
+	float reductionPerLOD = 0.5f;    //triangle count of a level relative to the previous one
+	float maxRelativeError = 0.05f;  //give up on further levels above this error, relative to the largest extent
+};
+
+//Everything BuildLODChains needs for one mesh.  lods and buildMs are filled in.
+struct LODChainJob
+{
+	const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices = nullptr;
+	size_t numVertices = 0;
+	const uint32_t* pIndices = nullptr;
+	size_t numIndices = 0;
+	const uint8_t* pLockedVertices = nullptr;  //optional, one flag per vertex, flagged vertices never move
+
+	std::vector< MeshLODLevel > lods;
+	double buildMs = 0.0;
+};
+
+//Quadric error metric edge collapse simplification (Garland and Heckbert 1997).  Vertices are never moved or created,
+//an edge collapse moves one vertex onto another one, so the simplified index lists share the vertex buffer of the
+//full mesh.  Vertices on an open border only slide along the border and vertices on a uv / normal seam (same
+//position, different attributes) only slide along the seam, together with their twin on the other side.
+namespace DXMeshSimplifier
+{
+	const UINT kMaxLODs = 5;
+
+	//collapse edges until at most targetIndexCount indices are left or the next collapse would exceed maxError
+	//(object space distance).  returns the number of indices in out_indices.
+	size_t Simplify(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		size_t targetIndexCount,
+		float maxError,
+		std::vector< uint32_t >& out_indices,
+		float* out_error = nullptr,
+		const uint8_t* pLockedVertices = nullptr);
+
+	//level 0 is the source mesh, every further level simplifies the previous one.  the chain stops early when a level
+	//would not remove at least 10% of the triangles or would exceed maxRelativeError.  the levels are reordered
+	//for the vertex cache.
+	void BuildLODChain(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const LODChainOptions& options,
+		std::vector< MeshLODLevel >& out_lods,
+		const uint8_t* pLockedVertices = nullptr);
+
+	//flags the vertices whose position is used by more than one index range.  locking them while the ranges are
+	//simplified separately keeps the ranges connected without cracks.
+	void FindSharedVertices(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		const std::vector< size_t >& rangeStarts,
+		size_t numIndices,
+		std::vector< uint8_t >& out_shared);
+
+	//one chain per job, the jobs are spread over numThreads threads (0 = all cores)
+	void BuildLODChains(std::vector< LODChainJob >& jobs, const LODChainOptions& options, uint32_t numThreads = 0);
+}
@@ -0,0 +1,132 @@
+#include "stdafx.h"
+#include "DXMeshWelder.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	const uint32_t kEmptySlot = 0xffffffff;
+
+	//the 8 attribute floats of a vertex as comparable integers
+	struct WeldKey
+	{
+		uint32_t words[8];
+
+		bool operator==(const WeldKey& other) const { return memcmp(words, other.words, sizeof(words)) == 0; }
+	};
+
+	inline uint32_t QuantizeFloat(float value, float epsilon)
+	{
+		if (epsilon > 0.0f)
+		{
+			return static_cast<uint32_t>(static_cast<int32_t>(std::floor(value / epsilon + 0.5f)));
+		}
+
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits == 0x80000000 ? 0 : bits; //-0 == +0
+	}
+
+	inline WeldKey MakeKey(const MeshVertexPosNormUV0& vertex, const WeldOptions& options)
+	{
+		WeldKey key;
+		key.words[0] = QuantizeFloat(vertex.position.x, options.positionEpsilon);
+		key.words[1] = QuantizeFloat(vertex.position.y, options.positionEpsilon);
+		key.words[2] = QuantizeFloat(vertex.position.z, options.positionEpsilon);
+		key.words[3] = QuantizeFloat(vertex.normal.x, options.normalEpsilon);
+		key.words[4] = QuantizeFloat(vertex.normal.y, options.normalEpsilon);
+		key.words[5] = QuantizeFloat(vertex.normal.z, options.normalEpsilon);
+		key.words[6] = QuantizeFloat(vertex.uv.x, options.uvEpsilon);
+		key.words[7] = QuantizeFloat(vertex.uv.y, options.uvEpsilon);
+		return key;
+	}
+
+	inline uint64_t HashKey(const WeldKey& key)
+	{
+		uint64_t hash = 0;
+		for (uint32_t word : key.words)
+		{
+			hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+			hash ^= hash >> 32;
+		}
+
+		// murmur3 finalizer so the low bits used for the slot depend on every input bit
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+}
+
+namespace DXMeshWelder
+{
+	void WeldVertices(const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const WeldOptions& options,
+		std::vector< MeshVertexPosNormUV0 >& out_vertices,
+		std::vector< uint32_t >& out_indices,
+		WeldStats* pStats,
+		std::pmr::memory_resource* pScratch)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		out_vertices.clear();
+		out_indices.resize(numVertices);
+
+		// keep the load factor at or below 0.5 so probe sequences stay short
+		size_t tableSize = 16;
+		while (tableSize < numVertices * 2)
+		{
+			tableSize <<= 1;
+		}
+		const size_t tableMask = tableSize - 1;
+
+		std::pmr::vector< uint32_t > table(tableSize, kEmptySlot, pScratch);
+		std::pmr::vector< WeldKey > uniqueKeys(pScratch);
+		uniqueKeys.reserve(numVertices / 2);
+		out_vertices.reserve(numVertices / 2);
+
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			WeldKey key = MakeKey(pVertices[i], options);
+			size_t slot = static_cast<size_t>(HashKey(key)) & tableMask;
+
+			while (true)
+			{
+				uint32_t vertexIndex = table[slot];
+				if (vertexIndex == kEmptySlot)
+				{
+					vertexIndex = static_cast<uint32_t>(out_vertices.size());
+					table[slot] = vertexIndex;
+					uniqueKeys.push_back(key);
+					out_vertices.push_back(pVertices[i]);
+					out_indices[i] = vertexIndex;
+					break;
+				}
+
+				if (uniqueKeys[vertexIndex] == key)
+				{
+					out_indices[i] = vertexIndex;
+					break;
+				}
+
+				slot = (slot + 1) & tableMask;
+			}
+		}
+
+		out_vertices.shrink_to_fit();
+
+		if (pStats)
+		{
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			pStats->numInputVertices = numVertices;
+			pStats->numOutputVertices = out_vertices.size();
+			pStats->weldMs = elapsed.count();
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include <vector>
+#include <memory_resource>
+
+//Options for DXMeshWelder::WeldVertices.  An epsilon of 0 welds only bit identical attributes (+0 and -0 are
+//treated as equal).  A positive epsilon quantizes the attribute to a grid of that size before comparing, so
+//vertices that differ by less than about epsilon / 2 are merged.  The first vertex of a group is kept as is.
+struct WeldOptions
+{
+	float positionEpsilon = 0.0f;
+	float normalEpsilon = 0.0f;
+	float uvEpsilon = 0.0f;
+};
+
+struct WeldStats
+{
+	size_t numInputVertices = 0;
+	size_t numOutputVertices = 0;
+	double weldMs = 0.0;
+
+	//input vertices per output vertex, e.g. 6.0 for a closed grid that was fully expanded
+	double GetReductionRatio() const { return numOutputVertices ? double(numInputVertices) / double(numOutputVertices) : 0.0; }
+};
+
+//Vertex welding.  Removes duplicate (position, normal, uv) vertices from an unindexed triangle list and builds
+//the matching index buffer.  The lookup is an open addressing (linear probing) hash table of vertex indices, no
+//allocation happens per vertex.  The hash table and the keys come from pScratch, e.g. a DXLoadArena.
+namespace DXMeshWelder
+{
+	void WeldVertices(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const WeldOptions& options,
+		std::vector< DXGraphicsUtilities::MeshVertexPosNormUV0 >& out_vertices,
+		std::vector< uint32_t >& out_indices,
+		WeldStats* pStats = nullptr,
+		std::pmr::memory_resource* pScratch = std::pmr::get_default_resource());
+}
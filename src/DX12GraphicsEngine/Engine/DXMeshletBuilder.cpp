@@ -0,0 +1,1017 @@
+#include "stdafx.h"
+#include "DXMeshletBuilder.h"
+#include "DXParallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	const uint32_t kNoVertex = 0xffffffff;
+	const uint32_t kNoTriangle = 0xffffffff;
+	const uint16_t kNotInMeshlet = 0xffff;
+
+	//MSHL buffer views are padded to this, MeshShaderModel only needs 4 byte alignment
+	const size_t kBufferViewAlignment = 16;
+
+	uint32_t GetFormatSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT: return 16;
+		case DXGI_FORMAT_R32G32B32_FLOAT: return 12;
+		case DXGI_FORMAT_R32G32_FLOAT: return 8;
+		case DXGI_FORMAT_R32_FLOAT: return 4;
+		default: return 0;
+		}
+	}
+
+	inline const XMFLOAT3& GetPosition(const XMFLOAT3* pPositions, size_t positionStride, uint32_t index)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(pPositions) + index * positionStride);
+	}
+
+	//spread the low 10 bits of v so there are two zero bits between any two of them
+	inline uint32_t SpreadBits(uint32_t v)
+	{
+		v &= 0x3ff;
+		v = (v | (v << 16)) & 0x030000ff;
+		v = (v | (v << 8)) & 0x0300f00f;
+		v = (v | (v << 4)) & 0x030c30c3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+
+	//compact vertex numbering of one subset, so the per vertex arrays only cover the vertices it uses
+	void RemapVertices(const uint32_t* pIndices,
+		size_t numIndices,
+		size_t numVertices,
+		std::vector< uint32_t >& out_localIndices,
+		std::vector< uint32_t >& out_globalVertices)
+	{
+		out_localIndices.resize(numIndices);
+		out_globalVertices.clear();
+
+		if (numVertices <= numIndices)
+		{
+			// dense, a table over all vertices is cheaper than sorting
+			std::vector< uint32_t > localOf(numVertices, kNoVertex);
+			for (size_t i = 0; i < numIndices; ++i)
+			{
+				uint32_t& local = localOf[pIndices[i]];
+				if (local == kNoVertex)
+				{
+					local = static_cast<uint32_t>(out_globalVertices.size());
+					out_globalVertices.push_back(pIndices[i]);
+				}
+				out_localIndices[i] = local;
+			}
+		}
+		else
+		{
+			out_globalVertices.assign(pIndices, pIndices + numIndices);
+			std::sort(out_globalVertices.begin(), out_globalVertices.end());
+			out_globalVertices.erase(std::unique(out_globalVertices.begin(), out_globalVertices.end()), out_globalVertices.end());
+
+			for (size_t i = 0; i < numIndices; ++i)
+			{
+				out_localIndices[i] = static_cast<uint32_t>(
+					std::lower_bound(out_globalVertices.begin(), out_globalVertices.end(), pIndices[i]) - out_globalVertices.begin());
+			}
+		}
+	}
+
+	struct Vec3
+	{
+		float x, y, z;
+	};
+
+	inline float DistanceSq(const Vec3& a, const Vec3& b)
+	{
+		float dx = a.x - b.x;
+		float dy = a.y - b.y;
+		float dz = a.z - b.z;
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	//the meshlet that is currently being filled
+	struct MeshletBuilderState
+	{
+		std::vector< uint32_t > vertices;     //local vertex ids
+		std::vector< uint16_t > triangles;    //3 meshlet slots per triangle
+		Vec3 centroidSum = { 0.0f, 0.0f, 0.0f };
+		size_t numTriangles = 0;
+
+		Vec3 GetCenter() const
+		{
+			float scale = numTriangles ? 1.0f / float(numTriangles) : 0.0f;
+			return { centroidSum.x * scale, centroidSum.y * scale, centroidSum.z * scale };
+		}
+	};
+
+	size_t AlignSize(size_t size)
+	{
+		return (size + kBufferViewAlignment - 1) & ~(kBufferViewAlignment - 1);
+	}
+
+	template< typename T >
+	void AppendBytes(std::vector< uint8_t >& out, const T& value)
+	{
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+		out.insert(out.end(), p, p + sizeof(T));
+	}
+
+	//cull data math is in double, the circumsphere solves lose too much in float for thin triangles
+	struct Vec3d
+	{
+		double x, y, z;
+	};
+
+	inline Vec3d ToVec3d(const XMFLOAT3& v) { return { v.x, v.y, v.z }; }
+	inline Vec3d Add(const Vec3d& a, const Vec3d& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	inline Vec3d Sub(const Vec3d& a, const Vec3d& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	inline Vec3d Scale(const Vec3d& a, double s) { return { a.x * s, a.y * s, a.z * s }; }
+	inline Vec3d Cross(const Vec3d& a, const Vec3d& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	inline double Dot(const Vec3d& a, const Vec3d& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	struct Sphere
+	{
+		Vec3d center;
+		double radiusSq;   //negative for the empty sphere
+	};
+
+	inline bool IsOutside(const Sphere& sphere, const Vec3d& p)
+	{
+		// relative slack, so points on the boundary of their own support sphere do not recurse again
+		return Dot(Sub(p, sphere.center), Sub(p, sphere.center)) > sphere.radiusSq * (1.0 + 1e-9) + 1e-18;
+	}
+
+	Sphere SphereFromDiameter(const Vec3d& a, const Vec3d& b)
+	{
+		Vec3d d = Sub(b, a);
+		return { Scale(Add(a, b), 0.5), Dot(d, d) * 0.25 };
+	}
+
+	//smallest sphere with all the support points on its boundary
+	Sphere SphereFromSupport(const Vec3d* pSupport, uint32_t count)
+	{
+		if (count == 0)
+			return { { 0.0, 0.0, 0.0 }, -1.0 };
+
+		if (count == 1)
+			return { pSupport[0], 0.0 };
+
+		if (count == 2)
+			return SphereFromDiameter(pSupport[0], pSupport[1]);
+
+		const Vec3d& a = pSupport[0];
+		Vec3d b = Sub(pSupport[1], a);
+		Vec3d c = Sub(pSupport[2], a);
+		Vec3d n = Cross(b, c);
+
+		if (count == 3)
+		{
+			double denominator = 2.0 * Dot(n, n);
+			if (denominator <= 1e-30)
+			{
+				// collinear, the two points farthest apart span the sphere
+				Sphere ab = SphereFromDiameter(pSupport[0], pSupport[1]);
+				Sphere ac = SphereFromDiameter(pSupport[0], pSupport[2]);
+				Sphere bc = SphereFromDiameter(pSupport[1], pSupport[2]);
+				return ab.radiusSq > ac.radiusSq ? (ab.radiusSq > bc.radiusSq ? ab : bc) : (ac.radiusSq > bc.radiusSq ? ac : bc);
+			}
+
+			Vec3d offset = Scale(Add(Scale(Cross(n, b), Dot(c, c)), Scale(Cross(c, n), Dot(b, b))), 1.0 / denominator);
+			return { Add(a, offset), Dot(offset, offset) };
+		}
+
+		Vec3d d = Sub(pSupport[3], a);
+		double denominator = 2.0 * Dot(b, Cross(c, d));
+		if (std::abs(denominator) <= 1e-30)
+		{
+			// coplanar, the largest circumcircle of the four triangles holds the other point
+			Sphere best = { { 0.0, 0.0, 0.0 }, -1.0 };
+			const uint32_t kTriangles[4][3] = { { 0, 1, 2 }, { 0, 1, 3 }, { 0, 2, 3 }, { 1, 2, 3 } };
+			for (const auto& t : kTriangles)
+			{
+				Vec3d triangle[3] = { pSupport[t[0]], pSupport[t[1]], pSupport[t[2]] };
+				Sphere sphere = SphereFromSupport(triangle, 3);
+				if (sphere.radiusSq > best.radiusSq)
+				{
+					best = sphere;
+				}
+			}
+			return best;
+		}
+
+		Vec3d offset = Scale(Add(Add(Scale(Cross(c, d), Dot(b, b)), Scale(Cross(d, b), Dot(c, c))), Scale(n, Dot(d, d))), 1.0 / denominator);
+		return { Add(a, offset), Dot(offset, offset) };
+	}
+
+	//Welzl's minimum enclosing sphere with the move to front heuristic.  points is reordered.
+	Sphere MinimumSphere(Vec3d* pPoints, uint32_t count, Vec3d* pSupport, uint32_t numSupport)
+	{
+		Sphere sphere = SphereFromSupport(pSupport, numSupport);
+		if (numSupport == 4)
+			return sphere;
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (IsOutside(sphere, pPoints[i]))
+			{
+				pSupport[numSupport] = pPoints[i];
+				sphere = MinimumSphere(pPoints, i, pSupport, numSupport + 1);
+
+				std::rotate(pPoints, pPoints + i, pPoints + i + 1);
+			}
+		}
+
+		return sphere;
+	}
+
+	Sphere MinimumSphere(std::vector< Vec3d >& points)
+	{
+		Vec3d support[4];
+		Sphere sphere = MinimumSphere(points.data(), static_cast<uint32_t>(points.size()), support, 0);
+
+		// the boundary tests are not exact, grow the sphere over any point that ended up a hair outside
+		for (const Vec3d& p : points)
+		{
+			sphere.radiusSq = std::max(sphere.radiusSq, Dot(Sub(p, sphere.center), Sub(p, sphere.center)));
+		}
+		return sphere;
+	}
+
+	inline uint8_t QuantizeUnorm8(double v)
+	{
+		return static_cast<uint8_t>(std::min(255.0, std::max(0.0, std::floor(v * 255.0 + 0.5))));
+	}
+
+	//the axis the culler works with: the quantized one, normalized
+	inline Vec3d DequantizeConeAxis(const uint8_t* pCone)
+	{
+		Vec3d axis = { pCone[0] / 255.0 * 2.0 - 1.0, pCone[1] / 255.0 * 2.0 - 1.0, pCone[2] / 255.0 * 2.0 - 1.0 };
+		double length = std::sqrt(Dot(axis, axis));
+		return length > 0.0 ? Scale(axis, 1.0 / length) : axis;
+	}
+}
+
+namespace DXMeshletBuilder
+{
+	void BuildMeshlets(const XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const MeshletBuildOptions& options,
+		std::vector< Meshlet >& out_meshlets,
+		std::vector< uint32_t >& out_uniqueVertexIndices,
+		std::vector< PackedTriangle >& out_primitiveIndices)
+	{
+		out_meshlets.clear();
+		out_uniqueVertexIndices.clear();
+		out_primitiveIndices.clear();
+
+		const uint32_t maxVertices = std::max< uint32_t >(3, std::min(options.maxVertices, kMaxMeshletVertices));
+		const uint32_t maxPrimitives = std::max< uint32_t >(1, std::min(options.maxPrimitives, kMaxMeshletPrimitives));
+
+		const size_t numTriangles = numIndices / 3;
+		if (numTriangles == 0)
+			return;
+
+		std::vector< uint32_t > indices, globalVertices;
+		RemapVertices(pIndices, numTriangles * 3, numVertices, indices, globalVertices);
+		const size_t numLocalVertices = globalVertices.size();
+
+		// triangle centroids and their order along a Morton curve
+		std::vector< Vec3 > centroids(numTriangles);
+		Vec3 boundsMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+		Vec3 boundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (size_t t = 0; t < numTriangles; ++t)
+		{
+			Vec3 c = { 0.0f, 0.0f, 0.0f };
+			for (int k = 0; k < 3; ++k)
+			{
+				const XMFLOAT3& p = GetPosition(pPositions, positionStride, globalVertices[indices[t * 3 + k]]);
+				c.x += p.x / 3.0f;
+				c.y += p.y / 3.0f;
+				c.z += p.z / 3.0f;
+			}
+			centroids[t] = c;
+
+			boundsMin = { std::min(boundsMin.x, c.x), std::min(boundsMin.y, c.y), std::min(boundsMin.z, c.z) };
+			boundsMax = { std::max(boundsMax.x, c.x), std::max(boundsMax.y, c.y), std::max(boundsMax.z, c.z) };
+		}
+
+		float extent = std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y), boundsMax.z - boundsMin.z);
+		float scale = extent > 0.0f ? 1023.0f / extent : 0.0f;
+
+		std::vector< std::pair< uint32_t, uint32_t > > mortonOrder(numTriangles);
+		for (size_t t = 0; t < numTriangles; ++t)
+		{
+			uint32_t x = static_cast<uint32_t>((centroids[t].x - boundsMin.x) * scale + 0.5f);
+			uint32_t y = static_cast<uint32_t>((centroids[t].y - boundsMin.y) * scale + 0.5f);
+			uint32_t z = static_cast<uint32_t>((centroids[t].z - boundsMin.z) * scale + 0.5f);
+			mortonOrder[t] = std::make_pair(SpreadBits(x) | (SpreadBits(y) << 1) | (SpreadBits(z) << 2), static_cast<uint32_t>(t));
+		}
+		std::sort(mortonOrder.begin(), mortonOrder.end());
+
+		// triangles around each vertex
+		std::vector< uint32_t > triangleOffsets(numLocalVertices + 1, 0);
+		for (size_t i = 0; i < numTriangles * 3; ++i)
+		{
+			triangleOffsets[indices[i] + 1]++;
+		}
+		for (size_t v = 0; v < numLocalVertices; ++v)
+		{
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		}
+
+		std::vector< uint32_t > vertexTriangles(numTriangles * 3);
+		{
+			std::vector< uint32_t > fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < numTriangles * 3; ++i)
+			{
+				vertexTriangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector< uint8_t > used(numTriangles, 0);
+		std::vector< uint16_t > slots(numLocalVertices, kNotInMeshlet);
+
+		MeshletBuilderState meshlet;
+		meshlet.vertices.reserve(maxVertices);
+		meshlet.triangles.reserve(maxPrimitives * 3);
+
+		out_meshlets.reserve(numTriangles / maxPrimitives + 1);
+		out_primitiveIndices.reserve(numTriangles);
+
+		auto countNewVertices = [&](uint32_t t)
+		{
+			const uint32_t* pTriangle = &indices[t * 3];
+			return (slots[pTriangle[0]] == kNotInMeshlet) + (slots[pTriangle[1]] == kNotInMeshlet) + (slots[pTriangle[2]] == kNotInMeshlet);
+		};
+
+		// best unused triangle around the given vertices that still fits into the meshlet
+		auto findNeighbour = [&](const uint32_t* pVertices, size_t count)
+		{
+			uint32_t best = kNoTriangle;
+			int bestNew = 4;
+			float bestDistance = FLT_MAX;
+			Vec3 center = meshlet.GetCenter();
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				uint32_t v = pVertices[i];
+				for (uint32_t j = triangleOffsets[v]; j < triangleOffsets[v + 1]; ++j)
+				{
+					uint32_t t = vertexTriangles[j];
+					if (used[t])
+						continue;
+
+					int numNew = countNewVertices(t);
+					if (meshlet.vertices.size() + numNew > maxVertices)
+						continue;
+
+					float distance = DistanceSq(centroids[t], center);
+					if (numNew < bestNew || (numNew == bestNew && distance < bestDistance))
+					{
+						best = t;
+						bestNew = numNew;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			return best;
+		};
+
+		auto flushMeshlet = [&]()
+		{
+			Meshlet m;
+			m.VertCount = static_cast<uint32_t>(meshlet.vertices.size());
+			m.VertOffset = static_cast<uint32_t>(out_uniqueVertexIndices.size());
+			m.PrimCount = static_cast<uint32_t>(meshlet.numTriangles);
+			m.PrimOffset = static_cast<uint32_t>(out_primitiveIndices.size());
+			out_meshlets.push_back(m);
+
+			for (uint32_t v : meshlet.vertices)
+			{
+				out_uniqueVertexIndices.push_back(globalVertices[v]);
+				slots[v] = kNotInMeshlet;
+			}
+
+			for (size_t i = 0; i < meshlet.triangles.size(); i += 3)
+			{
+				PackedTriangle triangle;
+				triangle.i0 = meshlet.triangles[i + 0];
+				triangle.i1 = meshlet.triangles[i + 1];
+				triangle.i2 = meshlet.triangles[i + 2];
+				out_primitiveIndices.push_back(triangle);
+			}
+
+			meshlet.vertices.clear();
+			meshlet.triangles.clear();
+			meshlet.centroidSum = { 0.0f, 0.0f, 0.0f };
+			meshlet.numTriangles = 0;
+		};
+
+		size_t cursor = 0;
+		while (true)
+		{
+			while (cursor < numTriangles && used[mortonOrder[cursor].second])
+			{
+				cursor++;
+			}
+			if (cursor == numTriangles)
+				break;
+
+			uint32_t t = mortonOrder[cursor].second;
+			while (t != kNoTriangle)
+			{
+				const uint32_t* pTriangle = &indices[t * 3];
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t v = pTriangle[k];
+					if (slots[v] == kNotInMeshlet)
+					{
+						slots[v] = static_cast<uint16_t>(meshlet.vertices.size());
+						meshlet.vertices.push_back(v);
+					}
+					meshlet.triangles.push_back(slots[v]);
+				}
+
+				meshlet.centroidSum = { meshlet.centroidSum.x + centroids[t].x, meshlet.centroidSum.y + centroids[t].y,
+					meshlet.centroidSum.z + centroids[t].z };
+				meshlet.numTriangles++;
+				used[t] = 1;
+
+				if (meshlet.numTriangles == maxPrimitives)
+					break;
+
+				// neighbours of the last triangle first, then of the whole meshlet, then the next triangle on the curve
+				t = findNeighbour(pTriangle, 3);
+				if (t == kNoTriangle)
+				{
+					t = findNeighbour(meshlet.vertices.data(), meshlet.vertices.size());
+				}
+				if (t == kNoTriangle)
+				{
+					while (cursor < numTriangles && used[mortonOrder[cursor].second])
+					{
+						cursor++;
+					}
+					if (cursor < numTriangles &&
+						meshlet.vertices.size() + countNewVertices(mortonOrder[cursor].second) <= maxVertices)
+					{
+						t = mortonOrder[cursor].second;
+					}
+				}
+			}
+
+			flushMeshlet();
+		}
+	}
+
+	void BuildMeshlets(const XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const std::vector< Subset >& indexSubsets,
+		const MeshletBuildOptions& options,
+		MeshletData& out_data,
+		MeshletStats* pStats,
+		uint32_t numThreads)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::vector< Subset > subsets = indexSubsets;
+		if (subsets.empty())
+		{
+			Subset all = { 0, static_cast<uint32_t>(numIndices) };
+			subsets.push_back(all);
+		}
+
+		struct SubsetMeshlets
+		{
+			std::vector< Meshlet > meshlets;
+			std::vector< uint32_t > uniqueVertexIndices;
+			std::vector< PackedTriangle > primitiveIndices;
+		};
+
+		std::vector< SubsetMeshlets > built(subsets.size());
+		DXParallel::ParallelFor(subsets.size(), [&](size_t i)
+		{
+			const Subset& subset = subsets[i];
+			size_t count = std::min< size_t >(subset.Count, numIndices - std::min< size_t >(subset.Offset, numIndices));
+			BuildMeshlets(pPositions, positionStride, numVertices, pIndices + subset.Offset, count, options,
+				built[i].meshlets, built[i].uniqueVertexIndices, built[i].primitiveIndices);
+		}, numThreads);
+
+		// concatenate in subset order and rebase the offsets
+		out_data.meshlets.clear();
+		out_data.uniqueVertexIndices.clear();
+		out_data.primitiveIndices.clear();
+		out_data.meshletSubsets.clear();
+
+		for (SubsetMeshlets& subset : built)
+		{
+			Subset meshletSubset = { static_cast<uint32_t>(out_data.meshlets.size()), static_cast<uint32_t>(subset.meshlets.size()) };
+			out_data.meshletSubsets.push_back(meshletSubset);
+
+			uint32_t vertexBase = static_cast<uint32_t>(out_data.uniqueVertexIndices.size());
+			uint32_t primitiveBase = static_cast<uint32_t>(out_data.primitiveIndices.size());
+			for (Meshlet m : subset.meshlets)
+			{
+				m.VertOffset += vertexBase;
+				m.PrimOffset += primitiveBase;
+				out_data.meshlets.push_back(m);
+			}
+
+			out_data.uniqueVertexIndices.insert(out_data.uniqueVertexIndices.end(), subset.uniqueVertexIndices.begin(), subset.uniqueVertexIndices.end());
+			out_data.primitiveIndices.insert(out_data.primitiveIndices.end(), subset.primitiveIndices.begin(), subset.primitiveIndices.end());
+		}
+
+		ComputeCullData(pPositions, positionStride, out_data, out_data.cullData);
+
+		if (pStats)
+		{
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			pStats->numMeshlets = out_data.meshlets.size();
+			pStats->numTriangles = out_data.primitiveIndices.size();
+			pStats->numMeshletVertices = out_data.uniqueVertexIndices.size();
+			pStats->maxVertices = std::min(options.maxVertices, kMaxMeshletVertices);
+			pStats->maxPrimitives = std::min(options.maxPrimitives, kMaxMeshletPrimitives);
+			pStats->buildMs = elapsed.count();
+		}
+	}
+
+	void ComputeCullData(const XMFLOAT3* pPositions,
+		size_t positionStride,
+		const MeshletData& data,
+		std::vector< CullData >& out_cullData)
+	{
+		out_cullData.resize(data.meshlets.size());
+
+		std::vector< Vec3d > points;
+		std::vector< Vec3d > normals;
+		std::vector< Vec3d > corners;
+
+		for (size_t i = 0; i < data.meshlets.size(); ++i)
+		{
+			const Meshlet& m = data.meshlets[i];
+			const uint32_t* pVertices = &data.uniqueVertexIndices[m.VertOffset];
+			CullData& cull = out_cullData[i];
+
+			points.resize(m.VertCount);
+			for (uint32_t j = 0; j < m.VertCount; ++j)
+			{
+				points[j] = ToVec3d(GetPosition(pPositions, positionStride, pVertices[j]));
+			}
+
+			Sphere bounds = MinimumSphere(points);
+			cull.BoundingSphere = XMFLOAT4(float(bounds.center.x), float(bounds.center.y), float(bounds.center.z),
+				float(std::sqrt(std::max(bounds.radiusSq, 0.0))));
+
+			// a float radius rounded down can leave the farthest vertex just outside
+			while (true)
+			{
+				Vec3d center = { cull.BoundingSphere.x, cull.BoundingSphere.y, cull.BoundingSphere.z };
+				double radius = cull.BoundingSphere.w;
+				bool bContained = true;
+				for (const Vec3d& p : points)
+				{
+					bContained = bContained && Dot(Sub(p, center), Sub(p, center)) <= radius * radius;
+				}
+				if (bContained)
+					break;
+				cull.BoundingSphere.w = std::nextafter(cull.BoundingSphere.w, FLT_MAX);
+			}
+
+			// degenerate until shown otherwise: the cone spreads wider than a hemisphere or has no triangles
+			cull.NormalCone[0] = 0;
+			cull.NormalCone[1] = 0;
+			cull.NormalCone[2] = 0;
+			cull.NormalCone[3] = 0xff;
+			cull.ApexOffset = 0.0f;
+
+			normals.clear();
+			corners.clear();
+			for (uint32_t j = 0; j < m.PrimCount; ++j)
+			{
+				const PackedTriangle& triangle = data.primitiveIndices[m.PrimOffset + j];
+				// not from points, the sphere search reordered it
+				Vec3d p0 = ToVec3d(GetPosition(pPositions, positionStride, pVertices[triangle.i0]));
+				Vec3d p1 = ToVec3d(GetPosition(pPositions, positionStride, pVertices[triangle.i1]));
+				Vec3d p2 = ToVec3d(GetPosition(pPositions, positionStride, pVertices[triangle.i2]));
+
+				Vec3d n = Cross(Sub(p1, p0), Sub(p2, p0));
+				double length = std::sqrt(Dot(n, n));
+				if (length <= 0.0)
+					continue;  // zero area triangles are never rasterized
+
+				normals.push_back(Scale(n, 1.0 / length));
+				corners.push_back(p0);
+			}
+
+			if (normals.empty())
+				continue;
+
+			// the axis is the center of the smallest sphere around the unit normals
+			std::vector< Vec3d > normalPoints = normals;
+			Sphere normalBounds = MinimumSphere(normalPoints);
+			double axisLength = std::sqrt(Dot(normalBounds.center, normalBounds.center));
+			if (axisLength <= 1e-6)
+				continue;
+
+			Vec3d axis = Scale(normalBounds.center, 1.0 / axisLength);
+			uint8_t cone[4] = { QuantizeUnorm8(axis.x * 0.5 + 0.5), QuantizeUnorm8(axis.y * 0.5 + 0.5), QuantizeUnorm8(axis.z * 0.5 + 0.5), 0 };
+
+			// measure the spread against the axis the culler will unpack, not the exact one
+			axis = DequantizeConeAxis(cone);
+			double minDot = 1.0;
+			for (const Vec3d& n : normals)
+			{
+				minDot = std::min(minDot, Dot(n, axis));
+			}
+
+			if (minDot < 0.1)
+				continue;
+
+			// -cos(a + 90) = sin(a), rounded up so the quantized cone culls less, never more
+			double cutoff = std::sqrt(1.0 - minDot * minDot);
+			double cutoffByte = std::ceil(cutoff * 255.0);
+			if (cutoffByte >= 255.0)
+				continue;
+
+			// move the apex back along the axis until it is behind the plane of every triangle
+			Vec3d center = { cull.BoundingSphere.x, cull.BoundingSphere.y, cull.BoundingSphere.z };
+			double apexOffset = 0.0;
+			for (size_t j = 0; j < normals.size(); ++j)
+			{
+				double t = Dot(Sub(center, corners[j]), normals[j]) / Dot(axis, normals[j]);
+				apexOffset = std::max(apexOffset, t);
+			}
+
+			cull.NormalCone[0] = cone[0];
+			cull.NormalCone[1] = cone[1];
+			cull.NormalCone[2] = cone[2];
+			cull.NormalCone[3] = static_cast<uint8_t>(cutoffByte);
+			cull.ApexOffset = static_cast<float>(apexOffset);
+			if (cull.ApexOffset < apexOffset)
+			{
+				cull.ApexOffset = std::nextafter(cull.ApexOffset, FLT_MAX);  // further back is still behind every plane
+			}
+		}
+	}
+
+	bool GetPositions(const Mesh& mesh, const XMFLOAT3*& out_pPositions, size_t& out_positionStride)
+	{
+		out_pPositions = nullptr;
+		out_positionStride = 0;
+
+		// the offset of every element in its vertex stream, AlignedByteOffset is the append marker not an offset
+		std::vector< uint32_t > slotOffsets(mesh.Vertices.size(), 0);
+
+		for (uint32_t i = 0; i < mesh.LayoutDesc.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& desc = mesh.LayoutElems[i];
+			if (desc.InputSlot >= mesh.Vertices.size())
+				continue;
+
+			uint32_t offset = desc.AlignedByteOffset == D3D12_APPEND_ALIGNED_ELEMENT ? slotOffsets[desc.InputSlot] : desc.AlignedByteOffset;
+			slotOffsets[desc.InputSlot] = offset + GetFormatSize(desc.Format);
+
+			if (strcmp(desc.SemanticName, "POSITION") == 0 && desc.SemanticIndex == 0 && desc.Format == DXGI_FORMAT_R32G32B32_FLOAT)
+			{
+				out_pPositions = reinterpret_cast<const XMFLOAT3*>(mesh.Vertices[desc.InputSlot].data() + offset);
+				out_positionStride = mesh.VertexStrides[desc.InputSlot];
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void SerializeMesh(const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const std::vector< Subset >& indexSubsets,
+		const MeshletData& data,
+		std::vector< uint8_t >& out_file)
+	{
+		using namespace MeshletFile;
+
+		const uint32_t indexSize = numVertices <= 0x10000 ? 2 : 4;
+
+		std::vector< Subset > subsets = indexSubsets;
+		if (subsets.empty())
+		{
+			Subset all = { 0, static_cast<uint32_t>(numIndices) };
+			subsets.push_back(all);
+		}
+
+		// one buffer view per array, in the order of the files written by the offline converter
+		enum
+		{
+			kViewIndices,
+			kViewIndexSubsets,
+			kViewVertices,
+			kViewMeshlets,
+			kViewMeshletSubsets,
+			kViewUniqueVertexIndices,
+			kViewPrimitiveIndices,
+			kViewCullData,
+			kViewCount
+		};
+
+		size_t viewSizes[kViewCount] =
+		{
+			numIndices * indexSize,
+			subsets.size() * sizeof(Subset),
+			numVertices * sizeof(MeshVertexPosNormUV0),
+			data.meshlets.size() * sizeof(Meshlet),
+			data.meshletSubsets.size() * sizeof(Subset),
+			data.uniqueVertexIndices.size() * indexSize,
+			data.primitiveIndices.size() * sizeof(PackedTriangle),
+			data.cullData.size() * sizeof(CullData),
+		};
+
+		BufferView views[kViewCount];
+		size_t bufferSize = 0;
+		for (int i = 0; i < kViewCount; ++i)
+		{
+			views[i].Offset = static_cast<uint32_t>(bufferSize);
+			views[i].Size = static_cast<uint32_t>(viewSizes[i]);
+			bufferSize += AlignSize(viewSizes[i]);
+		}
+
+		const Accessor accessors[] =
+		{
+			{ kViewIndices, 0, indexSize, indexSize, static_cast<uint32_t>(numIndices) },
+			{ kViewIndexSubsets, 0, sizeof(Subset), sizeof(Subset), static_cast<uint32_t>(subsets.size()) },
+			{ kViewVertices, 0, 12, sizeof(MeshVertexPosNormUV0), static_cast<uint32_t>(numVertices) },   //position
+			{ kViewVertices, 12, 12, sizeof(MeshVertexPosNormUV0), static_cast<uint32_t>(numVertices) },  //normal
+			{ kViewVertices, 24, 8, sizeof(MeshVertexPosNormUV0), static_cast<uint32_t>(numVertices) },   //uv
+			{ kViewMeshlets, 0, sizeof(Meshlet), sizeof(Meshlet), static_cast<uint32_t>(data.meshlets.size()) },
+			{ kViewMeshletSubsets, 0, sizeof(Subset), sizeof(Subset), static_cast<uint32_t>(data.meshletSubsets.size()) },
+			{ kViewUniqueVertexIndices, 0, indexSize, indexSize, static_cast<uint32_t>(data.uniqueVertexIndices.size()) },
+			{ kViewPrimitiveIndices, 0, sizeof(PackedTriangle), sizeof(PackedTriangle), static_cast<uint32_t>(data.primitiveIndices.size()) },
+			{ kViewCullData, 0, sizeof(CullData), sizeof(CullData), static_cast<uint32_t>(data.cullData.size()) },
+		};
+		const uint32_t kNoAttribute = 0xffffffff;
+
+		MeshHeader meshHeader = { 0, 1, { 2, 3, 4, kNoAttribute, kNoAttribute }, 5, 6, 7, 8, 9 };
+
+		FileHeader header;
+		header.Prolog = c_prolog;
+		header.Version = FILE_VERSION_INITIAL;
+		header.MeshCount = 1;
+		header.AccessorCount = _countof(accessors);
+		header.BufferViewCount = kViewCount;
+		header.BufferSize = static_cast<uint32_t>(bufferSize);
+
+		out_file.clear();
+		out_file.reserve(sizeof(header) + sizeof(meshHeader) + sizeof(accessors) + sizeof(views) + bufferSize);
+		AppendBytes(out_file, header);
+		AppendBytes(out_file, meshHeader);
+		AppendBytes(out_file, accessors);
+		AppendBytes(out_file, views);
+
+		size_t bufferStart = out_file.size();
+		out_file.resize(bufferStart + bufferSize, 0);
+		uint8_t* pBuffer = out_file.data() + bufferStart;
+
+		auto writeIndices = [&](uint8_t* pDest, const uint32_t* pSource, size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (indexSize == 2)
+				{
+					uint16_t index = static_cast<uint16_t>(pSource[i]);
+					memcpy(pDest + i * 2, &index, 2);
+				}
+				else
+				{
+					memcpy(pDest + i * 4, &pSource[i], 4);
+				}
+			}
+		};
+
+		writeIndices(pBuffer + views[kViewIndices].Offset, pIndices, numIndices);
+		memcpy(pBuffer + views[kViewIndexSubsets].Offset, subsets.data(), viewSizes[kViewIndexSubsets]);
+		memcpy(pBuffer + views[kViewVertices].Offset, pVertices, viewSizes[kViewVertices]);
+		memcpy(pBuffer + views[kViewMeshlets].Offset, data.meshlets.data(), viewSizes[kViewMeshlets]);
+		memcpy(pBuffer + views[kViewMeshletSubsets].Offset, data.meshletSubsets.data(), viewSizes[kViewMeshletSubsets]);
+		writeIndices(pBuffer + views[kViewUniqueVertexIndices].Offset, data.uniqueVertexIndices.data(), data.uniqueVertexIndices.size());
+		memcpy(pBuffer + views[kViewPrimitiveIndices].Offset, data.primitiveIndices.data(), viewSizes[kViewPrimitiveIndices]);
+		memcpy(pBuffer + views[kViewCullData].Offset, data.cullData.data(), viewSizes[kViewCullData]);
+	}
+
+	bool WriteMeshletFile(const char* path, const std::vector< uint8_t >& file)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		if (!stream.is_open())
+		{
+			printf("Failed to write meshlet file %s\n", path);
+			return false;
+		}
+
+		stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+		return stream.good();
+	}
+
+	bool ExtractMeshBlock(const std::vector< uint8_t >& file,
+		uint32_t meshIndex,
+		std::vector< uint8_t >& out_block,
+		MeshletFile::MeshEntry& out_entry)
+	{
+		using namespace MeshletFile;
+
+		FileHeader header;
+		if (file.size() < sizeof(header))
+			return false;
+
+		memcpy(&header, file.data(), sizeof(header));
+		size_t metadataSize = sizeof(FileHeader) + size_t(header.MeshCount) * sizeof(MeshHeader) +
+			size_t(header.AccessorCount) * sizeof(Accessor) + size_t(header.BufferViewCount) * sizeof(BufferView);
+		if (header.Prolog != c_prolog || header.Version != FILE_VERSION_INITIAL || meshIndex >= header.MeshCount ||
+			metadataSize + header.BufferSize != file.size())
+		{
+			return false;
+		}
+
+		const uint8_t* pMeshes = file.data() + sizeof(FileHeader);
+		const uint8_t* pAccessors = pMeshes + size_t(header.MeshCount) * sizeof(MeshHeader);
+		const uint8_t* pViews = pAccessors + size_t(header.AccessorCount) * sizeof(Accessor);
+		const uint8_t* pBuffer = file.data() + metadataSize;
+
+		MeshHeader mesh;
+		memcpy(&mesh, pMeshes + size_t(meshIndex) * sizeof(MeshHeader), sizeof(mesh));
+
+		// the accessors of the mesh and the buffer views behind them, renumbered in the order they are first used.
+		// every MeshHeader field is an accessor index, -1 for a missing attribute.
+		const uint32_t kUnused = 0xffffffff;
+		std::vector< uint32_t > accessorMap(header.AccessorCount, kUnused);
+		std::vector< uint32_t > viewMap(header.BufferViewCount, kUnused);
+		std::vector< Accessor > accessors;
+		std::vector< BufferView > sourceViews;
+
+		uint32_t* pFields = reinterpret_cast<uint32_t*>(&mesh);
+		for (size_t i = 0; i < sizeof(MeshHeader) / sizeof(uint32_t); ++i)
+		{
+			uint32_t& field = pFields[i];
+			if (field == kUnused)
+				continue;
+
+			if (field >= header.AccessorCount)
+				return false;
+
+			if (accessorMap[field] == kUnused)
+			{
+				Accessor accessor;
+				memcpy(&accessor, pAccessors + size_t(field) * sizeof(Accessor), sizeof(accessor));
+				if (accessor.BufferView >= header.BufferViewCount)
+					return false;
+
+				if (viewMap[accessor.BufferView] == kUnused)
+				{
+					BufferView view;
+					memcpy(&view, pViews + size_t(accessor.BufferView) * sizeof(BufferView), sizeof(view));
+					if (view.Offset > header.BufferSize || view.Size > header.BufferSize - view.Offset)
+						return false;
+
+					viewMap[accessor.BufferView] = static_cast<uint32_t>(sourceViews.size());
+					sourceViews.push_back(view);
+				}
+
+				accessor.BufferView = viewMap[accessor.BufferView];
+				accessorMap[field] = static_cast<uint32_t>(accessors.size());
+				accessors.push_back(accessor);
+			}
+
+			field = accessorMap[field];
+		}
+
+		// MeshHeader | Accessor[] | BufferView[] | data, the views relative to the start of the block
+		std::vector< BufferView > views(sourceViews.size());
+		size_t blockSize = AlignSize(sizeof(MeshHeader) + accessors.size() * sizeof(Accessor) + views.size() * sizeof(BufferView));
+		for (size_t i = 0; i < views.size(); ++i)
+		{
+			views[i].Offset = static_cast<uint32_t>(blockSize);
+			views[i].Size = sourceViews[i].Size;
+			blockSize += AlignSize(views[i].Size);
+		}
+
+		if (blockSize > UINT32_MAX)
+			return false;
+
+		out_block.clear();
+		out_block.reserve(blockSize);
+		AppendBytes(out_block, mesh);
+		for (const Accessor& accessor : accessors)
+		{
+			AppendBytes(out_block, accessor);
+		}
+		for (const BufferView& view : views)
+		{
+			AppendBytes(out_block, view);
+		}
+
+		out_block.resize(blockSize, 0);
+		for (size_t i = 0; i < views.size(); ++i)
+		{
+			memcpy(out_block.data() + views[i].Offset, pBuffer + sourceViews[i].Offset, views[i].Size);
+		}
+
+		// the same sphere MeshShaderModel computes for a version 0 file, so both versions give the same bounds
+		if (mesh.Attributes[Attribute::Position] == kUnused)
+			return false;
+
+		const Accessor& position = accessors[mesh.Attributes[Attribute::Position]];
+		const BufferView& positionView = views[position.BufferView];
+		BoundingSphere bounds;
+		BoundingSphere::CreateFromPoints(bounds, positionView.Size / position.Stride,
+			reinterpret_cast<const XMFLOAT3*>(out_block.data() + positionView.Offset + position.Offset), position.Stride);
+
+		out_entry = MeshEntry();
+		out_entry.Size = blockSize;
+		out_entry.AccessorCount = static_cast<uint32_t>(accessors.size());
+		out_entry.BufferViewCount = static_cast<uint32_t>(views.size());
+		out_entry.BoundingSphere[0] = bounds.Center.x;
+		out_entry.BoundingSphere[1] = bounds.Center.y;
+		out_entry.BoundingSphere[2] = bounds.Center.z;
+		out_entry.BoundingSphere[3] = bounds.Radius;
+		return true;
+	}
+
+	bool WriteMeshPack(const char* path,
+		const std::vector< std::vector< uint8_t > >& blocks,
+		const std::vector< MeshletFile::MeshEntry >& blockEntries,
+		const std::vector< uint32_t >& blockIndices)
+	{
+		using namespace MeshletFile;
+
+		auto alignUp = [](uint64_t value, uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; };
+
+		MeshTableHeader header;
+		header.Prolog = c_prolog;
+		header.Version = FILE_VERSION_MESH_TABLE;
+		header.MeshCount = static_cast<uint32_t>(blockIndices.size());
+		header.TableOffset = static_cast<uint32_t>(alignUp(sizeof(MeshTableHeader), c_tableAlignment));
+
+		std::vector< MeshEntry > table(blockIndices.size());
+		uint64_t offset = alignUp(header.TableOffset + table.size() * sizeof(MeshEntry), c_meshAlignment);
+		for (size_t i = 0; i < table.size(); ++i)
+		{
+			table[i] = blockEntries[blockIndices[i]];
+			table[i].Offset = offset;
+			offset = alignUp(offset + table[i].Size, c_meshAlignment);
+		}
+		header.FileSize = offset;
+
+		std::ofstream stream(path, std::ios::binary);
+		if (!stream.is_open())
+		{
+			printf("Failed to write meshlet file %s\n", path);
+			return false;
+		}
+
+		// the pack can be much larger than memory, it is written one block at a time
+		const std::vector< char > padding(c_meshAlignment, 0);
+		uint64_t position = 0;
+		auto write = [&](const void* pData, uint64_t size)
+		{
+			stream.write(reinterpret_cast<const char*>(pData), size);
+			position += size;
+		};
+		auto padTo = [&](uint64_t target)
+		{
+			write(padding.data(), target - position);
+		};
+
+		write(&header, sizeof(header));
+		padTo(header.TableOffset);
+		write(table.data(), table.size() * sizeof(MeshEntry));
+
+		for (size_t i = 0; i < table.size(); ++i)
+		{
+			padTo(table[i].Offset);
+			write(blocks[blockIndices[i]].data(), table[i].Size);
+		}
+		padTo(header.FileSize);
+
+		return stream.good();
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include "MeshShaderModel.h"
+#include <vector>
+#include <string>
+
+struct MeshletBuildOptions
+{
+	uint32_t maxVertices = 64;     //unique vertices per meshlet, at most kMaxMeshletVertices
+	uint32_t maxPrimitives = 126;  //triangles per meshlet, at most kMaxMeshletPrimitives
+};
+
+//The meshlet arrays of one mesh in the layout MeshShaderModel loads.  Meshlet::VertOffset indexes
+//uniqueVertexIndices and Meshlet::PrimOffset indexes primitiveIndices, meshletSubsets has one entry per index subset.
+struct MeshletData
+{
+	std::vector< Meshlet > meshlets;
+	std::vector< uint32_t > uniqueVertexIndices;
+	std::vector< PackedTriangle > primitiveIndices;
+	std::vector< Subset > meshletSubsets;
+	std::vector< CullData > cullData;
+};
+
+struct MeshletStats
+{
+	size_t numMeshlets = 0;
+	size_t numTriangles = 0;
+	size_t numMeshletVertices = 0;  //sum of the vertex counts, vertices on meshlet borders count once per meshlet
+	uint32_t maxVertices = 0;
+	uint32_t maxPrimitives = 0;
+	double buildMs = 0.0;
+
+	//average meshlet size relative to the limits, 1.0 means every meshlet is full
+	float GetVertexFill() const { return numMeshlets ? float(numMeshletVertices) / float(numMeshlets * maxVertices) : 0.0f; }
+	float GetPrimitiveFill() const { return numMeshlets ? float(numTriangles) / float(numMeshlets * maxPrimitives) : 0.0f; }
+
+	//vertex shader invocations per triangle, 0.5 would be a perfect regular grid
+	float GetVerticesPerTriangle() const { return numTriangles ? float(numMeshletVertices) / float(numTriangles) : 0.0f; }
+};
+
+//Splits indexed triangle lists into meshlets for the mesh shader path.  Triangles are sorted along a Morton curve
+//of their centroids.  A meshlet is grown from the first unused triangle in that order: the next triangle is the
+//unused neighbour (shares a vertex with the last triangles) that adds the fewest new vertices, ties go to the one
+//closest to the meshlet center.  When there is no neighbour left the meshlet continues with the next unused
+//triangle on the curve, so meshlets stay spatially compact and fill up.
+namespace DXMeshletBuilder
+{
+	const uint32_t kMaxMeshletVertices = 256;    //D3D12 mesh shader output limits
+	const uint32_t kMaxMeshletPrimitives = 256;
+
+	//meshlets of the triangles in pIndices.  positionStride is the distance in bytes between two positions.
+	//the vertex indices of the meshlets are not rebased, they index the vertex buffer of pIndices.
+	void BuildMeshlets(const DirectX::XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const MeshletBuildOptions& options,
+		std::vector< Meshlet >& out_meshlets,
+		std::vector< uint32_t >& out_uniqueVertexIndices,
+		std::vector< PackedTriangle >& out_primitiveIndices);
+
+	//every index subset is built on its own, the subsets are spread over numThreads threads (0 = all cores).  the
+	//output is the same for any thread count.
+	void BuildMeshlets(const DirectX::XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const std::vector< Subset >& indexSubsets,
+		const MeshletBuildOptions& options,
+		MeshletData& out_data,
+		MeshletStats* pStats = nullptr,
+		uint32_t numThreads = 0);
+
+	//exact (smallest) bounding sphere and normal cone of every meshlet, encoded the way the shaders and
+	//DXMeshletCuller unpack them.  cones wider than about 84 degrees from the axis are degenerate (w = 0xff) and
+	//never cull.  the quantized cutoff is rounded so a cone can only cull less than the exact one.
+	void ComputeCullData(const DirectX::XMFLOAT3* pPositions,
+		size_t positionStride,
+		const MeshletData& data,
+		std::vector< CullData >& out_cullData);
+
+	//the float3 positions of a loaded MSHL mesh.  the loaded layouts use D3D12_APPEND_ALIGNED_ELEMENT, the offset is
+	//resolved the way the input assembler does.  false if the mesh has no float3 POSITION.
+	bool GetPositions(const Mesh& mesh, const DirectX::XMFLOAT3*& out_pPositions, size_t& out_positionStride);
+
+	//MSHL file (version 0, the layout MeshShaderModel::LoadFromFile reads) of one mesh with position, normal and uv
+	//attributes.  the vertex indices are 16 bit when there are at most 64K vertices.
+	void SerializeMesh(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const std::vector< Subset >& indexSubsets,
+		const MeshletData& data,
+		std::vector< uint8_t >& out_file);
+
+	bool WriteMeshletFile(const char* path, const std::vector< uint8_t >& file);
+
+	//one mesh of a version 0 file as a self contained version 2 mesh block and its table entry (without the offset)
+	bool ExtractMeshBlock(const std::vector< uint8_t >& file,
+		uint32_t meshIndex,
+		std::vector< uint8_t >& out_block,
+		MeshletFile::MeshEntry& out_entry);
+
+	//version 2 file where mesh i is blocks[blockIndices[i]], a block can be used by any number of meshes.
+	//blockEntries[j] is the entry ExtractMeshBlock returned for blocks[j].
+	bool WriteMeshPack(const char* path,
+		const std::vector< std::vector< uint8_t > >& blocks,
+		const std::vector< MeshletFile::MeshEntry >& blockEntries,
+		const std::vector< uint32_t >& blockIndices);
+}
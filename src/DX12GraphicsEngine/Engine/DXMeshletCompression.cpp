@@ -0,0 +1,372 @@
+#include "stdafx.h"
+#include "DXMeshletCompression.h"
+#include "DXVertexCompression.h"
+
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace DXGraphicsUtilities;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	double GetElapsedMs(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	template< typename T >
+	inline const T& GetElement(const T* pElements, size_t stride, size_t index)
+	{
+		return *reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(pElements) + index * stride);
+	}
+
+	//count <= 32 bits at bitOffset, the words must have one word after the last one written
+	inline void WriteBits(std::vector< uint32_t >& words, uint64_t bitOffset, uint32_t value, uint32_t count)
+	{
+		size_t word = static_cast<size_t>(bitOffset >> 5);
+		uint32_t shift = static_cast<uint32_t>(bitOffset & 31);
+		uint64_t bits = static_cast<uint64_t>(value & static_cast<uint32_t>((1ull << count) - 1)) << shift;
+
+		words[word] |= static_cast<uint32_t>(bits);
+		words[word + 1] |= static_cast<uint32_t>(bits >> 32);
+	}
+
+	inline uint32_t ReadBits(const std::vector< uint32_t >& words, uint64_t bitOffset, uint32_t count)
+	{
+		size_t word = static_cast<size_t>(bitOffset >> 5);
+		uint32_t shift = static_cast<uint32_t>(bitOffset & 31);
+		uint64_t bits = (static_cast<uint64_t>(words[word + 1]) << 32) | words[word];
+
+		return static_cast<uint32_t>((bits >> shift) & ((1ull << count) - 1));
+	}
+
+	uint32_t GetFormatSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT: return 16;
+		case DXGI_FORMAT_R32G32B32_FLOAT: return 12;
+		case DXGI_FORMAT_R32G32_FLOAT: return 8;
+		case DXGI_FORMAT_R32_FLOAT: return 4;
+		default: return 0;
+		}
+	}
+
+	//unorm with levels steps, 0..levels maps to -1..1
+	inline float DequantizeOct(uint32_t value, float levels)
+	{
+		return value * (2.0f / levels) - 1.0f;
+	}
+
+	XMFLOAT3 NormalizeOrZero(const XMFLOAT3& v)
+	{
+		float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		return length > 0.0f ? XMFLOAT3(v.x / length, v.y / length, v.z / length) : XMFLOAT3(0.0f, 0.0f, 1.0f);
+	}
+
+	//of the 4 grid points around the octahedral coordinates the one that decodes closest to the normal is used,
+	//plain rounding can be off by about a grid cell (see QuantizeOctNormal of DXVertexCompression)
+	void QuantizeOctNormal(const XMFLOAT3& normal, uint32_t bits, uint32_t out_oct[2])
+	{
+		XMFLOAT3 n = NormalizeOrZero(normal);
+		XMFLOAT2 oct = DXVertexCompression::OctEncode(n);
+
+		uint32_t maxValue = (1u << bits) - 1;
+		float levels = static_cast<float>(maxValue);
+		int baseX = static_cast<int>(std::floor((oct.x + 1.0f) * 0.5f * levels));
+		int baseY = static_cast<int>(std::floor((oct.y + 1.0f) * 0.5f * levels));
+
+		float bestDot = -2.0f;
+		out_oct[0] = 0;
+		out_oct[1] = 0;
+
+		for (int dy = 0; dy < 2; ++dy)
+		{
+			for (int dx = 0; dx < 2; ++dx)
+			{
+				uint32_t qx = static_cast<uint32_t>(std::min(std::max(baseX + dx, 0), static_cast<int>(maxValue)));
+				uint32_t qy = static_cast<uint32_t>(std::min(std::max(baseY + dy, 0), static_cast<int>(maxValue)));
+
+				XMFLOAT3 decoded = DXVertexCompression::OctDecode(XMFLOAT2(DequantizeOct(qx, levels), DequantizeOct(qy, levels)));
+				float dot = decoded.x * n.x + decoded.y * n.y + decoded.z * n.z;
+
+				if (dot > bestDot)
+				{
+					bestDot = dot;
+					out_oct[0] = qx;
+					out_oct[1] = qy;
+				}
+			}
+		}
+	}
+
+	void MeasureError(const MeshletVertexAttributes& attributes, const MeshletData& data,
+		const std::vector< MeshVertexPosNormUV0 >& decoded, MeshletCompressionStats& stats)
+	{
+		float minNormalDot = 1.0f;
+
+		for (const Meshlet& meshlet : data.meshlets)
+		{
+			for (uint32_t i = 0; i < meshlet.VertCount; ++i)
+			{
+				uint32_t slot = meshlet.VertOffset + i;
+				uint32_t vertex = data.uniqueVertexIndices[slot];
+				const MeshVertexPosNormUV0& b = decoded[slot];
+
+				const XMFLOAT3& position = GetElement(attributes.pPositions, attributes.positionStride, vertex);
+				float positionError = std::max(std::max(std::fabs(position.x - b.position.x), std::fabs(position.y - b.position.y)),
+					std::fabs(position.z - b.position.z));
+				stats.maxPositionError = std::max(stats.maxPositionError, positionError);
+
+				if (attributes.pNormals)
+				{
+					XMFLOAT3 n = NormalizeOrZero(GetElement(attributes.pNormals, attributes.normalStride, vertex));
+					minNormalDot = std::min(minNormalDot, n.x * b.normal.x + n.y * b.normal.y + n.z * b.normal.z);
+				}
+
+				if (attributes.pUVs)
+				{
+					const XMFLOAT2& uv = GetElement(attributes.pUVs, attributes.uvStride, vertex);
+					stats.maxUVError = std::max(stats.maxUVError, std::max(std::fabs(uv.x - b.uv.x), std::fabs(uv.y - b.uv.y)));
+				}
+			}
+		}
+
+		minNormalDot = std::min(std::max(minNormalDot, -1.0f), 1.0f);
+		stats.maxNormalErrorDegrees = std::acos(minNormalDot) * 180.0f / 3.14159265f;
+	}
+}
+
+namespace DXMeshletCompression
+{
+	bool GetVertexAttributes(const Mesh& mesh, MeshletVertexAttributes& out_attributes)
+	{
+		out_attributes = MeshletVertexAttributes();
+		out_attributes.numVertices = mesh.VertexCount;
+
+		// the loaded layouts append every element, the offsets are resolved the way the input assembler does
+		std::vector< uint32_t > slotOffsets(mesh.Vertices.size(), 0);
+
+		for (uint32_t i = 0; i < mesh.LayoutDesc.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& desc = mesh.LayoutElems[i];
+			if (desc.InputSlot >= mesh.Vertices.size())
+				continue;
+
+			uint32_t offset = desc.AlignedByteOffset == D3D12_APPEND_ALIGNED_ELEMENT ? slotOffsets[desc.InputSlot] : desc.AlignedByteOffset;
+			slotOffsets[desc.InputSlot] = offset + GetFormatSize(desc.Format);
+
+			if (desc.SemanticIndex != 0)
+				continue;
+
+			const uint8_t* pElement = mesh.Vertices[desc.InputSlot].data() + offset;
+			size_t stride = mesh.VertexStrides[desc.InputSlot];
+
+			if (strcmp(desc.SemanticName, "POSITION") == 0 && desc.Format == DXGI_FORMAT_R32G32B32_FLOAT)
+			{
+				out_attributes.pPositions = reinterpret_cast<const XMFLOAT3*>(pElement);
+				out_attributes.positionStride = stride;
+			}
+			else if (strcmp(desc.SemanticName, "NORMAL") == 0 && desc.Format == DXGI_FORMAT_R32G32B32_FLOAT)
+			{
+				out_attributes.pNormals = reinterpret_cast<const XMFLOAT3*>(pElement);
+				out_attributes.normalStride = stride;
+			}
+			else if (strcmp(desc.SemanticName, "TEXCOORD") == 0 && desc.Format == DXGI_FORMAT_R32G32_FLOAT)
+			{
+				out_attributes.pUVs = reinterpret_cast<const XMFLOAT2*>(pElement);
+				out_attributes.uvStride = stride;
+			}
+		}
+
+		return out_attributes.pPositions != nullptr;
+	}
+
+	void EncodeVertices(const MeshletVertexAttributes& attributes,
+		const MeshletData& data,
+		const MeshletCompressionOptions& options,
+		CompressedMeshletVertices& out_compressed,
+		MeshletCompressionStats* pStats)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		CompressedMeshletVertices& c = out_compressed;
+		c = CompressedMeshletVertices();
+		c.positionBits = std::min(std::max(options.positionBits, 10u), 16u);
+		c.normalBits = attributes.pNormals ? std::min(std::max(options.normalBits, 8u), 16u) : 0;
+		c.uvBits = attributes.pUVs && options.bStoreUVs ? 16 : 0;
+		c.vertexBits = 3 * c.positionBits + 2 * c.normalBits + 2 * c.uvBits;
+		c.numVertices = static_cast<uint32_t>(data.uniqueVertexIndices.size());
+
+		// the mesh bounds are the grid origin, the largest meshlet extent sets the cell size.  one cell less than
+		// positionBits can hold leaves room for rounding the min and max corners of a meshlet in opposite directions.
+		XMFLOAT3 meshMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		float maxExtent = 0.0f;
+		float maxCoordinate = 0.0f;
+
+		for (const Meshlet& meshlet : data.meshlets)
+		{
+			XMFLOAT3 minCorner(FLT_MAX, FLT_MAX, FLT_MAX);
+			XMFLOAT3 maxCorner(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+			for (uint32_t i = 0; i < meshlet.VertCount; ++i)
+			{
+				const XMFLOAT3& p = GetElement(attributes.pPositions, attributes.positionStride, data.uniqueVertexIndices[meshlet.VertOffset + i]);
+				minCorner = XMFLOAT3(std::min(minCorner.x, p.x), std::min(minCorner.y, p.y), std::min(minCorner.z, p.z));
+				maxCorner = XMFLOAT3(std::max(maxCorner.x, p.x), std::max(maxCorner.y, p.y), std::max(maxCorner.z, p.z));
+				maxCoordinate = std::max(maxCoordinate, std::max(std::max(std::fabs(p.x), std::fabs(p.y)), std::fabs(p.z)));
+			}
+
+			if (meshlet.VertCount == 0)
+				continue;
+
+			meshMin = XMFLOAT3(std::min(meshMin.x, minCorner.x), std::min(meshMin.y, minCorner.y), std::min(meshMin.z, minCorner.z));
+			maxExtent = std::max(maxExtent, std::max(std::max(maxCorner.x - minCorner.x, maxCorner.y - minCorner.y), maxCorner.z - minCorner.z));
+		}
+
+		c.positionOrigin = data.meshlets.empty() ? XMFLOAT3(0.0f, 0.0f, 0.0f) : meshMin;
+		c.positionStep = maxExtent > 0.0f ? maxExtent / static_cast<float>((1u << c.positionBits) - 2) : 1.0f;
+
+		c.quantization.resize(data.meshlets.size());
+		c.words.assign(static_cast<size_t>((static_cast<uint64_t>(c.numVertices) * c.vertexBits + 31) / 32) + 1, 0);
+
+		const uint32_t maxLocal = (1u << c.positionBits) - 1;
+		std::vector< int32_t > cells;
+
+		for (size_t m = 0; m < data.meshlets.size(); ++m)
+		{
+			const Meshlet& meshlet = data.meshlets[m];
+			MeshletQuantization& quantization = c.quantization[m];
+
+			// grid cells of the vertices, the meshlet offset is their minimum so it is the same integer math for
+			// every meshlet that shares a vertex
+			cells.resize(meshlet.VertCount * 3);
+			int32_t minCell[3] = { INT32_MAX, INT32_MAX, INT32_MAX };
+
+			for (uint32_t i = 0; i < meshlet.VertCount; ++i)
+			{
+				const XMFLOAT3& p = GetElement(attributes.pPositions, attributes.positionStride, data.uniqueVertexIndices[meshlet.VertOffset + i]);
+				const float coordinates[3] = { p.x - c.positionOrigin.x, p.y - c.positionOrigin.y, p.z - c.positionOrigin.z };
+
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					cells[i * 3 + axis] = static_cast<int32_t>(std::floor(coordinates[axis] / c.positionStep + 0.5f));
+					minCell[axis] = std::min(minCell[axis], cells[i * 3 + axis]);
+				}
+			}
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				quantization.gridOffset[axis] = meshlet.VertCount ? minCell[axis] : 0;
+			}
+			quantization.reserved = 0;
+
+			for (uint32_t i = 0; i < meshlet.VertCount; ++i)
+			{
+				uint32_t slot = meshlet.VertOffset + i;
+				uint32_t vertex = data.uniqueVertexIndices[slot];
+				uint64_t bitOffset = static_cast<uint64_t>(slot) * c.vertexBits;
+
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					uint32_t local = static_cast<uint32_t>(cells[i * 3 + axis] - minCell[axis]);
+					assert(local <= maxLocal);
+					WriteBits(c.words, bitOffset, std::min(local, maxLocal), c.positionBits);
+					bitOffset += c.positionBits;
+				}
+
+				if (c.normalBits)
+				{
+					uint32_t oct[2];
+					QuantizeOctNormal(GetElement(attributes.pNormals, attributes.normalStride, vertex), c.normalBits, oct);
+					WriteBits(c.words, bitOffset, oct[0], c.normalBits);
+					WriteBits(c.words, bitOffset + c.normalBits, oct[1], c.normalBits);
+					bitOffset += 2 * c.normalBits;
+				}
+
+				if (c.uvBits)
+				{
+					const XMFLOAT2& uv = GetElement(attributes.pUVs, attributes.uvStride, vertex);
+					WriteBits(c.words, bitOffset, XMConvertFloatToHalf(uv.x), c.uvBits);
+					WriteBits(c.words, bitOffset + c.uvBits, XMConvertFloatToHalf(uv.y), c.uvBits);
+				}
+			}
+		}
+
+		if (pStats)
+		{
+			pStats->encodeMs = GetElapsedMs(start);
+			pStats->numMeshlets = data.meshlets.size();
+			pStats->numVertices = c.numVertices;
+			pStats->compressedBytes = c.GetSizeBytes();
+			pStats->positionErrorBound = c.positionStep * 0.5f + 2.0f * FLT_EPSILON * maxCoordinate;
+
+			auto decodeStart = std::chrono::high_resolution_clock::now();
+			std::vector< MeshVertexPosNormUV0 > decoded;
+			DecodeVertices(c, data, decoded);
+			pStats->decodeMs = GetElapsedMs(decodeStart);
+
+			MeasureError(attributes, data, decoded, *pStats);
+		}
+	}
+
+	void DecodeVertex(const CompressedMeshletVertices& compressed,
+		uint32_t meshletIndex,
+		uint32_t slot,
+		MeshVertexPosNormUV0& out_vertex)
+	{
+		const CompressedMeshletVertices& c = compressed;
+		const MeshletQuantization& quantization = c.quantization[meshletIndex];
+		uint64_t bitOffset = static_cast<uint64_t>(slot) * c.vertexBits;
+
+		// the cell is added up as an integer first, the float math is then the same in every meshlet
+		float position[3];
+		const float origin[3] = { c.positionOrigin.x, c.positionOrigin.y, c.positionOrigin.z };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			int32_t cell = quantization.gridOffset[axis] + static_cast<int32_t>(ReadBits(c.words, bitOffset, c.positionBits));
+			position[axis] = origin[axis] + static_cast<float>(cell) * c.positionStep;
+			bitOffset += c.positionBits;
+		}
+		out_vertex.position = XMFLOAT3(position[0], position[1], position[2]);
+
+		out_vertex.normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		if (c.normalBits)
+		{
+			float levels = static_cast<float>((1u << c.normalBits) - 1);
+			XMFLOAT2 oct(DequantizeOct(ReadBits(c.words, bitOffset, c.normalBits), levels),
+				DequantizeOct(ReadBits(c.words, bitOffset + c.normalBits, c.normalBits), levels));
+			out_vertex.normal = DXVertexCompression::OctDecode(oct);
+			bitOffset += 2 * c.normalBits;
+		}
+
+		out_vertex.uv = XMFLOAT2(0.0f, 0.0f);
+		if (c.uvBits)
+		{
+			out_vertex.uv = XMFLOAT2(XMConvertHalfToFloat(static_cast<HALF>(ReadBits(c.words, bitOffset, c.uvBits))),
+				XMConvertHalfToFloat(static_cast<HALF>(ReadBits(c.words, bitOffset + c.uvBits, c.uvBits))));
+		}
+	}
+
+	void DecodeVertices(const CompressedMeshletVertices& compressed,
+		const MeshletData& data,
+		std::vector< MeshVertexPosNormUV0 >& out_vertices)
+	{
+		out_vertices.resize(compressed.numVertices);
+
+		for (uint32_t m = 0; m < data.meshlets.size(); ++m)
+		{
+			const Meshlet& meshlet = data.meshlets[m];
+			for (uint32_t i = 0; i < meshlet.VertCount; ++i)
+			{
+				DecodeVertex(compressed, m, meshlet.VertOffset + i, out_vertices[meshlet.VertOffset + i]);
+			}
+		}
+	}
+}
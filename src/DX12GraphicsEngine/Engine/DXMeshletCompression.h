@@ -0,0 +1,94 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include "DXMeshletBuilder.h"
+#include <DirectXMath.h>
+#include <vector>
+
+//The vertices the meshlets index.  Normals and uvs are optional, they are not stored when null.
+struct MeshletVertexAttributes
+{
+	const DirectX::XMFLOAT3* pPositions = nullptr;
+	size_t positionStride = sizeof(DirectX::XMFLOAT3);
+	const DirectX::XMFLOAT3* pNormals = nullptr;
+	size_t normalStride = sizeof(DirectX::XMFLOAT3);
+	const DirectX::XMFLOAT2* pUVs = nullptr;
+	size_t uvStride = sizeof(DirectX::XMFLOAT2);
+	size_t numVertices = 0;
+};
+
+struct MeshletCompressionOptions
+{
+	uint32_t positionBits = 14;    //10 - 16 per component
+	uint32_t normalBits = 12;      //8 - 16 per octahedral component
+	bool bStoreUVs = true;         //as half floats, when there are uvs
+};
+
+//Per meshlet, indexed like the meshlets (the same as CullData).  16 bytes so it can be a StructuredBuffer.
+struct MeshletQuantization
+{
+	int32_t gridOffset[3];         //min corner of the meshlet in grid cells of the mesh
+	uint32_t reserved;
+};
+
+//Meshlet vertex slot s (Meshlet::VertOffset + the local index, the slots of the unique vertex indices) is stored at
+//bit s * vertexBits of words, no index buffer is needed to find it.  The fields are position xyz, normal xy and
+//uv xy in that order, low bits first, a field may cross into the next word.
+//
+//Positions are grid cells of one grid for the whole mesh, stored relative to the min corner of the meshlet.  The
+//grid is as fine as positionBits allow for the largest meshlet, so a vertex shared by two meshlets decodes to the
+//same position in both and the meshlets stay watertight.
+struct CompressedMeshletVertices
+{
+	DirectX::XMFLOAT3 positionOrigin = { 0.0f, 0.0f, 0.0f };
+	float positionStep = 0.0f;     //size of a grid cell
+	uint32_t positionBits = 0;
+	uint32_t normalBits = 0;       //0 when there are no normals
+	uint32_t uvBits = 0;           //16 or 0
+	uint32_t vertexBits = 0;
+	uint32_t numVertices = 0;      //slots
+
+	std::vector< MeshletQuantization > quantization;
+	std::vector< uint32_t > words;  //one word more than the data so a field can always be read as two words
+
+	size_t GetSizeBytes() const { return quantization.size() * sizeof(MeshletQuantization) + words.size() * sizeof(uint32_t); }
+};
+
+//largest difference between the source vertices and the decoded meshlet vertices
+struct MeshletCompressionStats
+{
+	size_t numMeshlets = 0;
+	size_t numVertices = 0;        //slots, vertices on meshlet borders count once per meshlet
+	size_t compressedBytes = 0;
+	float positionErrorBound = 0.0f;   //half a grid cell and the float rounding of the decoded position, per axis
+	float maxPositionError = 0.0f;     //per axis, object space units
+	float maxNormalErrorDegrees = 0.0f;
+	float maxUVError = 0.0f;
+	double encodeMs = 0.0;
+	double decodeMs = 0.0;
+};
+
+namespace DXMeshletCompression
+{
+	//position, normal and uv of a MSHL mesh, as float3 / float3 / float2 elements of any vertex stream.  false
+	//without positions.
+	bool GetVertexAttributes(const Mesh& mesh, MeshletVertexAttributes& out_attributes);
+
+	//if pStats is set the vertices are decoded again to measure the error
+	void EncodeVertices(const MeshletVertexAttributes& attributes,
+		const MeshletData& data,
+		const MeshletCompressionOptions& options,
+		CompressedMeshletVertices& out_compressed,
+		MeshletCompressionStats* pStats = nullptr);
+
+	//one vertex slot of a meshlet.  attributes that were not stored are zero.
+	void DecodeVertex(const CompressedMeshletVertices& compressed,
+		uint32_t meshletIndex,
+		uint32_t slot,
+		DXGraphicsUtilities::MeshVertexPosNormUV0& out_vertex);
+
+	//every slot of every meshlet, out_vertices[slot]
+	void DecodeVertices(const CompressedMeshletVertices& compressed,
+		const MeshletData& data,
+		std::vector< DXGraphicsUtilities::MeshVertexPosNormUV0 >& out_vertices);
+}
@@ -0,0 +1,262 @@
+#include "stdafx.h"
+#include "DXMeshletCuller.h"
+#include "DXCamera.h"
+
+#include <DirectXPackedVector.h>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	enum CullResult
+	{
+		kVisible,
+		kFrustumCulled,
+		kConeCulled
+	};
+
+	//the normal cone bytes are unorm8: axis = byte * 2 / 255 - 1, cutoff = byte / 255.  w = 0xff is degenerate.
+	const float kConeAxisScale = 2.0f / 255.0f;
+	const float kConeCutoffScale = 1.0f / 255.0f;
+	const float kDegenerateConeByte = 254.5f;
+
+	//the scalar version of one lane of CullMeshlets, the operations are done in the same order
+	CullResult CullMeshlet(const CullData& cullData, const MeshletCullView& view, uint32_t flags)
+	{
+		const XMFLOAT4& sphere = cullData.BoundingSphere;
+
+		if (flags & DXMeshletCuller::kCullFrustum)
+		{
+			for (const XMFLOAT4& plane : view.planes)
+			{
+				float distance = sphere.x * plane.x + plane.w;
+				distance = sphere.y * plane.y + distance;
+				distance = sphere.z * plane.z + distance;
+				if (distance < -sphere.w)
+					return kFrustumCulled;
+			}
+		}
+
+		if ((flags & DXMeshletCuller::kCullNormalCone) && !DXMeshletCuller::IsConeDegenerate(cullData))
+		{
+			float ax = cullData.NormalCone[0] * kConeAxisScale + -1.0f;
+			float ay = cullData.NormalCone[1] * kConeAxisScale + -1.0f;
+			float az = cullData.NormalCone[2] * kConeAxisScale + -1.0f;
+			float axisLength = std::sqrt(az * az + (ay * ay + ax * ax));
+			ax = ax / axisLength;
+			ay = ay / axisLength;
+			az = az / axisLength;
+
+			// from the apex (center - axis * offset) to the eye
+			float vx = view.eyePosition.x - (sphere.x - ax * cullData.ApexOffset);
+			float vy = view.eyePosition.y - (sphere.y - ay * cullData.ApexOffset);
+			float vz = view.eyePosition.z - (sphere.z - az * cullData.ApexOffset);
+			float viewLength = std::sqrt(vz * vz + (vy * vy + vx * vx));
+
+			// dot(normalize(v), -axis) > cutoff without the divide
+			float negativeDot = -(vz * az + (vy * ay + vx * ax));
+			float cutoff = cullData.NormalCone[3] * kConeCutoffScale;
+			if (negativeDot > cutoff * viewLength)
+				return kConeCulled;
+		}
+
+		return kVisible;
+	}
+}
+
+namespace DXMeshletCuller
+{
+	MeshletCullView CreateCullView(FXMMATRIX world, CXMMATRIX view, CXMMATRIX proj)
+	{
+		MeshletCullView cullView;
+
+		XMMATRIX worldView = XMMatrixMultiply(world, view);
+		XMFLOAT4X4 m;
+		XMStoreFloat4x4(&m, XMMatrixMultiply(worldView, proj));
+
+		// clip = p * M (row vectors), so each clip coordinate is p dotted with a column of M
+		XMVECTOR column0 = XMVectorSet(m._11, m._21, m._31, m._41);
+		XMVECTOR column1 = XMVectorSet(m._12, m._22, m._32, m._42);
+		XMVECTOR column2 = XMVectorSet(m._13, m._23, m._33, m._43);
+		XMVECTOR column3 = XMVectorSet(m._14, m._24, m._34, m._44);
+
+		XMVECTOR planes[6] =
+		{
+			XMVectorAdd(column3, column0),        // -w <= x
+			XMVectorSubtract(column3, column0),   // x <= w
+			XMVectorAdd(column3, column1),        // -w <= y
+			XMVectorSubtract(column3, column1),   // y <= w
+			column2,                              // 0 <= z
+			XMVectorSubtract(column3, column2)    // z <= w
+		};
+
+		for (int i = 0; i < 6; ++i)
+		{
+			XMStoreFloat4(&cullView.planes[i], XMPlaneNormalize(planes[i]));
+		}
+
+		XMVECTOR determinant;
+		XMMATRIX inverseWorldView = XMMatrixInverse(&determinant, worldView);
+		XMStoreFloat3(&cullView.eyePosition, inverseWorldView.r[3]);
+
+		return cullView;
+	}
+
+	MeshletCullView CreateCullView(DXCamera& camera, FXMMATRIX world)
+	{
+		return CreateCullView(world, camera.GetViewMatrix(), camera.GetProjectionMatrix());
+	}
+
+	bool IsMeshletVisible(const CullData& cullData, const MeshletCullView& view, uint32_t flags)
+	{
+		return CullMeshlet(cullData, view, flags) == kVisible;
+	}
+
+	size_t CullMeshlets(const CullData* pCullData,
+		size_t numMeshlets,
+		const MeshletCullView& view,
+		std::vector< uint32_t >& out_visibleMeshlets,
+		uint32_t firstIndex,
+		MeshletCullStats* pStats,
+		uint32_t flags)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		size_t numVisibleBefore = out_visibleMeshlets.size();
+		MeshletCullStats stats;
+		stats.numMeshlets = numMeshlets;
+
+		XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; ++p)
+		{
+			XMVECTOR plane = XMLoadFloat4(&view.planes[p]);
+			planeX[p] = XMVectorSplatX(plane);
+			planeY[p] = XMVectorSplatY(plane);
+			planeZ[p] = XMVectorSplatZ(plane);
+			planeW[p] = XMVectorSplatW(plane);
+		}
+
+		const XMVECTOR eyeX = XMVectorReplicate(view.eyePosition.x);
+		const XMVECTOR eyeY = XMVectorReplicate(view.eyePosition.y);
+		const XMVECTOR eyeZ = XMVectorReplicate(view.eyePosition.z);
+		const XMVECTOR axisScale = XMVectorReplicate(kConeAxisScale);
+		const XMVECTOR cutoffScale = XMVectorReplicate(kConeCutoffScale);
+		const XMVECTOR degenerateCone = XMVectorReplicate(kDegenerateConeByte);
+		const XMVECTOR minusOne = XMVectorReplicate(-1.0f);
+
+		size_t i = 0;
+		for (; i + 4 <= numMeshlets; i += 4)
+		{
+			const CullData* c = pCullData + i;
+
+			// four spheres as x, y, z and radius vectors
+			XMMATRIX spheres = XMMatrixTranspose(XMMATRIX(XMLoadFloat4(&c[0].BoundingSphere), XMLoadFloat4(&c[1].BoundingSphere),
+				XMLoadFloat4(&c[2].BoundingSphere), XMLoadFloat4(&c[3].BoundingSphere)));
+			XMVECTOR centerX = spheres.r[0];
+			XMVECTOR centerY = spheres.r[1];
+			XMVECTOR centerZ = spheres.r[2];
+			XMVECTOR radius = spheres.r[3];
+
+			XMVECTOR frustumCulled = XMVectorFalseInt();
+			if (flags & kCullFrustum)
+			{
+				XMVECTOR negativeRadius = XMVectorNegate(radius);
+				for (int p = 0; p < 6; ++p)
+				{
+					XMVECTOR distance = XMVectorMultiplyAdd(centerX, planeX[p], planeW[p]);
+					distance = XMVectorMultiplyAdd(centerY, planeY[p], distance);
+					distance = XMVectorMultiplyAdd(centerZ, planeZ[p], distance);
+					frustumCulled = XMVectorOrInt(frustumCulled, XMVectorLess(distance, negativeRadius));
+				}
+			}
+
+			XMVECTOR coneCulled = XMVectorFalseInt();
+			if (flags & kCullNormalCone)
+			{
+				XMMATRIX cones = XMMatrixTranspose(XMMATRIX(XMLoadUByte4(reinterpret_cast<const XMUBYTE4*>(c[0].NormalCone)),
+					XMLoadUByte4(reinterpret_cast<const XMUBYTE4*>(c[1].NormalCone)),
+					XMLoadUByte4(reinterpret_cast<const XMUBYTE4*>(c[2].NormalCone)),
+					XMLoadUByte4(reinterpret_cast<const XMUBYTE4*>(c[3].NormalCone))));
+
+				XMVECTOR axisX = XMVectorMultiplyAdd(cones.r[0], axisScale, minusOne);
+				XMVECTOR axisY = XMVectorMultiplyAdd(cones.r[1], axisScale, minusOne);
+				XMVECTOR axisZ = XMVectorMultiplyAdd(cones.r[2], axisScale, minusOne);
+				XMVECTOR axisLength = XMVectorSqrt(XMVectorMultiplyAdd(axisZ, axisZ, XMVectorMultiplyAdd(axisY, axisY, XMVectorMultiply(axisX, axisX))));
+				axisX = XMVectorDivide(axisX, axisLength);
+				axisY = XMVectorDivide(axisY, axisLength);
+				axisZ = XMVectorDivide(axisZ, axisLength);
+
+				XMVECTOR apexOffset = XMVectorSet(c[0].ApexOffset, c[1].ApexOffset, c[2].ApexOffset, c[3].ApexOffset);
+				XMVECTOR viewX = XMVectorSubtract(eyeX, XMVectorNegativeMultiplySubtract(axisX, apexOffset, centerX));
+				XMVECTOR viewY = XMVectorSubtract(eyeY, XMVectorNegativeMultiplySubtract(axisY, apexOffset, centerY));
+				XMVECTOR viewZ = XMVectorSubtract(eyeZ, XMVectorNegativeMultiplySubtract(axisZ, apexOffset, centerZ));
+				XMVECTOR viewLength = XMVectorSqrt(XMVectorMultiplyAdd(viewZ, viewZ, XMVectorMultiplyAdd(viewY, viewY, XMVectorMultiply(viewX, viewX))));
+
+				XMVECTOR negativeDot = XMVectorNegate(XMVectorMultiplyAdd(viewZ, axisZ, XMVectorMultiplyAdd(viewY, axisY, XMVectorMultiply(viewX, axisX))));
+				XMVECTOR cutoff = XMVectorMultiply(cones.r[3], cutoffScale);
+
+				coneCulled = XMVectorGreater(negativeDot, XMVectorMultiply(cutoff, viewLength));
+				coneCulled = XMVectorAndCInt(coneCulled, XMVectorGreater(cones.r[3], degenerateCone));
+				coneCulled = XMVectorAndCInt(coneCulled, frustumCulled);
+			}
+
+			uint32_t frustumMask[4];
+			uint32_t coneMask[4];
+			XMStoreInt4(frustumMask, frustumCulled);
+			XMStoreInt4(coneMask, coneCulled);
+
+			for (uint32_t lane = 0; lane < 4; ++lane)
+			{
+				if (frustumMask[lane])
+				{
+					stats.numFrustumCulled++;
+				}
+				else if (coneMask[lane])
+				{
+					stats.numConeCulled++;
+				}
+				else
+				{
+					out_visibleMeshlets.push_back(firstIndex + static_cast<uint32_t>(i + lane));
+				}
+			}
+		}
+
+		for (; i < numMeshlets; ++i)
+		{
+			switch (CullMeshlet(pCullData[i], view, flags))
+			{
+			case kFrustumCulled:
+				stats.numFrustumCulled++;
+				break;
+			case kConeCulled:
+				stats.numConeCulled++;
+				break;
+			default:
+				out_visibleMeshlets.push_back(firstIndex + static_cast<uint32_t>(i));
+				break;
+			}
+		}
+
+		if (pStats)
+		{
+			for (size_t m = 0; m < numMeshlets; ++m)
+			{
+				stats.numDegenerateCones += IsConeDegenerate(pCullData[m]) ? 1 : 0;
+			}
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			pStats->numMeshlets += stats.numMeshlets;
+			pStats->numFrustumCulled += stats.numFrustumCulled;
+			pStats->numConeCulled += stats.numConeCulled;
+			pStats->numDegenerateCones += stats.numDegenerateCones;
+			pStats->cullMs += elapsed.count();
+		}
+
+		return out_visibleMeshlets.size() - numVisibleBefore;
+	}
+}
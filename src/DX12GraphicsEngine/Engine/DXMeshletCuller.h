@@ -0,0 +1,62 @@
+#pragma once
+
+#include "MeshShaderModel.h"
+#include <DirectXMath.h>
+#include <vector>
+
+class DXCamera;
+
+//A view in the object space of one mesh, the meshlet cull data is tested without transforming it.  The world
+//matrix must not scale non uniformly, the normal cone angles are only kept by uniform scales (same as the shader).
+struct MeshletCullView
+{
+	DirectX::XMFLOAT4 planes[6];      //left, right, bottom, top, near, far.  xyz normalized and pointing inside.
+	DirectX::XMFLOAT3 eyePosition;
+};
+
+struct MeshletCullStats
+{
+	size_t numMeshlets = 0;
+	size_t numFrustumCulled = 0;
+	size_t numConeCulled = 0;         //inside the frustum but every triangle faces away from the eye
+	size_t numDegenerateCones = 0;    //meshlets the cone test can never cull
+	double cullMs = 0.0;
+
+	size_t GetNumVisible() const { return numMeshlets - numFrustumCulled - numConeCulled; }
+	float GetFrustumCulledRate() const { return numMeshlets ? float(numFrustumCulled) / float(numMeshlets) : 0.0f; }
+	float GetConeCulledRate() const { return numMeshlets ? float(numConeCulled) / float(numMeshlets) : 0.0f; }
+	float GetVisibleRate() const { return numMeshlets ? float(GetNumVisible()) / float(numMeshlets) : 0.0f; }
+};
+
+//CPU meshlet culling with the bounding sphere and normal cone tests an amplification shader runs on CullData:
+//the sphere against the six frustum planes, then the view direction from the cone apex against the inverted
+//cone.  IsMeshletVisible is the one meshlet reference, CullMeshlets tests four meshlets per iteration with
+//DirectXMath vectors and gives the same answers.
+namespace DXMeshletCuller
+{
+	enum CullFlags : uint32_t
+	{
+		kCullFrustum = 1,
+		kCullNormalCone = 2,   //only for pipelines that cull back faces, with CULL_MODE_NONE back faces are visible
+		kCullAll = kCullFrustum | kCullNormalCone
+	};
+
+	//planes of world * view * proj (D3D clip space, 0 <= z <= w) and the eye from the inverse of world * view
+	MeshletCullView CreateCullView(DirectX::FXMMATRIX world, DirectX::CXMMATRIX view, DirectX::CXMMATRIX proj);
+
+	MeshletCullView CreateCullView(DXCamera& camera, DirectX::FXMMATRIX world);
+
+	inline bool IsConeDegenerate(const CullData& cullData) { return cullData.NormalCone[3] == 0xff; }
+
+	bool IsMeshletVisible(const CullData& cullData, const MeshletCullView& view, uint32_t flags = kCullAll);
+
+	//appends firstIndex + i for every visible meshlet i to out_visibleMeshlets, returns how many were appended.
+	//the stats are added to, so one MeshletCullStats can sum up all subsets of a mesh.
+	size_t CullMeshlets(const CullData* pCullData,
+		size_t numMeshlets,
+		const MeshletCullView& view,
+		std::vector< uint32_t >& out_visibleMeshlets,
+		uint32_t firstIndex = 0,
+		MeshletCullStats* pStats = nullptr,
+		uint32_t flags = kCullAll);
+}
@@ -0,0 +1,721 @@
+#include "stdafx.h"
+#include "DXMeshletDAG.h"
+#include "DXMeshSimplifier.h"
+#include "DXParallel.h"
+#include "DXCamera.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	const uint32_t kNoCluster = 0xffffffff;
+
+	//the simplified triangles of one group split into meshlets
+	struct GroupResult
+	{
+		bool bSimplified = false;
+		float error = 0.0f;
+		MeshletData meshlets;
+	};
+
+	double GetElapsedMs(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	//first vertex with the same position bits, so positions can be compared across uv and normal seams
+	void BuildPositionRemap(const MeshVertexPosNormUV0* pVertices, size_t numVertices, std::vector< uint32_t >& out_remap)
+	{
+		struct PositionHash
+		{
+			size_t operator()(const XMFLOAT3& p) const
+			{
+				uint32_t bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const { return memcmp(&a, &b, sizeof(XMFLOAT3)) == 0; }
+		};
+
+		std::unordered_map< XMFLOAT3, uint32_t, PositionHash, PositionEqual > firstVertex;
+		firstVertex.reserve(numVertices);
+
+		out_remap.resize(numVertices);
+		for (size_t v = 0; v < numVertices; ++v)
+		{
+			out_remap[v] = firstVertex.emplace(pVertices[v].position, static_cast<uint32_t>(v)).first->second;
+		}
+	}
+
+	//the triangles of a meshlet with the vertex indices of the source vertex buffer
+	void AppendTriangles(const MeshletData& data, uint32_t meshletIndex, std::vector< uint32_t >& out_indices)
+	{
+		const Meshlet& meshlet = data.meshlets[meshletIndex];
+		const uint32_t* pVerts = &data.uniqueVertexIndices[meshlet.VertOffset];
+		for (uint32_t i = 0; i < meshlet.PrimCount; ++i)
+		{
+			const PackedTriangle& triangle = data.primitiveIndices[meshlet.PrimOffset + i];
+			out_indices.push_back(pVerts[triangle.i0]);
+			out_indices.push_back(pVerts[triangle.i1]);
+			out_indices.push_back(pVerts[triangle.i2]);
+		}
+	}
+
+	//adds the meshlets of source to the end of dest, the offsets are rebased
+	void AppendMeshlets(const MeshletData& source, MeshletData& dest)
+	{
+		uint32_t vertOffset = static_cast<uint32_t>(dest.uniqueVertexIndices.size());
+		uint32_t primOffset = static_cast<uint32_t>(dest.primitiveIndices.size());
+
+		for (Meshlet meshlet : source.meshlets)
+		{
+			meshlet.VertOffset += vertOffset;
+			meshlet.PrimOffset += primOffset;
+			dest.meshlets.push_back(meshlet);
+		}
+
+		dest.uniqueVertexIndices.insert(dest.uniqueVertexIndices.end(), source.uniqueVertexIndices.begin(), source.uniqueVertexIndices.end());
+		dest.primitiveIndices.insert(dest.primitiveIndices.end(), source.primitiveIndices.begin(), source.primitiveIndices.end());
+		dest.cullData.insert(dest.cullData.end(), source.cullData.begin(), source.cullData.end());
+	}
+
+	void BuildMeshletData(const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const std::vector< uint32_t >& indices,
+		const MeshletBuildOptions& options,
+		MeshletData& out_data)
+	{
+		DXMeshletBuilder::BuildMeshlets(&pVertices[0].position, sizeof(MeshVertexPosNormUV0), numVertices, indices.data(), indices.size(),
+			options, out_data.meshlets, out_data.uniqueVertexIndices, out_data.primitiveIndices);
+		out_data.meshletSubsets.assign(1, { 0, static_cast<uint32_t>(out_data.meshlets.size()) });
+		DXMeshletBuilder::ComputeCullData(&pVertices[0].position, sizeof(MeshVertexPosNormUV0), out_data, out_data.cullData);
+	}
+
+	//smallest sphere around two spheres
+	XMFLOAT4 MergeSpheres(const XMFLOAT4& a, const XMFLOAT4& b)
+	{
+		double dx = double(b.x) - a.x;
+		double dy = double(b.y) - a.y;
+		double dz = double(b.z) - a.z;
+		double distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+		if (distance + b.w <= a.w)
+			return a;
+		if (distance + a.w <= b.w)
+			return b;
+
+		double radius = (distance + a.w + b.w) * 0.5;
+		double t = (radius - a.w) / distance;
+
+		// a little larger so containment survives the rounding to float
+		return XMFLOAT4(static_cast<float>(a.x + dx * t), static_cast<float>(a.y + dy * t), static_cast<float>(a.z + dz * t),
+			static_cast<float>(radius * (1.0 + 1.0e-6)));
+	}
+
+	bool ContainsSphere(const XMFLOAT4& outer, const XMFLOAT4& inner)
+	{
+		float dx = inner.x - outer.x;
+		float dy = inner.y - outer.y;
+		float dz = inner.z - outer.z;
+		float tolerance = std::max(outer.w, 1.0f) * 1.0e-5f;
+		return std::sqrt(dx * dx + dy * dy + dz * dz) + inner.w <= outer.w + tolerance;
+	}
+
+	inline bool IsSameSphere(const XMFLOAT4& a, const XMFLOAT4& b)
+	{
+		return memcmp(&a, &b, sizeof(XMFLOAT4)) == 0;
+	}
+
+	//edges by position, (smaller, larger) in one key
+	void AppendEdges(const std::vector< uint32_t >& positionRemap, const std::vector< uint32_t >& indices, std::vector< uint64_t >& out_edges,
+		size_t& out_numTriangles)
+	{
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			uint32_t p[3] = { positionRemap[indices[i]], positionRemap[indices[i + 1]], positionRemap[indices[i + 2]] };
+			if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+				continue;
+
+			out_numTriangles++;
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t a = std::min(p[e], p[(e + 1) % 3]);
+				uint32_t b = std::max(p[e], p[(e + 1) % 3]);
+				out_edges.push_back((uint64_t(a) << 32) | b);
+			}
+		}
+	}
+
+	void AppendEdges(const MeshletDAG& dag, uint32_t cluster, std::vector< uint64_t >& out_edges, size_t& out_numTriangles)
+	{
+		std::vector< uint32_t > indices;
+		AppendTriangles(dag.meshlets, cluster, indices);
+		AppendEdges(dag.positionRemap, indices, out_edges, out_numTriangles);
+	}
+
+	//sorted keys of the edges used once, and how many are used by more than two triangles
+	void CountEdges(std::vector< uint64_t >& edges, std::vector< uint64_t >& out_openEdges, size_t& out_numOverlapEdges)
+	{
+		std::sort(edges.begin(), edges.end());
+
+		out_numOverlapEdges = 0;
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t end = i + 1;
+			while (end < edges.size() && edges[end] == edges[i])
+			{
+				end++;
+			}
+
+			if (end - i == 1)
+			{
+				out_openEdges.push_back(edges[i]);
+			}
+			else if (end - i > 2)
+			{
+				out_numOverlapEdges++;
+			}
+			i = end;
+		}
+	}
+
+	//same open edges and no new overlapping ones.  the open edges of a group are all between locked positions, so a
+	//simplification that keeps the group a surface keeps them exactly.
+	bool HasSameBorder(const std::vector< uint32_t >& positionRemap, const std::vector< uint32_t >& before, const std::vector< uint32_t >& after)
+	{
+		std::vector< uint64_t > edges, openBefore, openAfter;
+		size_t numTriangles = 0, overlapBefore = 0, overlapAfter = 0;
+
+		AppendEdges(positionRemap, before, edges, numTriangles);
+		CountEdges(edges, openBefore, overlapBefore);
+
+		edges.clear();
+		AppendEdges(positionRemap, after, edges, numTriangles);
+		CountEdges(edges, openAfter, overlapAfter);
+
+		return openBefore == openAfter && overlapAfter <= overlapBefore;
+	}
+
+	//greedy groups of up to groupSize clusters: a group starts at the first free cluster and keeps taking the free
+	//cluster that shares the most vertex positions with it.  the clusters come in Morton order, so a group that
+	//runs out of neighbours continues nearby.
+	void GroupClusters(const MeshletDAG& dag,
+		const std::vector< uint32_t >& clusters,
+		uint32_t groupSize,
+		std::vector< std::vector< uint32_t > >& out_groups)
+	{
+		const size_t numClusters = clusters.size();
+
+		// the distinct positions of every cluster and the clusters at every position
+		std::vector< std::vector< uint32_t > > positions(numClusters);
+		std::unordered_map< uint32_t, std::vector< uint32_t > > clustersAt;
+
+		std::vector< uint32_t > indices;
+		for (uint32_t c = 0; c < numClusters; ++c)
+		{
+			indices.clear();
+			AppendTriangles(dag.meshlets, clusters[c], indices);
+
+			std::vector< uint32_t >& p = positions[c];
+			for (uint32_t index : indices)
+			{
+				p.push_back(dag.positionRemap[index]);
+			}
+			std::sort(p.begin(), p.end());
+			p.erase(std::unique(p.begin(), p.end()), p.end());
+
+			for (uint32_t position : p)
+			{
+				clustersAt[position].push_back(c);
+			}
+		}
+
+		// neighbours with the number of shared positions
+		std::vector< std::vector< std::pair< uint32_t, uint32_t > > > neighbours(numClusters);
+		std::vector< uint32_t > touching;
+		for (uint32_t c = 0; c < numClusters; ++c)
+		{
+			touching.clear();
+			for (uint32_t position : positions[c])
+			{
+				for (uint32_t other : clustersAt[position])
+				{
+					if (other != c)
+					{
+						touching.push_back(other);
+					}
+				}
+			}
+
+			std::sort(touching.begin(), touching.end());
+			for (size_t i = 0; i < touching.size();)
+			{
+				size_t end = i + 1;
+				while (end < touching.size() && touching[end] == touching[i])
+				{
+					end++;
+				}
+				neighbours[c].push_back({ touching[i], static_cast<uint32_t>(end - i) });
+				i = end;
+			}
+		}
+
+		out_groups.clear();
+		std::vector< uint8_t > grouped(numClusters, 0);
+		std::vector< std::pair< uint32_t, uint32_t > > candidates;
+
+		for (uint32_t seed = 0; seed < numClusters; ++seed)
+		{
+			if (grouped[seed])
+				continue;
+
+			std::vector< uint32_t > group;
+			candidates.clear();
+
+			uint32_t next = seed;
+			while (next != kNoCluster)
+			{
+				grouped[next] = 1;
+				group.push_back(clusters[next]);
+
+				for (const auto& neighbour : neighbours[next])
+				{
+					auto it = std::find_if(candidates.begin(), candidates.end(),
+						[&](const std::pair< uint32_t, uint32_t >& c) { return c.first == neighbour.first; });
+					if (it == candidates.end())
+					{
+						candidates.push_back(neighbour);
+					}
+					else
+					{
+						it->second += neighbour.second;
+					}
+				}
+
+				next = kNoCluster;
+				if (group.size() < groupSize)
+				{
+					uint32_t bestShared = 0;
+					for (const auto& candidate : candidates)
+					{
+						if (!grouped[candidate.first] && (candidate.second > bestShared || (candidate.second == bestShared && candidate.first < next)))
+						{
+							next = candidate.first;
+							bestShared = candidate.second;
+						}
+					}
+				}
+			}
+
+			out_groups.push_back(std::move(group));
+		}
+	}
+
+	//merge the triangles of a group, simplify them with the locked positions kept in place and split the result
+	//into meshlets.  the simplifier only sees the vertices of the group.
+	void SimplifyGroup(const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const MeshletDAG& dag,
+		const std::vector< uint32_t >& group,
+		const std::vector< uint8_t >& lockedPositions,
+		const MeshletDAGOptions& options,
+		GroupResult& out_result)
+	{
+		std::vector< uint32_t > indices;
+		for (uint32_t cluster : group)
+		{
+			AppendTriangles(dag.meshlets, cluster, indices);
+		}
+
+		std::unordered_map< uint32_t, uint32_t > localOf;
+		std::vector< MeshVertexPosNormUV0 > localVertices;
+		std::vector< uint32_t > globalOf;
+		std::vector< uint8_t > localLocked;
+		std::vector< uint32_t > localIndices(indices.size());
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			auto inserted = localOf.emplace(indices[i], static_cast<uint32_t>(localVertices.size()));
+			if (inserted.second)
+			{
+				localVertices.push_back(pVertices[indices[i]]);
+				globalOf.push_back(indices[i]);
+				localLocked.push_back(lockedPositions[dag.positionRemap[indices[i]]]);
+			}
+			localIndices[i] = inserted.first->second;
+		}
+
+		size_t targetIndexCount = static_cast<size_t>(indices.size() / 3 * options.reduction) * 3;
+
+		std::vector< uint32_t > simplified;
+		float error = 0.0f;
+		DXMeshSimplifier::Simplify(localVertices.data(), localVertices.size(), localIndices.data(), localIndices.size(),
+			targetIndexCount, FLT_MAX, simplified, &error, localLocked.data());
+
+		if (simplified.empty() || simplified.size() > indices.size() * options.minReduction)
+			return;
+
+		for (uint32_t& index : simplified)
+		{
+			index = globalOf[index];
+		}
+
+		// an edge collapse that folds the group onto itself can add a triangle on a border edge, the neighbours
+		// would then overlap the group instead of meeting it
+		if (!HasSameBorder(dag.positionRemap, indices, simplified))
+			return;
+
+		BuildMeshletData(pVertices, numVertices, simplified, options.meshlet, out_result.meshlets);
+		out_result.error = error;
+		out_result.bSimplified = true;
+	}
+}
+
+namespace DXMeshletDAG
+{
+	void Build(const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const MeshletDAGOptions& options,
+		MeshletDAG& out_dag,
+		MeshletDAGStats* pStats,
+		uint32_t numThreads)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		out_dag = MeshletDAG();
+		MeshletDAGStats stats;
+
+		BuildPositionRemap(pVertices, numVertices, out_dag.positionRemap);
+
+		// level 0, the meshlets of the source mesh
+		MeshletData level0;
+		BuildMeshletData(pVertices, numVertices, std::vector< uint32_t >(pIndices, pIndices + numIndices - numIndices % 3),
+			options.meshlet, level0);
+		AppendMeshlets(level0, out_dag.meshlets);
+
+		std::vector< uint32_t > frontier;
+		for (uint32_t i = 0; i < level0.meshlets.size(); ++i)
+		{
+			MeshletDAGCluster cluster;
+			cluster.level = 0;
+			cluster.group = kNoGroup;
+			cluster.sourceGroup = kNoGroup;
+			cluster.error = 0.0f;
+			cluster.lodBounds = level0.cullData[i].BoundingSphere;
+			out_dag.clusters.push_back(cluster);
+			frontier.push_back(i);
+		}
+		out_dag.levelStarts.push_back(0);
+
+		// positions that never move: the open borders of the source mesh, so every level has the same outline, and
+		// the vertices of clusters that became roots, their neighbours must keep meeting them
+		std::vector< uint8_t > lockedPositions(numVertices, 0);
+		{
+			std::vector< uint64_t > edges, openEdges;
+			size_t numTriangles = 0, numOverlapEdges = 0;
+			for (uint32_t i = 0; i < out_dag.clusters.size(); ++i)
+			{
+				AppendEdges(out_dag, i, edges, numTriangles);
+			}
+			CountEdges(edges, openEdges, numOverlapEdges);
+
+			for (uint64_t edge : openEdges)
+			{
+				lockedPositions[static_cast<uint32_t>(edge >> 32)] = 1;
+				lockedPositions[static_cast<uint32_t>(edge)] = 1;
+			}
+		}
+
+		std::vector< std::vector< uint32_t > > groups;
+		std::vector< uint32_t > indices;
+		std::vector< uint32_t > owner;
+
+		for (uint32_t level = 0; frontier.size() > 1 && level + 1 < options.maxLevels; ++level)
+		{
+			GroupClusters(out_dag, frontier, std::max< uint32_t >(options.groupSize, 1), groups);
+
+			// a position used by two groups is on a group border and is locked for this level
+			std::vector< uint8_t > levelLocked = lockedPositions;
+			owner.assign(numVertices, kNoCluster);
+			for (uint32_t g = 0; g < groups.size(); ++g)
+			{
+				for (uint32_t cluster : groups[g])
+				{
+					indices.clear();
+					AppendTriangles(out_dag.meshlets, cluster, indices);
+					for (uint32_t index : indices)
+					{
+						uint32_t position = out_dag.positionRemap[index];
+						if (owner[position] == kNoCluster)
+						{
+							owner[position] = g;
+						}
+						else if (owner[position] != g)
+						{
+							levelLocked[position] = 1;
+						}
+					}
+				}
+			}
+
+			std::vector< GroupResult > results(groups.size());
+			DXParallel::ParallelFor(groups.size(), [&](size_t g)
+			{
+				SimplifyGroup(pVertices, numVertices, out_dag, groups[g], levelLocked, options, results[g]);
+			}, numThreads);
+
+			std::vector< uint32_t > nextFrontier;
+			uint32_t levelStart = static_cast<uint32_t>(out_dag.clusters.size());
+
+			for (uint32_t g = 0; g < groups.size(); ++g)
+			{
+				const GroupResult& result = results[g];
+				if (!result.bSimplified)
+				{
+					// the clusters stay as roots, their positions are locked for the levels above
+					for (uint32_t cluster : groups[g])
+					{
+						indices.clear();
+						AppendTriangles(out_dag.meshlets, cluster, indices);
+						for (uint32_t index : indices)
+						{
+							lockedPositions[out_dag.positionRemap[index]] = 1;
+						}
+					}
+					continue;
+				}
+
+				MeshletDAGGroup group;
+				group.level = level;
+				group.firstChild = static_cast<uint32_t>(out_dag.groupChildren.size());
+				group.numChildren = static_cast<uint32_t>(groups[g].size());
+				group.firstParent = static_cast<uint32_t>(out_dag.clusters.size());
+				group.numParents = static_cast<uint32_t>(result.meshlets.meshlets.size());
+				group.error = result.error;
+				group.lodBounds = out_dag.clusters[groups[g][0]].lodBounds;
+
+				for (uint32_t cluster : groups[g])
+				{
+					group.error = std::max(group.error, out_dag.clusters[cluster].error);
+					group.lodBounds = MergeSpheres(group.lodBounds, out_dag.clusters[cluster].lodBounds);
+				}
+
+				uint32_t groupIndex = static_cast<uint32_t>(out_dag.groups.size());
+				for (uint32_t cluster : groups[g])
+				{
+					MeshletDAGCluster& child = out_dag.clusters[cluster];
+					child.group = groupIndex;
+					child.parentError = group.error;
+					child.parentLodBounds = group.lodBounds;
+					out_dag.groupChildren.push_back(cluster);
+				}
+
+				for (uint32_t i = 0; i < group.numParents; ++i)
+				{
+					MeshletDAGCluster parent;
+					parent.level = level + 1;
+					parent.group = kNoGroup;
+					parent.sourceGroup = groupIndex;
+					parent.error = group.error;
+					parent.lodBounds = group.lodBounds;
+					nextFrontier.push_back(static_cast<uint32_t>(out_dag.clusters.size()));
+					out_dag.clusters.push_back(parent);
+				}
+
+				AppendMeshlets(result.meshlets, out_dag.meshlets);
+				out_dag.groups.push_back(group);
+			}
+
+			if (nextFrontier.empty())
+				break;
+
+			out_dag.levelStarts.push_back(levelStart);
+			frontier.swap(nextFrontier);
+		}
+		out_dag.levelStarts.push_back(static_cast<uint32_t>(out_dag.clusters.size()));
+
+		for (uint32_t l = 0; l < out_dag.GetNumLevels(); ++l)
+		{
+			uint32_t first = out_dag.levelStarts[l];
+			uint32_t count = out_dag.levelStarts[l + 1] - first;
+			out_dag.meshlets.meshletSubsets.push_back({ first, count });
+
+			size_t numTriangles = 0;
+			for (uint32_t c = first; c < first + count; ++c)
+			{
+				numTriangles += out_dag.meshlets.meshlets[c].PrimCount;
+			}
+			stats.levelTriangles.push_back(numTriangles);
+		}
+
+		if (pStats)
+		{
+			stats.numClusters = out_dag.clusters.size();
+			stats.numGroups = out_dag.groups.size();
+			for (const MeshletDAGCluster& cluster : out_dag.clusters)
+			{
+				stats.numRoots += cluster.group == kNoGroup ? 1 : 0;
+			}
+			stats.buildMs = GetElapsedMs(start);
+			*pStats = stats;
+		}
+	}
+
+	MeshletLODView CreateLODView(const XMFLOAT3& eyePosition, float fovY, float viewportHeight, float thresholdPixels)
+	{
+		MeshletLODView view;
+		view.eyePosition = eyePosition;
+		view.errorScale = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+		view.threshold = thresholdPixels;
+		return view;
+	}
+
+	MeshletLODView CreateLODView(DXCamera& camera, FXMMATRIX world, float viewportHeight, float thresholdPixels)
+	{
+		// errors and distances scale alike with a uniform world scale, so the object space ratio is the same
+		XMVECTOR determinant;
+		XMMATRIX inverseWorld = XMMatrixInverse(&determinant, world);
+		XMFLOAT3 cameraPosition = camera.GetPosition();
+
+		XMFLOAT3 eye;
+		XMStoreFloat3(&eye, XMVector3TransformCoord(XMLoadFloat3(&cameraPosition), inverseWorld));
+		return CreateLODView(eye, camera.GetFOV(), viewportHeight, thresholdPixels);
+	}
+
+	float GetProjectedError(float error, const XMFLOAT4& lodBounds, const MeshletLODView& view)
+	{
+		if (error == FLT_MAX)
+			return FLT_MAX;
+
+		float dx = lodBounds.x - view.eyePosition.x;
+		float dy = lodBounds.y - view.eyePosition.y;
+		float dz = lodBounds.z - view.eyePosition.z;
+		float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - lodBounds.w;
+		if (distance <= 0.0f)
+			return error > 0.0f ? FLT_MAX : 0.0f;
+
+		return error * view.errorScale / distance;
+	}
+
+	size_t SelectClusters(const MeshletDAG& dag,
+		const MeshletLODView& view,
+		std::vector< uint32_t >& out_clusters,
+		MeshletLODSelectStats* pStats)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		size_t numSelectedBefore = out_clusters.size();
+		size_t numTriangles = 0;
+
+		for (uint32_t i = 0; i < dag.clusters.size(); ++i)
+		{
+			if (IsClusterSelected(dag.clusters[i], view))
+			{
+				out_clusters.push_back(i);
+				numTriangles += dag.meshlets.meshlets[i].PrimCount;
+			}
+		}
+
+		size_t numSelected = out_clusters.size() - numSelectedBefore;
+		if (pStats)
+		{
+			pStats->numClusters += numSelected;
+			pStats->numTriangles += numTriangles;
+			pStats->selectMs += GetElapsedMs(start);
+		}
+
+		return numSelected;
+	}
+
+	bool CheckDAG(const MeshletDAG& dag)
+	{
+		if (dag.meshlets.meshlets.size() != dag.clusters.size() || dag.meshlets.cullData.size() != dag.clusters.size())
+			return false;
+
+		std::vector< uint32_t > numGroups(dag.clusters.size(), 0);
+
+		for (uint32_t g = 0; g < dag.groups.size(); ++g)
+		{
+			const MeshletDAGGroup& group = dag.groups[g];
+
+			for (uint32_t i = 0; i < group.numChildren; ++i)
+			{
+				uint32_t c = dag.groupChildren[group.firstChild + i];
+				const MeshletDAGCluster& child = dag.clusters[c];
+				numGroups[c]++;
+
+				if (child.group != g || child.level != group.level || child.error > group.error ||
+					child.parentError != group.error || !IsSameSphere(child.parentLodBounds, group.lodBounds) ||
+					!ContainsSphere(group.lodBounds, child.lodBounds))
+				{
+					return false;
+				}
+			}
+
+			for (uint32_t p = group.firstParent; p < group.firstParent + group.numParents; ++p)
+			{
+				const MeshletDAGCluster& parent = dag.clusters[p];
+				if (parent.sourceGroup != g || parent.level != group.level + 1 || parent.error != group.error ||
+					!IsSameSphere(parent.lodBounds, group.lodBounds))
+				{
+					return false;
+				}
+			}
+		}
+
+		for (uint32_t c = 0; c < dag.clusters.size(); ++c)
+		{
+			const MeshletDAGCluster& cluster = dag.clusters[c];
+			bool bRoot = cluster.group == kNoGroup;
+			if (numGroups[c] != (bRoot ? 0u : 1u) || (bRoot && cluster.parentError != FLT_MAX))
+				return false;
+		}
+
+		return true;
+	}
+
+	MeshletDAGCutCheck CheckCut(const MeshletDAG& dag, const std::vector< uint32_t >& clusters)
+	{
+		MeshletDAGCutCheck check;
+		if (dag.GetNumLevels() == 0)
+			return check;
+
+		// the open edges of level 0 are the borders of the source mesh, every level keeps them
+		std::vector< uint64_t > edges, sourceOpenEdges;
+		size_t numTriangles = 0, numOverlapEdges = 0;
+		for (uint32_t c = dag.levelStarts[0]; c < dag.levelStarts[1]; ++c)
+		{
+			AppendEdges(dag, c, edges, numTriangles);
+		}
+		CountEdges(edges, sourceOpenEdges, numOverlapEdges);
+
+		edges.clear();
+		for (uint32_t c : clusters)
+		{
+			AppendEdges(dag, c, edges, check.numTriangles);
+		}
+
+		std::vector< uint64_t > openEdges;
+		CountEdges(edges, openEdges, check.numOverlapEdges);
+
+		for (uint64_t edge : openEdges)
+		{
+			check.numCrackEdges += std::binary_search(sourceOpenEdges.begin(), sourceOpenEdges.end(), edge) ? 0 : 1;
+		}
+
+		return check;
+	}
+}
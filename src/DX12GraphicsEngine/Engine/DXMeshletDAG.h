@@ -0,0 +1,141 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include "DXMeshletBuilder.h"
+#include <DirectXMath.h>
+#include <cfloat>
+#include <vector>
+
+class DXCamera;
+
+struct MeshletDAGOptions
+{
+	MeshletBuildOptions meshlet;
+	uint32_t groupSize = 8;          //neighbouring clusters simplified together
+	float reduction = 0.5f;          //triangle count of a simplified group relative to the group
+	float minReduction = 0.85f;      //a group that keeps more than this is not simplified, its clusters become roots
+	uint32_t maxLevels = 24;
+};
+
+//One meshlet of the DAG.  The clusters of level 0 are the meshlets of the source mesh, the clusters of level n + 1
+//come from simplifying a group of level n clusters.  error and lodBounds are those of the group the cluster was
+//made from (0 and its own bounds at level 0), so every cluster of a group switches at the same distance.
+struct MeshletDAGCluster
+{
+	uint32_t level = 0;
+	uint32_t group = 0;            //the group that replaces this cluster, DXMeshletDAG::kNoGroup for roots
+	uint32_t sourceGroup = 0;      //the group this cluster was made from, kNoGroup at level 0
+	float error = 0.0f;            //object space distance to the level 0 surface
+	DirectX::XMFLOAT4 lodBounds;   //xyz = center, w = radius
+	float parentError = FLT_MAX;   //error of the group, FLT_MAX for roots
+	DirectX::XMFLOAT4 parentLodBounds;
+};
+
+//Clusters of one level that were merged, simplified and split again.  The children stay valid together with the
+//parents of the other groups: only the vertices inside the group move, the ones on its border are locked.
+struct MeshletDAGGroup
+{
+	uint32_t level = 0;            //of the children
+	uint32_t firstChild = 0;       //into MeshletDAG::groupChildren
+	uint32_t numChildren = 0;
+	uint32_t firstParent = 0;      //into MeshletDAG::clusters, the parents of a group are consecutive
+	uint32_t numParents = 0;
+	float error = 0.0f;            //at least the error of every child
+	DirectX::XMFLOAT4 lodBounds;   //contains the lodBounds of every child
+};
+
+struct MeshletDAG
+{
+	std::vector< MeshletDAGCluster > clusters;
+	std::vector< MeshletDAGGroup > groups;
+	std::vector< uint32_t > groupChildren;
+
+	//meshlets.meshlets[i] and meshlets.cullData[i] belong to clusters[i].  the vertex indices are those of the
+	//source vertex buffer, every level draws from it.  meshletSubsets has one subset per level.
+	MeshletData meshlets;
+
+	std::vector< uint32_t > levelStarts;    //first cluster of each level, one more entry at the end
+	std::vector< uint32_t > positionRemap;  //first vertex with the same position, the crack checks compare positions
+
+	uint32_t GetNumLevels() const { return levelStarts.empty() ? 0 : static_cast<uint32_t>(levelStarts.size() - 1); }
+};
+
+struct MeshletDAGStats
+{
+	size_t numClusters = 0;
+	size_t numGroups = 0;
+	size_t numRoots = 0;
+	std::vector< size_t > levelTriangles;  //triangles of the clusters of each level
+	double buildMs = 0.0;
+};
+
+//object space eye and the scale from an object space error at distance 1 to pixels
+struct MeshletLODView
+{
+	DirectX::XMFLOAT3 eyePosition;
+	float errorScale;
+	float threshold;               //largest error in pixels a selected cluster may have
+};
+
+struct MeshletLODSelectStats
+{
+	size_t numClusters = 0;
+	size_t numTriangles = 0;
+	double selectMs = 0.0;
+};
+
+//Result of CheckCut.  Edges are compared by position, so uv and normal seams do not count as open.
+struct MeshletDAGCutCheck
+{
+	size_t numTriangles = 0;
+	size_t numCrackEdges = 0;      //used by one triangle and not on an open border of the source mesh
+	size_t numOverlapEdges = 0;    //used by more than two triangles, two groups that both joined the same two locked
+	                               //positions.  the surface touches itself there but has no hole.
+};
+
+//Continuous level of detail for the mesh shader path (the cluster hierarchy of Nanite, Karis 2021).  The meshlets of
+//a mesh are grouped with their neighbours, each group is simplified with DXMeshSimplifier to about half its triangles
+//with the group border locked and split into new meshlets, and the new meshlets are grouped again until one cluster
+//is left or nothing simplifies any more.  A cluster is drawn when its error is small enough for the view and the
+//error of the group that replaces it is not.  Errors never decrease and bounds never shrink from a cluster to its
+//parents, so the projected error does not either and every view picks one consistent, crack free cut.
+namespace DXMeshletDAG
+{
+	const uint32_t kNoGroup = 0xffffffff;
+
+	void Build(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		const uint32_t* pIndices,
+		size_t numIndices,
+		const MeshletDAGOptions& options,
+		MeshletDAG& out_dag,
+		MeshletDAGStats* pStats = nullptr,
+		uint32_t numThreads = 0);
+
+	//viewportHeight in pixels, fovY in radians.  eyePosition is in the object space of the mesh.
+	MeshletLODView CreateLODView(const DirectX::XMFLOAT3& eyePosition, float fovY, float viewportHeight, float thresholdPixels);
+
+	MeshletLODView CreateLODView(DXCamera& camera, DirectX::FXMMATRIX world, float viewportHeight, float thresholdPixels);
+
+	//error in pixels of error seen from the view, FLT_MAX when the eye is inside the bounds
+	float GetProjectedError(float error, const DirectX::XMFLOAT4& lodBounds, const MeshletLODView& view);
+
+	inline bool IsClusterSelected(const MeshletDAGCluster& cluster, const MeshletLODView& view)
+	{
+		return GetProjectedError(cluster.error, cluster.lodBounds, view) <= view.threshold &&
+			GetProjectedError(cluster.parentError, cluster.parentLodBounds, view) > view.threshold;
+	}
+
+	//appends the index of every selected cluster (= its meshlet) to out_clusters, returns how many were appended
+	size_t SelectClusters(const MeshletDAG& dag,
+		const MeshletLODView& view,
+		std::vector< uint32_t >& out_clusters,
+		MeshletLODSelectStats* pStats = nullptr);
+
+	//the invariants the selection depends on: every group's error and bounds contain those of its children, every
+	//parent has the error and bounds of its group and every non root cluster is the child of exactly one group
+	bool CheckDAG(const MeshletDAG& dag);
+
+	//open and overlapping edges of the triangles of a set of clusters.  a valid cut has no crack edges.
+	MeshletDAGCutCheck CheckCut(const MeshletDAG& dag, const std::vector< uint32_t >& clusters);
+}
@@ -15,8 +15,14 @@ bool DXModel::msbDebugUseDiskSprites = false;
 bool DXModel::msbUseInlineRayTracing = false;
 
 ComPtr<ID3D12PipelineState> DXModel::m_pPipelineState = nullptr;
+ComPtr<ID3D12PipelineState> DXModel::m_pCompact16PipelineState = nullptr;
+ComPtr<ID3D12PipelineState> DXModel::m_pCompact12PipelineState = nullptr;
 ComPtr<ID3D12PipelineState> DXModel::m_pPointCloudPipelineState = nullptr;
+ComPtr<ID3D12PipelineState> DXModel::m_pPointCloudCompact12PipelineState = nullptr;
+ComPtr<ID3D12PipelineState> DXModel::m_pPointCloudCompact8PipelineState = nullptr;
 ComPtr<ID3D12PipelineState> DXModel::m_pPointCloudSpritePipelineState = nullptr;
+ComPtr<ID3D12PipelineState> DXModel::m_pPointCloudSpriteCompact12PipelineState = nullptr;
+ComPtr<ID3D12PipelineState> DXModel::m_pPointCloudSpriteCompact8PipelineState = nullptr;
 
 ComPtr<ID3D12RootSignature> DXModel::m_pRootSignature = nullptr;
 ComPtr<ID3D12RootSignature> DXModel::m_pPointCloudSpriteRootSignature = nullptr;
@@ -29,6 +35,10 @@ DXModel::DXModel() :
 	, m_DXTexture(nullptr)
 	, m_ModelID(0)
 	, m_bReceiveShadow(false)
+	, m_bOptimizeMesh(false)
+	, m_VertexFormat(kMeshVertexFormatFull)
+	, m_LODCount(1)
+	, m_fLODPixelError(1.0f)
 	, m_pDXCamera(nullptr)
 {
 	m_WorldMatrix = XMMatrixIdentity();
@@ -49,7 +59,7 @@ void  DXModel::Init(ComPtr<ID3D12Device>& pd3dDevice, ComPtr<ID3D12CommandQueue>
 	m_cbvSrvHeap = pCBVSRVHeap; 
 	m_cbDescriptorIndex = cbDescriptorIndex;
 
-	m_Viewport = Viewport;
+	SetViewport(Viewport);
 	m_ScissorRect = ScissorRect;
 
 	CreateD3DResources(commandQueue);
@@ -60,6 +70,14 @@ void DXModel::CreatePipelineState()
 	if (m_pPipelineState)
 		return;
 
+	//one pso per vertex buffer layout, they only differ in the vertex shader and the input layout
+	CreatePipelineState(kMeshVertexFormatFull, m_pPipelineState);
+	CreatePipelineState(kMeshVertexFormatCompact16, m_pCompact16PipelineState);
+	CreatePipelineState(kMeshVertexFormatCompact12, m_pCompact12PipelineState);
+}
+
+void DXModel::CreatePipelineState(MeshVertexFormat format, ComPtr<ID3D12PipelineState>& pPipelineState)
+{
 	// Create the pipeline state, which includes compiling and loading shaders.
 	{
 		ComPtr<ID3DBlob> objModelVertexShader;
@@ -77,12 +95,26 @@ void DXModel::CreatePipelineState()
 		D3D12ShaderCompilerInfo shaderCompiler;
 		DXShaderUtilities shaderUtils;
 
+		//the compact layouts decode their vertices and then run VSMain
+		const char* vsEntry = "VSMain";
+		const wchar_t* vsEntryW = L"VSMain";
+		if (format == kMeshVertexFormatCompact16)
+		{
+			vsEntry = "VSMainCompact";
+			vsEntryW = L"VSMainCompact";
+		}
+		else if (format == kMeshVertexFormatCompact12)
+		{
+			vsEntry = "VSMainCompactPacked";
+			vsEntryW = L"VSMainCompactPacked";
+		}
+
 		//load shader files from disk
 		if (msbUseInlineRayTracing)
 		{
 			shaderUtils.Init_Shader_Compiler(shaderCompiler);
 
-			D3D12ShaderInfo infoVS(L"assets/shaders/objModelShadersRayTrace.hlsl", L"VSMain", L"vs_6_6");
+			D3D12ShaderInfo infoVS(L"assets/shaders/objModelShadersRayTrace.hlsl", vsEntryW, L"vs_6_6");
 			shaderUtils.Compile_Shader(shaderCompiler, infoVS, &vsBlob);
 
 			D3D12ShaderInfo infoPS(L"assets/shaders/objModelShadersRayTrace.hlsl", L"PSMain", L"ps_6_6");
@@ -92,8 +124,8 @@ void DXModel::CreatePipelineState()
 		}
 		else
 		{
-			ThrowIfFailed(D3DCompileFromFile(L"assets/shaders/objModelShaders.hlsl", nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &objModelVertexShader, &error));
-			ThrowIfFailed(D3DCompileFromFile(L"assets/shaders/objModelShaders.hlsl", nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &objModelPixelShader, &error));
+			ThrowIfFailed(D3DCompileFromFile(L"assets/shaders/objModelShaders.hlsl", nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, vsEntry, "vs_5_0", compileFlags, 0, &objModelVertexShader, &error));
+			ThrowIfFailed(D3DCompileFromFile(L"assets/shaders/objModelShaders.hlsl", nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "PSMain", "ps_5_0", compileFlags, 0, &objModelPixelShader, &error));
 		}
 		
 		// Define the vertex input layouts.
@@ -103,11 +135,30 @@ void DXModel::CreatePipelineState()
 			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 		};
+
+		//MeshVertexCompact16, see DXVertexCompression.h
+		D3D12_INPUT_ELEMENT_DESC compact16InputElementDescs[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+
+		//MeshVertexCompact12, the normal is packed into the w component of the position
+		D3D12_INPUT_ELEMENT_DESC compact12InputElementDescs[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
 		
 
 		// Describe and create the graphics pipeline state objects (PSOs).
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+		if (format == kMeshVertexFormatCompact16)
+			psoDesc.InputLayout = { compact16InputElementDescs, _countof(compact16InputElementDescs) };
+		else if (format == kMeshVertexFormatCompact12)
+			psoDesc.InputLayout = { compact12InputElementDescs, _countof(compact12InputElementDescs) };
 		psoDesc.pRootSignature = m_pRootSignature.Get();
 
 		if (msbUseInlineRayTracing)
@@ -138,18 +189,99 @@ void DXModel::CreatePipelineState()
 		psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 		psoDesc.SampleDesc.Count = 1;
 
-		ThrowIfFailed(m_pd3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pPipelineState)));
-		NAME_D3D12_OBJECT(m_pPipelineState);
+		ThrowIfFailed(m_pd3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pPipelineState)));
+		NAME_D3D12_OBJECT(pPipelineState);
 
 	}
 
 }
 
+//pick the level of detail from the screen space size of its error.  the distance is taken to the closest point of
+//the bounding sphere so a large model is not simplified while the camera is next to one end of it.
+void DXModel::SelectLOD()
+{
+	const std::vector< DXMeshLOD >& lods = m_pDXMesh->GetLODs();
+	if (!m_pDXCamera || lods.size() < 2 || m_Viewport.Height <= 0.0f)
+		return;
+
+	const DXGraphicsUtilities::BoundingBox& bounds = m_pDXMesh->GetBounds();
+	XMVECTOR boundsMin = XMLoadFloat3(&bounds.mMin);
+	XMVECTOR boundsMax = XMLoadFloat3(&bounds.mMax);
+
+	//the lod errors are in object space, scale them by the largest axis scale of the world matrix
+	float worldScale = std::max(std::max(XMVectorGetX(XMVector3Length(m_WorldMatrix.r[0])),
+		XMVectorGetX(XMVector3Length(m_WorldMatrix.r[1]))), XMVectorGetX(XMVector3Length(m_WorldMatrix.r[2])));
+
+	XMVECTOR center = XMVector3Transform((boundsMin + boundsMax) * 0.5f, m_WorldMatrix);
+	float radius = XMVectorGetX(XMVector3Length(boundsMax - boundsMin)) * 0.5f * worldScale;
+
+	XMFLOAT3 cameraPosition = m_pDXCamera->GetPosition();
+	float distance = XMVectorGetX(XMVector3Length(center - XMLoadFloat3(&cameraPosition))) - radius;
+
+	float nearPlane, farPlane;
+	m_pDXCamera->GetNearFarPlanes(nearPlane, farPlane);
+	distance = std::max(distance, nearPlane);
+
+	//pixels per world unit at that distance.  GetFOV is the vertical field of view of the projection.
+	float pixelsPerUnit = m_Viewport.Height / (2.0f * distance * std::tan(m_pDXCamera->GetFOV() * 0.5f));
+
+	UINT lod = 0;
+	for (UINT i = 1; i < lods.size(); ++i)
+	{
+		if (lods[i].error * worldScale * pixelsPerUnit > m_fLODPixelError)
+			break;
+
+		lod = i;
+	}
+
+	m_pDXMesh->SetCurrentLOD(lod);
+}
+
+ID3D12PipelineState* DXModel::GetMeshPipelineState()
+{
+	switch (m_pDXMesh->GetVertexFormat())
+	{
+	case kMeshVertexFormatCompact16: return m_pCompact16PipelineState.Get();
+	case kMeshVertexFormatCompact12: return m_pCompact12PipelineState.Get();
+	default: return m_pPipelineState.Get();
+	}
+}
+
+ID3D12PipelineState* DXModel::GetPointCloudPipelineState()
+{
+	PointVertexFormat format = m_pDXPointCloud ? m_pDXPointCloud->GetPointVertexFormat() : kPointVertexFormatFull;
+
+	if (msbDebugUseSpritePointCloud)
+	{
+		switch (format)
+		{
+		case kPointVertexFormatCompact12: return m_pPointCloudSpriteCompact12PipelineState.Get();
+		case kPointVertexFormatCompact8: return m_pPointCloudSpriteCompact8PipelineState.Get();
+		default: return m_pPointCloudSpritePipelineState.Get();
+		}
+	}
+
+	switch (format)
+	{
+	case kPointVertexFormatCompact12: return m_pPointCloudCompact12PipelineState.Get();
+	case kPointVertexFormatCompact8: return m_pPointCloudCompact8PipelineState.Get();
+	default: return m_pPointCloudPipelineState.Get();
+	}
+}
+
 void DXModel::CreatePointCloudPipelineState()
 {
 	if (m_pPointCloudPipelineState)
 		return;
 
+	//one pso per vertex buffer layout, the shaders read the compact positions as unorm and the matrix dequantizes them
+	CreatePointCloudPipelineState(kPointVertexFormatFull, m_pPointCloudPipelineState);
+	CreatePointCloudPipelineState(kPointVertexFormatCompact12, m_pPointCloudCompact12PipelineState);
+	CreatePointCloudPipelineState(kPointVertexFormatCompact8, m_pPointCloudCompact8PipelineState);
+}
+
+void DXModel::CreatePointCloudPipelineState(PointVertexFormat format, ComPtr<ID3D12PipelineState>& pPipelineState)
+{
 	// Create the pipeline state, which includes compiling and loading shaders.
 	{
 		ComPtr<ID3DBlob> pointCloudVertexShader;
@@ -176,10 +308,28 @@ void DXModel::CreatePointCloudPipelineState()
 			//{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 		};
 
+		//PointVertexCompact12, see DXVertexCompression.h
+		D3D12_INPUT_ELEMENT_DESC compact12InputElementDescs[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+
+		//PointVertexCompact8
+		D3D12_INPUT_ELEMENT_DESC compact8InputElementDescs[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 4, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+
 
 		// Describe and create the graphics pipeline state objects (PSOs).
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+		if (format == kPointVertexFormatCompact12)
+			psoDesc.InputLayout = { compact12InputElementDescs, _countof(compact12InputElementDescs) };
+		else if (format == kPointVertexFormatCompact8)
+			psoDesc.InputLayout = { compact8InputElementDescs, _countof(compact8InputElementDescs) };
 		psoDesc.pRootSignature = m_pRootSignature.Get();
 		psoDesc.VS = CD3DX12_SHADER_BYTECODE(pointCloudVertexShader.Get());
 		psoDesc.PS = CD3DX12_SHADER_BYTECODE(pointCloudPixelShader.Get());
@@ -197,8 +347,8 @@ void DXModel::CreatePointCloudPipelineState()
 		psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 		psoDesc.SampleDesc.Count = 1;
 
-		ThrowIfFailed(m_pd3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pPointCloudPipelineState)));
-		NAME_D3D12_OBJECT(m_pPointCloudPipelineState);
+		ThrowIfFailed(m_pd3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pPipelineState)));
+		NAME_D3D12_OBJECT(pPipelineState);
 
 	}
 
@@ -250,18 +400,20 @@ void DXModel::CreatePointCloudSpriteRootSignature()
 		CD3DX12_DESCRIPTOR_RANGE cbvTable;
 		cbvTable.Init(
 			D3D12_DESCRIPTOR_RANGE_TYPE_CBV,
-			4,  // number of cb descriptors for view and proj matrices, camera pos, quad size
+			1,  // one cb descriptor for view and proj matrices, camera pos, quad size
 			0 // register b0
 		);
 
 
-		//root signature parameters (consists of two tables).  later, before rendering, we need to call
+		//root signature parameters (consists of two tables and the quad size of a draw).  later, before rendering, we need to call
 		//pCommandList->SetGraphicsRootDescriptorTable(0, texHandle);
 		//pCommandList->SetGraphicsRootDescriptorTable(1, cbvHandle);
+		//pCommandList->SetGraphicsRoot32BitConstants(2, 4, &quadSize, 0);
 		//This points the table directly to the heap memory where the descriptor handles reside
-		CD3DX12_ROOT_PARAMETER rootParameters[2];
+		CD3DX12_ROOT_PARAMETER rootParameters[3];
 		rootParameters[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
 		rootParameters[1].InitAsDescriptorTable(1, &cbvTable, D3D12_SHADER_VISIBILITY_ALL);
+		rootParameters[2].InitAsConstants(4, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);  // register b1
 
 
 		// Allow input layout and pixel shader access and deny uneccessary access to certain pipeline stages.
@@ -288,7 +440,7 @@ void DXModel::CreatePointCloudSpriteRootSignature()
 
 
 		// A root signature is an array of root parameters.
-		CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc(2, rootParameters,
+		CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc(3, rootParameters,
 			1, &sampler,
 			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -422,18 +574,11 @@ void DXModel::Render(ComPtr<ID3D12GraphicsCommandList> & pCommandList, const Dir
 
 	if (m_pDXPointCloud)
 	{
-		if (msbDebugUseSpritePointCloud)
-		{
-			pCommandList->SetPipelineState(m_pPointCloudSpritePipelineState.Get());
-		}
-		else
-		{
-			pCommandList->SetPipelineState(m_pPointCloudPipelineState.Get());
-		}
+		pCommandList->SetPipelineState(GetPointCloudPipelineState());
 	}
 	else
 	{
-		pCommandList->SetPipelineState(m_pPipelineState.Get());
+		pCommandList->SetPipelineState(GetMeshPipelineState());
 	}
 	
 	// Set pipeline state.
@@ -483,6 +628,7 @@ void DXModel::Render(ComPtr<ID3D12GraphicsCommandList> & pCommandList, const Dir
 	}
 	else
 	{
+		SelectLOD();
 		m_pDXMesh->Render(pCommandList, wvp);
 	}
 }
@@ -490,7 +636,7 @@ void DXModel::Render(ComPtr<ID3D12GraphicsCommandList> & pCommandList, const Dir
 void DXModel::Render(ComPtr<ID3D12GraphicsCommandList>& pCommandList, const DirectX::XMMATRIX& view, 
 	const DirectX::XMMATRIX& proj, std::vector<DXGraphicsUtilities::SrvParameter>& rootSrvParams)
 {
-	pCommandList->SetPipelineState(m_pPipelineState.Get());
+	pCommandList->SetPipelineState(GetMeshPipelineState());
 	pCommandList->SetGraphicsRootSignature(m_pRootSignature.Get());
 	
 	ID3D12DescriptorHeap* ppHeaps[] = { m_cbvSrvHeap.Get() };
@@ -513,19 +659,13 @@ void DXModel::Render(ComPtr<ID3D12GraphicsCommandList>& pCommandList, const Dire
 	XMMATRIX wvp = XMMatrixMultiply(wv, proj);
 	XMMATRIX vp = XMMatrixMultiply(view, proj);
 
+	SelectLOD();
 	m_pDXMesh->Render(pCommandList, m_WorldMatrix, wvp);
 }
 
 void DXModel::RenderPointCloud(ComPtr<ID3D12GraphicsCommandList>& pCommandList,  const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& proj)
 {
-	if (msbDebugUseSpritePointCloud)
-	{
-		pCommandList->SetPipelineState(m_pPointCloudSpritePipelineState.Get());
-	}
-	else
-	{
-		pCommandList->SetPipelineState(m_pPointCloudPipelineState.Get());
-	}
+	pCommandList->SetPipelineState(GetPointCloudPipelineState());
 
 	// Set pipeline state.
 	if (msbDebugUseSpritePointCloud)
@@ -597,7 +737,7 @@ void DXModel::LoadModelAndTexture(const std::string& modelFileName, const std::w
 	m_cbvSrvHeap = descriptor_heap_srv->GetDescriptorHeap(); 
 	m_cbDescriptorIndex = descriptor_heap_srv->GetNewDescriptorIndex();
 
-	m_Viewport = Viewport;
+	SetViewport(Viewport);
 	m_ScissorRect = ScissorRect;
 
 	CreateD3DResources(pCommandQueue);
@@ -606,12 +746,65 @@ void DXModel::LoadModelAndTexture(const std::string& modelFileName, const std::w
 
 	uint32_t texture_descriptor_index = descriptor_heap_srv->GetNewDescriptorIndex();
 	LoadTexture(strTextureFullPath, texture_descriptor_index, pd3dDevice, pCommandQueue);
+
+	LoadMaterialTextures(descriptor_heap_srv, pd3dDevice, pCommandQueue);
+}
+
+void DXModel::LoadMaterialTextures(std::shared_ptr<DXDescriptorHeap>& descriptor_heap_srv, ComPtr<ID3D12Device>& pd3dDevice,
+	ComPtr<ID3D12CommandQueue>& commandQueue)
+{
+	const std::vector< ObjMaterial >& materials = m_pDXMesh->GetMaterials();
+
+	m_MaterialTextures.assign(materials.size(), nullptr);
+	bool bHasMaterialTexture = false;
+
+	for (size_t i = 0; i < materials.size(); ++i)
+	{
+		const std::string& path = materials[i].diffuseTexture;
+		if (path.empty())
+			continue;
+
+		//DXTexture only decodes png files
+		if (path.size() < 4 || _stricmp(path.c_str() + path.size() - 4, ".png") != 0)
+		{
+			printf("material %s: only png textures are supported, %s is not used\n", materials[i].name.c_str(), path.c_str());
+			continue;
+		}
+
+		std::shared_ptr<DXTexture> pTexture = std::make_shared<DXTexture>();
+		uint32_t descriptorIndex = descriptor_heap_srv->GetNewDescriptorIndex();
+		if (pTexture->CreateTextureFromFile(pd3dDevice, commandQueue, m_cbvSrvHeap, std::wstring(path.begin(), path.end()), descriptorIndex))
+		{
+			m_MaterialTextures[i] = pTexture;
+			bHasMaterialTexture = true;
+		}
+		else
+		{
+			printf("material %s: failed to load %s\n", materials[i].name.c_str(), path.c_str());
+		}
+	}
+
+	//without any material texture the mesh draws with the texture bound by Render
+	std::vector< D3D12_GPU_DESCRIPTOR_HANDLE > handles;
+	if (bHasMaterialTexture)
+	{
+		for (std::shared_ptr<DXTexture>& pTexture : m_MaterialTextures)
+		{
+			std::shared_ptr<DXTexture>& pSubsetTexture = pTexture ? pTexture : m_DXTexture;
+			handles.push_back(pSubsetTexture->GetSrvGPUDescriptorHandle(m_pd3dDevice));
+		}
+	}
+
+	m_pDXMesh->SetMaterialTextureHandles(handles);
 }
 
 void  DXModel::LoadModel(const std::string & fileName)
 {
 	//create new mesh
 	m_pDXMesh = std::make_shared<DXMesh>();
+	m_pDXMesh->SetOptimizeMesh(m_bOptimizeMesh);
+	m_pDXMesh->SetVertexFormat(m_VertexFormat);
+	m_pDXMesh->SetLODCount(m_LODCount);
 
 	m_pDXMesh->LoadModelFromFile(fileName.c_str(), m_pd3dDevice, m_cbvSrvHeap, m_cbDescriptorIndex, 1.0);
 }
@@ -621,10 +814,31 @@ void DXModel::LoadPointCloud(const std::string& fileName, bool bSwitchYZAxes)
 	//create new mesh
 	m_pDXPointCloud = std::make_shared<DXPointCloud>();
 
+	// the point LOD is chosen by projected size, it needs the height of the viewport the cloud is drawn to
+	SetViewport(m_Viewport);
+
+	// a paged file is streamed, it was written in its final space so there is nothing to scale or switch
+	size_t extension = fileName.find_last_of('.');
+	if (extension != std::string::npos && _stricmp(fileName.c_str() + extension, ".dxpoints") == 0)
+	{
+		m_pDXPointCloud->LoadPagedPointCloud(fileName.c_str(), m_pd3dDevice, m_cbvSrvHeap, m_cbDescriptorIndex);
+		return;
+	}
+
 	DXGraphicsUtilities::vec3 scale{ 1.0f,1.0f, 1.0f };
 	m_pDXPointCloud->LoadPointCloudFromFile(fileName.c_str(), m_pd3dDevice, m_cbvSrvHeap, m_cbDescriptorIndex, scale, bSwitchYZAxes);
 }
 
+void DXModel::SetViewport(const CD3DX12_VIEWPORT& Viewport)
+{
+	m_Viewport = Viewport;
+
+	if (m_pDXPointCloud && m_Viewport.Height > 0.0f)
+	{
+		m_pDXPointCloud->SetLODViewportHeight(m_Viewport.Height);
+	}
+}
+
 void DXModel::LoadTexture(const std::wstring& strFullPath,  int descriptorIndex, ComPtr<ID3D12Device>& pd3dDevice, ComPtr<ID3D12CommandQueue> & commandQueue)
 {
 	m_DXTexture = std::make_shared<DXTexture>();
@@ -640,6 +854,14 @@ void DXModel::CreatePointCloudSpritePipelineState()
 	if ( m_pPointCloudSpritePipelineState )
 		return;
 
+	//the vertex shader dequantizes the compact positions with gPositionOffset and gPositionScale
+	CreatePointCloudSpritePipelineState(kPointVertexFormatFull, m_pPointCloudSpritePipelineState);
+	CreatePointCloudSpritePipelineState(kPointVertexFormatCompact12, m_pPointCloudSpriteCompact12PipelineState);
+	CreatePointCloudSpritePipelineState(kPointVertexFormatCompact8, m_pPointCloudSpriteCompact8PipelineState);
+}
+
+void DXModel::CreatePointCloudSpritePipelineState(PointVertexFormat format, ComPtr<ID3D12PipelineState>& pPipelineState)
+{
 	// Create the pipeline state, which includes compiling and loading shaders.
 	{
 		ComPtr<ID3DBlob> pointCloudVertexShader;
@@ -672,10 +894,28 @@ void DXModel::CreatePointCloudSpritePipelineState()
 			//{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 		};
 
+		//PointVertexCompact12, see DXVertexCompression.h
+		D3D12_INPUT_ELEMENT_DESC compact12InputElementDescs[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+
+		//PointVertexCompact8
+		D3D12_INPUT_ELEMENT_DESC compact8InputElementDescs[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 4, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+
 
 		// Describe and create the graphics pipeline state objects (PSOs).
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+		if (format == kPointVertexFormatCompact12)
+			psoDesc.InputLayout = { compact12InputElementDescs, _countof(compact12InputElementDescs) };
+		else if (format == kPointVertexFormatCompact8)
+			psoDesc.InputLayout = { compact8InputElementDescs, _countof(compact8InputElementDescs) };
 		psoDesc.pRootSignature = m_pPointCloudSpriteRootSignature.Get();
 		psoDesc.VS = CD3DX12_SHADER_BYTECODE(pointCloudVertexShader.Get());
 		psoDesc.PS = CD3DX12_SHADER_BYTECODE(pointCloudPixelShader.Get());
@@ -695,8 +935,8 @@ void DXModel::CreatePointCloudSpritePipelineState()
 		psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 		psoDesc.SampleDesc.Count = 1;
 
-		ThrowIfFailed(m_pd3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pPointCloudSpritePipelineState)));
-		NAME_D3D12_OBJECT(m_pPointCloudSpritePipelineState);
+		ThrowIfFailed(m_pd3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pPipelineState)));
+		NAME_D3D12_OBJECT(pPipelineState);
 
 	}
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DXGraphicsUtilities.h"
+#include "DXVertexCompression.h"
 #include <string>
 using namespace DirectX;
 
@@ -40,7 +41,15 @@ public:
 	void LoadModel(const std::string & fileName); // filename is the entire path
 	void LoadPointCloud(const std::string& fileName, bool bSwitchYZAxes); // filename is the entire path
 
+	//the mesh LOD and the point cloud LOD both select by the projected size on this viewport
+	void SetViewport(const CD3DX12_VIEWPORT& Viewport);
+
 	void LoadTexture(const std::wstring& strFullPath,  int descriptorIndex, ComPtr<ID3D12Device>& pd3dDevice, ComPtr<ID3D12CommandQueue> & commandQueue);
+
+	//load the map_Kd texture of every mtl material of the mesh.  Render binds them per subset, materials without a
+	//(loadable) texture use the model texture.  called by LoadModelAndTexture.
+	void LoadMaterialTextures(std::shared_ptr<DXDescriptorHeap>& descriptor_heap_srv, ComPtr<ID3D12Device>& pd3dDevice,
+		ComPtr<ID3D12CommandQueue>& commandQueue);
 	std::shared_ptr<DXTexture>& GetTexture() { return m_DXTexture; }
 
 	std::shared_ptr<DXPointCloud>& GetPointCloudMesh() { return m_pDXPointCloud; }
@@ -68,11 +77,30 @@ public:
 	void SetReceiveShadow(bool bReceiveShadow);
 	bool GetReceiveShadow() { return m_bReceiveShadow;  }
 
+	//run the vertex cache / overdraw / vertex fetch optimizer on meshes loaded after this call
+	void SetOptimizeMesh(bool bOptimize) { m_bOptimizeMesh = bOptimize; }
+	bool GetOptimizeMesh() { return m_bOptimizeMesh; }
+
+	//vertex buffer layout of meshes loaded after this call.  Render picks the pso with the matching input layout.
+	void SetVertexFormat(MeshVertexFormat format) { m_VertexFormat = format; }
+	MeshVertexFormat GetVertexFormat() { return m_VertexFormat; }
+
+	//levels of detail built for meshes loaded after this call (1 = full mesh only, see DXMesh::SetLODCount).  Render
+	//draws the coarsest level whose error projects to at most lodPixelError pixels.
+	void SetLODCount(UINT numLODs) { m_LODCount = numLODs; }
+	void SetLODPixelError(float lodPixelError) { m_fLODPixelError = lodPixelError; }
+
 protected:
 	void CreateD3DResources(ComPtr<ID3D12CommandQueue> & commandQueue);
 	void CreatePipelineState();
+	void CreatePipelineState(MeshVertexFormat format, ComPtr<ID3D12PipelineState>& pPipelineState);
+	ID3D12PipelineState* GetMeshPipelineState();
+	void SelectLOD();
 	void CreatePointCloudPipelineState();
+	void CreatePointCloudPipelineState(PointVertexFormat format, ComPtr<ID3D12PipelineState>& pPipelineState);
 	void CreatePointCloudSpritePipelineState();
+	void CreatePointCloudSpritePipelineState(PointVertexFormat format, ComPtr<ID3D12PipelineState>& pPipelineState);
+	ID3D12PipelineState* GetPointCloudPipelineState();
 	void CreateRootSignature();
 	void CreatePointCloudSpriteRootSignature();
 
@@ -83,8 +111,14 @@ protected:
 	int m_cbDescriptorIndex;
 
 	static ComPtr<ID3D12PipelineState> m_pPipelineState;
+	static ComPtr<ID3D12PipelineState> m_pCompact16PipelineState; //kMeshVertexFormatCompact16 meshes
+	static ComPtr<ID3D12PipelineState> m_pCompact12PipelineState; //kMeshVertexFormatCompact12 meshes
 	static ComPtr<ID3D12PipelineState> m_pPointCloudPipelineState;
+	static ComPtr<ID3D12PipelineState> m_pPointCloudCompact12PipelineState; //kPointVertexFormatCompact12 clouds
+	static ComPtr<ID3D12PipelineState> m_pPointCloudCompact8PipelineState;  //kPointVertexFormatCompact8 clouds
 	static ComPtr<ID3D12PipelineState> m_pPointCloudSpritePipelineState;
+	static ComPtr<ID3D12PipelineState> m_pPointCloudSpriteCompact12PipelineState;
+	static ComPtr<ID3D12PipelineState> m_pPointCloudSpriteCompact8PipelineState;
 
 	static ComPtr<ID3D12RootSignature> m_pRootSignature;
 	static ComPtr<ID3D12RootSignature> m_pPointCloudSpriteRootSignature;
@@ -98,8 +132,13 @@ protected:
 	XMMATRIX     m_WorldMatrix;
 
 	std::shared_ptr<DXTexture> m_DXTexture;
+	std::vector< std::shared_ptr<DXTexture> > m_MaterialTextures; //per material index, nullptr uses m_DXTexture
 	uint32_t m_ModelID;
 	bool m_bReceiveShadow;
+	bool m_bOptimizeMesh;
+	MeshVertexFormat m_VertexFormat;
+	UINT m_LODCount;
+	float m_fLODPixelError;
 	DXCamera* m_pDXCamera;
 	
 public:
@@ -0,0 +1,676 @@
+#include "stdafx.h"
+#include "DXObjParser.h"
+#include "DXMemoryMappedFile.h"
+#include "DXParallel.h"
+
+#include <stdio.h>
+#include <string>
+#include <cstring>
+#include <charconv>
+#include <fstream>
+#include <algorithm>
+#include <map>
+
+#ifdef TINYOBJLOADER_IMPLEMENTATION
+#undef TINYOBJLOADER_IMPLEMENTATION
+#endif
+#include <tiny_obj_loader.h>
+
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	enum ObjRecord
+	{
+		kRecordOther,
+		kRecordPosition,
+		kRecordUV,
+		kRecordNormal,
+		kRecordFace,
+		kRecordMaterialLibrary,
+		kRecordUseMaterial
+	};
+
+	// chunks are only worth a thread when they hold a reasonable amount of text
+	const size_t kMinChunkBytes = 256 * 1024;
+	const size_t kChunksPerThread = 4;
+
+	//A line aligned slice of the file.  The counts come from the counting pass, the bases are the prefix sums
+	//of the counts of all earlier chunks.
+	struct ObjChunk
+	{
+		const char* pBegin;
+		const char* pEnd;
+
+		size_t numLines;
+		size_t numPositions;
+		size_t numUVs;
+		size_t numNormals;
+		size_t numCorners;
+
+		size_t firstLine;
+		size_t positionBase;
+		size_t uvBase;
+		size_t normalBase;
+		size_t cornerBase;
+
+		const char* pError; //first error in this chunk, nullptr if none
+		size_t errorLine;   //1 based line number inside the chunk
+		std::string materialLibrary;
+
+		//usemtl records of this chunk, the first corner they apply to (relative to cornerBase) and the name
+		std::vector< std::pair< size_t, std::string > > materialSwitches;
+	};
+
+	inline bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+	inline const char* SkipBlanks(const char* p, const char* pEnd)
+	{
+		while (p < pEnd && IsBlank(*p))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	inline const char* FindLineEnd(const char* p, const char* pEnd)
+	{
+		const char* pEol = static_cast<const char*>(memchr(p, '\n', pEnd - p));
+		return pEol ? pEol : pEnd;
+	}
+
+	//classify a line by its keyword.  pData is set to the first character after the keyword.
+	inline ObjRecord GetRecordType(const char* p, const char* pLineEnd, const char*& pData)
+	{
+		if (pLineEnd - p < 2)
+			return kRecordOther;
+
+		if (p[0] == 'v')
+		{
+			if (IsBlank(p[1]))
+			{
+				pData = p + 2;
+				return kRecordPosition;
+			}
+
+			if (pLineEnd - p >= 3 && IsBlank(p[2]))
+			{
+				pData = p + 3;
+				if (p[1] == 't')
+					return kRecordUV;
+				if (p[1] == 'n')
+					return kRecordNormal;
+			}
+		}
+		else if (p[0] == 'f' && IsBlank(p[1]))
+		{
+			pData = p + 2;
+			return kRecordFace;
+		}
+		else if (p[0] == 'm' && pLineEnd - p > 7 && memcmp(p, "mtllib", 6) == 0 && IsBlank(p[6]))
+		{
+			pData = p + 7;
+			return kRecordMaterialLibrary;
+		}
+		else if (p[0] == 'u' && pLineEnd - p > 7 && memcmp(p, "usemtl", 6) == 0 && IsBlank(p[6]))
+		{
+			pData = p + 7;
+			return kRecordUseMaterial;
+		}
+
+		return kRecordOther;
+	}
+
+	//the rest of the line without surrounding blanks
+	inline std::string ReadName(const char* pData, const char* pLineEnd)
+	{
+		const char* pName = SkipBlanks(pData, pLineEnd);
+		const char* pNameEnd = pLineEnd;
+		while (pNameEnd > pName && (IsBlank(pNameEnd[-1]) || pNameEnd[-1] == '\r'))
+		{
+			pNameEnd--;
+		}
+		return std::string(pName, pNameEnd);
+	}
+
+	//parse up to numValues floats.  missing values are left at 0 like an exporter that omits the w component.
+	inline void ParseFloats(const char* p, const char* pLineEnd, float* pValues, int numValues)
+	{
+		for (int i = 0; i < numValues; ++i)
+		{
+			pValues[i] = 0.0f;
+			p = SkipBlanks(p, pLineEnd);
+			const char* pNext = DXObjParser::ParseFloat(p, pLineEnd, pValues[i]);
+			if (pNext == nullptr)
+			{
+				pValues[i] = 0.0f;
+				return;
+			}
+			p = pNext;
+		}
+	}
+
+	//convert a 1 based (or negative relative) obj index into a 0 based index.  returns false if out of range.
+	inline bool ResolveIndex(int32_t index, size_t count, int32_t& resolved)
+	{
+		if (index > 0)
+			resolved = index - 1;
+		else if (index < 0)
+			resolved = static_cast<int32_t>(count) + index;
+		else
+			return false;
+
+		return resolved >= 0 && static_cast<size_t>(resolved) < count;
+	}
+
+	//number of triangle corners a face line produces after fan triangulation
+	inline size_t CountFaceCorners(const char* p, const char* pLineEnd)
+	{
+		size_t numVertices = 0;
+		while (true)
+		{
+			p = SkipBlanks(p, pLineEnd);
+			if (p >= pLineEnd || *p == '\r' || *p == '#')
+				break;
+
+			numVertices++;
+			while (p < pLineEnd && !IsBlank(*p) && *p != '\r')
+			{
+				p++;
+			}
+		}
+
+		return numVertices >= 3 ? (numVertices - 2) * 3 : 0;
+	}
+
+	void CountChunk(ObjChunk& chunk)
+	{
+		for (const char* p = chunk.pBegin; p < chunk.pEnd; )
+		{
+			const char* pLineEnd = FindLineEnd(p, chunk.pEnd);
+			const char* pData = nullptr;
+			chunk.numLines++;
+
+			switch (GetRecordType(SkipBlanks(p, pLineEnd), pLineEnd, pData))
+			{
+			case kRecordPosition: chunk.numPositions++; break;
+			case kRecordUV: chunk.numUVs++; break;
+			case kRecordNormal: chunk.numNormals++; break;
+			case kRecordFace: chunk.numCorners += CountFaceCorners(pData, pLineEnd); break;
+			default: break;
+			}
+
+			p = pLineEnd + 1;
+		}
+	}
+
+	inline bool SetChunkError(ObjChunk& chunk, const char* pError, size_t lineNumber)
+	{
+		chunk.pError = pError;
+		chunk.errorLine = lineNumber;
+		return false;
+	}
+
+	//parse the records of one chunk into its slice of out.  relative indices resolve against the prefix summed
+	//counts so a face can reference attributes from any earlier chunk.
+	bool ParseChunk(ObjChunk& chunk, ObjMeshData& out, bool bFlipWinding)
+	{
+		vec3* pPosition = out.positions.data() + chunk.positionBase;
+		vec2* pUV = out.uvs.data() + chunk.uvBase;
+		vec3* pNormal = out.normals.data() + chunk.normalBase;
+		ObjCorner* pCorner = out.corners.data() + chunk.cornerBase;
+
+		size_t positionCount = 0;
+		size_t uvCount = 0;
+		size_t normalCount = 0;
+		size_t cornerCount = 0;
+
+		std::vector< ObjCorner > polygon;
+		polygon.reserve(16);
+
+		size_t lineNumber = 0;
+		for (const char* p = chunk.pBegin; p < chunk.pEnd; )
+		{
+			const char* pLineEnd = FindLineEnd(p, chunk.pEnd);
+			const char* pData = nullptr;
+			lineNumber++;
+
+			switch (GetRecordType(SkipBlanks(p, pLineEnd), pLineEnd, pData))
+			{
+			case kRecordPosition:
+				ParseFloats(pData, pLineEnd, &pPosition[positionCount++].x, 3);
+				break;
+
+			case kRecordUV:
+				ParseFloats(pData, pLineEnd, &pUV[uvCount++].x, 2);
+				break;
+
+			case kRecordNormal:
+				ParseFloats(pData, pLineEnd, &pNormal[normalCount++].x, 3);
+				break;
+
+			case kRecordMaterialLibrary:
+				if (chunk.materialLibrary.empty())
+				{
+					chunk.materialLibrary = ReadName(pData, pLineEnd);
+				}
+				break;
+
+			case kRecordUseMaterial:
+				chunk.materialSwitches.push_back(std::make_pair(cornerCount, ReadName(pData, pLineEnd)));
+				break;
+
+			case kRecordFace:
+			{
+				polygon.clear();
+
+				const char* it = pData;
+				while (true)
+				{
+					it = SkipBlanks(it, pLineEnd);
+					if (it >= pLineEnd || *it == '\r' || *it == '#')
+						break;
+
+					int32_t vertexIndex = 0;
+					int32_t uvIndex = 0;
+					int32_t normalIndex = 0;
+
+					it = DXObjParser::ParseInt(it, pLineEnd, vertexIndex);
+					if (it == nullptr)
+						break;
+
+					if (it < pLineEnd && *it == '/')
+					{
+						it++;
+						if (it < pLineEnd && *it != '/')
+						{
+							it = DXObjParser::ParseInt(it, pLineEnd, uvIndex);
+							if (it == nullptr)
+								break;
+						}
+
+						if (it < pLineEnd && *it == '/')
+						{
+							it++;
+							it = DXObjParser::ParseInt(it, pLineEnd, normalIndex);
+							if (it == nullptr)
+								break;
+						}
+					}
+
+					ObjCorner corner = { -1, -1, -1 };
+					bool bValid = ResolveIndex(vertexIndex, chunk.positionBase + positionCount, corner.v);
+					if (uvIndex != 0)
+						bValid = bValid && ResolveIndex(uvIndex, chunk.uvBase + uvCount, corner.vt);
+					if (normalIndex != 0)
+						bValid = bValid && ResolveIndex(normalIndex, chunk.normalBase + normalCount, corner.vn);
+
+					if (!bValid)
+						return SetChunkError(chunk, "face index out of range", lineNumber);
+
+					polygon.push_back(corner);
+				}
+
+				size_t numFaceCorners = polygon.size() >= 3 ? (polygon.size() - 2) * 3 : 0;
+				if (it == nullptr || numFaceCorners == 0 || cornerCount + numFaceCorners > chunk.numCorners)
+					return SetChunkError(chunk, "face can't be read by our parser", lineNumber);
+
+				// fan triangulate polygons.  a triangle produces exactly one entry.
+				for (size_t i = 2; i < polygon.size(); ++i)
+				{
+					pCorner[cornerCount++] = polygon[0];
+					if (bFlipWinding)
+					{
+						pCorner[cornerCount++] = polygon[i];
+						pCorner[cornerCount++] = polygon[i - 1];
+					}
+					else
+					{
+						pCorner[cornerCount++] = polygon[i - 1];
+						pCorner[cornerCount++] = polygon[i];
+					}
+				}
+				break;
+			}
+
+			default:
+				break;
+			}
+
+			p = pLineEnd + 1;
+		}
+
+		return true;
+	}
+}
+
+namespace DXObjParser
+{
+	const char* ParseFloat(const char* p, const char* pEnd, float& value)
+	{
+		if (p < pEnd && *p == '+')
+		{
+			p++;
+		}
+
+		std::from_chars_result result = std::from_chars(p, pEnd, value);
+		if (result.ptr == p)
+		{
+			return nullptr;
+		}
+
+		return result.ptr;
+	}
+
+	const char* ParseInt(const char* p, const char* pEnd, int32_t& value)
+	{
+		bool bNegative = false;
+		if (p < pEnd && (*p == '-' || *p == '+'))
+		{
+			bNegative = (*p == '-');
+			p++;
+		}
+
+		// the digits are summed in 64 bits, an index that does not fit in 32 bits fails instead of wrapping around
+		const char* pDigits = p;
+		int64_t result = 0;
+		while (p < pEnd && *p >= '0' && *p <= '9')
+		{
+			result = result * 10 + (*p - '0');
+			if (result > INT32_MAX)
+			{
+				return nullptr;
+			}
+			p++;
+		}
+
+		if (p == pDigits)
+		{
+			return nullptr;
+		}
+
+		value = static_cast<int32_t>(bNegative ? -result : result);
+		return p;
+	}
+
+	bool ParseFile(const char* path, ObjMeshData& out, bool bFlipWinding, uint32_t numThreads)
+	{
+		DXMemoryMappedFile file;
+		if (!file.Open(path))
+		{
+			printf("Failed to open OBJ file %s\n", path);
+			return false;
+		}
+
+		return ParseBuffer(file.GetData(), file.GetEnd(), out, bFlipWinding, numThreads);
+	}
+
+	bool ParseBuffer(const char* pBegin, const char* pEnd, ObjMeshData& out, bool bFlipWinding, uint32_t numThreads)
+	{
+		out.positions.clear();
+		out.uvs.clear();
+		out.normals.clear();
+		out.corners.clear();
+		out.materialLibrary.clear();
+		out.materials.clear();
+		out.materialRuns.clear();
+
+		if (numThreads == 0)
+		{
+			numThreads = DXParallel::GetWorkerCount();
+		}
+
+		// Split the file at line boundaries.  Small files end up in one chunk.
+		size_t fileSize = static_cast<size_t>(pEnd - pBegin);
+		size_t numChunks = std::min< size_t >(numThreads * kChunksPerThread, fileSize / kMinChunkBytes);
+		numChunks = std::max< size_t >(numChunks, 1);
+
+		std::vector< ObjChunk > chunks;
+		chunks.reserve(numChunks);
+
+		const char* pChunkBegin = pBegin;
+		for (size_t i = 1; i <= numChunks && pChunkBegin < pEnd; ++i)
+		{
+			const char* pChunkEnd = pEnd;
+			if (i < numChunks)
+			{
+				pChunkEnd = std::max(pChunkBegin, pBegin + fileSize / numChunks * i);
+				pChunkEnd = std::min(FindLineEnd(pChunkEnd, pEnd) + 1, pEnd);
+			}
+
+			ObjChunk chunk = {};
+			chunk.pBegin = pChunkBegin;
+			chunk.pEnd = pChunkEnd;
+			chunks.push_back(chunk);
+
+			pChunkBegin = pChunkEnd;
+		}
+
+		// Counting pass, one task per chunk
+		DXParallel::ParallelFor(chunks.size(), [&](size_t i) { CountChunk(chunks[i]); }, numThreads);
+
+		// The prefix sums give every chunk the place of its first line and record in the final arrays
+		size_t numLines = 0;
+		size_t numPositions = 0;
+		size_t numUVs = 0;
+		size_t numNormals = 0;
+		size_t numCorners = 0;
+
+		for (ObjChunk& chunk : chunks)
+		{
+			chunk.firstLine = numLines;
+			chunk.positionBase = numPositions;
+			chunk.uvBase = numUVs;
+			chunk.normalBase = numNormals;
+			chunk.cornerBase = numCorners;
+
+			numLines += chunk.numLines;
+			numPositions += chunk.numPositions;
+			numUVs += chunk.numUVs;
+			numNormals += chunk.numNormals;
+			numCorners += chunk.numCorners;
+		}
+
+		out.positions.resize(numPositions);
+		out.uvs.resize(numUVs);
+		out.normals.resize(numNormals);
+		out.corners.resize(numCorners);
+
+		// Parsing pass.  Every chunk writes its own slice of the arrays, so the result does not depend on the
+		// number of chunks and matches a serial parse bit for bit.
+		DXParallel::ParallelFor(chunks.size(), [&](size_t i) { ParseChunk(chunks[i], out, bFlipWinding); }, numThreads);
+
+		// report the first error in file order
+		for (const ObjChunk& chunk : chunks)
+		{
+			if (chunk.pError)
+			{
+				printf("OBJ %s on line %zu\n", chunk.pError, chunk.firstLine + chunk.errorLine);
+				return false;
+			}
+		}
+
+		for (const ObjChunk& chunk : chunks)
+		{
+			if (!chunk.materialLibrary.empty())
+			{
+				out.materialLibrary = chunk.materialLibrary;
+				break;
+			}
+		}
+
+		// number the usemtl names in order of first use and turn the switches into runs of triangles
+		std::map< std::string, uint32_t > materialIndices;
+		for (const ObjChunk& chunk : chunks)
+		{
+			for (const std::pair< size_t, std::string >& materialSwitch : chunk.materialSwitches)
+			{
+				auto inserted = materialIndices.insert(std::make_pair(materialSwitch.second, static_cast<uint32_t>(out.materials.size())));
+				if (inserted.second)
+				{
+					out.materials.push_back(materialSwitch.second);
+				}
+
+				ObjMaterialRun run = { static_cast<uint32_t>((chunk.cornerBase + materialSwitch.first) / 3), inserted.first->second };
+
+				// a switch without faces in between only changes the material of the next run
+				if (!out.materialRuns.empty() && out.materialRuns.back().firstTriangle == run.firstTriangle)
+				{
+					out.materialRuns.back().material = run.material;
+				}
+				else if (out.materialRuns.empty() || out.materialRuns.back().material != run.material)
+				{
+					out.materialRuns.push_back(run);
+				}
+			}
+		}
+
+		if (!out.materialRuns.empty() && out.materialRuns.front().firstTriangle > 0)
+		{
+			auto inserted = materialIndices.insert(std::make_pair(std::string(), static_cast<uint32_t>(out.materials.size())));
+			if (inserted.second)
+			{
+				out.materials.push_back(std::string());
+			}
+
+			ObjMaterialRun run = { 0, inserted.first->second };
+			out.materialRuns.insert(out.materialRuns.begin(), run);
+		}
+
+		return true;
+	}
+
+	void SortByMaterial(const ObjMeshData& data, std::vector< uint32_t >& indices, std::vector< ObjSubset >& out_subsets)
+	{
+		out_subsets.clear();
+
+		const size_t numTriangles = indices.size() / 3;
+		const size_t numMaterials = std::max< size_t >(data.materials.size(), 1);
+
+		// counting sort of the runs by material, a run keeps its triangles in file order
+		std::vector< size_t > materialTriangles(numMaterials, 0);
+		for (size_t i = 0; i < data.materialRuns.size(); ++i)
+		{
+			size_t runEnd = i + 1 < data.materialRuns.size() ? data.materialRuns[i + 1].firstTriangle : numTriangles;
+			materialTriangles[data.materialRuns[i].material] += runEnd - data.materialRuns[i].firstTriangle;
+		}
+
+		if (data.materialRuns.empty())
+		{
+			materialTriangles[0] = numTriangles;
+		}
+
+		std::vector< size_t > materialOffsets(numMaterials, 0);
+		size_t startIndex = 0;
+		for (size_t material = 0; material < numMaterials; ++material)
+		{
+			materialOffsets[material] = startIndex;
+			if (materialTriangles[material] > 0)
+			{
+				ObjSubset subset = { static_cast<uint32_t>(startIndex), static_cast<uint32_t>(materialTriangles[material] * 3),
+					static_cast<uint32_t>(material) };
+				out_subsets.push_back(subset);
+			}
+			startIndex += materialTriangles[material] * 3;
+		}
+
+		if (out_subsets.size() <= 1)
+			return;
+
+		std::vector< uint32_t > sorted(indices.size());
+		for (size_t i = 0; i < data.materialRuns.size(); ++i)
+		{
+			size_t runBegin = data.materialRuns[i].firstTriangle * 3;
+			size_t runEnd = i + 1 < data.materialRuns.size() ? data.materialRuns[i + 1].firstTriangle * 3 : numTriangles * 3;
+
+			size_t& offset = materialOffsets[data.materialRuns[i].material];
+			std::copy(indices.begin() + runBegin, indices.begin() + runEnd, sorted.begin() + offset);
+			offset += runEnd - runBegin;
+		}
+
+		indices.swap(sorted);
+	}
+
+	bool ParseMaterialLibrary(const char* path, std::vector< ObjMaterial >& out_materials)
+	{
+		out_materials.clear();
+
+		std::ifstream mtlFile(path);
+		if (!mtlFile)
+			return false;
+
+		std::vector< tinyobj::material_t > materials;
+		std::map< std::string, int > materialMap;
+		std::string warning;
+		tinyobj::LoadMtl(&materialMap, &materials, &mtlFile, &warning);
+
+		for (const tinyobj::material_t& material : materials)
+		{
+			ObjMaterial objMaterial;
+			objMaterial.name = material.name;
+			objMaterial.diffuse = XMFLOAT3(material.diffuse[0], material.diffuse[1], material.diffuse[2]);
+			objMaterial.diffuseTexture = material.diffuse_texname;
+			out_materials.push_back(objMaterial);
+		}
+
+		return true;
+	}
+
+	void ExpandCorners(const ObjMeshData& data,
+		std::vector< vec3 >& out_vertices,
+		std::vector< vec2 >& out_uvs,
+		std::vector< vec3 >& out_normals)
+	{
+		const size_t numCorners = data.corners.size();
+
+		out_vertices.resize(numCorners);
+		out_uvs.resize(numCorners);
+		out_normals.resize(numCorners);
+
+		const vec2 zeroUV = { 0.0f, 0.0f };
+		const vec3 zeroNormal = { 0.0f, 0.0f, 0.0f };
+
+		for (size_t i = 0; i < numCorners; ++i)
+		{
+			const ObjCorner& corner = data.corners[i];
+
+			out_vertices[i] = data.positions[corner.v];
+			out_uvs[i] = corner.vt >= 0 ? data.uvs[corner.vt] : zeroUV;
+			out_normals[i] = corner.vn >= 0 ? data.normals[corner.vn] : zeroNormal;
+		}
+	}
+
+	void ExpandCorners(const ObjMeshData& data, std::vector< MeshVertexPosNormUV0 >& out_vertices)
+	{
+		out_vertices.resize(data.corners.size());
+		ExpandCorners(data, out_vertices.data());
+	}
+
+	void ExpandCorners(const ObjMeshData& data, MeshVertexPosNormUV0* pOutVertices)
+	{
+		const size_t numCorners = data.corners.size();
+
+		for (size_t i = 0; i < numCorners; ++i)
+		{
+			const ObjCorner& corner = data.corners[i];
+			const vec3& position = data.positions[corner.v];
+
+			MeshVertexPosNormUV0& vertex = pOutVertices[i];
+			vertex.position = XMFLOAT3(position.x, position.y, position.z);
+			vertex.normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			vertex.uv = XMFLOAT2(0.0f, 0.0f);
+
+			if (corner.vn >= 0)
+			{
+				const vec3& normal = data.normals[corner.vn];
+				vertex.normal = XMFLOAT3(normal.x, normal.y, normal.z);
+			}
+
+			if (corner.vt >= 0)
+			{
+				const vec2& uv = data.uvs[corner.vt];
+				vertex.uv = XMFLOAT2(uv.x, uv.y);
+			}
+		}
+	}
+}
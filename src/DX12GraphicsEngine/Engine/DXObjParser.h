@@ -0,0 +1,91 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include <vector>
+#include <string>
+
+//Indices of one triangle corner into the position, uv and normal arrays of an ObjMeshData.  Indices are zero
+//based and already resolved (negative obj indices are relative to the end of the array).  -1 means the face
+//did not reference that attribute.
+struct ObjCorner
+{
+	int32_t v;
+	int32_t vt;
+	int32_t vn;
+};
+
+//The triangles from firstTriangle up to the next run use material (an index into ObjMeshData::materials)
+struct ObjMaterialRun
+{
+	uint32_t firstTriangle;
+	uint32_t material;
+};
+
+//A contiguous range of an index list drawn with one material
+struct ObjSubset
+{
+	uint32_t startIndex;
+	uint32_t indexCount;
+	uint32_t material;
+};
+
+//The parts of a mtl material the engine uses
+struct ObjMaterial
+{
+	std::string name;
+	DirectX::XMFLOAT3 diffuse = { 1.0f, 1.0f, 1.0f };
+	std::string diffuseTexture; //map_Kd as written in the mtl file, empty if there is none
+};
+
+//Raw indexed data of an obj file.  corners holds 3 entries per triangle.  Polygons are fan triangulated.
+struct ObjMeshData
+{
+	std::vector< DXGraphicsUtilities::vec3 > positions;
+	std::vector< DXGraphicsUtilities::vec2 > uvs;
+	std::vector< DXGraphicsUtilities::vec3 > normals;
+	std::vector< ObjCorner > corners;
+	std::string materialLibrary; //file name of the first mtllib record, empty if there is none
+
+	//usemtl names in order of first use and the runs of triangles using them.  both are empty if the file has no
+	//usemtl record.  triangles before the first usemtl get a material with an empty name.
+	std::vector< std::string > materials;
+	std::vector< ObjMaterialRun > materialRuns;
+
+	size_t GetTriangleCount() const { return corners.size() / 3; }
+};
+
+//Obj tokenizer that works directly on a memory mapped view of the file.  There are no per line string copies,
+//numbers are converted with from_chars and the attribute arrays are sized by a counting pass before they are
+//filled, so peak memory is the mapped file plus the final arrays.
+//Large files are split at line boundaries and both passes run on numThreads threads (0 = all cores).  The prefix
+//sums of the per chunk counts place every chunk's records in the final arrays, so the output is identical for
+//any thread count.
+namespace DXObjParser
+{
+	bool ParseFile(const char* path, ObjMeshData& out, bool bFlipWinding, uint32_t numThreads = 0);
+	bool ParseBuffer(const char* pBegin, const char* pEnd, ObjMeshData& out, bool bFlipWinding, uint32_t numThreads = 0);
+
+	//de-index the triangle corners into 3 vertices per triangle.  this is the layout DXMesh::LoadOBJ returns.
+	void ExpandCorners(const ObjMeshData& data,
+		std::vector< DXGraphicsUtilities::vec3 >& out_vertices,
+		std::vector< DXGraphicsUtilities::vec2 >& out_uvs,
+		std::vector< DXGraphicsUtilities::vec3 >& out_normals);
+
+	//same as above but interleaved into the vertex layout used by DXMesh and the DXR models
+	void ExpandCorners(const ObjMeshData& data, std::vector< DXGraphicsUtilities::MeshVertexPosNormUV0 >& out_vertices);
+	//into a caller provided array of data.corners.size() vertices, e.g. load time scratch memory
+	void ExpandCorners(const ObjMeshData& data, DXGraphicsUtilities::MeshVertexPosNormUV0* pOutVertices);
+
+	//reorder the triangles of an index list with one entry per corner of data (e.g. the welded indices) so every
+	//material is contiguous.  the order inside a material is kept.  out_subsets gets one entry per used material in
+	//material order, a file without usemtl gives a single subset with material 0.
+	void SortByMaterial(const ObjMeshData& data, std::vector< uint32_t >& indices, std::vector< ObjSubset >& out_subsets);
+
+	//read newmtl, Kd and map_Kd from a mtl file.  returns false if the file can't be opened.
+	bool ParseMaterialLibrary(const char* path, std::vector< ObjMaterial >& out_materials);
+
+	//number conversion used by the tokenizer.  return the position after the number or nullptr if no number was found.
+	//ParseInt also returns nullptr for a number that does not fit in 32 bits, the face is then rejected.
+	const char* ParseFloat(const char* p, const char* pEnd, float& value);
+	const char* ParseInt(const char* p, const char* pEnd, int32_t& value);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+//Minimal fork/join helpers for the CPU side asset pipeline.  Work items are pulled from a shared counter so
+//uneven items balance across threads.  The calling thread takes part in the work, so a single worker runs
+//everything inline without creating a thread.
+namespace DXParallel
+{
+	//smallest range of points ParallelForRange should hand to a thread, a smaller one costs more to schedule than
+	//it saves.  shared by the point cloud passes so they split their work the same way.
+	const size_t kMinRangePoints = 64 * 1024;
+
+	//number of threads to use when the caller passes 0
+	inline uint32_t GetWorkerCount()
+	{
+		uint32_t numThreads = std::thread::hardware_concurrency();
+		return numThreads > 0 ? numThreads : 1;
+	}
+
+	//call func(i) for every i in [0, numItems).  blocks until all items are done.
+	template< typename Func >
+	void ParallelFor(size_t numItems, Func func, uint32_t numThreads = 0)
+	{
+		if (numItems == 0)
+			return;
+
+		if (numThreads == 0)
+		{
+			numThreads = GetWorkerCount();
+		}
+
+		size_t numWorkers = std::min< size_t >(numThreads, numItems);
+
+		std::atomic< size_t > nextItem(0);
+		auto worker = [&]()
+		{
+			for (size_t i = nextItem++; i < numItems; i = nextItem++)
+			{
+				func(i);
+			}
+		};
+
+		std::vector< std::thread > threads;
+		threads.reserve(numWorkers - 1);
+		for (size_t t = 1; t < numWorkers; ++t)
+		{
+			threads.emplace_back(worker);
+		}
+
+		worker();
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	//split [0, numItems) into contiguous ranges of at least minRangeSize and call func(begin, end) for each range
+	template< typename Func >
+	void ParallelForRange(size_t numItems, size_t minRangeSize, Func func, uint32_t numThreads = 0)
+	{
+		if (numItems == 0)
+			return;
+
+		if (numThreads == 0)
+		{
+			numThreads = GetWorkerCount();
+		}
+
+		size_t rangeSize = std::max< size_t >(minRangeSize, (numItems + numThreads * 4 - 1) / (numThreads * 4));
+		size_t numRanges = (numItems + rangeSize - 1) / rangeSize;
+
+		ParallelFor(numRanges, [&](size_t range)
+		{
+			size_t begin = range * rangeSize;
+			func(begin, std::min(begin + rangeSize, numItems));
+		}, numThreads);
+	}
+}
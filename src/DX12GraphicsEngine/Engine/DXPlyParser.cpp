@@ -0,0 +1,925 @@
+#include "stdafx.h"
+#include "DXPlyParser.h"
+#include "DXObjParser.h"
+#include "DXMemoryMappedFile.h"
+#include "DXParallel.h"
+
+#include <stdio.h>
+#include <cstring>
+#include <algorithm>
+
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	// a range of records or a chunk of text is only worth a thread when it is a reasonable amount of data
+	const size_t kMinRangeRecords = 64 * 1024;
+	const size_t kMinChunkBytes = 256 * 1024;
+	const size_t kChunksPerThread = 4;
+	const size_t kWriteBatchPoints = 64 * 1024;
+
+	//the vertex properties the engine uses, each read from one property of the record
+	enum PlyChannel
+	{
+		kChannelX, kChannelY, kChannelZ,
+		kChannelRed, kChannelGreen, kChannelBlue, kChannelAlpha,
+		kChannelNX, kChannelNY, kChannelNZ,
+		kChannelIntensity,
+		kNumChannels
+	};
+
+	const char* const kChannelNames[kNumChannels][2] =
+	{
+		{ "x", "x" }, { "y", "y" }, { "z", "z" },
+		{ "red", "r" }, { "green", "g" }, { "blue", "b" }, { "alpha", "a" },
+		{ "nx", "nx" }, { "ny", "ny" }, { "nz", "nz" },
+		{ "intensity", "scalar_intensity" }
+	};
+
+	struct ChannelSource
+	{
+		int property = -1;          //index into the properties of the element, -1 if the file does not have it
+		uint32_t offset = 0;
+		PlyType type = kPlyTypeInvalid;
+		float scale = 1.0f;
+	};
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	inline const char* SkipSpace(const char* p, const char* pEnd)
+	{
+		while (p < pEnd && IsSpace(*p))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	inline const char* SkipToken(const char* p, const char* pEnd)
+	{
+		while (p < pEnd && !IsSpace(*p))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	//next whitespace separated word of a header line
+	bool NextWord(const char*& p, const char* pEnd, std::string& out_word)
+	{
+		p = SkipSpace(p, pEnd);
+		const char* pWord = p;
+		p = SkipToken(p, pEnd);
+		out_word.assign(pWord, p);
+		return !out_word.empty();
+	}
+
+	PlyType ParseType(const std::string& name)
+	{
+		if (name == "char" || name == "int8") return kPlyTypeInt8;
+		if (name == "uchar" || name == "uint8") return kPlyTypeUInt8;
+		if (name == "short" || name == "int16") return kPlyTypeInt16;
+		if (name == "ushort" || name == "uint16") return kPlyTypeUInt16;
+		if (name == "int" || name == "int32") return kPlyTypeInt32;
+		if (name == "uint" || name == "uint32") return kPlyTypeUInt32;
+		if (name == "float" || name == "float32") return kPlyTypeFloat32;
+		if (name == "double" || name == "float64") return kPlyTypeFloat64;
+		return kPlyTypeInvalid;
+	}
+
+	//scale from a color of this type to 0..255
+	float GetColorScale(PlyType type)
+	{
+		switch (type)
+		{
+		case kPlyTypeInt8: return 255.0f / 127.0f;
+		case kPlyTypeInt16: return 255.0f / 32767.0f;
+		case kPlyTypeUInt16: return 255.0f / 65535.0f;
+		case kPlyTypeInt32: return 255.0f / 2147483647.0f;
+		case kPlyTypeUInt32: return 255.0f / 4294967295.0f;
+		case kPlyTypeFloat32:
+		case kPlyTypeFloat64: return 255.0f;
+		default: return 1.0f;
+		}
+	}
+
+	template< bool bSwap >
+	inline float ReadBinaryValue(const uint8_t* p, PlyType type)
+	{
+		uint8_t bytes[8];
+		uint32_t size = DXPlyParser::GetTypeSize(type);
+		if (bSwap)
+		{
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				bytes[i] = p[size - 1 - i];
+			}
+		}
+		else
+		{
+			memcpy(bytes, p, size);
+		}
+
+		switch (type)
+		{
+		case kPlyTypeInt8: return static_cast<float>(*reinterpret_cast<const int8_t*>(bytes));
+		case kPlyTypeUInt8: return static_cast<float>(bytes[0]);
+		case kPlyTypeInt16: { int16_t v; memcpy(&v, bytes, 2); return static_cast<float>(v); }
+		case kPlyTypeUInt16: { uint16_t v; memcpy(&v, bytes, 2); return static_cast<float>(v); }
+		case kPlyTypeInt32: { int32_t v; memcpy(&v, bytes, 4); return static_cast<float>(v); }
+		case kPlyTypeUInt32: { uint32_t v; memcpy(&v, bytes, 4); return static_cast<float>(v); }
+		case kPlyTypeFloat32: { float v; memcpy(&v, bytes, 4); return v; }
+		case kPlyTypeFloat64: { double v; memcpy(&v, bytes, 8); return static_cast<float>(v); }
+		default: return 0.0f;
+		}
+	}
+
+	inline uint32_t ReadListCount(const uint8_t* p, PlyType type, bool bSwap)
+	{
+		float count = bSwap ? ReadBinaryValue< true >(p, type) : ReadBinaryValue< false >(p, type);
+		return count > 0.0f ? static_cast<uint32_t>(count) : 0;
+	}
+
+	//walks the records of an element with lists, returns the end of the element or nullptr if the data ends first.
+	//pRecordStarts gets the start of every record when it is set.
+	const uint8_t* WalkBinaryElement(const PlyElement& element, const uint8_t* p, const uint8_t* pEnd, bool bSwap,
+		std::vector< const uint8_t* >* pRecordStarts)
+	{
+		if (element.recordSize > 0)
+		{
+			if (static_cast<size_t>(pEnd - p) / element.recordSize < element.count)
+				return nullptr;
+			return p + element.count * element.recordSize;
+		}
+
+		for (size_t i = 0; i < element.count; ++i)
+		{
+			if (pRecordStarts)
+			{
+				pRecordStarts->push_back(p);
+			}
+
+			for (const PlyProperty& property : element.properties)
+			{
+				if (property.IsList())
+				{
+					uint32_t countSize = DXPlyParser::GetTypeSize(property.listCountType);
+					if (static_cast<size_t>(pEnd - p) < countSize)
+						return nullptr;
+
+					uint32_t count = ReadListCount(p, property.listCountType, bSwap);
+					p += countSize;
+
+					size_t listSize = static_cast<size_t>(count) * DXPlyParser::GetTypeSize(property.type);
+					if (static_cast<size_t>(pEnd - p) < listSize)
+						return nullptr;
+					p += listSize;
+				}
+				else
+				{
+					uint32_t size = DXPlyParser::GetTypeSize(property.type);
+					if (static_cast<size_t>(pEnd - p) < size)
+						return nullptr;
+					p += size;
+				}
+			}
+		}
+
+		return p;
+	}
+
+	//the offsets of an element with a list are only known per record, they are found again for every record
+	void FindRecordOffsets(const PlyElement& element, const uint8_t* pRecord, bool bSwap, uint32_t* pOffsets)
+	{
+		uint32_t offset = 0;
+		for (size_t i = 0; i < element.properties.size(); ++i)
+		{
+			const PlyProperty& property = element.properties[i];
+			pOffsets[i] = offset;
+
+			if (property.IsList())
+			{
+				uint32_t count = ReadListCount(pRecord + offset, property.listCountType, bSwap);
+				offset += DXPlyParser::GetTypeSize(property.listCountType) + count * DXPlyParser::GetTypeSize(property.type);
+			}
+			else
+			{
+				offset += DXPlyParser::GetTypeSize(property.type);
+			}
+		}
+	}
+
+	void FindChannels(const PlyElement& element, ChannelSource* pChannels)
+	{
+		for (int c = 0; c < kNumChannels; ++c)
+		{
+			pChannels[c] = ChannelSource();
+
+			for (int name = 0; name < 2 && pChannels[c].property < 0; ++name)
+			{
+				int property = element.FindProperty(kChannelNames[c][name]);
+				if (property >= 0 && !element.properties[property].IsList())
+				{
+					pChannels[c].property = property;
+					pChannels[c].offset = element.properties[property].offset;
+					pChannels[c].type = element.properties[property].type;
+					pChannels[c].scale = (c >= kChannelRed && c <= kChannelAlpha) ? GetColorScale(pChannels[c].type) : 1.0f;
+				}
+			}
+		}
+	}
+
+	void ResizeOutput(const ChannelSource* pChannels, size_t numPoints, PlyPointData& out)
+	{
+		out.positions.resize(numPoints);
+		out.colors.resize(numPoints);
+		out.normals.resize(pChannels[kChannelNX].property >= 0 ? numPoints : 0);
+		out.intensities.resize(pChannels[kChannelIntensity].property >= 0 ? numPoints : 0);
+	}
+
+	//one record of channel values into the output arrays.  missing colors are 255.
+	inline void StorePoint(const float* pValues, const ChannelSource* pChannels, size_t i, PlyPointData& out)
+	{
+		out.positions[i] = vec3{ pValues[kChannelX], pValues[kChannelY], pValues[kChannelZ] };
+
+		float rgba[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			rgba[c] = pChannels[kChannelRed + c].property >= 0 ? pValues[kChannelRed + c] * pChannels[kChannelRed + c].scale : 255.0f;
+		}
+		out.colors[i] = vec4{ rgba[0], rgba[1], rgba[2], rgba[3] };
+
+		if (!out.normals.empty())
+		{
+			out.normals[i] = vec3{ pValues[kChannelNX], pValues[kChannelNY], pValues[kChannelNZ] };
+		}
+
+		if (!out.intensities.empty())
+		{
+			out.intensities[i] = pValues[kChannelIntensity];
+		}
+	}
+
+	//one property of a range of fixed size records into every outStride'th float of pOut
+	template< typename T, bool bSwap >
+	void ConvertColumn(const uint8_t* pSource, size_t recordSize, size_t count, float scale, float* pOut, size_t outStride)
+	{
+		for (size_t i = 0; i < count; ++i, pSource += recordSize, pOut += outStride)
+		{
+			uint8_t bytes[sizeof(T)];
+			for (size_t b = 0; b < sizeof(T); ++b)
+			{
+				bytes[b] = pSource[bSwap ? sizeof(T) - 1 - b : b];
+			}
+
+			T value;
+			memcpy(&value, bytes, sizeof(T));
+			*pOut = static_cast<float>(value) * scale;
+		}
+	}
+
+	template< bool bSwap >
+	void ConvertColumn(const ChannelSource& channel, const uint8_t* pRecords, size_t recordSize, size_t count, float* pOut, size_t outStride)
+	{
+		const uint8_t* pSource = pRecords + channel.offset;
+		switch (channel.type)
+		{
+		case kPlyTypeInt8: ConvertColumn< int8_t, bSwap >(pSource, recordSize, count, channel.scale, pOut, outStride); break;
+		case kPlyTypeUInt8: ConvertColumn< uint8_t, bSwap >(pSource, recordSize, count, channel.scale, pOut, outStride); break;
+		case kPlyTypeInt16: ConvertColumn< int16_t, bSwap >(pSource, recordSize, count, channel.scale, pOut, outStride); break;
+		case kPlyTypeUInt16: ConvertColumn< uint16_t, bSwap >(pSource, recordSize, count, channel.scale, pOut, outStride); break;
+		case kPlyTypeInt32: ConvertColumn< int32_t, bSwap >(pSource, recordSize, count, channel.scale, pOut, outStride); break;
+		case kPlyTypeUInt32: ConvertColumn< uint32_t, bSwap >(pSource, recordSize, count, channel.scale, pOut, outStride); break;
+		case kPlyTypeFloat32: ConvertColumn< float, bSwap >(pSource, recordSize, count, channel.scale, pOut, outStride); break;
+		case kPlyTypeFloat64: ConvertColumn< double, bSwap >(pSource, recordSize, count, channel.scale, pOut, outStride); break;
+		default: break;
+		}
+	}
+
+	//records begin..end of an element without lists.  a range is converted one property at a time, the type is
+	//switched on once per property instead of once per value and the records of the range stay in the cache between
+	//the passes.
+	template< bool bSwap >
+	void ConvertFixedRecords(const uint8_t* pRecords, const PlyElement& element, const ChannelSource* pChannels, size_t begin,
+		size_t end, PlyPointData& out)
+	{
+		static_assert(sizeof(vec3) == 3 * sizeof(float) && sizeof(vec4) == 4 * sizeof(float), "the outputs are written as float arrays");
+
+		size_t count = end - begin;
+		const uint8_t* pRange = pRecords + begin * element.recordSize;
+
+		// little endian float x y z next to each other are copied as they are
+		bool bCopyPositions = !bSwap && pChannels[kChannelX].type == kPlyTypeFloat32 && pChannels[kChannelY].type == kPlyTypeFloat32 &&
+			pChannels[kChannelZ].type == kPlyTypeFloat32 && pChannels[kChannelY].offset == pChannels[kChannelX].offset + 4 &&
+			pChannels[kChannelZ].offset == pChannels[kChannelX].offset + 8;
+
+		if (bCopyPositions)
+		{
+			const uint8_t* pSource = pRange + pChannels[kChannelX].offset;
+			for (size_t i = begin; i < end; ++i, pSource += element.recordSize)
+			{
+				memcpy(&out.positions[i], pSource, sizeof(vec3));
+			}
+		}
+		else
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				ConvertColumn< bSwap >(pChannels[kChannelX + c], pRange, element.recordSize, count, &out.positions[begin].x + c, 3);
+			}
+		}
+
+		for (int c = 0; c < 4; ++c)
+		{
+			float* pOut = &out.colors[begin].x + c;
+			if (pChannels[kChannelRed + c].property >= 0)
+			{
+				ConvertColumn< bSwap >(pChannels[kChannelRed + c], pRange, element.recordSize, count, pOut, 4);
+			}
+			else
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					pOut[i * 4] = 255.0f;
+				}
+			}
+		}
+
+		for (int c = 0; c < 3 && !out.normals.empty(); ++c)
+		{
+			ConvertColumn< bSwap >(pChannels[kChannelNX + c], pRange, element.recordSize, count, &out.normals[begin].x + c, 3);
+		}
+
+		if (!out.intensities.empty())
+		{
+			ConvertColumn< bSwap >(pChannels[kChannelIntensity], pRange, element.recordSize, count, &out.intensities[begin], 1);
+		}
+	}
+
+	//records begin..end of an element with a list, the offsets of the properties are found again for every record
+	template< bool bSwap >
+	void ConvertListRecords(const PlyElement& element, const std::vector< const uint8_t* >& recordStarts, const ChannelSource* pChannels,
+		size_t begin, size_t end, PlyPointData& out)
+	{
+		std::vector< uint32_t > offsets(element.properties.size());
+		float values[kNumChannels] = {};
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const uint8_t* pRecord = recordStarts[i];
+			FindRecordOffsets(element, pRecord, bSwap, offsets.data());
+
+			for (int c = 0; c < kNumChannels; ++c)
+			{
+				const ChannelSource& channel = pChannels[c];
+				if (channel.property >= 0)
+				{
+					values[c] = ReadBinaryValue< bSwap >(pRecord + offsets[channel.property], channel.type);
+				}
+			}
+
+			StorePoint(values, pChannels, i, out);
+		}
+	}
+
+	bool ParseBinaryBody(const PlyHeader& header, int vertexElement, const uint8_t* p, const uint8_t* pEnd, PlyPointData& out,
+		uint32_t numThreads)
+	{
+		bool bSwap = header.format == kPlyFormatBinaryBigEndian;
+
+		for (int e = 0; e < vertexElement; ++e)
+		{
+			p = WalkBinaryElement(header.elements[e], p, pEnd, bSwap, nullptr);
+			if (!p)
+			{
+				printf("PLY: the data of element %s is cut off\n", header.elements[e].name.c_str());
+				return false;
+			}
+		}
+
+		const PlyElement& element = header.elements[vertexElement];
+
+		// records with a list have no fixed size, their starts are found in one serial walk
+		std::vector< const uint8_t* > recordStarts;
+		if (element.recordSize == 0)
+		{
+			recordStarts.reserve(element.count);
+		}
+
+		if (!WalkBinaryElement(element, p, pEnd, bSwap, element.recordSize == 0 ? &recordStarts : nullptr))
+		{
+			printf("PLY: the vertex data is cut off\n");
+			return false;
+		}
+
+		ChannelSource channels[kNumChannels];
+		FindChannels(element, channels);
+		ResizeOutput(channels, element.count, out);
+
+		DXParallel::ParallelForRange(element.count, kMinRangeRecords, [&](size_t begin, size_t end)
+		{
+			if (element.recordSize == 0)
+			{
+				if (bSwap)
+					ConvertListRecords< true >(element, recordStarts, channels, begin, end, out);
+				else
+					ConvertListRecords< false >(element, recordStarts, channels, begin, end, out);
+			}
+			else if (bSwap)
+			{
+				ConvertFixedRecords< true >(p, element, channels, begin, end, out);
+			}
+			else
+			{
+				ConvertFixedRecords< false >(p, element, channels, begin, end, out);
+			}
+		}, numThreads);
+
+		return true;
+	}
+
+	//skips the tokens of one property, returns nullptr if the text ends first
+	const char* SkipAsciiProperty(const PlyProperty& property, const char* p, const char* pEnd)
+	{
+		p = SkipSpace(p, pEnd);
+		if (p == pEnd)
+			return nullptr;
+
+		if (!property.IsList())
+			return SkipToken(p, pEnd);
+
+		int32_t listCount = 0;
+		p = DXObjParser::ParseInt(p, pEnd, listCount);
+		for (int32_t item = 0; p && item < listCount; ++item)
+		{
+			p = SkipSpace(p, pEnd);
+			p = p < pEnd ? SkipToken(p, pEnd) : nullptr;
+		}
+		return p;
+	}
+
+	const char* SkipAsciiRecords(const PlyElement& element, const char* p, const char* pEnd)
+	{
+		for (size_t i = 0; p && i < element.count; ++i)
+		{
+			for (size_t property = 0; p && property < element.properties.size(); ++property)
+			{
+				p = SkipAsciiProperty(element.properties[property], p, pEnd);
+			}
+		}
+		return p;
+	}
+
+	//the values of one record.  propertyChannels gives the channel of every property, -1 for the ones that are skipped.
+	const char* ParseAsciiRecord(const PlyElement& element, const std::vector< int >& propertyChannels, const char* p, const char* pEnd,
+		float* pValues)
+	{
+		for (size_t property = 0; p && property < element.properties.size(); ++property)
+		{
+			if (propertyChannels[property] >= 0)
+			{
+				p = DXObjParser::ParseFloat(SkipSpace(p, pEnd), pEnd, pValues[propertyChannels[property]]);
+			}
+			else
+			{
+				p = SkipAsciiProperty(element.properties[property], p, pEnd);
+			}
+		}
+		return p;
+	}
+
+	inline bool IsBlankLine(const char* p, const char* pLineEnd)
+	{
+		return SkipSpace(p, pLineEnd) == pLineEnd;
+	}
+
+	inline const char* FindLineEnd(const char* p, const char* pEnd)
+	{
+		const char* pLineEnd = static_cast<const char*>(memchr(p, '\n', pEnd - p));
+		return pLineEnd ? pLineEnd : pEnd;
+	}
+
+	//A line aligned slice of the ascii body.  numRecords comes from the counting pass (every line that is not
+	//blank), firstRecord is the prefix sum of the records of all earlier chunks.
+	struct PlyAsciiChunk
+	{
+		const char* pBegin;
+		const char* pEnd;
+		size_t numRecords;
+		size_t firstRecord;
+		bool bFailed;           //a line that is not exactly one record
+	};
+
+	void CountAsciiChunk(PlyAsciiChunk& chunk)
+	{
+		for (const char* p = chunk.pBegin; p < chunk.pEnd; )
+		{
+			const char* pLineEnd = FindLineEnd(p, chunk.pEnd);
+			chunk.numRecords += IsBlankLine(p, pLineEnd) ? 0 : 1;
+			p = pLineEnd + 1;
+		}
+	}
+
+	void ParseAsciiChunk(PlyAsciiChunk& chunk, const PlyElement& element, const std::vector< int >& propertyChannels,
+		const ChannelSource* pChannels, PlyPointData& out)
+	{
+		float values[kNumChannels] = {};
+		size_t record = chunk.firstRecord;
+
+		for (const char* p = chunk.pBegin; p < chunk.pEnd && record < element.count; )
+		{
+			const char* pLineEnd = FindLineEnd(p, chunk.pEnd);
+			if (!IsBlankLine(p, pLineEnd))
+			{
+				// the tokens of the record can't run past the line
+				const char* pRecordEnd = ParseAsciiRecord(element, propertyChannels, p, pLineEnd, values);
+				if (!pRecordEnd || !IsBlankLine(pRecordEnd, pLineEnd))
+				{
+					chunk.bFailed = true;
+					return;
+				}
+
+				StorePoint(values, pChannels, record, out);
+				record++;
+			}
+			p = pLineEnd + 1;
+		}
+	}
+
+	bool ParseAsciiSerial(const PlyElement& element, const std::vector< int >& propertyChannels, const ChannelSource* pChannels,
+		const char* p, const char* pEnd, PlyPointData& out)
+	{
+		float values[kNumChannels] = {};
+		for (size_t i = 0; i < element.count; ++i)
+		{
+			p = ParseAsciiRecord(element, propertyChannels, p, pEnd, values);
+			if (!p)
+			{
+				printf("PLY: bad or missing value in vertex %zu\n", i);
+				return false;
+			}
+
+			StorePoint(values, pChannels, i, out);
+		}
+
+		return true;
+	}
+
+	bool ParseAsciiBody(const PlyHeader& header, int vertexElement, const char* p, const char* pEnd, PlyPointData& out,
+		uint32_t numThreads)
+	{
+		for (int e = 0; e < vertexElement; ++e)
+		{
+			p = SkipAsciiRecords(header.elements[e], p, pEnd);
+			if (!p)
+			{
+				printf("PLY: the data of element %s is cut off\n", header.elements[e].name.c_str());
+				return false;
+			}
+		}
+
+		const PlyElement& element = header.elements[vertexElement];
+
+		ChannelSource channels[kNumChannels];
+		FindChannels(element, channels);
+		ResizeOutput(channels, element.count, out);
+
+		// the channel each property is stored in, -1 for properties that are skipped
+		std::vector< int > propertyChannels(element.properties.size(), -1);
+		for (int c = 0; c < kNumChannels; ++c)
+		{
+			if (channels[c].property >= 0)
+			{
+				propertyChannels[channels[c].property] = c;
+			}
+		}
+
+		if (numThreads == 0)
+		{
+			numThreads = DXParallel::GetWorkerCount();
+		}
+
+		// Split the body at line boundaries.  Small files end up in one chunk.
+		p = SkipSpace(p, pEnd);
+		size_t bodySize = static_cast<size_t>(pEnd - p);
+		size_t numChunks = std::min< size_t >(numThreads * kChunksPerThread, bodySize / kMinChunkBytes);
+		numChunks = std::max< size_t >(numChunks, 1);
+
+		std::vector< PlyAsciiChunk > chunks;
+		chunks.reserve(numChunks);
+
+		const char* pChunkBegin = p;
+		for (size_t i = 1; i <= numChunks && pChunkBegin < pEnd; ++i)
+		{
+			const char* pChunkEnd = pEnd;
+			if (i < numChunks)
+			{
+				pChunkEnd = std::max(pChunkBegin, p + bodySize / numChunks * i);
+				pChunkEnd = std::min(FindLineEnd(pChunkEnd, pEnd) + 1, pEnd);
+			}
+
+			PlyAsciiChunk chunk = {};
+			chunk.pBegin = pChunkBegin;
+			chunk.pEnd = pChunkEnd;
+			chunks.push_back(chunk);
+
+			pChunkBegin = pChunkEnd;
+		}
+
+		// Counting pass, then the prefix sums give every chunk the index of its first record.  Lines past the
+		// vertex records belong to the elements that follow and are not parsed.
+		DXParallel::ParallelFor(chunks.size(), [&](size_t i) { CountAsciiChunk(chunks[i]); }, numThreads);
+
+		size_t numRecords = 0;
+		for (PlyAsciiChunk& chunk : chunks)
+		{
+			chunk.firstRecord = numRecords;
+			numRecords += chunk.numRecords;
+		}
+
+		// Parsing pass, every chunk writes its own slice of the arrays
+		bool bLineRecords = numRecords >= element.count;
+		if (bLineRecords)
+		{
+			DXParallel::ParallelFor(chunks.size(), [&](size_t i) { ParseAsciiChunk(chunks[i], element, propertyChannels, channels, out); },
+				numThreads);
+
+			for (const PlyAsciiChunk& chunk : chunks)
+			{
+				bLineRecords &= !chunk.bFailed;
+			}
+		}
+
+		// records that share or span lines (or a file that is cut off) go through the serial tokenizer, it does not
+		// care about lines and reports where the data ends
+		if (!bLineRecords)
+			return ParseAsciiSerial(element, propertyChannels, channels, p, pEnd, out);
+
+		return true;
+	}
+
+	template< typename T >
+	void AppendValue(std::vector< char >& buffer, T value, bool bSwap)
+	{
+		char bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+		if (bSwap)
+		{
+			std::reverse(bytes, bytes + sizeof(T));
+		}
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+}
+
+int PlyElement::FindProperty(const char* propertyName) const
+{
+	for (size_t i = 0; i < properties.size(); ++i)
+	{
+		if (properties[i].name == propertyName)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+int PlyHeader::FindElement(const char* elementName) const
+{
+	for (size_t i = 0; i < elements.size(); ++i)
+	{
+		if (elements[i].name == elementName)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+namespace DXPlyParser
+{
+	uint32_t GetTypeSize(PlyType type)
+	{
+		switch (type)
+		{
+		case kPlyTypeInt8:
+		case kPlyTypeUInt8: return 1;
+		case kPlyTypeInt16:
+		case kPlyTypeUInt16: return 2;
+		case kPlyTypeInt32:
+		case kPlyTypeUInt32:
+		case kPlyTypeFloat32: return 4;
+		case kPlyTypeFloat64: return 8;
+		default: return 0;
+		}
+	}
+
+	bool ParseHeader(const char* pBegin, const char* pEnd, PlyHeader& out_header)
+	{
+		out_header = PlyHeader();
+
+		bool bFormat = false;
+		bool bFirstLine = true;
+		std::string word;
+
+		const char* pLine = pBegin;
+		while (pLine < pEnd)
+		{
+			const char* pLineEnd = static_cast<const char*>(memchr(pLine, '\n', pEnd - pLine));
+			const char* pNext = pLineEnd ? pLineEnd + 1 : pEnd;
+			pLineEnd = pLineEnd ? pLineEnd : pEnd;
+
+			const char* p = pLine;
+			pLine = pNext;
+
+			if (!NextWord(p, pLineEnd, word))
+				continue;
+
+			if (bFirstLine)
+			{
+				if (word != "ply")
+					return false;
+				bFirstLine = false;
+			}
+			else if (word == "format")
+			{
+				NextWord(p, pLineEnd, word);
+				if (word == "ascii") out_header.format = kPlyFormatAscii;
+				else if (word == "binary_little_endian") out_header.format = kPlyFormatBinaryLittleEndian;
+				else if (word == "binary_big_endian") out_header.format = kPlyFormatBinaryBigEndian;
+				else
+				{
+					printf("PLY: unknown format %s\n", word.c_str());
+					return false;
+				}
+				bFormat = true;
+			}
+			else if (word == "element")
+			{
+				PlyElement element;
+				std::string count;
+				if (!NextWord(p, pLineEnd, element.name) || !NextWord(p, pLineEnd, count))
+					return false;
+
+				element.count = strtoull(count.c_str(), nullptr, 10);
+				out_header.elements.push_back(element);
+			}
+			else if (word == "property")
+			{
+				if (out_header.elements.empty())
+					return false;
+
+				PlyProperty property;
+				NextWord(p, pLineEnd, word);
+				if (word == "list")
+				{
+					NextWord(p, pLineEnd, word);
+					property.listCountType = ParseType(word);
+					NextWord(p, pLineEnd, word);
+				}
+				property.type = ParseType(word);
+
+				if (property.type == kPlyTypeInvalid || (property.IsList() && property.listCountType == kPlyTypeInvalid) ||
+					!NextWord(p, pLineEnd, property.name))
+				{
+					printf("PLY: unknown property type %s\n", word.c_str());
+					return false;
+				}
+
+				out_header.elements.back().properties.push_back(property);
+			}
+			else if (word == "end_header")
+			{
+				out_header.dataOffset = static_cast<size_t>(pNext - pBegin);
+
+				// binary records without lists have fixed offsets
+				for (PlyElement& element : out_header.elements)
+				{
+					uint32_t offset = 0;
+					bool bFixed = true;
+					for (PlyProperty& property : element.properties)
+					{
+						property.offset = offset;
+						offset += GetTypeSize(property.type);
+						bFixed &= !property.IsList();
+					}
+					element.recordSize = bFixed ? offset : 0;
+				}
+
+				return bFormat;
+			}
+			// comment and obj_info lines are skipped
+		}
+
+		return false;
+	}
+
+	bool ParseFile(const char* path, PlyPointData& out, uint32_t numThreads)
+	{
+		DXMemoryMappedFile file;
+		if (!file.Open(path))
+		{
+			printf("Failed to open PLY file %s\n", path);
+			return false;
+		}
+
+		return ParseBuffer(file.GetData(), file.GetEnd(), out, numThreads);
+	}
+
+	bool ParseBuffer(const char* pBegin, const char* pEnd, PlyPointData& out, uint32_t numThreads)
+	{
+		out.positions.clear();
+		out.colors.clear();
+		out.normals.clear();
+		out.intensities.clear();
+
+		PlyHeader header;
+		if (!ParseHeader(pBegin, pEnd, header))
+		{
+			printf("PLY: bad header\n");
+			return false;
+		}
+
+		int vertexElement = header.FindElement("vertex");
+		if (vertexElement < 0)
+		{
+			printf("PLY: no vertex element\n");
+			return false;
+		}
+
+		const PlyElement& element = header.elements[vertexElement];
+		for (const char* name : { "x", "y", "z" })
+		{
+			int property = element.FindProperty(name);
+			if (property < 0 || element.properties[property].IsList())
+			{
+				printf("PLY: the vertex element has no %s\n", name);
+				return false;
+			}
+		}
+
+		const char* pData = pBegin + header.dataOffset;
+		if (header.format == kPlyFormatAscii)
+			return ParseAsciiBody(header, vertexElement, pData, pEnd, out, numThreads);
+
+		return ParseBinaryBody(header, vertexElement, reinterpret_cast<const uint8_t*>(pData), reinterpret_cast<const uint8_t*>(pEnd),
+			out, numThreads);
+	}
+
+	bool WriteFile(const char* path, const vec3* pPositions, const vec4* pColors, size_t numPoints, PlyFormat format)
+	{
+		FILE* pFile = nullptr;
+		if (fopen_s(&pFile, path, "wb") != 0 || !pFile)
+			return false;
+
+		const char* formatName = format == kPlyFormatAscii ? "ascii" :
+			(format == kPlyFormatBinaryLittleEndian ? "binary_little_endian" : "binary_big_endian");
+
+		fprintf(pFile, "ply\nformat %s 1.0\nelement vertex %zu\nproperty float x\nproperty float y\nproperty float z\n"
+			"property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\nend_header\n", formatName, numPoints);
+
+		bool bSwap = format == kPlyFormatBinaryBigEndian;
+		std::vector< char > buffer;
+
+		for (size_t first = 0; first < numPoints; first += kWriteBatchPoints)
+		{
+			size_t end = std::min(first + kWriteBatchPoints, numPoints);
+			buffer.clear();
+
+			for (size_t i = first; i < end; ++i)
+			{
+				uint8_t rgba[4] = { 255, 255, 255, 255 };
+				if (pColors)
+				{
+					const float color[4] = { pColors[i].x, pColors[i].y, pColors[i].z, pColors[i].w };
+					for (int c = 0; c < 4; ++c)
+					{
+						rgba[c] = static_cast<uint8_t>(std::min(std::max(color[c], 0.0f), 255.0f) + 0.5f);
+					}
+				}
+
+				if (format == kPlyFormatAscii)
+				{
+					char line[128];
+					int length = snprintf(line, sizeof(line), "%.9g %.9g %.9g %u %u %u %u\n", pPositions[i].x, pPositions[i].y, pPositions[i].z,
+						rgba[0], rgba[1], rgba[2], rgba[3]);
+					buffer.insert(buffer.end(), line, line + length);
+				}
+				else
+				{
+					AppendValue(buffer, pPositions[i].x, bSwap);
+					AppendValue(buffer, pPositions[i].y, bSwap);
+					AppendValue(buffer, pPositions[i].z, bSwap);
+					buffer.insert(buffer.end(), rgba, rgba + 4);
+				}
+			}
+
+			if (fwrite(buffer.data(), 1, buffer.size(), pFile) != buffer.size())
+			{
+				fclose(pFile);
+				return false;
+			}
+		}
+
+		fclose(pFile);
+		return true;
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+enum PlyFormat
+{
+	kPlyFormatAscii,
+	kPlyFormatBinaryLittleEndian,
+	kPlyFormatBinaryBigEndian
+};
+
+enum PlyType : uint8_t
+{
+	kPlyTypeInt8,
+	kPlyTypeUInt8,
+	kPlyTypeInt16,
+	kPlyTypeUInt16,
+	kPlyTypeInt32,
+	kPlyTypeUInt32,
+	kPlyTypeFloat32,
+	kPlyTypeFloat64,
+	kPlyTypeInvalid
+};
+
+struct PlyProperty
+{
+	std::string name;
+	PlyType type = kPlyTypeInvalid;           //of the items for a list
+	PlyType listCountType = kPlyTypeInvalid;  //kPlyTypeInvalid for a scalar property
+	uint32_t offset = 0;                      //in a binary record, only valid when the element has no list
+
+	bool IsList() const { return listCountType != kPlyTypeInvalid; }
+};
+
+struct PlyElement
+{
+	std::string name;
+	size_t count = 0;
+	std::vector< PlyProperty > properties;
+	uint32_t recordSize = 0;                  //bytes of a binary record, 0 when the element has a list
+
+	int FindProperty(const char* name) const;
+};
+
+//The schema of a ply file.  The body starts at dataOffset bytes from the start of the file.
+struct PlyHeader
+{
+	PlyFormat format = kPlyFormatAscii;
+	std::vector< PlyElement > elements;
+	size_t dataOffset = 0;
+
+	int FindElement(const char* name) const;
+};
+
+//The vertex element of a ply file.  Colors are in 0..255 the way DXPointCloud uploads them: integer colors are
+//scaled from the range of their type, float colors from 0..1.  A file without colors gives white, one without alpha
+//gives 255.  normals and intensities are empty when the file does not have them.  The arrays use the memory
+//resource passed to the constructor, e.g. the load arena.
+struct PlyPointData
+{
+	explicit PlyPointData(std::pmr::memory_resource* pResource = std::pmr::get_default_resource()) :
+		positions(pResource)
+		, colors(pResource)
+		, normals(pResource)
+		, intensities(pResource)
+	{
+
+	}
+
+	std::pmr::vector< DXGraphicsUtilities::vec3 > positions;
+	std::pmr::vector< DXGraphicsUtilities::vec4 > colors;
+	std::pmr::vector< DXGraphicsUtilities::vec3 > normals;
+	std::pmr::vector< float > intensities;
+
+	size_t GetPointCount() const { return positions.size(); }
+};
+
+//Ply reader driven by the header.  The properties of the vertex element may come in any order and with any of the
+//scalar types, x y z are required, red green blue alpha (or r g b a), nx ny nz and intensity are read when present
+//and everything else is skipped.  Binary bodies are converted in one pass over the memory mapped file: every
+//property is read at its offset in the record and swapped for big endian files, the records are split over
+//numThreads threads (0 = all cores).  Ascii bodies are split into line aligned chunks that are parsed on the same
+//threads, each chunk writes its own slice of the arrays (one record per line; other layouts are parsed serially).
+namespace DXPlyParser
+{
+	uint32_t GetTypeSize(PlyType type);
+
+	//header only, returns false if it is not a ply header or uses an unknown format or type
+	bool ParseHeader(const char* pBegin, const char* pEnd, PlyHeader& out_header);
+
+	bool ParseFile(const char* path, PlyPointData& out, uint32_t numThreads = 0);
+	bool ParseBuffer(const char* pBegin, const char* pEnd, PlyPointData& out, uint32_t numThreads = 0);
+
+	//x y z as float and red green blue alpha as uchar (colors are clamped to 0..255), in any of the formats
+	bool WriteFile(const char* path,
+		const DXGraphicsUtilities::vec3* pPositions,
+		const DXGraphicsUtilities::vec4* pColors,
+		size_t numPoints,
+		PlyFormat format);
+}
@@ -0,0 +1,236 @@
+#include "stdafx.h"
+#include "DXPointChunks.h"
+#include "DXPointSorter.h"
+#include "DXParallel.h"
+
+#include <cfloat>
+#include <chrono>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t kMortonBits = 10;
+	const uint32_t kMortonCells = 1 << kMortonBits;
+
+	inline const XMFLOAT3& GetPosition(const XMFLOAT3* pPositions, size_t stride, size_t i)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(pPositions) + i * stride);
+	}
+
+	//spreads the low 10 bits of v to every third bit
+	inline uint32_t SpreadBits(uint32_t v)
+	{
+		v &= 0x3ff;
+		v = (v | (v << 16)) & 0x030000ff;
+		v = (v | (v << 8)) & 0x0300f00f;
+		v = (v | (v << 4)) & 0x030c30c3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+
+	inline uint32_t GetCell(float value, float origin, float scale)
+	{
+		float cell = (value - origin) * scale;
+		return cell <= 0.0f ? 0 : std::min(static_cast<uint32_t>(cell), kMortonCells - 1);
+	}
+}
+
+namespace DXPointChunks
+{
+	uint32_t GetMortonCode(uint32_t x, uint32_t y, uint32_t z)
+	{
+		return SpreadBits(x) | (SpreadBits(y) << 1) | (SpreadBits(z) << 2);
+	}
+
+	void SortByMortonCode(const XMFLOAT3* pPositions, size_t positionStride, size_t numPoints, std::vector< uint32_t >& out_order,
+		uint32_t numThreads)
+	{
+		out_order.resize(numPoints);
+		SortByMortonCode(pPositions, positionStride, numPoints, out_order.data(), numThreads);
+	}
+
+	void SortByMortonCode(const XMFLOAT3* pPositions, size_t positionStride, size_t numPoints, uint32_t* pOutOrder,
+		uint32_t numThreads)
+	{
+		if (numPoints == 0)
+			return;
+
+		XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			const XMFLOAT3& p = GetPosition(pPositions, positionStride, i);
+			boundsMin = XMFLOAT3(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+			boundsMax = XMFLOAT3(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+		}
+
+		// cubic cells so a chunk is about as wide as it is deep
+		float extent = std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y), boundsMax.z - boundsMin.z);
+		float scale = extent > 0.0f ? kMortonCells / extent : 0.0f;
+
+		std::vector< uint64_t > pairs(numPoints);
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const XMFLOAT3& p = GetPosition(pPositions, positionStride, i);
+				uint32_t code = GetMortonCode(GetCell(p.x, boundsMin.x, scale), GetCell(p.y, boundsMin.y, scale),
+					GetCell(p.z, boundsMin.z, scale));
+				pairs[i] = (static_cast<uint64_t>(code) << 32) | i;
+			}
+		}, numThreads);
+
+		std::vector< uint64_t > scratch;
+		DXPointSorter::RadixSort(pairs, scratch, numThreads);
+
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				pOutOrder[i] = static_cast<uint32_t>(pairs[i]);
+			}
+		}, numThreads);
+	}
+
+	void BuildChunks(const XMFLOAT3* pPositions, size_t positionStride, size_t numPoints, uint32_t chunkSize,
+		std::vector< PointChunk >& out_chunks, uint32_t numThreads)
+	{
+		chunkSize = std::max(chunkSize, 1u);
+		out_chunks.resize((numPoints + chunkSize - 1) / chunkSize);
+
+		DXParallel::ParallelFor(out_chunks.size(), [&](size_t c)
+		{
+			PointChunk& chunk = out_chunks[c];
+			chunk.firstPoint = static_cast<uint32_t>(c * chunkSize);
+			chunk.numPoints = static_cast<uint32_t>(std::min< size_t >(chunkSize, numPoints - chunk.firstPoint));
+
+			XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+			for (uint32_t i = chunk.firstPoint; i < chunk.firstPoint + chunk.numPoints; ++i)
+			{
+				XMVECTOR p = XMLoadFloat3(&GetPosition(pPositions, positionStride, i));
+				boundsMin = XMVectorMin(boundsMin, p);
+				boundsMax = XMVectorMax(boundsMax, p);
+			}
+
+			XMStoreFloat3(&chunk.boundsMin, boundsMin);
+			XMStoreFloat3(&chunk.boundsMax, boundsMax);
+		}, numThreads);
+	}
+
+	bool IsChunkVisible(const PointChunk& chunk, const MeshletCullView& view)
+	{
+		for (const XMFLOAT4& plane : view.planes)
+		{
+			// the corner of the box farthest along the plane normal
+			float x = plane.x >= 0.0f ? chunk.boundsMax.x : chunk.boundsMin.x;
+			float y = plane.y >= 0.0f ? chunk.boundsMax.y : chunk.boundsMin.y;
+			float z = plane.z >= 0.0f ? chunk.boundsMax.z : chunk.boundsMin.z;
+
+			float distance = x * plane.x + plane.w;
+			distance = y * plane.y + distance;
+			distance = z * plane.z + distance;
+			if (distance < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	void CullChunks(const PointChunk* pChunks, size_t numChunks, const MeshletCullView& view, std::vector< PointDrawRange >& out_ranges,
+		PointChunkCullStats* pStats)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		out_ranges.clear();
+		PointChunkCullStats stats;
+		stats.numChunks = numChunks;
+
+		// the corner to test is the same for every box, each plane only needs to know which side of it to read
+		XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+		bool bUseMaxX[6], bUseMaxY[6], bUseMaxZ[6];
+		for (int p = 0; p < 6; ++p)
+		{
+			XMVECTOR plane = XMLoadFloat4(&view.planes[p]);
+			planeX[p] = XMVectorSplatX(plane);
+			planeY[p] = XMVectorSplatY(plane);
+			planeZ[p] = XMVectorSplatZ(plane);
+			planeW[p] = XMVectorSplatW(plane);
+			bUseMaxX[p] = view.planes[p].x >= 0.0f;
+			bUseMaxY[p] = view.planes[p].y >= 0.0f;
+			bUseMaxZ[p] = view.planes[p].z >= 0.0f;
+		}
+
+		auto addVisibleChunk = [&](const PointChunk& chunk)
+		{
+			if (!out_ranges.empty() && out_ranges.back().firstPoint + out_ranges.back().numPoints == chunk.firstPoint)
+			{
+				out_ranges.back().numPoints += chunk.numPoints;
+			}
+			else
+			{
+				out_ranges.push_back({ chunk.firstPoint, chunk.numPoints });
+			}
+
+			stats.numVisibleChunks++;
+			stats.numVisiblePoints += chunk.numPoints;
+		};
+
+		size_t i = 0;
+		for (; i + 4 <= numChunks; i += 4)
+		{
+			const PointChunk* c = pChunks + i;
+
+			// four boxes as x, y, z vectors of their min and max corners
+			XMMATRIX mins = XMMatrixTranspose(XMMATRIX(XMLoadFloat3(&c[0].boundsMin), XMLoadFloat3(&c[1].boundsMin),
+				XMLoadFloat3(&c[2].boundsMin), XMLoadFloat3(&c[3].boundsMin)));
+			XMMATRIX maxs = XMMatrixTranspose(XMMATRIX(XMLoadFloat3(&c[0].boundsMax), XMLoadFloat3(&c[1].boundsMax),
+				XMLoadFloat3(&c[2].boundsMax), XMLoadFloat3(&c[3].boundsMax)));
+
+			XMVECTOR culled = XMVectorFalseInt();
+			for (int p = 0; p < 6; ++p)
+			{
+				XMVECTOR distance = XMVectorMultiplyAdd(bUseMaxX[p] ? maxs.r[0] : mins.r[0], planeX[p], planeW[p]);
+				distance = XMVectorMultiplyAdd(bUseMaxY[p] ? maxs.r[1] : mins.r[1], planeY[p], distance);
+				distance = XMVectorMultiplyAdd(bUseMaxZ[p] ? maxs.r[2] : mins.r[2], planeZ[p], distance);
+				culled = XMVectorOrInt(culled, XMVectorLess(distance, XMVectorZero()));
+			}
+
+			uint32_t culledMask[4];
+			XMStoreInt4(culledMask, culled);
+
+			for (uint32_t lane = 0; lane < 4; ++lane)
+			{
+				if (!culledMask[lane])
+				{
+					addVisibleChunk(c[lane]);
+				}
+			}
+		}
+
+		for (; i < numChunks; ++i)
+		{
+			if (IsChunkVisible(pChunks[i], view))
+			{
+				addVisibleChunk(pChunks[i]);
+			}
+		}
+
+		if (pStats)
+		{
+			for (size_t c = 0; c < numChunks; ++c)
+			{
+				stats.numPoints += pChunks[c].numPoints;
+			}
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			pStats->numChunks += stats.numChunks;
+			pStats->numVisibleChunks += stats.numVisibleChunks;
+			pStats->numPoints += stats.numPoints;
+			pStats->numVisiblePoints += stats.numVisiblePoints;
+			pStats->numDrawRanges += out_ranges.size();
+			pStats->cullMs += elapsed.count();
+		}
+	}
+}
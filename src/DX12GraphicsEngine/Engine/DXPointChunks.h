@@ -0,0 +1,77 @@
+#pragma once
+
+#include "DXMeshletCuller.h"
+#include <DirectXMath.h>
+#include <vector>
+
+//A run of consecutive points of the vertex buffer and their bounds, in object space
+struct PointChunk
+{
+	DirectX::XMFLOAT3 boundsMin;
+	uint32_t firstPoint;
+	DirectX::XMFLOAT3 boundsMax;
+	uint32_t numPoints;
+};
+
+//consecutive visible chunks of the same buffer become one draw
+struct PointDrawRange
+{
+	uint32_t firstPoint;
+	uint32_t numPoints;
+};
+
+struct PointChunkCullStats
+{
+	size_t numChunks = 0;
+	size_t numVisibleChunks = 0;
+	size_t numPoints = 0;
+	size_t numVisiblePoints = 0;
+	size_t numDrawRanges = 0;
+	double cullMs = 0.0;
+
+	float GetCulledPointRate() const { return numPoints ? 1.0f - float(numVisiblePoints) / float(numPoints) : 0.0f; }
+};
+
+//Spatial chunks of a point cloud.  The points are put in the order of a 3D Morton curve (10 bits per axis over the
+//bounding cube of the cloud) with the parallel radix sort of DXPointSorter, so every run of chunkSize consecutive
+//points stays in a small box.  CullChunks tests the boxes against the frustum planes of a MeshletCullView, four
+//chunks per iteration with DirectXMath vectors, and returns the visible parts of the buffer as draw ranges.
+namespace DXPointChunks
+{
+	const uint32_t kDefaultChunkSize = 8192;
+
+	//interleaved bits of a cell, x in bit 0
+	uint32_t GetMortonCode(uint32_t x, uint32_t y, uint32_t z);
+
+	//point indices in Morton order, positions are read every positionStride bytes
+	void SortByMortonCode(const DirectX::XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numPoints,
+		std::vector< uint32_t >& out_order,
+		uint32_t numThreads = 0);
+
+	//the order goes into a caller provided array of numPoints entries, e.g. load time scratch memory
+	void SortByMortonCode(const DirectX::XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numPoints,
+		uint32_t* pOutOrder,
+		uint32_t numThreads = 0);
+
+	//chunks of chunkSize points (the last one may be smaller) in buffer order
+	void BuildChunks(const DirectX::XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numPoints,
+		uint32_t chunkSize,
+		std::vector< PointChunk >& out_chunks,
+		uint32_t numThreads = 0);
+
+	//false when the box is outside one of the planes
+	bool IsChunkVisible(const PointChunk& chunk, const MeshletCullView& view);
+
+	//replaces out_ranges with the visible ranges of the buffer.  the stats are added to.
+	void CullChunks(const PointChunk* pChunks,
+		size_t numChunks,
+		const MeshletCullView& view,
+		std::vector< PointDrawRange >& out_ranges,
+		PointChunkCullStats* pStats = nullptr);
+}
@@ -1,6 +1,10 @@
 #include "stdafx.h"
 #include "DXPointCloud.h"
 #include "DXCamera.h"
+#include "DXPlyParser.h"
+#include "DXParallel.h"
+#include "DXPointChunks.h"
+#include "DXPointOctree.h"
 
 #include <stdio.h>
 #include <string>
@@ -21,6 +25,9 @@ ComPtr<ID3D12PipelineState> DXPointCloud::m_PointCloudProcessPipelineState = nul
 
 bool DXPointCloud::mDebugVizDepthBuffer = false;
 
+//the evicted ranges of the page pool are reused after this many frames, the samples keep 2 frames in flight
+const size_t kPagePoolFramesInFlight = 3;
+
 // constructor
 DXPointCloud::DXPointCloud() 
 {
@@ -31,24 +38,31 @@ DXPointCloud::DXPointCloud()
 // destructor
 DXPointCloud::~DXPointCloud()
 {
-   
+	mPointStreamer.SetSink(nullptr);
 }
 
 void DXPointCloud::Update(DXCamera* pCamera)
 {
 	if (!pCamera) return;
 
-	if (mbUseCPUPointSort)
+	if (mbUseCPUPointSort && !IsPaged())
 	{
-		SortPointCloud(pCamera);
+		const std::vector< uint32_t >& order = SortPointCloud(pCamera);
 
 		UINT8* pMappedBuffer;
 		CD3DX12_RANGE readRange(0, 0);
 		m_pVertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMappedBuffer));
 
-		int sizeOfVert = sizeof(DXGraphicsUtilities::CloudVertexPosColor);
-		void* vertexData = (void*)mvCloudVertices.data();
-		memcpy(pMappedBuffer, vertexData, mvCloudVertices.size() * sizeOfVert); //copy vertices into GPU VB
+		// gather the encoded vertices into the VB in sorted order, mvPointVertexBytes itself stays in load order
+		const uint8_t* pSource = mvPointVertexBytes.data();
+		size_t stride = m_vertexBufferView.StrideInBytes;
+		DXParallel::ParallelForRange(order.size(), 64 * 1024, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				memcpy(pMappedBuffer + i * stride, pSource + order[i] * stride, stride);
+			}
+		});
 
 		m_pVertexBuffer->Unmap(0, nullptr);
 	}
@@ -56,31 +70,13 @@ void DXPointCloud::Update(DXCamera* pCamera)
 	m_pDXCamera = pCamera;
 }
 
-void DXPointCloud::SortPointCloud(DXCamera* pCamera)
+const std::vector< uint32_t >& DXPointCloud::SortPointCloud(DXCamera* pCamera)
 {
-	using namespace DXGraphicsUtilities;
-
-	std::sort(mvCloudVertices.begin(), mvCloudVertices.end(), [pCamera](CloudVertexPosColor& p0, CloudVertexPosColor& p1) {
-		
-		XMFLOAT3 cam_pos3=pCamera->GetPosition();
-		XMVECTOR vCamPos= XMLoadFloat3(&cam_pos3);
-		
-		XMVECTOR vecPos0 = XMLoadFloat3(&p0.Pos);
-		XMVECTOR vecPos1= XMLoadFloat3(&p1.Pos);
-
-		XMVECTOR vectorSub0 = XMVectorSubtract(vCamPos, vecPos0); // Get difference vector
-		XMVECTOR length0 = XMVector3Length(vectorSub0); // Calculate length
-		float distance0 = 0.0f;
-		XMStoreFloat(&distance0, length0); // Store the length into the float variable
+	if (mvCloudVertices.empty())
+		return mPointSorter.GetOrder();
 
-		XMVECTOR vectorSub1 = XMVectorSubtract(vCamPos, vecPos1); // Get difference vector
-		XMVECTOR length1 = XMVector3Length(vectorSub1); // Calculate length
-		float distance1 = 0.0f;
-		XMStoreFloat(&distance1, length1); // Store the length into the float variable
-
-		return distance0 > distance1;
-
-		});
+	return mPointSorter.Sort(&mvCloudVertices[0].Pos, sizeof(DXGraphicsUtilities::CloudVertexPosColor), mvCloudVertices.size(),
+		pCamera->GetPosition());
 }
 
 void DXPointCloud::UpdateBoundingBox()
@@ -112,7 +108,8 @@ HRESULT DXPointCloud::LoadPointCloudFromFile( const char *          filename,
 								   ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
 								   int cbDescriptorIndex,
 								   DXGraphicsUtilities::vec3& scale,
-								   bool bSwitchYZAxes)
+								   bool bSwitchYZAxes,
+								   IndexFormatRequest indexFormat)
 {
 
     mpd3dDevice        = pd3dDevice;
@@ -120,140 +117,319 @@ HRESULT DXPointCloud::LoadPointCloudFromFile( const char *          filename,
 	m_cbDescriptorIndex = cbDescriptorIndex;
 	mbSwitchYZAxesOnPLYFileLoad = bSwitchYZAxes;
 
-    std::vector< DXGraphicsUtilities::vec3 > * out_vertices = new std::vector< DXGraphicsUtilities::vec3 >();
-    std::vector< DXGraphicsUtilities::vec4 > * out_colors     = new std::vector< DXGraphicsUtilities::vec4 >();
+	m_LoadStats = DXMeshLoadStats();
+
+	// the temporaries of the load live in the scratch arena of this thread, nothing is freed one by one
+	DXLoadArena& arena = DXLoadArena::GetThreadArena();
+	arena.Reset();
+
+    std::pmr::vector< DXGraphicsUtilities::vec3 > out_vertices(&arena);
+    std::pmr::vector< DXGraphicsUtilities::vec4 > out_colors(&arena);
 
     // load data for the vertex position  and colors into separate vectors
-    bool bLoaded = LoadPLY( filename, *out_vertices, *out_colors);
+    bool bLoaded = LoadPLY( filename, out_vertices, out_colors);
 
     assert( bLoaded && "Failed to load ply file\n" );
-    assert( out_vertices->size() == out_colors->size() );
+    assert( out_vertices.size() == out_colors.size() );
 
-    int numberOfVertices = static_cast< int >( out_vertices->size() );
+	// drop the duplicates and merge the points of a voxel before anything else touches them
+	mPointDownsampleStats = PointDownsampleStats();
+	if (mPointDownsampleOptions.bRemoveDuplicates || mPointDownsampleOptions.voxelSize > 0.0f)
+	{
+		std::pmr::vector< DXGraphicsUtilities::vec3 > downsampledVertices(out_vertices.size(), &arena);
+		std::pmr::vector< DXGraphicsUtilities::vec4 > downsampledColors(out_colors.size(), &arena);
+
+		size_t numDownsampled = DXPointDownsample::Downsample(out_vertices.data(), out_colors.data(), out_vertices.size(),
+			mPointDownsampleOptions, downsampledVertices.data(), downsampledColors.data(), &mPointDownsampleStats);
+		downsampledVertices.resize(numDownsampled);
+		downsampledColors.resize(numDownsampled);
+		out_vertices.swap(downsampledVertices);
+		out_colors.swap(downsampledColors);
+
+		printf("  downsampled %zu -> %zu points (%zu duplicates, voxel %g), %.2f ms\n", mPointDownsampleStats.numInputPoints,
+			mPointDownsampleStats.numOutputPoints, mPointDownsampleStats.numDuplicates, mPointDownsampleStats.voxelSize,
+			mPointDownsampleStats.totalMs);
+	}
+
+    int numberOfVertices = static_cast< int >( out_vertices.size() );
     int numberOfIndices  = numberOfVertices;
 
     // create an index array.  vertices are in the vector in proper order already
-	std::vector<WORD> meshIndicesVector;
+	UINT* pMeshIndices = arena.AllocateArray< UINT >(numberOfIndices);
 
     int i = 0;
     for ( i = 0; i < numberOfIndices; ++i )
     {
-		meshIndicesVector.push_back(i);
+		pMeshIndices[i] = i;
     }
 
-	// Switch y and z axes save the final vertices for CPU analysis if needed
-	for (i = 0; i < numberOfVertices; ++i)
+	// Switch y and z axes before the points are ordered, the order is computed from the final positions
+	if (mbSwitchYZAxesOnPLYFileLoad)
 	{
-		if (mbSwitchYZAxesOnPLYFileLoad)
+		for (i = 0; i < numberOfVertices; ++i)
 		{
-			float temp = (*out_vertices)[i].y;
-			(*out_vertices)[i].y = (*out_vertices)[i].z;
-			(*out_vertices)[i].z = temp;
+			std::swap(out_vertices[i].y, out_vertices[i].z);
 		}
-	
+	}
+
+	// put the points in Morton order, then every run of the buffer is a small box that can be frustum culled.  the
+	// octree keeps the points of every node together, in Morton order within the node.
+	uint32_t* pPointOrder = arena.AllocateArray< uint32_t >(numberOfVertices);
+	mPointOctree = PointOctree();
+	if (mbUsePointLOD)
+	{
+		DXPointOctree::Build(reinterpret_cast<const XMFLOAT3*>(out_vertices.data()), sizeof(DXGraphicsUtilities::vec3), numberOfVertices,
+			PointOctreeOptions(), mPointOctree, pPointOrder, &mOctreeBuildStats);
+		printf("  octree %zu nodes in %u levels, %.2f ms\n", mOctreeBuildStats.numNodes, mPointOctree.numLevels,
+			mOctreeBuildStats.mortonMs + mOctreeBuildStats.buildMs);
+	}
+	else
+	{
+		DXPointChunks::SortByMortonCode(reinterpret_cast<const XMFLOAT3*>(out_vertices.data()), sizeof(DXGraphicsUtilities::vec3),
+			numberOfVertices, pPointOrder);
+	}
+
+	// gather the points in their new order.  the final vertices are kept for CPU analysis, they are written in that
+	// order directly so the cloud is not held a second time.
+	DXGraphicsUtilities::vec3* pSortedVertices = arena.AllocateArray< DXGraphicsUtilities::vec3 >(numberOfVertices);
+	DXGraphicsUtilities::vec4* pSortedColors = arena.AllocateArray< DXGraphicsUtilities::vec4 >(numberOfVertices);
+	mvCloudVertices.clear();
+	mvCloudVertices.resize(numberOfVertices);
+	mPointSorter.Reset();
+	for (i = 0; i < numberOfVertices; ++i)
+	{
+		const DXGraphicsUtilities::vec3& position = out_vertices[pPointOrder[i]];
+		const DXGraphicsUtilities::vec4& color = out_colors[pPointOrder[i]];
+		pSortedVertices[i] = position;
+		pSortedColors[i] = color;
 
-		DXGraphicsUtilities::CloudVertexPosColor v;
-		v.Pos = XMFLOAT3{ (*out_vertices)[i].x, (*out_vertices)[i].y, (*out_vertices)[i].z }; 
-		v.Color = XMFLOAT4{ (*out_colors)[i].x,  (*out_colors)[i].y,  (*out_colors)[i].z, 
-							 (*out_colors)[i].w };
-		
 		//scale position of point
-		v.Pos.x *= scale.x; v.Pos.y *= scale.y; v.Pos.z *= scale.z;
-		mvCloudVertices.push_back(v);
+		DXGraphicsUtilities::CloudVertexPosColor& v = mvCloudVertices[i];
+		v.Pos = XMFLOAT3{ position.x * scale.x, position.y * scale.y, position.z * scale.z };
+		v.Color = XMFLOAT4{ color.x, color.y, color.z, color.w };
 	}
-	
-	
+
+	DXPointChunks::BuildChunks(reinterpret_cast<const XMFLOAT3*>(pSortedVertices), sizeof(DXGraphicsUtilities::vec3), numberOfVertices,
+		DXPointChunks::kDefaultChunkSize, mPointChunks);
+
 	//create vertex buffer, index buffer, vertexbuffer  view, index buffer view, constant buffer view
-	CreateD3DResources(pd3dDevice, pCBVSRVHeap, m_cbDescriptorIndex, *out_vertices, *out_colors, meshIndicesVector, scale);
+	CreateD3DResources(pd3dDevice, pCBVSRVHeap, m_cbDescriptorIndex, pSortedVertices, pSortedColors, numberOfVertices,
+		pMeshIndices, numberOfIndices, indexFormat, scale);
 	
 	UpdateBoundingBox();
 
-    // delete the vectors
-    delete  out_vertices;
-	delete  out_colors;
+	m_LoadStats.scratchStats = arena.GetStats();
+	printf("  %d points, scratch %.2f MB in %zu allocations, %zu heap blocks\n", numberOfVertices,
+		m_LoadStats.scratchStats.bytesAllocated / (1024.0 * 1024.0), m_LoadStats.scratchStats.numAllocations,
+		m_LoadStats.scratchStats.numHeapAllocations);
 
 	return S_OK;
 }
 
-bool DXPointCloud::LoadPLY(
-    const char* path,
-    std::vector< DXGraphicsUtilities::vec3 >& out_vertices,
-	std::vector< DXGraphicsUtilities::vec4 >& out_colors
-)
+HRESULT DXPointCloud::LoadPagedPointCloud(const char* filename,
+	ComPtr<ID3D12Device>        pd3dDevice,
+	ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
+	int cbDescriptorIndex,
+	const PointStreamOptions& options)
 {
-    printf("Loading Ply file %s...\n", path);
+	mpd3dDevice = pd3dDevice;
+	m_pCBVSRVHeap = pCBVSRVHeap;
+	m_cbDescriptorIndex = cbDescriptorIndex;
 
-    std::vector< DXGraphicsUtilities::vec3 > temp_vertices;
+	printf("Streaming paged point cloud %s...\n", filename);
 
+	mPointStreamer.SetSink(nullptr);
+	mPointStreamer.Close();
+	if (!mPointStreamer.Open(filename, options))
+	{
+		printf("  could not open %s\n", filename);
+		return E_FAIL;
+	}
+	mPointStreamer.SetSink(this);
+
+	// nothing is kept on the CPU besides the streamer's cache.  the nodes are encoded into mPointVertexFormat when
+	// they are placed in the pool, quantized against the bounds of the whole file so every node shares the constants.
+	const PointPageHeader& header = mPointStreamer.GetFile().GetHeader();
+	mvCloudVertices.clear();
+	mvPointVertexBytes.clear();
+	mPointChunks.clear();
+	mPointOctree = PointOctree();
+	mBBox.mMin = header.boundsMin;
+	mBBox.mMax = header.boundsMax;
+	mPointQuantization = VertexQuantization();
+	if (mPointVertexFormat != kPointVertexFormatFull)
+	{
+		mPointQuantization = DXVertexCompression::ComputeQuantization(mBBox);
+	}
 
-    // open the file and read it into char buffer
-    std::ifstream infile;
-    infile.open(path, std::ios::binary);
-    infile.seekg(0, std::ios::end);
-    size_t fileSize = infile.tellg();
-    std::vector< char > buffer; // used to store text data
-    buffer.resize(fileSize);
-    infile.seekg(0, std::ios::beg);
-    infile.read(&buffer[0], fileSize);
+	// the pool is larger than the budget, the ranges of evicted nodes stay in use for the frames in flight and the
+	// free ranges fragment.  the budget is in points of the file, a compact pool holds the same points in less memory.
+	UINT stride = DXVertexCompression::GetPointStride(mPointVertexFormat);
+	uint64_t poolPoints = (options.cacheBudget + options.cacheBudget / 4) / sizeof(DXGraphicsUtilities::CloudVertexPosColor);
+	poolPoints = std::min< uint64_t >(poolPoints, UINT_MAX / stride);
 
-    std::string strBuffer(buffer.data(), fileSize);
-    std::stringstream ss(strBuffer);
+	ThrowIfFailed(pd3dDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(poolPoints * stride),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_pPagePool)));
 
-    const int scanf_buffer_sz = 512; //hack since we switched from sscanf to sscanf_s
-    std::string strLine;
+	CD3DX12_RANGE readRange(0, 0);
+	m_pPagePool->Map(0, &readRange, reinterpret_cast<void**>(&m_pPagePoolData));
 
-	int numPoints = 0;
-	bool bReadingData = false;
+	m_pVertexBuffer = m_pPagePool;
+	m_vertexBufferView.BufferLocation = m_pPagePool->GetGPUVirtualAddress();
+	m_vertexBufferView.StrideInBytes = stride;
+	m_vertexBufferView.SizeInBytes = static_cast<UINT>(poolPoints * stride);
+	m_unVertexCount = static_cast<UINT>(poolPoints);
 
-    while (std::getline(ss, strLine, '\n'))
-    {
-        const char* lineHeader = strLine.c_str();
-        char firstWord[scanf_buffer_sz];
-		char cSecondWord[64];
-        sscanf_s(lineHeader, "%s", firstWord, scanf_buffer_sz);
-		
+	mvPageRanges.assign(header.numNodes, { 0, 0 });
+	mvFreePageRanges.assign(1, { 0, static_cast<uint32_t>(poolPoints) });
+	mvPendingPageFrees.clear();
+	mvUnplacedPages.clear();
+	mvStreamDraws.clear();
+	mPageFrame = 0;
 
-		if (strcmp(firstWord, "element") == 0)
-		{
-			// get second word in string.  this is start of actual data
-			int    firstWordLength = static_cast<int>(strlen(firstWord));
-			char* it = const_cast<char*>(lineHeader) + firstWordLength;
-			while (*it == ' ' || *it == '\t' || *it == '\0')
-			{
-				it++;
-			}
+	CreateConstantBuffer(pd3dDevice, cbDescriptorIndex);
 
-			sscanf_s(it, "%s", cSecondWord,64);
-			if (strcmp(cSecondWord, "vertex") == 0)
-			{
-				int secondWordLength = static_cast<int>(strlen(cSecondWord));
+	CreateProcessingRootSignature(pd3dDevice);
 
-				it = const_cast<char*>(lineHeader) + firstWordLength + secondWordLength+1;
-				while (*it == ' ' || *it == '\t' || *it == '\0')
-				{
-					it++;
-				}
+	CreateProcessingPipelineState(pd3dDevice);
 
-				sscanf_s(it, "%d", &numPoints);
-			}
+	printf("  %llu points in %u nodes, %.2f MB vertex buffer pool\n", header.numPoints, header.numNodes,
+		poolPoints * stride / (1024.0 * 1024.0));
+
+	return S_OK;
+}
+
+void DXPointCloud::OnNodesLoaded(const uint32_t* pNodes, size_t count, const DXPointStreamer& streamer)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!PlacePointPage(pNodes[i]))
+		{
+			mvUnplacedPages.push_back(pNodes[i]);
 		}
-		
-		if (strcmp(firstWord, "end_header") == 0)
+	}
+}
+
+void DXPointCloud::OnNodesEvicted(const uint32_t* pNodes, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		PointDrawRange& range = mvPageRanges[pNodes[i]];
+		if (range.numPoints)
+		{
+			// the command lists of the last frames may still draw from the range
+			mvPendingPageFrees.push_back({ range, mPageFrame });
+			range = { 0, 0 };
+		}
+		else
 		{
-			bReadingData = true;
-			continue; //go to next line ie back to top of while loop
+			mvUnplacedPages.erase(std::remove(mvUnplacedPages.begin(), mvUnplacedPages.end(), pNodes[i]), mvUnplacedPages.end());
 		}
+	}
+}
+
+bool DXPointCloud::PlacePointPage(uint32_t node)
+{
+	uint32_t numPoints = mPointStreamer.GetFile().GetNode(node).node.numPoints;
+	const DXGraphicsUtilities::CloudVertexPosColor* pPoints = mPointStreamer.GetNodePoints(node);
+	if (numPoints == 0 || !pPoints)
+	{
+		return true;
+	}
 
-		if (bReadingData)
+	// first fit, the nodes are at most a few hundred KB so the pool doesn't need anything smarter
+	for (size_t i = 0; i < mvFreePageRanges.size(); ++i)
+	{
+		PointDrawRange& freeRange = mvFreePageRanges[i];
+		if (freeRange.numPoints < numPoints)
+			continue;
+
+		mvPageRanges[node] = { freeRange.firstPoint, numPoints };
+		DXVertexCompression::EncodePoints(pPoints, numPoints, mPointVertexFormat, mPointQuantization,
+			m_pPagePoolData + size_t(freeRange.firstPoint) * DXVertexCompression::GetPointStride(mPointVertexFormat));
+
+		freeRange.firstPoint += numPoints;
+		freeRange.numPoints -= numPoints;
+		if (freeRange.numPoints == 0)
 		{
-			DXGraphicsUtilities::vec3 pos;
-			DXGraphicsUtilities::vec4 color;
-			sscanf_s(lineHeader, "%f %f %f %f %f %f %f\n", &pos.x, &pos.y, &pos.z, &color.x, &color.y, &color.z, &color.w);
-			out_vertices.push_back(pos);
-			out_colors.push_back(color);
+			mvFreePageRanges.erase(mvFreePageRanges.begin() + i);
 		}
-      
-    }
+		return true;
+	}
+
+	return false;
+}
+
+void DXPointCloud::FreePointPageRange(const PointDrawRange& range)
+{
+	auto next = std::lower_bound(mvFreePageRanges.begin(), mvFreePageRanges.end(), range,
+		[](const PointDrawRange& a, const PointDrawRange& b) { return a.firstPoint < b.firstPoint; });
+	next = mvFreePageRanges.insert(next, range);
+
+	// merge with the following and the preceding free range
+	if (next + 1 != mvFreePageRanges.end() && next->firstPoint + next->numPoints == (next + 1)->firstPoint)
+	{
+		next->numPoints += (next + 1)->numPoints;
+		mvFreePageRanges.erase(next + 1);
+	}
+	if (next != mvFreePageRanges.begin() && (next - 1)->firstPoint + (next - 1)->numPoints == next->firstPoint)
+	{
+		(next - 1)->numPoints += next->numPoints;
+		mvFreePageRanges.erase(next);
+	}
+}
+
+void DXPointCloud::StreamPointPages(const XMMATRIX& matWVP)
+{
+	++mPageFrame;
+
+	// the frames that could draw from these ranges are done
+	size_t numReleased = 0;
+	while (numReleased < mvPendingPageFrees.size() &&
+		mvPendingPageFrees[numReleased].frame + kPagePoolFramesInFlight <= mPageFrame)
+	{
+		FreePointPageRange(mvPendingPageFrees[numReleased].range);
+		++numReleased;
+	}
+	mvPendingPageFrees.erase(mvPendingPageFrees.begin(), mvPendingPageFrees.begin() + numReleased);
+
+	std::vector< uint32_t > unplaced;
+	unplaced.swap(mvUnplacedPages);
+	for (uint32_t node : unplaced)
+	{
+		if (!PlacePointPage(node))
+		{
+			mvUnplacedPages.push_back(node);
+		}
+	}
+
+	float fovY = m_pDXCamera ? m_pDXCamera->GetFOV() : XM_PIDIV4;
+	PointLODView view = DXPointOctree::CreateLODView(matWVP, fovY, mLODViewportHeight, mPointBudget);
+	mPointStreamer.Update(view, mvStreamDraws);
+}
+
+bool DXPointCloud::LoadPLY(
+    const char* path,
+    std::pmr::vector< DXGraphicsUtilities::vec3 >& out_vertices,
+	std::pmr::vector< DXGraphicsUtilities::vec4 >& out_colors
+)
+{
+    printf("Loading Ply file %s...\n", path);
+
+	// the file is mapped and converted by the header, ascii or binary.  the arrays come from the same arena as the
+	// output so they are moved, not copied.
+	PlyPointData data(out_vertices.get_allocator().resource());
+	if (!DXPlyParser::ParseFile(path, data))
+	{
+		return false;
+	}
+
+	out_vertices = std::move(data.positions);
+	out_colors = std::move(data.colors);
 
     return true;
 }
@@ -261,36 +437,45 @@ bool DXPointCloud::LoadPLY(
 bool DXPointCloud::CreateD3DResources(ComPtr<ID3D12Device>        pDevice,
 	ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
 	int cbDescriptorIndex,
-	const std::vector< DXGraphicsUtilities::vec3 >& vertices,
-	const std::vector< DXGraphicsUtilities::vec4 >& colors,
-	const std::vector<WORD>& meshIndices,
+	const DXGraphicsUtilities::vec3* pVertices,
+	const DXGraphicsUtilities::vec4* pColors,
+	size_t numVertices,
+	const UINT* pMeshIndices,
+	size_t numIndices,
+	IndexFormatRequest indexFormat,
 	DXGraphicsUtilities::vec3& scale)
 {
 	m_cbDescriptorIndex = cbDescriptorIndex;
 	m_pCBVSRVHeap = pCBVSRVHeap;
 
-	int numVerts = (int)vertices.size();
-	int numIndices = static_cast<int>(meshIndices.size());
-	int sizeOfVert = sizeof(DXGraphicsUtilities::CloudVertexPosColor);
-	void* vertexData = (void*)vertices.data();
-	void* indexData = (void*)meshIndices.data(); //data is WORD ie 16 bit int
+	int numVerts = (int)numVertices;
+	int sizeOfVert = DXVertexCompression::GetPointStride(mPointVertexFormat);
 
-	assert(colors.size() == vertices.size());
-
-	// create a vertex array
-	DXGraphicsUtilities::CloudVertexPosColor* verts = new DXGraphicsUtilities::CloudVertexPosColor[numVerts];
-
-	// create an array of vertices.  we will submit this to D3D to create a D3D vertex buffer resource
-	for (int i = 0; i < numVerts; ++i)
+	// quantize positions against the bounds of the cloud, the renderer undoes it with GetPointDequantizationMatrix.
+	// the encoded points stay on the CPU for the sorted gather in Update.
+	mPointQuantization = VertexQuantization();
+	if (mPointVertexFormat != kPointVertexFormatFull && numVertices > 0)
 	{
-		DXGraphicsUtilities::CloudVertexPosColor v =
-		{ XMFLOAT3(vertices[i].x,  vertices[i].y, vertices[i].z),
-			XMFLOAT4(colors[i].x/255.0f,colors[i].y / 255.0f, colors[i].z / 255.0f, colors[i].w / 255.0f)};
-
-		verts[i] = v; //store vertex in heap array
+		DXGraphicsUtilities::BoundingBox bounds;
+		bounds.mMin = XMFLOAT3(pVertices[0].x, pVertices[0].y, pVertices[0].z);
+		bounds.mMax = bounds.mMin;
+		for (size_t i = 1; i < numVertices; ++i)
+		{
+			bounds.mMin = XMFLOAT3(std::min(bounds.mMin.x, pVertices[i].x), std::min(bounds.mMin.y, pVertices[i].y), std::min(bounds.mMin.z, pVertices[i].z));
+			bounds.mMax = XMFLOAT3(std::max(bounds.mMax.x, pVertices[i].x), std::max(bounds.mMax.y, pVertices[i].y), std::max(bounds.mMax.z, pVertices[i].z));
+		}
+		mPointQuantization = DXVertexCompression::ComputeQuantization(bounds);
 	}
 
-	// Create and populate the vertex buffer
+	mPointCompressionStats = PointCompressionStats();
+	DXVertexCompression::EncodePoints(pVertices, pColors, numVertices, mPointVertexFormat, mPointQuantization, mvPointVertexBytes,
+		&mPointCompressionStats);
+
+	printf("  %d byte points: %zu -> %zu bytes, max error position %g color %g, %.2f ms\n", sizeOfVert,
+		mPointCompressionStats.sourceBytes, mPointCompressionStats.compressedBytes, mPointCompressionStats.maxPositionError,
+		mPointCompressionStats.maxColorError, mPointCompressionStats.encodeMs);
+
+	// Create and populate the vertex buffer.
 	{
 		pDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
 			D3D12_HEAP_FLAG_NONE,
@@ -302,7 +487,9 @@ bool DXPointCloud::CreateD3DResources(ComPtr<ID3D12Device>        pDevice,
 		UINT8* pMappedBuffer;
 		CD3DX12_RANGE readRange(0, 0);
 		m_pVertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMappedBuffer));
-		memcpy(pMappedBuffer, verts, numVerts * sizeOfVert); //copy vertices into GPU VB
+
+		memcpy(pMappedBuffer, mvPointVertexBytes.data(), mvPointVertexBytes.size());
+
 		m_pVertexBuffer->Unmap(0, nullptr);
 
 		m_vertexBufferView.BufferLocation = m_pVertexBuffer->GetGPUVirtualAddress();
@@ -310,60 +497,14 @@ bool DXPointCloud::CreateD3DResources(ComPtr<ID3D12Device>        pDevice,
 		m_vertexBufferView.SizeInBytes = numVerts * sizeOfVert;
 	}
 
-	// Create and populate the index buffer
-	{
-		pDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint16_t) * numIndices),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_pIndexBuffer));
-
-		UINT8* pMappedBuffer;
-		CD3DX12_RANGE readRange(0, 0);
-		m_pIndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMappedBuffer));
-		memcpy(pMappedBuffer, indexData, sizeof(uint16_t) * numIndices);  //copy indices into GPU IB
-		m_pIndexBuffer->Unmap(0, nullptr);
-
-		m_indexBufferView.BufferLocation = m_pIndexBuffer->GetGPUVirtualAddress();
-		m_indexBufferView.Format = DXGI_FORMAT_R16_UINT;
-		m_indexBufferView.SizeInBytes = sizeof(uint16_t) * numIndices;
-	}
-
+	// Create and populate the index buffer.  Large clouds are drawn as several 64K point ranges.
+	CreateIndexBuffer(pDevice.Get(), pMeshIndices, numIndices, 1, indexFormat);
 
-	// Create a constant buffer to hold the global shader data 
-	{
-		pDevice->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(1024 * 64), //min size is PointSpriteShaderData
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_pConstantBuffer));
 
-		// Keep as persistently mapped buffer
-		UINT8* pBuffer;
-		CD3DX12_RANGE readRange(0, 0);
-		m_pConstantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pBuffer));
-		m_pConstantBufferData = pBuffer;
-
-
-		//get a handle in the srv-cbv-uav descriptor heap
-		CD3DX12_CPU_DESCRIPTOR_HANDLE cbvHandle(m_pCBVSRVHeap->GetCPUDescriptorHandleForHeapStart());
-		cbvHandle.Offset(cbDescriptorIndex, pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
-		
-		//create a buffer view attached to the descriptor
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-		cbvDesc.BufferLocation = m_pConstantBuffer->GetGPUVirtualAddress();
-		cbvDesc.SizeInBytes = (sizeof(PointSpriteShaderData) + 255) & ~255; // Pad to 256 bytes
-
-		pDevice->CreateConstantBufferView(&cbvDesc, cbvHandle);
-	}
+	CreateConstantBuffer(pDevice, cbDescriptorIndex);
 
 	m_unVertexCount = numVerts;
 
-	delete verts;
-
 	CreateProcessingRootSignature(pDevice);
 
 	CreateProcessingPipelineState(pDevice);
@@ -371,13 +512,43 @@ bool DXPointCloud::CreateD3DResources(ComPtr<ID3D12Device>        pDevice,
 	return true;
 }
 
+void DXPointCloud::CreateConstantBuffer(ComPtr<ID3D12Device> pDevice, int cbDescriptorIndex)
+{
+	// Create a constant buffer to hold the global shader data 
+	pDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(1024 * 64), //min size is PointSpriteShaderData
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_pConstantBuffer));
+
+	// Keep as persistently mapped buffer
+	UINT8* pBuffer;
+	CD3DX12_RANGE readRange(0, 0);
+	m_pConstantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pBuffer));
+	m_pConstantBufferData = pBuffer;
+
+
+	//get a handle in the srv-cbv-uav descriptor heap
+	CD3DX12_CPU_DESCRIPTOR_HANDLE cbvHandle(m_pCBVSRVHeap->GetCPUDescriptorHandleForHeapStart());
+	cbvHandle.Offset(cbDescriptorIndex, pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+	
+	//create a buffer view attached to the descriptor
+	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+	cbvDesc.BufferLocation = m_pConstantBuffer->GetGPUVirtualAddress();
+	cbvDesc.SizeInBytes = (sizeof(PointSpriteShaderData) + 255) & ~255; // Pad to 256 bytes
+
+	pDevice->CreateConstantBufferView(&cbvDesc, cbvHandle);
+}
+
 void DXPointCloud::RenderPointCloud(ComPtr<ID3D12GraphicsCommandList> & pCommandList, const XMMATRIX &matMVP)
 {
 	UINT nCBVSRVDescriptorSize = mpd3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);;
 	
 	//copy mvp matrix data into the constant buffer
 	DirectX::XMFLOAT4X4 mvp4x4;
-	XMStoreFloat4x4(&mvp4x4, XMMatrixTranspose(matMVP));
+	XMStoreFloat4x4(&mvp4x4, XMMatrixTranspose(GetPointDequantizationMatrix() * matMVP));
 	memcpy(m_pConstantBufferData, &mvp4x4, sizeof(mvp4x4));
 
 
@@ -398,8 +569,52 @@ void DXPointCloud::RenderPointCloud(ComPtr<ID3D12GraphicsCommandList> & pCommand
 	// Bind the VB/IB and draw
 	pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
 	pCommandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+
+	// the nodes of a paged cloud are ranges of the page pool, there is no index buffer
+	if (IsPaged())
+	{
+		StreamPointPages(matMVP);
+		for (const PointStreamDraw& draw : mvStreamDraws)
+		{
+			const PointDrawRange& page = mvPageRanges[draw.node];
+			if (page.numPoints)
+			{
+				pCommandList->DrawInstanced(draw.numPoints, 1, page.firstPoint + draw.firstPoint, 0);
+			}
+		}
+		return;
+	}
+
 	pCommandList->IASetIndexBuffer(&m_indexBufferView);
-	pCommandList->DrawIndexedInstanced((UINT)m_unVertexCount, 1, 0, 0, 0);
+
+	// the index buffer lists the points in order, so a visible range of points is the same range of indices.  it
+	// is clipped against the 16 bit index ranges.
+	if (IsPointLODActive())
+	{
+		SelectPointLOD(matMVP);
+		mvVisiblePointRanges.clear();
+		for (const PointLODDraw& draw : mvLODDraws)
+		{
+			mvVisiblePointRanges.push_back({ draw.firstPoint, draw.numPoints });
+		}
+	}
+	else
+	{
+		CullPointChunks(matMVP);
+	}
+
+	for (const IndexDrawRange& range : m_IndexRanges)
+	{
+		for (const PointDrawRange& visible : mvVisiblePointRanges)
+		{
+			UINT begin = std::max(range.startIndex, visible.firstPoint);
+			UINT end = std::min(range.startIndex + range.indexCount, visible.firstPoint + visible.numPoints);
+			if (begin < end)
+			{
+				pCommandList->DrawIndexedInstanced(end - begin, 1, begin, range.baseVertex, 0);
+			}
+		}
+	}
 }
 
 void DXPointCloud::RenderPointSpriteCloud(ComPtr<ID3D12GraphicsCommandList>& pCommandList,
@@ -429,7 +644,48 @@ void DXPointCloud::RenderPointSpriteCloud(ComPtr<ID3D12GraphicsCommandList>& pCo
 	// Bind the VB and draw
 	pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
 	pCommandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-	pCommandList->DrawInstanced((UINT)m_unVertexCount, 1, 0, 0);
+
+	//quad size of each draw, third parameter of the root
+	int quad_size_root_parameter = 2;
+
+	if (IsPaged())
+	{
+		StreamPointPages(matWVP);
+		for (const PointStreamDraw& draw : mvStreamDraws)
+		{
+			const PointDrawRange& page = mvPageRanges[draw.node];
+			if (!page.numPoints)
+				continue;
+
+			float splatSize = draw.spacing * mLODSplatScale;
+			XMFLOAT4 drawQuadSize4 = { std::max(mQuadSize.x, splatSize), std::max(mQuadSize.y, splatSize), 0.0f, 0.0f };
+			pCommandList->SetGraphicsRoot32BitConstants(quad_size_root_parameter, 4, &drawQuadSize4, 0);
+			pCommandList->DrawInstanced(draw.numPoints, 1, page.firstPoint + draw.firstPoint, 0);
+		}
+	}
+	else if (IsPointLODActive())
+	{
+		// a range is drawn with quads as large as the spacing of its points, never smaller than mQuadSize
+		SelectPointLOD(matWVP);
+		for (const PointLODDraw& draw : mvLODDraws)
+		{
+			float splatSize = draw.spacing * mLODSplatScale;
+			XMFLOAT4 drawQuadSize4 = { std::max(mQuadSize.x, splatSize), std::max(mQuadSize.y, splatSize), 0.0f, 0.0f };
+			pCommandList->SetGraphicsRoot32BitConstants(quad_size_root_parameter, 4, &drawQuadSize4, 0);
+			pCommandList->DrawInstanced(draw.numPoints, 1, draw.firstPoint, 0);
+		}
+	}
+	else
+	{
+		XMFLOAT4 quadSize4 = { mQuadSize.x, mQuadSize.y, 0.0f, 0.0f };
+		pCommandList->SetGraphicsRoot32BitConstants(quad_size_root_parameter, 4, &quadSize4, 0);
+
+		CullPointChunks(matWVP);
+		for (const PointDrawRange& visible : mvVisiblePointRanges)
+		{
+			pCommandList->DrawInstanced(visible.numPoints, 1, visible.firstPoint, 0);
+		}
+	}
 
 	//Bind the IB and draw
 	//pCommandList->IASetIndexBuffer(&m_indexBufferView);
@@ -437,6 +693,41 @@ void DXPointCloud::RenderPointSpriteCloud(ComPtr<ID3D12GraphicsCommandList>& pCo
 	
 }
 
+void DXPointCloud::CullPointChunks(const XMMATRIX& matWVP)
+{
+	// the CPU sort gathers the points in depth order, the chunks don't describe the buffer then
+	if (!mbUseChunkCulling || mbUseCPUPointSort || mPointChunks.empty())
+	{
+		mvVisiblePointRanges.assign(1, { 0, static_cast<uint32_t>(m_unVertexCount) });
+		return;
+	}
+
+	// the planes of the world view projection matrix are in the object space of the points
+	MeshletCullView view = DXMeshletCuller::CreateCullView(XMMatrixIdentity(), XMMatrixIdentity(), matWVP);
+
+	mChunkCullStats = PointChunkCullStats();
+	DXPointChunks::CullChunks(mPointChunks.data(), mPointChunks.size(), view, mvVisiblePointRanges, &mChunkCullStats);
+}
+
+void DXPointCloud::SelectPointLOD(const XMMATRIX& matWVP)
+{
+	float fovY = m_pDXCamera ? m_pDXCamera->GetFOV() : XM_PIDIV4;
+	PointLODView view = DXPointOctree::CreateLODView(matWVP, fovY, mLODViewportHeight, mPointBudget);
+
+	mLODSelectStats = PointLODSelectStats();
+	DXPointOctree::SelectNodes(mPointOctree, view, mvLODDraws, &mLODSelectStats);
+}
+
+XMMATRIX DXPointCloud::GetPointDequantizationMatrix() const
+{
+	if (mPointVertexFormat == kPointVertexFormatFull)
+		return XMMatrixIdentity();
+
+	const XMFLOAT3& offset = mPointQuantization.positionOffset;
+	const XMFLOAT3& scale = mPointQuantization.positionScale;
+	return XMMatrixScaling(scale.x, scale.y, scale.z) * XMMatrixTranslation(offset.x, offset.y, offset.z);
+}
+
 void DXPointCloud::UpdateShaderData(const XMMATRIX& matWVP, const XMMATRIX& matVP, const XMMATRIX& view)
 {
 	XMStoreFloat4x4(&mShaderData.g_WVPMatrix, XMMatrixTranspose(matWVP));
@@ -459,6 +750,12 @@ void DXPointCloud::UpdateShaderData(const XMMATRIX& matWVP, const XMMATRIX& matV
 	XMFLOAT4 quadSize4 = { quad_size.x, quad_size.y, 0.0f, 0.0f };
 	mShaderData.gQuadSize = quadSize4;
 
+	//the sprite vertex shader dequantizes the point centers itself, the geometry shader needs them in world space
+	const XMFLOAT3& offset = mPointQuantization.positionOffset;
+	const XMFLOAT3& scale = mPointQuantization.positionScale;
+	mShaderData.gPositionOffset = { offset.x, offset.y, offset.z, 0.0f };
+	mShaderData.gPositionScale = { scale.x, scale.y, scale.z, 0.0f };
+
 	memcpy(m_pConstantBufferData, &mShaderData, sizeof(mShaderData));
 }
 
@@ -10,11 +10,16 @@ using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
 #include "DXMesh.h"
+#include "DXPointSorter.h"
+#include "DXPointChunks.h"
+#include "DXPointOctree.h"
+#include "DXPointDownsample.h"
+#include "DXPointStreamer.h"
 #include <vector>
 
 class DXCamera;
 
-class DXPointCloud : public DXMesh
+class DXPointCloud : public DXMesh, public IPointPageSink
 {
 public:
 	DXPointCloud();
@@ -27,7 +32,23 @@ public:
 		ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
 		int cbDescriptorIndex,
 		DXGraphicsUtilities::vec3& scale,
-		bool bSwitchYZAxes);
+		bool bSwitchYZAxes,
+		IndexFormatRequest indexFormat = kIndexFormat16Bit);
+
+	//streams a .dxpoints file (see DXPointPages::WritePageFile) instead of loading every point.  the resident nodes
+	//are suballocated from one upload heap vertex buffer the size of the cache budget, the points are drawn in
+	//kPointVertexFormatFull with the spacing of their level like the octree LOD.
+	HRESULT LoadPagedPointCloud(const char* filename,
+		ComPtr<ID3D12Device>        pd3dDevice,
+		ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
+		int cbDescriptorIndex,
+		const PointStreamOptions& options = PointStreamOptions());
+	bool IsPaged() const { return mPointStreamer.IsOpen(); }
+	const DXPointStreamer& GetPointStreamer() const { return mPointStreamer; }
+
+	// IPointPageSink, called by the streamer from RenderPointCloud and RenderPointSpriteCloud
+	virtual void OnNodesLoaded(const uint32_t* pNodes, size_t count, const DXPointStreamer& streamer) override;
+	virtual void OnNodesEvicted(const uint32_t* pNodes, size_t count) override;
 
 	void Update(DXCamera* pCamera);
 
@@ -39,6 +60,28 @@ public:
 	void CreateBoxPointCloudFile(const char* filename, float box_size);
 
 	void SetUseCPUPointSort(bool bUseCPUSort) { mbUseCPUPointSort = bUseCPUSort; }
+	void SetUseTemporalPointSort(bool bUseTemporalSort) { mPointSorter.SetUseTemporalCoherence(bUseTemporalSort); }
+	const PointSortStats& GetPointSortStats() const { return mPointSorter.GetStats(); }
+	void SetUseChunkCulling(bool bUseChunkCulling) { mbUseChunkCulling = bUseChunkCulling; }
+	const PointChunkCullStats& GetChunkCullStats() const { return mChunkCullStats; }
+	//the octree is built by LoadPointCloudFromFile, set before loading
+	void SetUsePointLOD(bool bUsePointLOD) { mbUsePointLOD = bUsePointLOD; }
+	void SetPointBudget(size_t pointBudget) { mPointBudget = pointBudget; }
+	void SetLODViewportHeight(float viewportHeight) { mLODViewportHeight = viewportHeight; }
+	const PointOctreeBuildStats& GetOctreeBuildStats() const { return mOctreeBuildStats; }
+	const PointLODSelectStats& GetLODSelectStats() const { return mLODSelectStats; }
+	//duplicate removal and voxel grid downsampling of the loaded points, set before loading.  exact duplicates are
+	//removed by default, the voxel size (in the units of the file) depends on the scan and is off.
+	void SetPointDownsampleOptions(const PointDownsampleOptions& options) { mPointDownsampleOptions = options; }
+	const PointDownsampleStats& GetPointDownsampleStats() const { return mPointDownsampleStats; }
+	//vertex buffer layout, set before loading.  the compact layouts need the pso with the matching input layout (see
+	//DXModel) and are dequantized with GetPointDequantizationMatrix.  12 byte points by default.
+	void SetPointVertexFormat(PointVertexFormat format) { mPointVertexFormat = format; }
+	PointVertexFormat GetPointVertexFormat() const { return mPointVertexFormat; }
+	const VertexQuantization& GetPointQuantization() const { return mPointQuantization; }
+	const PointCompressionStats& GetPointCompressionStats() const { return mPointCompressionStats; }
+	//maps the unorm positions of the vertex buffer back to object space, identity for kPointVertexFormatFull
+	XMMATRIX GetPointDequantizationMatrix() const;
 	XMFLOAT2& GetQuadSize() { return  mQuadSize; }
 
 	static ComPtr<ID3D12RootSignature>& GetProcessingRootSignature() {
@@ -50,27 +93,78 @@ public:
 	
 	
 protected:
-	bool DXPointCloud::LoadPLY(const char* path, std::vector< DXGraphicsUtilities::vec3 >& out_vertices, 
-								std::vector< DXGraphicsUtilities::vec4 >& out_colors);
+	//ascii, binary_little_endian or binary_big_endian, see DXPlyParser.  the arrays come from the thread's DXLoadArena
+	bool DXPointCloud::LoadPLY(const char* path, std::pmr::vector< DXGraphicsUtilities::vec3 >& out_vertices, 
+								std::pmr::vector< DXGraphicsUtilities::vec4 >& out_colors);
 
 
 	//create vertex buffer, index buffer, vertexbuffer  view, index buffer view, constant buffer view
 	bool CreateD3DResources(ComPtr<ID3D12Device>        pDevice,
 		ComPtr<ID3D12DescriptorHeap> pCBVSRVHeap,
 		int cbDescriptorIndex,
-		const std::vector< DXGraphicsUtilities::vec3 >& vertices,
-		const std::vector< DXGraphicsUtilities::vec4 >& colors,
-		const std::vector<WORD>& meshIndices,
+		const DXGraphicsUtilities::vec3* pVertices,
+		const DXGraphicsUtilities::vec4* pColors,
+		size_t numVertices,
+		const UINT* pMeshIndices,
+		size_t numIndices,
+		IndexFormatRequest indexFormat,
 		DXGraphicsUtilities::vec3& scale);
 
+	//persistently mapped constant buffer for the shader data and its view at cbDescriptorIndex
+	void CreateConstantBuffer(ComPtr<ID3D12Device> pDevice, int cbDescriptorIndex);
+
 	static void CreateProcessingRootSignature(ComPtr<ID3D12Device> pDevice);
 	static void CreateProcessingPipelineState(ComPtr<ID3D12Device> pDevice);
 
 	void UpdateBoundingBox();
-	void SortPointCloud(DXCamera* pCamera);
+	//the ranges of the vertex buffer to draw with this matrix.  everything when chunk culling is off or the points
+	//are sorted on the CPU.
+	void CullPointChunks(const XMMATRIX& matWVP);
+	//the ranges of the octree nodes selected for this matrix and their spacing
+	void SelectPointLOD(const XMMATRIX& matWVP);
+	bool IsPointLODActive() const { return mbUsePointLOD && !mbUseCPUPointSort && !mPointOctree.IsEmpty(); }
+	//updates the streamer with the view of this matrix, mvStreamDraws are the resident ranges to draw then
+	void StreamPointPages(const XMMATRIX& matWVP);
+	//copies the points of a resident node to a free range of the page pool, false if no range is large enough
+	bool PlacePointPage(uint32_t node);
+	void FreePointPageRange(const PointDrawRange& range);
+
+	//back to front order of mvCloudVertices for the camera position
+	const std::vector< uint32_t >& SortPointCloud(DXCamera* pCamera);
 
 	DXGraphicsUtilities::BoundingBox mBBox;
 	std::vector< DXGraphicsUtilities::CloudVertexPosColor> mvCloudVertices;
+	std::vector< uint8_t > mvPointVertexBytes;           //the vertex buffer in mPointVertexFormat, gathered by the CPU sort
+	PointVertexFormat mPointVertexFormat = kPointVertexFormatCompact12;
+	VertexQuantization mPointQuantization;
+	PointCompressionStats mPointCompressionStats;
+	PointDownsampleOptions mPointDownsampleOptions;
+	PointDownsampleStats mPointDownsampleStats;
+	DXPointSorter mPointSorter;
+	std::vector< PointChunk > mPointChunks;              //Morton ordered runs of the vertex buffer
+	std::vector< PointDrawRange > mvVisiblePointRanges;
+	PointChunkCullStats mChunkCullStats;
+	PointOctree mPointOctree;                            //nodes reference ranges of the vertex buffer
+	std::vector< PointLODDraw > mvLODDraws;
+	PointOctreeBuildStats mOctreeBuildStats;
+	PointLODSelectStats mLODSelectStats;
+
+	// paged clouds
+	struct PendingPageFree
+	{
+		PointDrawRange range;
+		size_t frame;                                    //mPageFrame when the node was evicted
+	};
+
+	DXPointStreamer mPointStreamer;
+	ComPtr<ID3D12Resource> m_pPagePool;                  //vertex buffer of the resident nodes, upload heap
+	UINT8* m_pPagePoolData = nullptr;                    //persistently mapped
+	std::vector< PointDrawRange > mvPageRanges;          //range of every node in the pool, numPoints 0 when not in it
+	std::vector< PointDrawRange > mvFreePageRanges;      //sorted by firstPoint, neighbours merged
+	std::vector< PendingPageFree > mvPendingPageFrees;   //ranges of evicted nodes the GPU may still read
+	std::vector< uint32_t > mvUnplacedPages;             //resident nodes that did not fit the pool yet
+	std::vector< PointStreamDraw > mvStreamDraws;
+	size_t mPageFrame = 0;
 
 	void UpdateShaderData(const XMMATRIX& matWVP, const XMMATRIX& matVP, const XMMATRIX& view);
 
@@ -82,6 +176,8 @@ protected:
 		XMFLOAT4X4 gInvView;
 		XMFLOAT4 gEyePosW;
 		XMFLOAT4 gQuadSize; //only uses first 2 floats
+		XMFLOAT4 gPositionOffset; //dequantization of the compact point formats, only uses first 3 floats
+		XMFLOAT4 gPositionScale;
 	};
 
 	PointSpriteShaderData mShaderData;
@@ -96,6 +192,11 @@ protected:
 
 	bool mbSwitchYZAxesOnPLYFileLoad = false;  //Scaniverse created .ply files need this set to true
 	bool mbUseCPUPointSort = false;  //sort based on point distance to camera
+	bool mbUseChunkCulling = true;   //draw only the chunks inside the frustum
+	bool mbUsePointLOD = true;       //draw the octree nodes that fit the point budget instead of the chunks
+	size_t mPointBudget = 10000000;
+	float mLODViewportHeight = 1080.0f;
+	float mLODSplatScale = 1.0f;     //quad size relative to the spacing of the points of a level
 	float mDebugBoxPointCloudResolution = 0.005f;  //spacing between points in box shaped cloud
 	float mDebugPointCloudBoxSize = 0.5f;  //dimension of a side of box
 	bool mbDebugFrontFaceWriteOnly = false;  //write only z plane of cube to file
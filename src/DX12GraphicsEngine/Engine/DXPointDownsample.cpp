@@ -0,0 +1,437 @@
+#include "stdafx.h"
+#include "DXPointDownsample.h"
+#include "DXPointSorter.h"
+#include "DXParallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	const uint32_t kVoxelBits = 21;
+	const uint32_t kMaxVoxelCell = (1u << kVoxelBits) - 1;
+
+	double GetElapsedMs(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	inline uint64_t MixBits(uint64_t value)
+	{
+		value ^= value >> 31;
+		value *= 0xbf58476d1ce4e5b9ull;
+		value ^= value >> 29;
+		value *= 0x94d049bb133111ebull;
+		value ^= value >> 32;
+		return value;
+	}
+
+	inline uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	//the key of the duplicate removal, position and color bit for bit
+	struct PointBits
+	{
+		uint32_t words[7];
+
+		PointBits(const vec3& position, const vec4& color)
+		{
+			words[0] = FloatBits(position.x);
+			words[1] = FloatBits(position.y);
+			words[2] = FloatBits(position.z);
+			words[3] = FloatBits(color.x);
+			words[4] = FloatBits(color.y);
+			words[5] = FloatBits(color.z);
+			words[6] = FloatBits(color.w);
+		}
+
+		bool operator<(const PointBits& other) const
+		{
+			return std::lexicographical_compare(words, words + 7, other.words, other.words + 7);
+		}
+
+		bool operator==(const PointBits& other) const
+		{
+			return std::equal(words, words + 7, other.words);
+		}
+
+		uint32_t GetHash() const
+		{
+			uint64_t hash = 0;
+			for (uint32_t word : words)
+			{
+				hash = MixBits(hash ^ word);
+			}
+			return static_cast<uint32_t>(hash >> 32);
+		}
+	};
+
+	//the voxels of a grid over the bounds of the points, 21 bits per axis
+	struct VoxelGrid
+	{
+		vec3 origin;
+		float voxelSize;
+		float scale;
+
+		VoxelGrid(const vec3* pPositions, size_t numPoints, float minVoxelSize)
+		{
+			vec3 boundsMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+			vec3 boundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (size_t i = 0; i < numPoints; ++i)
+			{
+				const vec3& p = pPositions[i];
+				boundsMin = { std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z) };
+				boundsMax = { std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z) };
+			}
+
+			float extent = numPoints ? std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y), boundsMax.z - boundsMin.z) : 0.0f;
+
+			origin = numPoints ? boundsMin : vec3{ 0.0f, 0.0f, 0.0f };
+			voxelSize = std::max(minVoxelSize, extent / kMaxVoxelCell);
+			scale = voxelSize > 0.0f ? 1.0f / voxelSize : 0.0f;
+		}
+
+		uint32_t GetCell(float value, float cellOrigin) const
+		{
+			float cell = (value - cellOrigin) * scale;
+			return cell <= 0.0f ? 0 : std::min(static_cast<uint32_t>(cell), kMaxVoxelCell);
+		}
+
+		uint64_t GetKey(const vec3& p) const
+		{
+			return static_cast<uint64_t>(GetCell(p.x, origin.x)) | (static_cast<uint64_t>(GetCell(p.y, origin.y)) << kVoxelBits) |
+				(static_cast<uint64_t>(GetCell(p.z, origin.z)) << (2 * kVoxelBits));
+		}
+	};
+
+	//puts the points with equal keys together.  out_indices are the points sorted by hash and key, first point first
+	//within a group, out_groupStarts the start of every group in out_indices in the order of the first points of the
+	//groups.  a group ends where the next group in out_indices starts, out_isStart marks the starts.
+	template < typename HashFunc, typename LessFunc >
+	void GroupPoints(size_t numPoints, HashFunc getHash, LessFunc isLess, std::vector< uint32_t >& out_indices,
+		std::vector< uint8_t >& out_isStart, std::vector< uint32_t >& out_groupStarts, uint32_t numThreads)
+	{
+		out_indices.resize(numPoints);
+		out_isStart.assign(numPoints, 0);
+		out_groupStarts.clear();
+		if (numPoints == 0)
+			return;
+
+		std::vector< uint32_t > hashes(numPoints);
+		{
+			std::vector< uint64_t > pairs(numPoints);
+			DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					pairs[i] = (static_cast<uint64_t>(getHash(i)) << 32) | i;
+				}
+			}, numThreads);
+
+			std::vector< uint64_t > scratch;
+			DXPointSorter::RadixSort(pairs, scratch, numThreads);
+
+			DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					out_indices[i] = static_cast<uint32_t>(pairs[i]);
+					hashes[i] = static_cast<uint32_t>(pairs[i] >> 32);
+				}
+			}, numThreads);
+		}
+
+		// a range splits the hash runs that start in it, a run can end in the next range
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			size_t i = begin;
+			while (i < end && i > 0 && hashes[i] == hashes[i - 1])
+			{
+				++i;
+			}
+
+			while (i < end)
+			{
+				size_t runEnd = i + 1;
+				while (runEnd < numPoints && hashes[runEnd] == hashes[i])
+				{
+					++runEnd;
+				}
+
+				out_isStart[i] = 1;
+
+				// different keys with the same hash.  the stable sort keeps the points of a key in file order.
+				uint32_t* pRun = &out_indices[i];
+				size_t runSize = runEnd - i;
+				bool bCollision = false;
+				for (size_t k = 1; k < runSize && !bCollision; ++k)
+				{
+					bCollision = isLess(pRun[0], pRun[k]) || isLess(pRun[k], pRun[0]);
+				}
+
+				if (bCollision)
+				{
+					std::stable_sort(pRun, pRun + runSize, isLess);
+					for (size_t k = 1; k < runSize; ++k)
+					{
+						out_isStart[i + k] = isLess(pRun[k - 1], pRun[k]) ? 1 : 0;
+					}
+				}
+
+				i = runEnd;
+			}
+		}, numThreads);
+
+		// order the groups by their first point.  firstOf[point] is the start + 1 of the group the point is first of.
+		std::vector< uint32_t > firstOf(numPoints, 0);
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				if (out_isStart[i])
+				{
+					firstOf[out_indices[i]] = static_cast<uint32_t>(i + 1);
+				}
+			}
+		}, numThreads);
+
+		// compact in blocks, count then write at the prefix sum of the counts
+		size_t numBlocks = (numPoints + DXParallel::kMinRangePoints - 1) / DXParallel::kMinRangePoints;
+		std::vector< size_t > blockOffsets(numBlocks + 1, 0);
+		DXParallel::ParallelFor(numBlocks, [&](size_t block)
+		{
+			size_t end = std::min(numPoints, (block + 1) * DXParallel::kMinRangePoints);
+			size_t count = 0;
+			for (size_t i = block * DXParallel::kMinRangePoints; i < end; ++i)
+			{
+				count += firstOf[i] ? 1 : 0;
+			}
+			blockOffsets[block + 1] = count;
+		}, numThreads);
+
+		for (size_t block = 0; block < numBlocks; ++block)
+		{
+			blockOffsets[block + 1] += blockOffsets[block];
+		}
+
+		out_groupStarts.resize(blockOffsets[numBlocks]);
+		DXParallel::ParallelFor(numBlocks, [&](size_t block)
+		{
+			size_t end = std::min(numPoints, (block + 1) * DXParallel::kMinRangePoints);
+			size_t out = blockOffsets[block];
+			for (size_t i = block * DXParallel::kMinRangePoints; i < end; ++i)
+			{
+				if (firstOf[i])
+				{
+					out_groupStarts[out++] = firstOf[i] - 1;
+				}
+			}
+		}, numThreads);
+	}
+
+	size_t RemoveDuplicates(const vec3* pPositions, const vec4* pColors, size_t numPoints, vec3* pOutPositions, vec4* pOutColors,
+		uint32_t numThreads)
+	{
+		std::vector< uint32_t > indices;
+		std::vector< uint8_t > isStart;
+		std::vector< uint32_t > groupStarts;
+		GroupPoints(numPoints,
+			[&](size_t i) { return PointBits(pPositions[i], pColors[i]).GetHash(); },
+			[&](uint32_t a, uint32_t b) { return PointBits(pPositions[a], pColors[a]) < PointBits(pPositions[b], pColors[b]); },
+			indices, isStart, groupStarts, numThreads);
+
+		DXParallel::ParallelForRange(groupStarts.size(), DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			for (size_t g = begin; g < end; ++g)
+			{
+				uint32_t first = indices[groupStarts[g]];
+				pOutPositions[g] = pPositions[first];
+				pOutColors[g] = pColors[first];
+			}
+		}, numThreads);
+
+		return groupStarts.size();
+	}
+
+	size_t MergeVoxels(const vec3* pPositions, const vec4* pColors, size_t numPoints, const VoxelGrid& grid,
+		const PointDownsampleOptions& options, vec3* pOutPositions, vec4* pOutColors, uint32_t numThreads)
+	{
+		std::vector< uint32_t > indices;
+		std::vector< uint8_t > isStart;
+		std::vector< uint32_t > groupStarts;
+		GroupPoints(numPoints,
+			[&](size_t i) { return static_cast<uint32_t>(MixBits(grid.GetKey(pPositions[i])) >> 32); },
+			[&](uint32_t a, uint32_t b) { return grid.GetKey(pPositions[a]) < grid.GetKey(pPositions[b]); },
+			indices, isStart, groupStarts, numThreads);
+
+		DXParallel::ParallelForRange(groupStarts.size(), DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			for (size_t g = begin; g < end; ++g)
+			{
+				size_t start = groupStarts[g];
+				size_t groupEnd = start + 1;
+				while (groupEnd < numPoints && !isStart[groupEnd])
+				{
+					++groupEnd;
+				}
+
+				uint32_t first = indices[start];
+				pOutPositions[g] = pPositions[first];
+				pOutColors[g] = pColors[first];
+
+				double count = static_cast<double>(groupEnd - start);
+				if (options.pointMode == kVoxelPointCentroid && count > 1.0)
+				{
+					double sum[3] = { 0.0, 0.0, 0.0 };
+					for (size_t k = start; k < groupEnd; ++k)
+					{
+						const vec3& p = pPositions[indices[k]];
+						sum[0] += p.x;
+						sum[1] += p.y;
+						sum[2] += p.z;
+					}
+					pOutPositions[g] = { static_cast<float>(sum[0] / count), static_cast<float>(sum[1] / count),
+						static_cast<float>(sum[2] / count) };
+				}
+
+				if (options.bAverageColors && count > 1.0)
+				{
+					double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+					for (size_t k = start; k < groupEnd; ++k)
+					{
+						const vec4& c = pColors[indices[k]];
+						sum[0] += c.x;
+						sum[1] += c.y;
+						sum[2] += c.z;
+						sum[3] += c.w;
+					}
+					pOutColors[g] = { static_cast<float>(sum[0] / count), static_cast<float>(sum[1] / count),
+						static_cast<float>(sum[2] / count), static_cast<float>(sum[3] / count) };
+				}
+			}
+		}, numThreads);
+
+		return groupStarts.size();
+	}
+}
+
+namespace DXPointDownsample
+{
+	size_t Downsample(const vec3* pPositions,
+		const vec4* pColors,
+		size_t numPoints,
+		const PointDownsampleOptions& options,
+		vec3* pOutPositions,
+		vec4* pOutColors,
+		PointDownsampleStats* pStats,
+		uint32_t numThreads)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		PointDownsampleStats stats;
+		stats.numInputPoints = numPoints;
+
+		size_t numOutPoints = numPoints;
+		if (options.bRemoveDuplicates)
+		{
+			numOutPoints = RemoveDuplicates(pPositions, pColors, numPoints, pOutPositions, pOutColors, numThreads);
+			stats.numDuplicates = numPoints - numOutPoints;
+			stats.duplicateMs = GetElapsedMs(start);
+		}
+		else
+		{
+			std::copy(pPositions, pPositions + numPoints, pOutPositions);
+			std::copy(pColors, pColors + numPoints, pOutColors);
+		}
+
+		if (options.voxelSize > 0.0f)
+		{
+			auto voxelStart = std::chrono::high_resolution_clock::now();
+
+			// the voxels of the points left, the grid is the same with or without the duplicates
+			std::vector< vec3 > positions(pOutPositions, pOutPositions + numOutPoints);
+			std::vector< vec4 > colors(pOutColors, pOutColors + numOutPoints);
+
+			VoxelGrid grid(positions.data(), numOutPoints, options.voxelSize);
+			stats.voxelSize = grid.voxelSize;
+
+			numOutPoints = MergeVoxels(positions.data(), colors.data(), numOutPoints, grid, options, pOutPositions, pOutColors, numThreads);
+			stats.voxelMs = GetElapsedMs(voxelStart);
+		}
+
+		stats.numOutputPoints = numOutPoints;
+		stats.totalMs = GetElapsedMs(start);
+
+		if (pStats)
+		{
+			*pStats = stats;
+		}
+
+		return numOutPoints;
+	}
+
+	bool CheckDownsample(const vec3* pPositions,
+		const vec4* pColors,
+		size_t numPoints,
+		const PointDownsampleOptions& options,
+		float voxelSize,
+		const vec3* pOutPositions,
+		const vec4* pOutColors,
+		size_t numOutPoints)
+	{
+		if (options.voxelSize > 0.0f)
+		{
+			// the grid of Downsample, the bounds don't change when duplicates are removed
+			VoxelGrid grid(pPositions, numPoints, voxelSize);
+
+			std::vector< uint64_t > inputKeys(numPoints);
+			for (size_t i = 0; i < numPoints; ++i)
+			{
+				inputKeys[i] = grid.GetKey(pPositions[i]);
+			}
+			std::sort(inputKeys.begin(), inputKeys.end());
+			inputKeys.erase(std::unique(inputKeys.begin(), inputKeys.end()), inputKeys.end());
+
+			std::vector< uint64_t > outputKeys(numOutPoints);
+			for (size_t i = 0; i < numOutPoints; ++i)
+			{
+				outputKeys[i] = grid.GetKey(pOutPositions[i]);
+			}
+			std::sort(outputKeys.begin(), outputKeys.end());
+
+			return outputKeys == inputKeys;
+		}
+
+		std::vector< PointBits > inputPoints;
+		inputPoints.reserve(numPoints);
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			inputPoints.emplace_back(pPositions[i], pColors[i]);
+		}
+		std::sort(inputPoints.begin(), inputPoints.end());
+		if (options.bRemoveDuplicates)
+		{
+			inputPoints.erase(std::unique(inputPoints.begin(), inputPoints.end()), inputPoints.end());
+		}
+
+		std::vector< PointBits > outputPoints;
+		outputPoints.reserve(numOutPoints);
+		for (size_t i = 0; i < numOutPoints; ++i)
+		{
+			outputPoints.emplace_back(pOutPositions[i], pOutColors[i]);
+		}
+		std::sort(outputPoints.begin(), outputPoints.end());
+
+		return outputPoints == inputPoints;
+	}
+}
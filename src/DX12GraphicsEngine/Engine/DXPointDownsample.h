@@ -0,0 +1,65 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include <vector>
+
+//the point that stands for the points of a voxel
+enum VoxelPointMode
+{
+	kVoxelPointCentroid,      //mean position of the points
+	kVoxelPointFirst          //the first of the points in the file, keeps the positions of the scan
+};
+
+struct PointDownsampleOptions
+{
+	bool bRemoveDuplicates = true;            //points with the same position and color as an earlier point
+	float voxelSize = 0.0f;                   //edge of a grid cell in object space, 0 keeps every distinct point
+	VoxelPointMode pointMode = kVoxelPointCentroid;
+	bool bAverageColors = true;               //mean color of a voxel, else the color of its first point
+};
+
+struct PointDownsampleStats
+{
+	size_t numInputPoints = 0;
+	size_t numDuplicates = 0;                 //removed as exact duplicates
+	size_t numOutputPoints = 0;
+	float voxelSize = 0.0f;                   //used, larger than asked when the grid would not fit 21 bits per axis
+	double duplicateMs = 0.0;
+	double voxelMs = 0.0;
+	double totalMs = 0.0;
+
+	float GetReduction() const { return numOutputPoints ? float(numInputPoints) / float(numOutputPoints) : 0.0f; }
+};
+
+//Load time reduction of a point cloud.  Phone scans store many points more than once and many more points than the
+//screen can resolve, each of them is a quad of the sprite geometry shader.
+//
+//Both steps group equal points with a hash: every point gets a 32 bit hash of its key (the bits of its position and
+//color, or its voxel of the grid over the bounds), the (hash, index) pairs are radix sorted and the runs of equal
+//hashes are split where the keys differ.  The hashes, the runs and the output points are computed in parallel ranges
+//on numThreads threads.  The sort is stable, so the first point of a group is its first point in the file, and the
+//groups are output in the order of their first points, the result doesn't depend on the number of threads.
+namespace DXPointDownsample
+{
+	//pOutPositions and pOutColors hold numPoints points and don't overlap the input.  the colors are 0..255 like
+	//DXPlyParser returns them.  returns the number of points written.
+	size_t Downsample(const DXGraphicsUtilities::vec3* pPositions,
+		const DXGraphicsUtilities::vec4* pColors,
+		size_t numPoints,
+		const PointDownsampleOptions& options,
+		DXGraphicsUtilities::vec3* pOutPositions,
+		DXGraphicsUtilities::vec4* pOutColors,
+		PointDownsampleStats* pStats = nullptr,
+		uint32_t numThreads = 0);
+
+	//serial reference for tests: the output has no duplicates, and one point in every voxel of the input (voxelSize
+	//from the stats of the Downsample call) or every distinct input point once
+	bool CheckDownsample(const DXGraphicsUtilities::vec3* pPositions,
+		const DXGraphicsUtilities::vec4* pColors,
+		size_t numPoints,
+		const PointDownsampleOptions& options,
+		float voxelSize,
+		const DXGraphicsUtilities::vec3* pOutPositions,
+		const DXGraphicsUtilities::vec4* pOutColors,
+		size_t numOutPoints);
+}
@@ -0,0 +1,690 @@
+#include "stdafx.h"
+#include "DXPointOctree.h"
+#include "DXPointSorter.h"
+#include "DXParallel.h"
+#include "DXCamera.h"
+
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <queue>
+
+using namespace DirectX;
+
+namespace
+{
+	const size_t kMinRangeNodes = 256;
+	const uint32_t kMortonBits = 21;
+
+	double GetElapsedMs(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	inline const XMFLOAT3& GetPosition(const XMFLOAT3* pPositions, size_t stride, size_t i)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(pPositions) + i * stride);
+	}
+
+	//spreads the low 21 bits of v to every third bit
+	inline uint64_t SpreadBits(uint64_t v)
+	{
+		v &= 0x1fffff;
+		v = (v | (v << 32)) & 0x1f00000000ffffull;
+		v = (v | (v << 16)) & 0x1f0000ff0000ffull;
+		v = (v | (v << 8)) & 0x100f00f00f00f00full;
+		v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+		v = (v | (v << 2)) & 0x1249249249249249ull;
+		return v;
+	}
+
+	//the inverse of SpreadBits, every third bit of v starting at bit 0
+	inline uint32_t CompactBits(uint64_t v)
+	{
+		v &= 0x1249249249249249ull;
+		v = (v ^ (v >> 2)) & 0x10c30c30c30c30c3ull;
+		v = (v ^ (v >> 4)) & 0x100f00f00f00f00full;
+		v = (v ^ (v >> 8)) & 0x1f0000ff0000ffull;
+		v = (v ^ (v >> 16)) & 0x1f00000000ffffull;
+		v = (v ^ (v >> 32)) & 0x1fffff;
+		return static_cast<uint32_t>(v);
+	}
+
+	//child octant of a code at a level, the top three bits of the code are level 0
+	inline uint32_t GetOctant(uint64_t code, uint32_t level)
+	{
+		return static_cast<uint32_t>(code >> (3 * (kMortonBits - 1 - level))) & 7;
+	}
+
+	inline uint32_t CountBits(uint32_t v)
+	{
+		uint32_t count = 0;
+		for (; v; v &= v - 1)
+		{
+			count++;
+		}
+		return count;
+	}
+
+	//the octant ranges of [begin, end), the codes of the range share every digit above level
+	void SplitOctants(const uint64_t* pCodes, uint32_t begin, uint32_t end, uint32_t level, uint32_t* pStarts)
+	{
+		pStarts[0] = begin;
+		for (uint32_t c = 1; c < 8; ++c)
+		{
+			pStarts[c] = static_cast<uint32_t>(std::partition_point(pCodes + pStarts[c - 1], pCodes + end,
+				[&](uint64_t code) { return GetOctant(code, level) < c; }) - pCodes);
+		}
+		pStarts[8] = end;
+	}
+
+	//the points of a node while it is built, the points it does not keep are split into childStarts
+	struct BuildRange
+	{
+		uint32_t begin;
+		uint32_t end;
+		uint32_t childStarts[9];
+	};
+
+	struct OctreeBuilder
+	{
+		XMFLOAT3 cubeMin;
+		float cubeSize;
+		uint32_t gridLevels;
+		uint32_t maxLeafPoints;
+		uint32_t maxLevel;
+
+		// the positions move with the points, the cells read them in order
+		std::vector< uint32_t > points;   //sorted by code within every node
+		std::vector< uint64_t > codes;
+		std::vector< XMFLOAT3 > positions;
+		std::vector< uint32_t > scratchPoints;
+		std::vector< uint64_t > scratchCodes;
+		std::vector< XMFLOAT3 > scratchPositions;
+		std::vector< uint8_t > isKept;
+
+		XMFLOAT3 GetCellCenter(uint64_t prefix, float cellSize) const
+		{
+			return XMFLOAT3(cubeMin.x + (CompactBits(prefix) + 0.5f) * cellSize, cubeMin.y + (CompactBits(prefix >> 1) + 0.5f) * cellSize,
+				cubeMin.z + (CompactBits(prefix >> 2) + 0.5f) * cellSize);
+		}
+
+		//keeps the point nearest to the center of every occupied grid cell at the front of the range
+		void ProcessNode(PointOctreeNode& node, BuildRange& range, uint32_t numThreads)
+		{
+			uint32_t begin = range.begin;
+			uint32_t end = range.end;
+
+			float nodeSize = std::ldexp(cubeSize, -static_cast<int>(node.level));
+			uint64_t nodePrefix = node.level > 0 ? codes[begin] >> (3 * (kMortonBits - node.level)) : 0;
+			node.center = GetCellCenter(nodePrefix, nodeSize);
+			node.halfSize = 0.5f * nodeSize;
+			node.firstPoint = begin;
+
+			if (end - begin <= maxLeafPoints || node.level >= maxLevel)
+			{
+				node.spacing = 0.0f;
+				node.numPoints = end - begin;
+				SplitOctants(codes.data(), begin, end, node.level, node.octantStarts);
+				std::fill(range.childStarts, range.childStarts + 9, end);
+				return;
+			}
+
+			uint32_t cellShift = 3 * (kMortonBits - node.level - gridLevels);
+			float cellSize = std::ldexp(nodeSize, -static_cast<int>(gridLevels));
+
+			// the blocks start at cell boundaries so every cell is decided by one thread
+			size_t count = end - begin;
+			size_t numBlocks = std::max< size_t >(1, std::min< size_t >(numThreads, count / DXParallel::kMinRangePoints));
+			std::vector< uint32_t > blockStarts(numBlocks + 1);
+			for (size_t block = 0; block < numBlocks; ++block)
+			{
+				uint32_t start = static_cast<uint32_t>(begin + count * block / numBlocks);
+				while (block > 0 && start < end && (codes[start] >> cellShift) == (codes[start - 1] >> cellShift))
+				{
+					++start;
+				}
+				blockStarts[block] = start;
+			}
+			blockStarts[numBlocks] = end;
+
+			std::vector< uint32_t > blockKept(numBlocks, 0);
+			DXParallel::ParallelFor(numBlocks, [&](size_t block)
+			{
+				uint32_t kept = 0;
+				for (uint32_t i = blockStarts[block]; i < blockStarts[block + 1];)
+				{
+					uint64_t cell = codes[i] >> cellShift;
+					XMFLOAT3 center = GetCellCenter(cell, cellSize);
+
+					uint32_t best = i;
+					float bestDistanceSq = FLT_MAX;
+					uint32_t j = i;
+					for (; j < end && (codes[j] >> cellShift) == cell; ++j)
+					{
+						const XMFLOAT3& p = positions[j];
+						float x = p.x - center.x;
+						float y = p.y - center.y;
+						float z = p.z - center.z;
+						float distanceSq = x * x + y * y + z * z;
+						if (distanceSq < bestDistanceSq)
+						{
+							bestDistanceSq = distanceSq;
+							best = j;
+						}
+						isKept[j] = 0;
+					}
+
+					isKept[best] = 1;
+					kept++;
+					i = j;
+				}
+				blockKept[block] = kept;
+			}, numThreads);
+
+			std::vector< uint32_t > keptBefore(numBlocks + 1, 0);
+			for (size_t block = 0; block < numBlocks; ++block)
+			{
+				keptBefore[block + 1] = keptBefore[block] + blockKept[block];
+			}
+			uint32_t numKept = keptBefore[numBlocks];
+
+			// stable partition, the kept points and the others both stay in code order
+			DXParallel::ParallelFor(numBlocks, [&](size_t block)
+			{
+				uint32_t keptOut = begin + keptBefore[block];
+				uint32_t restOut = begin + numKept + (blockStarts[block] - begin - keptBefore[block]);
+				for (uint32_t i = blockStarts[block]; i < blockStarts[block + 1]; ++i)
+				{
+					uint32_t out = isKept[i] ? keptOut++ : restOut++;
+					scratchPoints[out] = points[i];
+					scratchCodes[out] = codes[i];
+					scratchPositions[out] = positions[i];
+				}
+			}, numThreads);
+
+			DXParallel::ParallelFor(numBlocks, [&](size_t block)
+			{
+				std::copy(scratchPoints.begin() + blockStarts[block], scratchPoints.begin() + blockStarts[block + 1], points.begin() + blockStarts[block]);
+				std::copy(scratchCodes.begin() + blockStarts[block], scratchCodes.begin() + blockStarts[block + 1], codes.begin() + blockStarts[block]);
+				std::copy(scratchPositions.begin() + blockStarts[block], scratchPositions.begin() + blockStarts[block + 1],
+					positions.begin() + blockStarts[block]);
+			}, numThreads);
+
+			node.spacing = cellSize;
+			node.numPoints = numKept;
+			SplitOctants(codes.data(), begin, begin + numKept, node.level, node.octantStarts);
+			SplitOctants(codes.data(), begin + numKept, end, node.level, range.childStarts);
+		}
+	};
+
+	//false when the cube is outside one of the planes
+	bool IsNodeVisible(const PointOctreeNode& node, const MeshletCullView& view)
+	{
+		for (const XMFLOAT4& plane : view.planes)
+		{
+			// the corner of the cube farthest along the plane normal
+			float distance = node.center.x * plane.x + node.center.y * plane.y + node.center.z * plane.z + plane.w;
+			distance += node.halfSize * (std::fabs(plane.x) + std::fabs(plane.y) + std::fabs(plane.z));
+			if (distance < 0.0f)
+				return false;
+		}
+		return true;
+	}
+}
+
+uint32_t PointOctree::GetChild(const PointOctreeNode& node, uint32_t c) const
+{
+	return node.firstChild + CountBits(node.childMask & ((1u << c) - 1));
+}
+
+namespace DXPointOctree
+{
+	void Build(const XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numPoints,
+		const PointOctreeOptions& options,
+		PointOctree& out_octree,
+		std::vector< uint32_t >& out_order,
+		PointOctreeBuildStats* pStats,
+		uint32_t numThreads)
+	{
+		out_order.resize(numPoints);
+		Build(pPositions, positionStride, numPoints, options, out_octree, out_order.data(), pStats, numThreads);
+	}
+
+	void Build(const XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numPoints,
+		const PointOctreeOptions& options,
+		PointOctree& out_octree,
+		uint32_t* pOutOrder,
+		PointOctreeBuildStats* pStats,
+		uint32_t numThreads)
+	{
+		out_octree = PointOctree();
+		if (numPoints == 0)
+			return;
+
+		if (numThreads == 0)
+		{
+			numThreads = DXParallel::GetWorkerCount();
+		}
+
+		auto mortonStart = std::chrono::high_resolution_clock::now();
+
+		XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			const XMFLOAT3& p = GetPosition(pPositions, positionStride, i);
+			boundsMin = XMFLOAT3(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+			boundsMax = XMFLOAT3(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+		}
+
+		OctreeBuilder builder;
+		builder.cubeMin = boundsMin;
+		builder.gridLevels = 0;
+		while ((2u << builder.gridLevels) <= std::max(options.gridSize, 1u) && builder.gridLevels < kMortonBits - 1)
+		{
+			builder.gridLevels++;
+		}
+		builder.maxLeafPoints = std::max(options.maxLeafPoints, 1u);
+		builder.maxLevel = kMortonBits - std::max(builder.gridLevels, 1u);
+
+		// a little larger than the extent so the largest coordinate still maps inside the cube
+		float extent = std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y), boundsMax.z - boundsMin.z);
+		builder.cubeSize = extent > 0.0f ? extent * (1.0f + 1.0e-5f) : 1.0f;
+		float scale = static_cast<float>(1u << kMortonBits) / builder.cubeSize;
+		auto getCell = [&](float value, float origin)
+		{
+			float cell = (value - origin) * scale;
+			return cell <= 0.0f ? 0u : std::min(static_cast<uint32_t>(cell), (1u << kMortonBits) - 1);
+		};
+
+		std::vector< uint64_t > pointCodes(numPoints);
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const XMFLOAT3& p = GetPosition(pPositions, positionStride, i);
+				pointCodes[i] = SpreadBits(getCell(p.x, boundsMin.x)) | (SpreadBits(getCell(p.y, boundsMin.y)) << 1) |
+					(SpreadBits(getCell(p.z, boundsMin.z)) << 2);
+			}
+		}, numThreads);
+
+		// the radix sort orders by 32 bit keys, the low half of the codes first and the stable sort by the high half
+		// after it gives the order of the whole code
+		std::vector< uint64_t > pairs(numPoints);
+		std::vector< uint64_t > scratch;
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				pairs[i] = (pointCodes[i] << 32) | i;
+			}
+		}, numThreads);
+		DXPointSorter::RadixSort(pairs, scratch, numThreads);
+
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				uint32_t point = static_cast<uint32_t>(pairs[i]);
+				pairs[i] = (pointCodes[point] & 0xffffffff00000000ull) | point;
+			}
+		}, numThreads);
+		DXPointSorter::RadixSort(pairs, scratch, numThreads);
+
+		builder.points.resize(numPoints);
+		builder.codes.resize(numPoints);
+		builder.positions.resize(numPoints);
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				uint32_t point = static_cast<uint32_t>(pairs[i]);
+				builder.points[i] = point;
+				builder.codes[i] = pointCodes[point];
+				builder.positions[i] = GetPosition(pPositions, positionStride, point);
+			}
+		}, numThreads);
+
+		std::vector< uint64_t >().swap(pairs);
+		std::vector< uint64_t >().swap(scratch);
+		std::vector< uint64_t >().swap(pointCodes);
+
+		double mortonMs = GetElapsedMs(mortonStart);
+		auto buildStart = std::chrono::high_resolution_clock::now();
+
+		builder.scratchPoints.resize(numPoints);
+		builder.scratchCodes.resize(numPoints);
+		builder.scratchPositions.resize(numPoints);
+		builder.isKept.resize(numPoints);
+
+		std::vector< PointOctreeNode >& nodes = out_octree.nodes;
+		std::vector< BuildRange > ranges;
+
+		PointOctreeNode root = {};
+		nodes.push_back(root);
+		ranges.push_back({ 0, static_cast<uint32_t>(numPoints) });
+
+		size_t levelBegin = 0;
+		while (levelBegin < nodes.size())
+		{
+			size_t levelEnd = nodes.size();
+			size_t numLevelNodes = levelEnd - levelBegin;
+
+			// the few large nodes at the top share the threads, further down every node gets a thread
+			if (numLevelNodes < numThreads)
+			{
+				for (size_t i = levelBegin; i < levelEnd; ++i)
+				{
+					builder.ProcessNode(nodes[i], ranges[i], numThreads);
+				}
+			}
+			else
+			{
+				DXParallel::ParallelFor(numLevelNodes, [&](size_t i)
+				{
+					builder.ProcessNode(nodes[levelBegin + i], ranges[levelBegin + i], 1);
+				}, numThreads);
+			}
+
+			for (size_t i = levelBegin; i < levelEnd; ++i)
+			{
+				uint32_t firstChild = static_cast<uint32_t>(nodes.size());
+				uint32_t childMask = 0;
+				for (uint32_t c = 0; c < 8; ++c)
+				{
+					if (ranges[i].childStarts[c] < ranges[i].childStarts[c + 1])
+					{
+						PointOctreeNode child = {};
+						child.level = nodes[i].level + 1;
+						nodes.push_back(child);
+						ranges.push_back({ ranges[i].childStarts[c], ranges[i].childStarts[c + 1] });
+						childMask |= 1u << c;
+					}
+				}
+
+				nodes[i].firstChild = firstChild;
+				nodes[i].childMask = childMask;
+
+				// a node that kept every point is at full resolution like a leaf
+				if (childMask == 0)
+				{
+					nodes[i].spacing = 0.0f;
+				}
+			}
+
+			levelBegin = levelEnd;
+		}
+
+		out_octree.numLevels = nodes.back().level + 1;
+		std::copy(builder.points.begin(), builder.points.end(), pOutOrder);
+
+		if (pStats)
+		{
+			pStats->numNodes = nodes.size();
+			pStats->numLeaves = 0;
+			pStats->levelPoints.assign(out_octree.numLevels, 0);
+			for (const PointOctreeNode& node : nodes)
+			{
+				pStats->numLeaves += node.childMask == 0 ? 1 : 0;
+				pStats->levelPoints[node.level] += node.numPoints;
+			}
+			pStats->mortonMs = mortonMs;
+			pStats->buildMs = GetElapsedMs(buildStart);
+		}
+	}
+
+	PointLODView CreateLODView(FXMMATRIX wvp, float fovY, float viewportHeight, size_t pointBudget, float minSpacingPixels)
+	{
+		PointLODView view;
+		view.cullView = DXMeshletCuller::CreateCullView(XMMatrixIdentity(), XMMatrixIdentity(), wvp);
+
+		// the eye is the object space point that lands on w = 0 with x = y = 0, the third row of the inverse
+		XMVECTOR determinant;
+		XMMATRIX inverseWVP = XMMatrixInverse(&determinant, wvp);
+		XMVECTOR eye = XMVectorDivide(inverseWVP.r[2], XMVectorSplatW(inverseWVP.r[2]));
+		XMStoreFloat3(&view.eyePosition, eye);
+		view.cullView.eyePosition = view.eyePosition;
+
+		view.pixelScale = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+		view.minSpacingPixels = minSpacingPixels;
+		view.pointBudget = pointBudget;
+		return view;
+	}
+
+	PointLODView CreateLODView(DXCamera& camera, FXMMATRIX world, float viewportHeight, size_t pointBudget, float minSpacingPixels)
+	{
+		XMMATRIX wvp = XMMatrixMultiply(XMMatrixMultiply(world, camera.GetViewMatrix()), camera.GetProjectionMatrix());
+		return CreateLODView(wvp, camera.GetFOV(), viewportHeight, pointBudget, minSpacingPixels);
+	}
+
+	float GetProjectedSize(const PointOctreeNode& node, float size, const PointLODView& view)
+	{
+		float dx = node.center.x - view.eyePosition.x;
+		float dy = node.center.y - view.eyePosition.y;
+		float dz = node.center.z - view.eyePosition.z;
+
+		// distance to the bounding sphere of the cube
+		float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - node.halfSize * 1.7320508f;
+		if (distance <= 0.0f)
+			return FLT_MAX;
+
+		return size * view.pixelScale / distance;
+	}
+
+	void SelectNodeList(const PointOctree& octree,
+		const PointLODView& view,
+		std::vector< uint32_t >& out_nodes,
+		PointLODSelectStats* pStats,
+		uint32_t numThreads)
+	{
+		auto scoreStart = std::chrono::high_resolution_clock::now();
+
+		out_nodes.clear();
+		const std::vector< PointOctreeNode >& nodes = octree.nodes;
+		if (nodes.empty())
+			return;
+
+		// the size on screen of every node, negative outside the frustum
+		std::vector< float > nodeSizes(nodes.size());
+		std::atomic< size_t > numVisible(0);
+		DXParallel::ParallelForRange(nodes.size(), kMinRangeNodes, [&](size_t begin, size_t end)
+		{
+			size_t rangeVisible = 0;
+			for (size_t i = begin; i < end; ++i)
+			{
+				bool bVisible = IsNodeVisible(nodes[i], view.cullView);
+				nodeSizes[i] = bVisible ? GetProjectedSize(nodes[i], 2.0f * nodes[i].halfSize, view) : -1.0f;
+				rangeVisible += bVisible ? 1 : 0;
+			}
+			numVisible += rangeVisible;
+		}, numThreads);
+
+		double scoreMs = GetElapsedMs(scoreStart);
+		auto selectStart = std::chrono::high_resolution_clock::now();
+
+		// the largest nodes on screen first until the next one would not fit the budget
+		std::priority_queue< std::pair< float, uint32_t > > queue;
+		if (nodeSizes[0] >= 0.0f)
+		{
+			queue.push(std::make_pair(nodeSizes[0], 0u));
+		}
+
+		size_t numPoints = 0;
+		while (!queue.empty())
+		{
+			uint32_t n = queue.top().second;
+			queue.pop();
+
+			const PointOctreeNode& node = nodes[n];
+			if (numPoints + node.numPoints > view.pointBudget)
+				break;
+
+			out_nodes.push_back(n);
+			numPoints += node.numPoints;
+
+			// the children add nothing visible once the points of the node are closer than minSpacingPixels on screen
+			if (node.childMask == 0 || GetProjectedSize(node, node.spacing, view) <= view.minSpacingPixels)
+				continue;
+
+			for (uint32_t c = 0; c < 8; ++c)
+			{
+				if (node.childMask & (1u << c))
+				{
+					uint32_t child = octree.GetChild(node, c);
+					if (nodeSizes[child] >= 0.0f)
+					{
+						queue.push(std::make_pair(nodeSizes[child], child));
+					}
+				}
+			}
+		}
+
+		if (pStats)
+		{
+			pStats->numVisibleNodes += numVisible;
+			pStats->numSelectedNodes += out_nodes.size();
+			pStats->numPoints += numPoints;
+			pStats->scoreMs += scoreMs;
+			pStats->selectMs += GetElapsedMs(selectStart);
+		}
+	}
+
+	void SelectNodes(const PointOctree& octree,
+		const PointLODView& view,
+		std::vector< PointLODDraw >& out_draws,
+		PointLODSelectStats* pStats,
+		uint32_t numThreads)
+	{
+		out_draws.clear();
+		const std::vector< PointOctreeNode >& nodes = octree.nodes;
+
+		std::vector< uint32_t > selectedNodes;
+		SelectNodeList(octree, view, selectedNodes, pStats, numThreads);
+
+		auto drawStart = std::chrono::high_resolution_clock::now();
+
+		std::vector< uint8_t > selected(nodes.size(), 0);
+		for (uint32_t n : selectedNodes)
+		{
+			selected[n] = 1;
+		}
+
+		// an octant is as dense as the deepest selected node there, the selected child when there is one
+		for (uint32_t n = 0; n < nodes.size(); ++n)
+		{
+			if (!selected[n])
+				continue;
+
+			const PointOctreeNode& node = nodes[n];
+			for (uint32_t c = 0; c < 8; ++c)
+			{
+				uint32_t begin = node.octantStarts[c];
+				uint32_t end = node.octantStarts[c + 1];
+				if (begin == end)
+					continue;
+
+				float spacing = node.spacing;
+				if (node.childMask & (1u << c))
+				{
+					uint32_t child = octree.GetChild(node, c);
+					spacing = selected[child] ? nodes[child].spacing : spacing;
+				}
+
+				if (!out_draws.empty() && out_draws.back().firstPoint + out_draws.back().numPoints == begin && out_draws.back().spacing == spacing)
+				{
+					out_draws.back().numPoints += end - begin;
+				}
+				else
+				{
+					out_draws.push_back({ begin, end - begin, spacing });
+				}
+			}
+		}
+
+		if (pStats)
+		{
+			pStats->numDraws += out_draws.size();
+			pStats->selectMs += GetElapsedMs(drawStart);
+		}
+	}
+
+	bool CheckOctree(const PointOctree& octree, const XMFLOAT3* pPositions, size_t positionStride, const std::vector< uint32_t >& order)
+	{
+		std::vector< uint8_t > seen(order.size(), 0);
+		for (uint32_t point : order)
+		{
+			if (point >= order.size() || seen[point])
+				return false;
+			seen[point] = 1;
+		}
+
+		// the nodes cover the order once
+		std::vector< uint8_t > covered(order.size(), 0);
+		for (uint32_t n = 0; n < octree.nodes.size(); ++n)
+		{
+			const PointOctreeNode& node = octree.nodes[n];
+			if (node.octantStarts[0] != node.firstPoint || node.octantStarts[8] != node.firstPoint + node.numPoints ||
+				node.firstPoint + node.numPoints > order.size())
+			{
+				return false;
+			}
+
+			float tolerance = node.halfSize * 1.0e-4f;
+			for (uint32_t c = 0; c < 8; ++c)
+			{
+				if (node.octantStarts[c] > node.octantStarts[c + 1])
+					return false;
+
+				for (uint32_t i = node.octantStarts[c]; i < node.octantStarts[c + 1]; ++i)
+				{
+					if (covered[i])
+						return false;
+					covered[i] = 1;
+
+					// inside the cube and on the side of the center of its octant, x is bit 0
+					const XMFLOAT3& p = GetPosition(pPositions, positionStride, order[i]);
+					const float offsets[3] = { p.x - node.center.x, p.y - node.center.y, p.z - node.center.z };
+					for (uint32_t axis = 0; axis < 3; ++axis)
+					{
+						bool bUpper = (c >> axis) & 1;
+						if (std::fabs(offsets[axis]) > node.halfSize + tolerance || (bUpper ? offsets[axis] < -tolerance : offsets[axis] > tolerance))
+							return false;
+					}
+				}
+			}
+
+			for (uint32_t c = 0; c < 8; ++c)
+			{
+				if (!(node.childMask & (1u << c)))
+					continue;
+
+				uint32_t child = octree.GetChild(node, c);
+				if (child <= n || child >= octree.nodes.size() || octree.nodes[child].level != node.level + 1)
+					return false;
+
+				const PointOctreeNode& childNode = octree.nodes[child];
+				const float childCenter[3] = { node.center.x + ((c & 1) ? 0.5f : -0.5f) * node.halfSize,
+					node.center.y + ((c & 2) ? 0.5f : -0.5f) * node.halfSize, node.center.z + ((c & 4) ? 0.5f : -0.5f) * node.halfSize };
+				if (std::fabs(childCenter[0] - childNode.center.x) > tolerance || std::fabs(childCenter[1] - childNode.center.y) > tolerance ||
+					std::fabs(childCenter[2] - childNode.center.z) > tolerance)
+				{
+					return false;
+				}
+			}
+		}
+
+		for (uint8_t bCovered : covered)
+		{
+			if (!bCovered)
+				return false;
+		}
+		return true;
+	}
+}
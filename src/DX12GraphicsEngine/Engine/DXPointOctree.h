@@ -0,0 +1,138 @@
+#pragma once
+
+#include "DXMeshletCuller.h"
+#include <DirectXMath.h>
+#include <vector>
+
+class DXCamera;
+
+struct PointOctreeOptions
+{
+	uint32_t gridSize = 128;          //cells per axis of the subsampling grid of a node, a power of two
+	uint32_t maxLeafPoints = 20000;   //a node with at most this many points keeps all of them
+};
+
+//One cube of the octree.  The points of a node are consecutive in the reordered cloud and in Morton order, so the
+//points that lie in child octant c are the range [octantStarts[c], octantStarts[c + 1]).
+struct PointOctreeNode
+{
+	DirectX::XMFLOAT3 center;
+	float halfSize;
+	float spacing;                  //cell size of the subsampling grid, 0 for leaves (they keep every point)
+	uint32_t level;
+	uint32_t firstPoint;
+	uint32_t numPoints;
+	uint32_t firstChild;            //the children are consecutive nodes in octant order
+	uint32_t childMask;             //bit c is set when octant c has a child
+	uint32_t octantStarts[9];
+};
+
+struct PointOctree
+{
+	std::vector< PointOctreeNode > nodes;  //breadth first, nodes[0] is the root
+	uint32_t numLevels = 0;
+
+	bool IsEmpty() const { return nodes.empty(); }
+
+	//index of the child in octant c, the bit must be set in childMask
+	uint32_t GetChild(const PointOctreeNode& node, uint32_t c) const;
+};
+
+struct PointOctreeBuildStats
+{
+	size_t numNodes = 0;
+	size_t numLeaves = 0;
+	std::vector< size_t > levelPoints;    //points kept by the nodes of each level
+	double mortonMs = 0.0;                //codes and sort
+	double buildMs = 0.0;                 //subsampling of the levels
+};
+
+//what the camera sees, in the object space of the points
+struct PointLODView
+{
+	MeshletCullView cullView;
+	DirectX::XMFLOAT3 eyePosition;
+	float pixelScale;                     //viewportHeight / (2 tan(fovY / 2)), an object space size at distance 1 in pixels
+	float minSpacingPixels;               //the children of a node are not needed once its spacing is smaller on screen
+	size_t pointBudget;
+};
+
+//a range of the reordered cloud drawn with one splat size
+struct PointLODDraw
+{
+	uint32_t firstPoint;
+	uint32_t numPoints;
+	float spacing;                        //spacing of the points in the range, 0 at full resolution
+};
+
+struct PointLODSelectStats
+{
+	size_t numVisibleNodes = 0;
+	size_t numSelectedNodes = 0;
+	size_t numPoints = 0;
+	size_t numDraws = 0;
+	double scoreMs = 0.0;                 //frustum test and projected size of every node
+	double selectMs = 0.0;                //traversal and draws
+};
+
+//Multi-resolution octree of a point cloud for level of detail (Potree, Schuetz 2016).  The points are sorted along a
+//21 bit per axis Morton curve over the bounding cube of the cloud.  Every node lays a gridSize^3 grid over its cube
+//and keeps the point nearest to the center of every occupied cell, the other points go down to its children, so the
+//points of the levels 0..n together cover the cloud with the spacing of level n.  As the points of a grid cell are
+//consecutive in Morton order, the cells of a node are found in one pass, the large nodes at the top of the tree
+//split their pass over numThreads threads and the levels below process their nodes in parallel.
+//
+//SelectNodes walks the octree from the root, the largest nodes on screen first, and stops at the point budget.  The
+//selected nodes are drawn together (a node adds detail to its parent), each child octant with the spacing of the
+//deepest selected node there so the splats can shrink where the finer levels are drawn.
+namespace DXPointOctree
+{
+	//out_order is the new order of the points, the nodes reference ranges of it
+	void Build(const DirectX::XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numPoints,
+		const PointOctreeOptions& options,
+		PointOctree& out_octree,
+		std::vector< uint32_t >& out_order,
+		PointOctreeBuildStats* pStats = nullptr,
+		uint32_t numThreads = 0);
+
+	//the order goes into a caller provided array of numPoints entries, e.g. load time scratch memory
+	void Build(const DirectX::XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numPoints,
+		const PointOctreeOptions& options,
+		PointOctree& out_octree,
+		uint32_t* pOutOrder,
+		PointOctreeBuildStats* pStats = nullptr,
+		uint32_t numThreads = 0);
+
+	//wvp takes the object space of the points to clip space.  viewportHeight in pixels, fovY in radians.
+	PointLODView CreateLODView(DirectX::FXMMATRIX wvp, float fovY, float viewportHeight, size_t pointBudget,
+		float minSpacingPixels = 1.0f);
+
+	PointLODView CreateLODView(DXCamera& camera, DirectX::FXMMATRIX world, float viewportHeight, size_t pointBudget,
+		float minSpacingPixels = 1.0f);
+
+	//object space size in pixels at the distance of the node, FLT_MAX when the eye is inside it
+	float GetProjectedSize(const PointOctreeNode& node, float size, const PointLODView& view);
+
+	//replaces out_nodes with the selected nodes in the order they were taken, the largest on screen first and a parent
+	//before its children, so every prefix of the list is a valid selection too
+	void SelectNodeList(const PointOctree& octree,
+		const PointLODView& view,
+		std::vector< uint32_t >& out_nodes,
+		PointLODSelectStats* pStats = nullptr,
+		uint32_t numThreads = 0);
+
+	//replaces out_draws with the ranges of the selected nodes, the node scores are computed on numThreads threads
+	void SelectNodes(const PointOctree& octree,
+		const PointLODView& view,
+		std::vector< PointLODDraw >& out_draws,
+		PointLODSelectStats* pStats = nullptr,
+		uint32_t numThreads = 0);
+
+	//every point in exactly one node, inside its cube, and the octant ranges and children consistent
+	bool CheckOctree(const PointOctree& octree, const DirectX::XMFLOAT3* pPositions, size_t positionStride,
+		const std::vector< uint32_t >& order);
+}
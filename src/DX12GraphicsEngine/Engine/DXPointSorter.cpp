@@ -0,0 +1,301 @@
+#include "stdafx.h"
+#include "DXPointSorter.h"
+#include "DXParallel.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t kRadixBits = 8;
+	const uint32_t kRadixSize = 1 << kRadixBits;
+	const size_t kPointsPerBucket = 8;
+
+	double GetElapsedMs(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	inline const XMFLOAT3* GetPosition(const XMFLOAT3* pPositions, size_t stride, size_t i)
+	{
+		return reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(pPositions) + i * stride);
+	}
+
+	//keys of points begin..end, four at a time.  the last group repeats its last point in the unused lanes so every
+	//key goes through the same instructions.
+	void ComputeDepthKeys(const XMFLOAT3* pPositions, size_t stride, const XMFLOAT3& eyePosition, size_t begin, size_t end,
+		uint32_t* pKeys)
+	{
+		const XMVECTOR eye = XMLoadFloat3(&eyePosition);
+
+		for (size_t i = begin; i < end; i += 4)
+		{
+			XMMATRIX offsets;
+			for (size_t lane = 0; lane < 4; ++lane)
+			{
+				offsets.r[lane] = XMVectorSubtract(XMLoadFloat3(GetPosition(pPositions, stride, std::min(i + lane, end - 1))), eye);
+			}
+
+			// rows x y z of the four points, the squared distances come out in one vector
+			offsets = XMMatrixTranspose(offsets);
+			XMVECTOR distanceSq = XMVectorMultiply(offsets.r[0], offsets.r[0]);
+			distanceSq = XMVectorMultiplyAdd(offsets.r[1], offsets.r[1], distanceSq);
+			distanceSq = XMVectorMultiplyAdd(offsets.r[2], offsets.r[2], distanceSq);
+
+			XMFLOAT4 distances;
+			XMStoreFloat4(&distances, distanceSq);
+			const float lanes[4] = { distances.x, distances.y, distances.z, distances.w };
+
+			// inverted so the farthest point has the smallest key
+			for (size_t lane = 0; lane < 4 && i + lane < end; ++lane)
+			{
+				pKeys[i + lane] = ~DXPointSorter::FloatToSortableKey(lanes[lane]);
+			}
+		}
+	}
+
+	//stable insertion sort by the high 32 bits that gives up after maxMoves moves.  the pairs are still a
+	//permutation of the input when it gives up.
+	bool InsertionSort(uint64_t* pPairs, size_t numPairs, size_t maxMoves, size_t& moves)
+	{
+		for (size_t i = 1; i < numPairs; ++i)
+		{
+			uint64_t pair = pPairs[i];
+			uint32_t key = static_cast<uint32_t>(pair >> 32);
+
+			size_t j = i;
+			while (j > 0 && static_cast<uint32_t>(pPairs[j - 1] >> 32) > key)
+			{
+				pPairs[j] = pPairs[j - 1];
+				--j;
+
+				if (++moves > maxMoves)
+				{
+					pPairs[j] = pair;
+					return false;
+				}
+			}
+			pPairs[j] = pair;
+		}
+
+		return true;
+	}
+
+	//one stable counting pass into buckets spread evenly over the key range, then an insertion sort of every bucket.
+	//the pairs come in last frame's order, so the points of a bucket are close to sorted already.  false if the
+	//insertion sorts went over their budget, the pairs are still a permutation then.
+	bool BucketInsertionSort(std::vector< uint64_t >& pairs, std::vector< uint64_t >& scratch, std::vector< size_t >& bucketStarts,
+		uint32_t numThreads, size_t& moves)
+	{
+		size_t numPairs = pairs.size();
+		scratch.resize(numPairs);
+
+		uint32_t minKey = UINT32_MAX;
+		uint32_t maxKey = 0;
+		for (uint64_t pair : pairs)
+		{
+			uint32_t key = static_cast<uint32_t>(pair >> 32);
+			minKey = std::min(minKey, key);
+			maxKey = std::max(maxKey, key);
+		}
+
+		// the bucket of a key only grows with the key, rounding included
+		size_t numBuckets = std::max< size_t >(1, numPairs / kPointsPerBucket);
+		double bucketScale = double(numBuckets) / (double(maxKey - minKey) + 1.0);
+		auto getBucket = [&](uint64_t pair)
+		{
+			return std::min(static_cast<size_t>(double(static_cast<uint32_t>(pair >> 32) - minKey) * bucketScale), numBuckets - 1);
+		};
+
+		// bucketStarts[b + 1] counts bucket b, the prefix sum makes it the start of bucket b + 1
+		bucketStarts.assign(numBuckets + 1, 0);
+		for (uint64_t pair : pairs)
+		{
+			bucketStarts[getBucket(pair) + 1]++;
+		}
+		for (size_t bucket = 1; bucket <= numBuckets; ++bucket)
+		{
+			bucketStarts[bucket] += bucketStarts[bucket - 1];
+		}
+
+		// scattering moves every start to the end of its bucket, the start of the next one
+		for (uint64_t pair : pairs)
+		{
+			scratch[bucketStarts[getBucket(pair)]++] = pair;
+		}
+		pairs.swap(scratch);
+
+		std::atomic< size_t > totalMoves(0);
+		std::atomic< bool > bSorted(true);
+		DXParallel::ParallelForRange(numBuckets, DXParallel::kMinRangePoints / kPointsPerBucket, [&](size_t begin, size_t end)
+		{
+			size_t rangeBegin = begin > 0 ? bucketStarts[begin - 1] : 0;
+			size_t maxMoves = (bucketStarts[end - 1] - rangeBegin) * DXPointSorter::kMaxMovesPerPoint;
+			size_t rangeMoves = 0;
+
+			for (size_t bucket = begin; bucket < end && bSorted; ++bucket)
+			{
+				size_t bucketBegin = bucket > 0 ? bucketStarts[bucket - 1] : 0;
+				if (!InsertionSort(pairs.data() + bucketBegin, bucketStarts[bucket] - bucketBegin, maxMoves, rangeMoves))
+				{
+					bSorted = false;
+				}
+			}
+			totalMoves += rangeMoves;
+		}, numThreads);
+
+		moves += totalMoves;
+		return bSorted;
+	}
+}
+
+uint32_t DXPointSorter::FloatToSortableKey(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	// positive floats sort like their bits once the sign is set, negative ones need every bit flipped
+	uint32_t mask = (bits & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+	return bits ^ mask;
+}
+
+uint32_t DXPointSorter::RadixSort(std::vector< uint64_t >& pairs, std::vector< uint64_t >& scratch, uint32_t numThreads)
+{
+	size_t numPairs = pairs.size();
+	scratch.resize(numPairs);
+
+	if (numThreads == 0)
+	{
+		numThreads = DXParallel::GetWorkerCount();
+	}
+
+	// one block per thread, each block is histogrammed and scattered on its own.  the digits of a block go to
+	// consecutive slots after the same digits of the earlier blocks, so the sort stays stable.
+	size_t numBlocks = std::max< size_t >(1, std::min< size_t >(numThreads, numPairs / DXParallel::kMinRangePoints));
+	std::vector< std::array< size_t, kRadixSize > > blockOffsets(numBlocks);
+
+	auto getBlockBegin = [&](size_t block) { return numPairs * block / numBlocks; };
+
+	uint64_t* pSource = pairs.data();
+	uint64_t* pDest = scratch.data();
+	uint32_t numPasses = 0;
+
+	for (uint32_t shift = 32; shift < 64; shift += kRadixBits)
+	{
+		DXParallel::ParallelFor(numBlocks, [&](size_t block)
+		{
+			std::array< size_t, kRadixSize >& counts = blockOffsets[block];
+			counts.fill(0);
+			for (size_t i = getBlockBegin(block); i < getBlockBegin(block + 1); ++i)
+			{
+				counts[(pSource[i] >> shift) & (kRadixSize - 1)]++;
+			}
+		}, numThreads);
+
+		// the counts become the first slot of every digit of every block
+		size_t offset = 0;
+		bool bSkipPass = false;
+		for (uint32_t digit = 0; digit < kRadixSize; ++digit)
+		{
+			size_t digitStart = offset;
+			for (std::array< size_t, kRadixSize >& offsets : blockOffsets)
+			{
+				size_t count = offsets[digit];
+				offsets[digit] = offset;
+				offset += count;
+			}
+
+			// every key has this digit, the pass would not move anything
+			bSkipPass |= (offset - digitStart == numPairs);
+		}
+
+		if (bSkipPass)
+			continue;
+
+		DXParallel::ParallelFor(numBlocks, [&](size_t block)
+		{
+			std::array< size_t, kRadixSize >& offsets = blockOffsets[block];
+			for (size_t i = getBlockBegin(block); i < getBlockBegin(block + 1); ++i)
+			{
+				uint64_t pair = pSource[i];
+				pDest[offsets[(pair >> shift) & (kRadixSize - 1)]++] = pair;
+			}
+		}, numThreads);
+
+		std::swap(pSource, pDest);
+		numPasses++;
+	}
+
+	if (pSource != pairs.data())
+	{
+		pairs.swap(scratch);
+	}
+
+	return numPasses;
+}
+
+const std::vector< uint32_t >& DXPointSorter::Sort(const XMFLOAT3* pPositions, size_t positionStride, size_t numPoints,
+	const XMFLOAT3& eyePosition, uint32_t numThreads)
+{
+	m_Stats = PointSortStats();
+	m_Stats.numPoints = numPoints;
+
+	if (numThreads == 0)
+	{
+		numThreads = DXParallel::GetWorkerCount();
+	}
+
+	auto keyStart = std::chrono::high_resolution_clock::now();
+
+	m_Keys.resize(numPoints);
+	DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+	{
+		ComputeDepthKeys(pPositions, positionStride, eyePosition, begin, end, m_Keys.data());
+	}, numThreads);
+
+	// last frame's order is only a starting point when it is an order of the same points
+	bool bStartFromOrder = m_bUseTemporalCoherence && m_Order.size() == numPoints;
+
+	m_Pairs.resize(numPoints);
+	DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			uint32_t point = bStartFromOrder ? m_Order[i] : static_cast<uint32_t>(i);
+			m_Pairs[i] = (static_cast<uint64_t>(m_Keys[point]) << 32) | point;
+		}
+	}, numThreads);
+
+	m_Stats.keyMs = GetElapsedMs(keyStart);
+	auto sortStart = std::chrono::high_resolution_clock::now();
+
+	bool bSorted = false;
+	if (bStartFromOrder)
+	{
+		bSorted = BucketInsertionSort(m_Pairs, m_Scratch, m_BucketStarts, numThreads, m_Stats.numMoves);
+		m_Stats.bUsedPreviousOrder = bSorted;
+	}
+
+	if (!bSorted)
+	{
+		m_Stats.numRadixPasses = RadixSort(m_Pairs, m_Scratch, numThreads);
+	}
+
+	m_Order.resize(numPoints);
+	DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			m_Order[i] = static_cast<uint32_t>(m_Pairs[i]);
+		}
+	}, numThreads);
+
+	m_Stats.sortMs = GetElapsedMs(sortStart);
+
+	return m_Order;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+struct PointSortStats
+{
+	size_t numPoints = 0;
+	bool bUsedPreviousOrder = false;   //the adaptive sort of last frame's order finished within its budget
+	size_t numMoves = 0;               //element moves of the adaptive sort
+	uint32_t numRadixPasses = 0;       //8 bit passes run, passes where every key has the same digit are skipped
+	double keyMs = 0.0;
+	double sortMs = 0.0;
+};
+
+//Back to front order of a point cloud for alpha blending.  The squared distance of every point to the eye is
+//computed once, four points at a time with DirectXMath, and mapped to a uint32 key that sorts like the float.  The
+//(key, index) pairs are then sorted with a stable LSD radix sort, one 8 bit digit per pass, the blocks of a pass
+//are histogrammed and scattered on numThreads threads (0 = all cores).
+//
+//With temporal coherence the pairs start in last frame's order.  One stable counting pass spreads them over buckets
+//of about eight keys each, and as the points of a bucket come in almost sorted order when the camera moved a
+//little, the insertion sort of the buckets is close to linear.  When it is not (more than kMaxMovesPerPoint moves
+//per point, e.g. after a jump of the camera) the radix sort finishes the job.  Either way the keys come out in the
+//same order, only points at exactly the same distance may swap places.
+class DXPointSorter
+{
+public:
+	static const size_t kMaxMovesPerPoint = 8;
+
+	void SetUseTemporalCoherence(bool bUseTemporalCoherence) { m_bUseTemporalCoherence = bUseTemporalCoherence; }
+	bool GetUseTemporalCoherence() const { return m_bUseTemporalCoherence; }
+
+	//indices of the points from the farthest to the nearest.  positionStride is the distance in bytes between two
+	//positions, so the positions can be read straight out of a vertex array.  The order stays valid until the next call.
+	const std::vector< uint32_t >& Sort(const DirectX::XMFLOAT3* pPositions,
+		size_t positionStride,
+		size_t numPoints,
+		const DirectX::XMFLOAT3& eyePosition,
+		uint32_t numThreads = 0);
+
+	const std::vector< uint32_t >& GetOrder() const { return m_Order; }
+	const PointSortStats& GetStats() const { return m_Stats; }
+
+	//forget last frame's order, e.g. when the points changed
+	void Reset() { m_Order.clear(); }
+
+	//uint32 that compares like the float, negative values included
+	static uint32_t FloatToSortableKey(float value);
+
+	//stable sort of pairs by their high 32 bits.  scratch is resized as needed, returns the number of passes run.
+	static uint32_t RadixSort(std::vector< uint64_t >& pairs, std::vector< uint64_t >& scratch, uint32_t numThreads = 0);
+
+protected:
+	bool m_bUseTemporalCoherence = false;
+	std::vector< uint32_t > m_Keys;      //per point, in point order
+	std::vector< uint64_t > m_Pairs;     //key << 32 | point index
+	std::vector< uint64_t > m_Scratch;
+	std::vector< uint32_t > m_Order;
+	std::vector< size_t > m_BucketStarts;
+	PointSortStats m_Stats;
+};
@@ -0,0 +1,565 @@
+#include "stdafx.h"
+#include "DXPointStreamer.h"
+
+#include <cfloat>
+#include <cstring>
+
+using namespace DirectX;
+using namespace DXGraphicsUtilities;
+
+namespace
+{
+	const uint64_t kSectionAlignment = 16;
+
+	inline uint64_t AlignUp(uint64_t value)
+	{
+		return (value + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+	}
+
+	double GetElapsedMs(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	bool WriteSection(FILE* pFile, const void* pData, size_t size)
+	{
+		static const uint8_t padding[kSectionAlignment] = {};
+
+		if (size > 0 && fwrite(pData, 1, size, pFile) != size)
+			return false;
+
+		size_t paddingSize = static_cast<size_t>(AlignUp(size) - size);
+		return paddingSize == 0 || fwrite(padding, 1, paddingSize, pFile) == paddingSize;
+	}
+}
+
+DXPointPageFile::DXPointPageFile() :
+	m_Header()
+{
+}
+
+bool DXPointPageFile::Open(const char* path)
+{
+	Close();
+
+	FILE* pFile = nullptr;
+	if (fopen_s(&pFile, path, "rb") != 0 || pFile == nullptr)
+		return false;
+
+	PointPageHeader header = {};
+	bool bValid = fread(&header, sizeof(header), 1, pFile) == 1 &&
+		_fseeki64(pFile, 0, SEEK_END) == 0;
+
+	uint64_t fileSize = bValid ? static_cast<uint64_t>(_ftelli64(pFile)) : 0;
+
+	bValid = bValid &&
+		header.magic == kPointPageMagic &&
+		header.version == kPointPageVersion &&
+		header.pointStride == sizeof(CloudVertexPosColor) &&
+		header.fileSize == fileSize &&
+		header.nodeOffset + uint64_t(header.numNodes) * sizeof(PointPageNode) <= fileSize;
+
+	std::vector< PointPageNode > nodes(bValid ? header.numNodes : 0);
+	bValid = bValid &&
+		_fseeki64(pFile, static_cast<int64_t>(header.nodeOffset), SEEK_SET) == 0 &&
+		(nodes.empty() || fread(nodes.data(), sizeof(PointPageNode), nodes.size(), pFile) == nodes.size());
+
+	fclose(pFile);
+
+	PointOctree octree;
+	octree.nodes.resize(nodes.size());
+	octree.numLevels = header.numLevels;
+	std::vector< uint32_t > parents(nodes.size(), UINT32_MAX);
+
+	// the point ranges must lie inside the file and the children inside the table, this is what the reads trust
+	for (uint32_t n = 0; bValid && n < nodes.size(); ++n)
+	{
+		const PointPageNode& pageNode = nodes[n];
+		const PointOctreeNode& node = pageNode.node;
+		octree.nodes[n] = node;
+
+		bValid = pageNode.dataSize == uint64_t(node.numPoints) * header.pointStride &&
+			pageNode.dataOffset + pageNode.dataSize <= fileSize &&
+			node.octantStarts[0] == node.firstPoint &&
+			node.octantStarts[8] == node.firstPoint + node.numPoints;
+
+		for (uint32_t c = 0; bValid && c < 8; ++c)
+		{
+			if (node.childMask & (1u << c))
+			{
+				uint32_t child = octree.GetChild(node, c);
+				bValid = child > n && child < nodes.size();
+				parents[bValid ? child : 0] = n;
+			}
+		}
+	}
+
+	if (!bValid)
+		return false;
+
+	m_Path = path;
+	m_Header = header;
+	m_Nodes.swap(nodes);
+	m_Octree = std::move(octree);
+	m_Parents.swap(parents);
+	return true;
+}
+
+void DXPointPageFile::Close()
+{
+	m_Path.clear();
+	m_Header = PointPageHeader();
+	m_Nodes.clear();
+	m_Octree = PointOctree();
+	m_Parents.clear();
+}
+
+FILE* DXPointPageFile::OpenReader() const
+{
+	FILE* pFile = nullptr;
+	if (m_Path.empty() || fopen_s(&pFile, m_Path.c_str(), "rb") != 0)
+		return nullptr;
+
+	return pFile;
+}
+
+bool DXPointPageFile::ReadNode(FILE* pFile, uint32_t node, CloudVertexPosColor* pOut) const
+{
+	const PointPageNode& pageNode = m_Nodes[node];
+	size_t size = static_cast<size_t>(pageNode.dataSize);
+
+	return _fseeki64(pFile, static_cast<int64_t>(pageNode.dataOffset), SEEK_SET) == 0 &&
+		(size == 0 || fread(pOut, 1, size, pFile) == size);
+}
+
+DXPointStreamer::DXPointStreamer() :
+	m_pSink(nullptr)
+	, m_ResidentBytes(0)
+	, m_ReservedBytes(0)
+	, m_NumReading(0)
+	, m_ReadMs(0.0)
+	, m_bStop(false)
+{
+}
+
+DXPointStreamer::~DXPointStreamer()
+{
+	Close();
+}
+
+bool DXPointStreamer::Open(const char* path, const PointStreamOptions& options)
+{
+	Close();
+
+	if (!m_File.Open(path))
+		return false;
+
+	size_t numNodes = m_File.GetHeader().numNodes;
+	m_Options = options;
+	m_NodePoints.assign(numNodes, std::vector< CloudVertexPosColor >());
+	m_LruEntries.assign(numNodes, m_Lru.end());
+	m_LastUsed.assign(numNodes, 0);
+	m_States.assign(numNodes, kNodeUnloaded);
+	m_ResidentBytes = 0;
+	m_ReservedBytes = 0;
+	m_Stats = PointStreamStats();
+	m_ReadMs = 0.0;
+	m_bStop = false;
+	m_OpenTime = std::chrono::high_resolution_clock::now();
+	m_DetailStart = m_OpenTime;
+
+	for (uint32_t i = 0; i < std::max(options.numIOThreads, 1u); ++i)
+	{
+		m_Threads.emplace_back(&DXPointStreamer::ReadNodes, this);
+	}
+
+	return true;
+}
+
+void DXPointStreamer::Close()
+{
+	{
+		std::lock_guard< std::mutex > lock(m_Mutex);
+		m_bStop = true;
+	}
+	m_ReadCondition.notify_all();
+
+	for (std::thread& thread : m_Threads)
+	{
+		thread.join();
+	}
+	m_Threads.clear();
+
+	// the sink releases its copies of whatever is still resident
+	if (m_pSink && !m_Lru.empty())
+	{
+		std::vector< uint32_t > resident(m_Lru.begin(), m_Lru.end());
+		m_pSink->OnNodesEvicted(resident.data(), resident.size());
+	}
+
+	m_NodePoints.clear();
+	m_Lru.clear();
+	m_LruEntries.clear();
+	m_LastUsed.clear();
+	m_Selection.clear();
+	m_Drawn.clear();
+	m_States.clear();
+	m_Queue.clear();
+	m_Completed.clear();
+	m_NumReading = 0;
+	m_ResidentBytes = 0;
+	m_ReservedBytes = 0;
+	m_bStop = false;
+	m_File.Close();
+}
+
+void DXPointStreamer::ReadNodes()
+{
+	FILE* pFile = m_File.OpenReader();
+
+	std::unique_lock< std::mutex > lock(m_Mutex);
+	while (true)
+	{
+		m_ReadCondition.wait(lock, [&] { return m_bStop || !m_Queue.empty(); });
+		if (m_bStop)
+			break;
+
+		CompletedRead read;
+		read.node = m_Queue.front();
+		m_Queue.pop_front();
+		m_States[read.node] = kNodeReading;
+		m_NumReading++;
+		lock.unlock();
+
+		auto readStart = std::chrono::high_resolution_clock::now();
+
+		read.points.resize(m_File.GetNode(read.node).node.numPoints);
+		if (!pFile || !m_File.ReadNode(pFile, read.node, read.points.data()))
+		{
+			// an empty read tells the calling thread the node failed
+			read.points.clear();
+		}
+
+		double readMs = GetElapsedMs(readStart);
+
+		lock.lock();
+		m_States[read.node] = kNodeRead;
+		m_Completed.push_back(std::move(read));
+		m_NumReading--;
+		m_ReadMs += readMs;
+		m_IdleCondition.notify_all();
+	}
+	lock.unlock();
+
+	if (pFile)
+	{
+		fclose(pFile);
+	}
+}
+
+void DXPointStreamer::TakeCompletedReads(std::vector< uint32_t >& out_loaded)
+{
+	std::vector< CompletedRead > completed;
+	{
+		std::lock_guard< std::mutex > lock(m_Mutex);
+		completed.swap(m_Completed);
+		m_Stats.readMs = m_ReadMs;
+
+		for (CompletedRead& read : completed)
+		{
+			// a failed node is not requested again, the file is broken there
+			bool bRead = read.points.size() == m_File.GetNode(read.node).node.numPoints;
+			m_States[read.node] = bRead ? kNodeResident : kNodeFailed;
+		}
+	}
+
+	for (CompletedRead& read : completed)
+	{
+		uint32_t n = read.node;
+		uint64_t size = m_File.GetNode(n).dataSize;
+		if (read.points.size() != m_File.GetNode(n).node.numPoints)
+		{
+			m_ReservedBytes -= size;
+			continue;
+		}
+
+		m_NodePoints[n].swap(read.points);
+		m_Lru.push_front(n);
+		m_LruEntries[n] = m_Lru.begin();
+		m_ResidentBytes += size;
+
+		m_Stats.numReads++;
+		m_Stats.bytesRead += size;
+		out_loaded.push_back(n);
+	}
+}
+
+bool DXPointStreamer::MakeRoom(uint64_t size, std::vector< uint32_t >& out_evicted)
+{
+	while (m_ReservedBytes + size > m_Options.cacheBudget)
+	{
+		// the nodes of this update were touched, the least recently used one is only evictable when it was not
+		if (m_Lru.empty() || m_LastUsed[m_Lru.back()] == m_Stats.numUpdates)
+			return false;
+
+		uint32_t n = m_Lru.back();
+		m_Lru.pop_back();
+		m_LruEntries[n] = m_Lru.end();
+		m_States[n] = kNodeUnloaded;
+
+		uint64_t nodeSize = m_File.GetNode(n).dataSize;
+		m_ReservedBytes -= nodeSize;
+		m_ResidentBytes -= nodeSize;
+		m_Stats.numEvictions++;
+		m_Stats.bytesEvicted += nodeSize;
+		out_evicted.push_back(n);
+	}
+
+	return true;
+}
+
+void DXPointStreamer::Update(const PointLODView& view, std::vector< PointStreamDraw >& out_draws)
+{
+	out_draws.clear();
+	if (!IsOpen())
+		return;
+
+	m_Stats.numUpdates++;
+
+	std::vector< uint32_t > loaded;
+	TakeCompletedReads(loaded);
+	if (m_pSink && !loaded.empty())
+	{
+		m_pSink->OnNodesLoaded(loaded.data(), loaded.size(), *this);
+	}
+
+	DXPointOctree::SelectNodeList(m_File.GetOctree(), view, m_Selection);
+
+	// the selection is in priority order and every prefix of it is a valid selection, the cache holds the longest
+	// prefix that fits
+	size_t numWanted = 0;
+	uint64_t wantedBytes = 0;
+	for (; numWanted < m_Selection.size(); ++numWanted)
+	{
+		uint64_t size = m_File.GetNode(m_Selection[numWanted]).dataSize;
+		if (wantedBytes + size > m_Options.cacheBudget)
+			break;
+
+		wantedBytes += size;
+	}
+
+	std::vector< uint32_t > evicted;
+	size_t numDrawn = 0;
+	bool bQueued = false;
+	m_Drawn.assign(m_File.GetHeader().numNodes, 0);
+	{
+		std::lock_guard< std::mutex > lock(m_Mutex);
+
+		// requests that did not start yet are replaced by the ones of this view
+		for (uint32_t n : m_Queue)
+		{
+			m_States[n] = kNodeUnloaded;
+			m_ReservedBytes -= m_File.GetNode(n).dataSize;
+		}
+		m_Queue.clear();
+
+		// touch the resident nodes first so none of them is evicted for a node behind it
+		for (size_t i = 0; i < numWanted; ++i)
+		{
+			uint32_t n = m_Selection[i];
+			m_LastUsed[n] = m_Stats.numUpdates;
+
+			if (m_States[n] == kNodeResident)
+			{
+				m_Lru.splice(m_Lru.begin(), m_Lru, m_LruEntries[n]);
+				m_Stats.numHits++;
+			}
+		}
+		m_Stats.numRequests += numWanted;
+
+		for (size_t i = 0; i < numWanted && m_Queue.size() < m_Options.maxQueuedReads; ++i)
+		{
+			uint32_t n = m_Selection[i];
+			if (m_States[n] != kNodeUnloaded)
+				continue;
+
+			uint64_t size = m_File.GetNode(n).dataSize;
+			if (!MakeRoom(size, evicted))
+				break;
+
+			m_States[n] = kNodeQueued;
+			m_ReservedBytes += size;
+			m_Queue.push_back(n);
+		}
+		bQueued = !m_Queue.empty();
+
+		// a node adds detail to its parent, it is only drawn when the parent is.  the parents come first.
+		for (uint32_t n : m_Selection)
+		{
+			uint32_t parent = m_File.GetParent(n);
+			if (m_States[n] == kNodeResident && (parent == UINT32_MAX || m_Drawn[parent]))
+			{
+				m_Drawn[n] = 1;
+				numDrawn++;
+			}
+		}
+	}
+
+	if (bQueued)
+	{
+		m_ReadCondition.notify_all();
+	}
+
+	if (!evicted.empty())
+	{
+		if (m_pSink)
+		{
+			m_pSink->OnNodesEvicted(evicted.data(), evicted.size());
+		}
+
+		for (uint32_t n : evicted)
+		{
+			std::vector< CloudVertexPosColor >().swap(m_NodePoints[n]);
+		}
+	}
+
+	// an octant is as dense as the deepest drawn node there, like DXPointOctree::SelectNodes
+	const std::vector< PointOctreeNode >& nodes = m_File.GetOctree().nodes;
+	for (uint32_t n : m_Selection)
+	{
+		if (!m_Drawn[n])
+			continue;
+
+		const PointOctreeNode& node = nodes[n];
+		for (uint32_t c = 0; c < 8; ++c)
+		{
+			uint32_t begin = node.octantStarts[c] - node.firstPoint;
+			uint32_t end = node.octantStarts[c + 1] - node.firstPoint;
+			if (begin == end)
+				continue;
+
+			float spacing = node.spacing;
+			if (node.childMask & (1u << c))
+			{
+				uint32_t child = m_File.GetOctree().GetChild(node, c);
+				spacing = m_Drawn[child] ? nodes[child].spacing : spacing;
+			}
+
+			if (!out_draws.empty() && out_draws.back().node == n && out_draws.back().firstPoint + out_draws.back().numPoints == begin &&
+				out_draws.back().spacing == spacing)
+			{
+				out_draws.back().numPoints += end - begin;
+			}
+			else
+			{
+				out_draws.push_back({ n, begin, end - begin, spacing });
+			}
+		}
+	}
+
+	m_Stats.streamMs = GetElapsedMs(m_OpenTime);
+	if (m_Stats.fullDetailMs < 0.0 && numDrawn == m_Selection.size())
+	{
+		m_Stats.fullDetailMs = GetElapsedMs(m_DetailStart);
+	}
+}
+
+void DXPointStreamer::WaitForReads()
+{
+	std::unique_lock< std::mutex > lock(m_Mutex);
+	m_IdleCondition.wait(lock, [&] { return m_Queue.empty() && m_NumReading == 0; });
+}
+
+void DXPointStreamer::RestartDetailTimer()
+{
+	m_DetailStart = std::chrono::high_resolution_clock::now();
+	m_Stats.fullDetailMs = -1.0;
+}
+
+const CloudVertexPosColor* DXPointStreamer::GetNodePoints(uint32_t node) const
+{
+	return m_LruEntries[node] != m_Lru.end() ? m_NodePoints[node].data() : nullptr;
+}
+
+namespace DXPointPages
+{
+	std::string GetPagePath(const char* sourcePath)
+	{
+		return std::string(sourcePath) + ".dxpoints";
+	}
+
+	bool WritePageFile(const char* path, const CloudVertexPosColor* pPoints, size_t numPoints, const PointOctreeOptions& options,
+		PointOctreeBuildStats* pStats, uint32_t numThreads)
+	{
+		if (numPoints > UINT32_MAX)
+			return false;
+
+		PointOctree octree;
+		std::vector< uint32_t > order;
+		DXPointOctree::Build(&pPoints[0].Pos, sizeof(CloudVertexPosColor), numPoints, options, octree, order, pStats, numThreads);
+
+		PointPageHeader header = {};
+		header.magic = kPointPageMagic;
+		header.version = kPointPageVersion;
+		header.pointStride = sizeof(CloudVertexPosColor);
+		header.numNodes = static_cast<uint32_t>(octree.nodes.size());
+		header.numLevels = octree.numLevels;
+		header.numPoints = numPoints;
+		header.nodeOffset = AlignUp(sizeof(PointPageHeader));
+		header.boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		header.boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			const XMFLOAT3& p = pPoints[i].Pos;
+			header.boundsMin = XMFLOAT3(std::min(header.boundsMin.x, p.x), std::min(header.boundsMin.y, p.y), std::min(header.boundsMin.z, p.z));
+			header.boundsMax = XMFLOAT3(std::max(header.boundsMax.x, p.x), std::max(header.boundsMax.y, p.y), std::max(header.boundsMax.z, p.z));
+		}
+
+		// the node data follows the table in node order, so the nodes of a level are next to each other on disk
+		std::vector< PointPageNode > nodes(octree.nodes.size());
+		uint64_t dataOffset = header.nodeOffset + AlignUp(nodes.size() * sizeof(PointPageNode));
+		for (size_t n = 0; n < nodes.size(); ++n)
+		{
+			memset(&nodes[n], 0, sizeof(PointPageNode));
+			nodes[n].node = octree.nodes[n];
+			nodes[n].dataOffset = dataOffset;
+			nodes[n].dataSize = uint64_t(octree.nodes[n].numPoints) * sizeof(CloudVertexPosColor);
+			dataOffset += AlignUp(nodes[n].dataSize);
+		}
+		header.fileSize = dataOffset;
+
+		std::string tempPath = std::string(path) + ".tmp";
+
+		FILE* pFile = nullptr;
+		if (fopen_s(&pFile, tempPath.c_str(), "wb") != 0 || pFile == nullptr)
+			return false;
+
+		bool bWritten = WriteSection(pFile, &header, sizeof(header)) &&
+			WriteSection(pFile, nodes.data(), nodes.size() * sizeof(PointPageNode));
+
+		std::vector< CloudVertexPosColor > nodePoints;
+		for (size_t n = 0; n < nodes.size() && bWritten; ++n)
+		{
+			const PointOctreeNode& node = octree.nodes[n];
+			nodePoints.resize(node.numPoints);
+			for (uint32_t i = 0; i < node.numPoints; ++i)
+			{
+				nodePoints[i] = pPoints[order[node.firstPoint + i]];
+			}
+
+			bWritten = WriteSection(pFile, nodePoints.data(), nodePoints.size() * sizeof(CloudVertexPosColor));
+		}
+
+		bWritten = (fclose(pFile) == 0) && bWritten;
+
+		if (!bWritten || !MoveFileExA(tempPath.c_str(), path, MOVEFILE_REPLACE_EXISTING))
+		{
+			DeleteFileA(tempPath.c_str());
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include "DXPointOctree.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Paged point cloud (.dxpoints).  The LOD octree of DXPointOctree with the points of every node stored together, so
+//a node is one read and a cloud larger than memory can be drawn.  Only the header and the node table are read when
+//the file is opened.
+//
+//  PointPageHeader | PointPageNode[] | points of node 0 | points of node 1 | ...     (each section 16 byte aligned)
+//
+//The nodes are breadth first like PointOctree::nodes.  The points of a node are CloudVertexPosColor in the order of
+//its octants, so octant c is [octantStarts[c], octantStarts[c + 1]) - firstPoint of the node data.
+const uint32_t kPointPageMagic = 0x4c435044; //"DPCL"
+const uint32_t kPointPageVersion = 1;
+
+struct PointPageHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t pointStride;
+	uint32_t numNodes;
+	uint32_t numLevels;
+	uint32_t reserved;
+	uint64_t numPoints;
+
+	uint64_t nodeOffset;
+	uint64_t fileSize;
+
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+};
+
+//a node of the octree and where its points are in the file
+struct PointPageNode
+{
+	PointOctreeNode node;
+	uint64_t dataOffset;
+	uint64_t dataSize;
+};
+
+//The header and node table of a .dxpoints file.  Node data is read on demand with ReadNode, every reading thread
+//passes its own FILE opened with OpenReader.
+class DXPointPageFile
+{
+public:
+	DXPointPageFile();
+
+	//returns false (and stays closed) if the file is missing, truncated or from another version
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return !m_Path.empty(); }
+
+	const PointPageHeader& GetHeader() const { return m_Header; }
+	const PointPageNode& GetNode(uint32_t node) const { return m_Nodes[node]; }
+	const PointOctree& GetOctree() const { return m_Octree; }
+	//UINT32_MAX for the root
+	uint32_t GetParent(uint32_t node) const { return m_Parents[node]; }
+
+	FILE* OpenReader() const;
+	bool ReadNode(FILE* pFile, uint32_t node, DXGraphicsUtilities::CloudVertexPosColor* pOut) const;
+
+protected:
+	std::string m_Path;
+	PointPageHeader m_Header;
+	std::vector< PointPageNode > m_Nodes;
+	PointOctree m_Octree;                   //the nodes without their file ranges, for DXPointOctree::SelectNodeList
+	std::vector< uint32_t > m_Parents;
+};
+
+struct PointStreamOptions
+{
+	uint64_t cacheBudget = 512ull << 20;    //bytes of node data in memory, reads in flight included
+	uint32_t numIOThreads = 2;
+	uint32_t maxQueuedReads = 32;           //reads waiting for an I/O thread, the rest is requested again next update
+};
+
+struct PointStreamStats
+{
+	size_t numUpdates = 0;
+	size_t numRequests = 0;                 //selected nodes that fit the cache, summed over the updates
+	size_t numHits = 0;                     //of those, the nodes that were resident
+	size_t numReads = 0;
+	size_t numEvictions = 0;
+	uint64_t bytesRead = 0;
+	uint64_t bytesEvicted = 0;
+	double readMs = 0.0;                    //time the I/O threads spent in reads, summed over the threads
+	double streamMs = 0.0;                  //from Open to the last update
+	double fullDetailMs = -1.0;             //from Open or RestartDetailTimer to the first update with the whole selection resident
+
+	float GetHitRate() const { return numRequests ? float(numHits) / float(numRequests) : 0.0f; }
+	double GetBytesPerSecond() const { return streamMs > 0.0 ? bytesRead * 1000.0 / streamMs : 0.0; }
+	double GetReadBytesPerSecond() const { return readMs > 0.0 ? bytesRead * 1000.0 / readMs : 0.0; }
+};
+
+//a range of the points of one resident node drawn with one splat size
+struct PointStreamDraw
+{
+	uint32_t node;
+	uint32_t firstPoint;                    //relative to the node data
+	uint32_t numPoints;
+	float spacing;
+};
+
+class DXPointStreamer;
+
+//Gets the nodes that became resident and the nodes that were evicted during an update, on the thread that calls
+//Update.  This is where the points go to the GPU, everything before it runs without a device.  DXPointCloud is the
+//sink of the renderer, it encodes the nodes into ranges of one vertex buffer (LoadPagedPointCloud).
+class IPointPageSink
+{
+public:
+	virtual ~IPointPageSink() {}
+
+	//the points are DXPointStreamer::GetNodePoints, valid until the node is evicted
+	virtual void OnNodesLoaded(const uint32_t* pNodes, size_t count, const DXPointStreamer& streamer) = 0;
+
+	//the points of the nodes are still valid during the call and freed after it
+	virtual void OnNodesEvicted(const uint32_t* pNodes, size_t count) = 0;
+};
+
+//Streams the nodes of a .dxpoints file through a cache of a fixed byte budget.  Every Update selects the nodes of
+//the view with DXPointOctree::SelectNodeList, largest on screen first, and requests the missing ones in that order
+//from a pool of I/O threads.  Requests that did not start before the next update are replaced by the requests of
+//the new view.  A read only starts when its bytes fit the budget, nodes the view no longer needs are evicted least
+//recently used first to make room, and the nodes the view needs are never evicted.  Finished reads become
+//resident at the next Update, so the cache only changes on the calling thread.
+//
+//	DXPointStreamer streamer;
+//	streamer.Open("scan.dxpoints");
+//	streamer.Update(DXPointOctree::CreateLODView(wvp, fovY, 1080.0f, pointBudget), draws);
+class DXPointStreamer
+{
+public:
+	DXPointStreamer();
+	~DXPointStreamer();
+
+	DXPointStreamer(const DXPointStreamer&) = delete;
+	DXPointStreamer& operator=(const DXPointStreamer&) = delete;
+
+	bool Open(const char* path, const PointStreamOptions& options = PointStreamOptions());
+	void Close();
+
+	bool IsOpen() const { return m_File.IsOpen(); }
+
+	void SetSink(IPointPageSink* pSink) { m_pSink = pSink; }
+
+	//replaces out_draws with the resident part of the selection, a node is only drawn when its parent is
+	void Update(const PointLODView& view, std::vector< PointStreamDraw >& out_draws);
+
+	//blocks until the I/O threads are idle.  for tests and benchmarks, a frame loop never waits.
+	void WaitForReads();
+
+	//the next full detail time is measured from now, e.g. after a camera cut
+	void RestartDetailTimer();
+
+	const DXPointPageFile& GetFile() const { return m_File; }
+	const PointStreamStats& GetStats() const { return m_Stats; }
+	uint64_t GetResidentBytes() const { return m_ResidentBytes; }
+	size_t GetNumResidentNodes() const { return m_Lru.size(); }
+
+	//nullptr when the node is not resident
+	const DXGraphicsUtilities::CloudVertexPosColor* GetNodePoints(uint32_t node) const;
+
+protected:
+	enum NodeState : uint8_t
+	{
+		kNodeUnloaded,
+		kNodeQueued,
+		kNodeReading,
+		kNodeRead,                          //waiting for the next Update
+		kNodeResident,
+		kNodeFailed,
+	};
+
+	struct CompletedRead
+	{
+		uint32_t node;
+		std::vector< DXGraphicsUtilities::CloudVertexPosColor > points;
+	};
+
+	void ReadNodes();
+	void TakeCompletedReads(std::vector< uint32_t >& out_loaded);
+	bool MakeRoom(uint64_t size, std::vector< uint32_t >& out_evicted);
+
+	DXPointPageFile m_File;
+	PointStreamOptions m_Options;
+	IPointPageSink* m_pSink;
+
+	// owned by the calling thread
+	std::vector< std::vector< DXGraphicsUtilities::CloudVertexPosColor > > m_NodePoints;
+	std::list< uint32_t > m_Lru;                               //resident nodes, most recently used first
+	std::vector< std::list< uint32_t >::iterator > m_LruEntries;
+	std::vector< size_t > m_LastUsed;                          //update that last selected the node
+	std::vector< uint32_t > m_Selection;
+	std::vector< uint8_t > m_Drawn;
+	uint64_t m_ResidentBytes;
+	uint64_t m_ReservedBytes;                                  //resident, queued, reading and read
+	PointStreamStats m_Stats;
+	std::chrono::high_resolution_clock::time_point m_OpenTime;
+	std::chrono::high_resolution_clock::time_point m_DetailStart;
+
+	// shared with the I/O threads
+	std::mutex m_Mutex;
+	std::condition_variable m_ReadCondition;
+	std::condition_variable m_IdleCondition;
+	std::vector< uint8_t > m_States;
+	std::deque< uint32_t > m_Queue;                            //highest priority first
+	std::vector< CompletedRead > m_Completed;
+	uint32_t m_NumReading;
+	double m_ReadMs;
+	bool m_bStop;
+	std::vector< std::thread > m_Threads;
+};
+
+namespace DXPointPages
+{
+	//the paged file lives next to the source, e.g. scans/hall.ply -> scans/hall.ply.dxpoints
+	std::string GetPagePath(const char* sourcePath);
+
+	//builds the LOD octree of the points and writes the paged file.  the points must fit in memory here, streaming
+	//is for drawing.  they are stored as drawn: final positions and 0..1 colors.  written to a temporary file first and renamed like DXMeshCache::WriteCacheFile.
+	bool WritePageFile(const char* path,
+		const DXGraphicsUtilities::CloudVertexPosColor* pPoints,
+		size_t numPoints,
+		const PointOctreeOptions& options = PointOctreeOptions(),
+		PointOctreeBuildStats* pStats = nullptr,
+		uint32_t numThreads = 0);
+}
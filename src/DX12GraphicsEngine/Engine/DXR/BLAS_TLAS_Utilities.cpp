@@ -55,6 +55,7 @@ BLAS_TLAS_Utilities::~BLAS_TLAS_Utilities()
         SAFE_RELEASE(mBottomLevelBuffers[i].pResult);
         SAFE_RELEASE(mBottomLevelBuffers[i].pScratch);
         SAFE_RELEASE(mBottomLevelBuffers[i].pInstanceDesc);
+        SAFE_RELEASE(mBottomLevelBuffers[i].pTransforms);
     }
 
     SAFE_RELEASE(mTopLevelBuffers.pResult);
@@ -88,7 +89,7 @@ ID3D12Resource* BLAS_TLAS_Utilities::createBuffer(ID3D12Device5* pDevice, uint64
     return pBuffer;
 }
 
-//Create a BLAS resource.  Each BLAS holds vertex buffers for a single model (ie the mesh data for a model is copied
+//Create a BLAS resource.  Each BLAS holds vertex and index buffers for a single model (ie the mesh data for a model is copied
 // into a BLAS D3D resource).  The data copied is the actual Vertex Buffer data for each mesh in a model.  If there
 //is only 1 mesh in the model, then there is only 1 vertex buffer.  Two mesh objects will have a total of two vertex
 //buffers.  For example, if a model has two meshes, geometryCount=2 and we create a D3D12_RAYTRACING_GEOMETRY_DESC
@@ -100,11 +101,34 @@ ID3D12Resource* BLAS_TLAS_Utilities::createBuffer(ID3D12Device5* pDevice, uint64
 //instances of the geometry, but the SHADER code needs to have access to Each VERTEX AND INDEX BUFFER
 
 AccelerationStructureBuffer BLAS_TLAS_Utilities::createBottomLevelAS(ID3D12Device5* pDevice, ID3D12GraphicsCommandList4* pCmdList,
-    ID3D12Resource* pVB[], uint32_t *vertexCount, uint32_t geometryCount)
+    ID3D12Resource* pVB[], uint32_t *vertexCount, uint32_t* vertexStride, DXGI_FORMAT* vertexFormat, XMFLOAT3X4* vertexTransform,
+    ID3D12Resource* pIB[], uint32_t* indexStart, uint32_t* indexCount, DXGI_FORMAT* indexFormat, uint32_t geometryCount)
 {
     std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geomDesc;//store 1 D3D12_RAYTRACING_GEOMETRY_DESC for each VB
     geomDesc.resize(geometryCount);
 
+    AccelerationStructureBuffer buffers;
+
+    //compact vertex buffers hold 16 bit unorm positions.  The BLAS build reads them as R16G16B16A16_UNORM (w is
+    //ignored) and the per geometry 3x4 transform maps them back to object space.  The transforms must stay alive
+    //until the build has executed, they are kept in pTransforms.
+    bool bNeedsTransforms = false;
+    for (uint32_t i = 0; i < geometryCount; i++)
+    {
+        bNeedsTransforms = bNeedsTransforms || vertexFormat[i] != DXGI_FORMAT_R32G32B32_FLOAT;
+    }
+
+    if (bNeedsTransforms)
+    {
+        buffers.pTransforms = createBuffer(pDevice, sizeof(XMFLOAT3X4) * geometryCount, D3D12_RESOURCE_FLAG_NONE,
+            D3D12_RESOURCE_STATE_GENERIC_READ, kUploadHeapProps);
+
+        XMFLOAT3X4* pTransforms;
+        buffers.pTransforms->Map(0, nullptr, (void**)&pTransforms);
+        memcpy(pTransforms, vertexTransform, sizeof(XMFLOAT3X4) * geometryCount);
+        buffers.pTransforms->Unmap(0, nullptr);
+    }
+
     //Each geometry is a vertex buffer contained in the model.  For API tier 1_1 there is an HLSL intrinsic called
     // GeometryIndex() that gives index of the geometry (ie index of the VB) that the ray hit.  This is different
     // than the InstanceIndex() that specifices a TLAS object.  The value of GeometryIndex() is an index automatically
@@ -118,9 +142,20 @@ AccelerationStructureBuffer BLAS_TLAS_Utilities::createBottomLevelAS(ID3D12Devic
         //Create a GeometryInstance in a BLAS object.  NOT to be confused with an InstanceIndex created in TLAS.
         geomDesc[i].Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
         geomDesc[i].Triangles.VertexBuffer.StartAddress = pVB[i]->GetGPUVirtualAddress(); //store VB address
-        geomDesc[i].Triangles.VertexBuffer.StrideInBytes = sizeof(ModelVertex);
+        geomDesc[i].Triangles.VertexBuffer.StrideInBytes = vertexStride[i];
         geomDesc[i].Triangles.VertexCount = vertexCount[i]; //number of vertices in the VB
-        geomDesc[i].Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+        geomDesc[i].Triangles.VertexFormat = vertexFormat[i];
+
+        if (vertexFormat[i] != DXGI_FORMAT_R32G32B32_FLOAT)
+        {
+            geomDesc[i].Triangles.Transform3x4 = buffers.pTransforms->GetGPUVirtualAddress() + sizeof(XMFLOAT3X4) * i;
+        }
+
+        //meshes are welded so the triangles come from the index buffer.  the material subsets of a mesh share the
+        //index buffer and start at their first index (the DXR meshes use 32 bit indices).
+        geomDesc[i].Triangles.IndexBuffer = pIB[i]->GetGPUVirtualAddress() + uint64_t(indexStart[i]) * sizeof(uint32_t);
+        geomDesc[i].Triangles.IndexCount = indexCount[i];
+        geomDesc[i].Triangles.IndexFormat = indexFormat[i];
 
         // !! Using D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE means the "ANY HIT" will NOT be executed !!
         geomDesc[i].Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
@@ -138,7 +173,6 @@ AccelerationStructureBuffer BLAS_TLAS_Utilities::createBottomLevelAS(ID3D12Devic
     pDevice->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
 
     // Create the buffers. They need to support UAV, and since we are going to immediately use them, we create them with an unordered-access state
-    AccelerationStructureBuffer buffers;
     buffers.pScratch = createBuffer(pDevice, info.ScratchDataSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, kDefaultHeapProps);
     buffers.pResult = createBuffer(pDevice, info.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, kDefaultHeapProps);
 
@@ -259,22 +293,61 @@ void BLAS_TLAS_Utilities::createAccelerationStructures(D3D12Global d3d, D3DScene
 
     std::vector < std::vector< ID3D12Resource* >  > mSceneVBs;
     std::vector < std::vector< uint32_t >  > mSceneVBsNumVerts;
+    std::vector < std::vector< uint32_t >  > mSceneVBsStrides;
+    std::vector < std::vector< DXGI_FORMAT >  > mSceneVBsFormats;
+    std::vector < std::vector< XMFLOAT3X4 >  > mSceneVBsTransforms;
+    std::vector < std::vector< ID3D12Resource* >  > mSceneIBs;
+    std::vector < std::vector< uint32_t >  > mSceneIBsStarts;
+    std::vector < std::vector< uint32_t >  > mSceneIBsNumIndices;
+    std::vector < std::vector< DXGI_FORMAT >  > mSceneIBsFormats;
 
     for (auto model : models)
     {
         std::vector< ID3D12Resource* > vbs;
         std::vector< uint32_t > numverts;
+        std::vector< uint32_t > strides;
+        std::vector< DXGI_FORMAT > vertexformats;
+        std::vector< XMFLOAT3X4 > transforms;
+        std::vector< ID3D12Resource* > ibs;
+        std::vector< uint32_t > indexstarts;
+        std::vector< uint32_t > numindices;
+        std::vector< DXGI_FORMAT > indexformats;
 
         std::vector<D3DMesh>& meshes = model.GetMeshObjects();
         for (auto mesh : meshes)
         {
-            vbs.push_back(mesh.m_pVertexBuffer.Get());  //store vbs for each mesh
-            numverts.push_back(mesh.vertices.size());
-            num_mesh_objects_total++;
+            //one geometry per material subset, all of them read the vertex and index buffer of the mesh
+            for (const D3DMeshSubset& subset : mesh.GetGeometries())
+            {
+                vbs.push_back(mesh.m_pVertexBuffer.Get());  //store vbs for each geometry
+                numverts.push_back(mesh.vertices.size());
+                strides.push_back(mesh.m_VertexStride);
+
+                //compact meshes (MeshVertexFormat != 0) are dequantized by the geometry transform
+                bool bCompact = mesh.m_VertexFormat != 0;
+                vertexformats.push_back(bCompact ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT);
+                transforms.push_back(XMFLOAT3X4(
+                    mesh.m_PositionScale.x, 0.0f, 0.0f, mesh.m_PositionOffset.x,
+                    0.0f, mesh.m_PositionScale.y, 0.0f, mesh.m_PositionOffset.y,
+                    0.0f, 0.0f, mesh.m_PositionScale.z, mesh.m_PositionOffset.z));
+
+                ibs.push_back(mesh.m_pIndexBuffer.Get());  //and the matching ibs
+                indexstarts.push_back(subset.m_StartIndex);
+                numindices.push_back(subset.m_IndexCount);
+                indexformats.push_back(mesh.m_indexBufferView.Format);
+                num_mesh_objects_total++;
+            }
         }
 
         mSceneVBs.push_back(vbs);
         mSceneVBsNumVerts.push_back(numverts);
+        mSceneVBsStrides.push_back(strides);
+        mSceneVBsFormats.push_back(vertexformats);
+        mSceneVBsTransforms.push_back(transforms);
+        mSceneIBs.push_back(ibs);
+        mSceneIBsStarts.push_back(indexstarts);
+        mSceneIBsNumIndices.push_back(numindices);
+        mSceneIBsFormats.push_back(indexformats);
     }
 
     mBottomLevelBuffers = new AccelerationStructureBuffer[num_models];
@@ -285,7 +358,9 @@ void BLAS_TLAS_Utilities::createAccelerationStructures(D3D12Global d3d, D3DScene
     for (auto model : models)
     {
         mBottomLevelBuffers[modelindex] = createBottomLevelAS(d3d.device, d3d.cmdList,
-            mSceneVBs[modelindex].data(), mSceneVBsNumVerts[modelindex].data(), mSceneVBs[modelindex].size());
+            mSceneVBs[modelindex].data(), mSceneVBsNumVerts[modelindex].data(), mSceneVBsStrides[modelindex].data(),
+            mSceneVBsFormats[modelindex].data(), mSceneVBsTransforms[modelindex].data(), mSceneIBs[modelindex].data(),
+            mSceneIBsStarts[modelindex].data(), mSceneIBsNumIndices[modelindex].data(), mSceneIBsFormats[modelindex].data(), mSceneVBs[modelindex].size());
 
         mpBottomLevelAS[modelindex] = mBottomLevelBuffers[modelindex].pResult;
 
@@ -31,7 +31,8 @@ protected:
 	ID3D12Resource* createBuffer(ID3D12Device5* pDevice, uint64_t size, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initState, const D3D12_HEAP_PROPERTIES& heapProps);
 
 	AccelerationStructureBuffer createBottomLevelAS(ID3D12Device5* pDevice, ID3D12GraphicsCommandList4* pCmdList,
-		ID3D12Resource* pVB[],  uint32_t *vertexCount, uint32_t geometryCount);
+		ID3D12Resource* pVB[],  uint32_t *vertexCount, uint32_t* vertexStride, DXGI_FORMAT* vertexFormat, XMFLOAT3X4* vertexTransform,
+		ID3D12Resource* pIB[], uint32_t* indexStart, uint32_t* indexCount, DXGI_FORMAT* indexFormat, uint32_t geometryCount);
 
 	AccelerationStructureBuffer createTopLevelAS(ID3D12Device5* pDevice, ID3D12GraphicsCommandList4* pCmdList, 
 		ID3D12Resource* pBottomLevelAS[2], uint64_t& tlasSize, D3DModel *d3dModels, uint32_t num_models);
@@ -161,7 +161,7 @@ HRESULT DXRManager::CreateShadersAndRootSignatures(D3DSceneModels& d3dSceneModel
 
 	for (auto& model : models)
 	{
-		uint32_t num_meshes = (uint32_t)model.GetMeshObjects().size();
+		uint32_t num_meshes = model.GetNumGeometries();
 		numMeshObjects += num_meshes;
 	}
  
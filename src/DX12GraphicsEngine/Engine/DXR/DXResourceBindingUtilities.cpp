@@ -46,19 +46,27 @@ void DXResourceBindingUtilities::CalculateShaderData(D3DSceneModels& d3dSceneMod
 
 	for (auto &model : models)
 	{
-		uint32_t num_meshes =(uint32_t)model.GetMeshObjects().size();
+		//each material subset of a mesh is its own BLAS geometry, the arrays below are indexed by geometry
+		uint32_t num_meshes = model.GetNumGeometries();
 		num_mesh_objects_total += num_meshes;
 
 		m_SceneShaderData.numberOfMeshes[modelIndex].x = num_meshes;
 		modelIndex++;
 
-		std::vector<D3DMesh> meshObjects = model.GetMeshObjects();
+		std::vector<D3DMesh>& meshObjects = model.GetMeshObjects();
 		for (auto &mesh : meshObjects)
 		{
-			uint32_t diffuseIndex = mesh.m_DiffuseTexIndex;
-
-			m_SceneTextureShaderData.diffuseTextureIndexForMesh[meshIndex].x = diffuseIndex; //store albedo texture for this mesh
-			meshIndex++;
+			for (const D3DMeshSubset& subset : mesh.GetGeometries())
+			{
+				//store albedo texture and material of this geometry
+				m_SceneTextureShaderData.diffuseTextureIndexForMesh[meshIndex] = XMUINT4(subset.m_DiffuseTexIndex, subset.m_MaterialIndex, 0, 0);
+
+				//store how the vertex buffer of this geometry is laid out
+				m_SceneTextureShaderData.vertexFormatForMesh[meshIndex] = XMUINT4(mesh.m_VertexFormat, mesh.m_VertexStride, 0, 0);
+				m_SceneTextureShaderData.positionOffsetForMesh[meshIndex] = XMFLOAT4(mesh.m_PositionOffset.x, mesh.m_PositionOffset.y, mesh.m_PositionOffset.z, 0.0f);
+				m_SceneTextureShaderData.positionScaleForMesh[meshIndex] = XMFLOAT4(mesh.m_PositionScale.x, mesh.m_PositionScale.y, mesh.m_PositionScale.z, 0.0f);
+				meshIndex++;
+			}
 		}
 	}
 
@@ -145,35 +153,39 @@ void  DXResourceBindingUtilities::CreateVertexAndIndexBufferSRVs(D3D12Global& d3
 		
 		for (auto mesh : meshes)
 		{
-			// Create the index buffer SRV We need an an srv since we access the vertices in shader ie ByteAddressBuffer s
-			D3D12_SHADER_RESOURCE_VIEW_DESC indexSRVDesc;
-			indexSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
-			indexSRVDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-			indexSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
-			indexSRVDesc.Buffer.StructureByteStride = 0;
-			indexSRVDesc.Buffer.FirstElement = 0;
-			indexSRVDesc.Buffer.NumElements = (static_cast<UINT>(mesh.indices.size()) * sizeof(UINT)) / sizeof(float);
-			indexSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-
-			handle.ptr += handleIncrement;
-			d3d.device->CreateShaderResourceView(mesh.m_pIndexBuffer.Get(), &indexSRVDesc, handle);
-
-			// Create the vertex buffer SRV We need an an srv since we access the verts in ByteAddressBuffer
-			D3D12_SHADER_RESOURCE_VIEW_DESC vertexSRVDesc;
-			vertexSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
-			vertexSRVDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-			vertexSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
-			vertexSRVDesc.Buffer.StructureByteStride = 0;
-			vertexSRVDesc.Buffer.FirstElement = 0;
-			vertexSRVDesc.Buffer.NumElements = (static_cast<UINT>(mesh.vertices.size()) * sizeof(ModelVertex)) / sizeof(float);
-			vertexSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-
-			handle.ptr += handleIncrement;
-			d3d.device->CreateShaderResourceView(mesh.m_pVertexBuffer.Get(), &vertexSRVDesc, handle);
+			for (const D3DMeshSubset& subset : mesh.GetGeometries())
+			{
+				// Create the index buffer SRV We need an an srv since we access the vertices in shader ie ByteAddressBuffer s
+				// The view starts at the first index of the geometry so PrimitiveIndex() addresses it from 0.
+				D3D12_SHADER_RESOURCE_VIEW_DESC indexSRVDesc;
+				indexSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+				indexSRVDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+				indexSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+				indexSRVDesc.Buffer.StructureByteStride = 0;
+				indexSRVDesc.Buffer.FirstElement = (subset.m_StartIndex * sizeof(UINT)) / sizeof(float);
+				indexSRVDesc.Buffer.NumElements = (subset.m_IndexCount * sizeof(UINT)) / sizeof(float);
+				indexSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+				handle.ptr += handleIncrement;
+				d3d.device->CreateShaderResourceView(mesh.m_pIndexBuffer.Get(), &indexSRVDesc, handle);
+
+				// Create the vertex buffer SRV We need an an srv since we access the verts in ByteAddressBuffer
+				D3D12_SHADER_RESOURCE_VIEW_DESC vertexSRVDesc;
+				vertexSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+				vertexSRVDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+				vertexSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+				vertexSRVDesc.Buffer.StructureByteStride = 0;
+				vertexSRVDesc.Buffer.FirstElement = 0;
+				vertexSRVDesc.Buffer.NumElements = (static_cast<UINT>(mesh.vertices.size()) * mesh.m_VertexStride) / sizeof(float);
+				vertexSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+				handle.ptr += handleIncrement;
+				d3d.device->CreateShaderResourceView(mesh.m_pVertexBuffer.Get(), &vertexSRVDesc, handle);
 			
 
-			num_mesh_objects_total++;
-			GeometryIndex++;
+				num_mesh_objects_total++;
+				GeometryIndex++;
+			}
 		}
 
 		m_SceneShaderData.numberOfMeshes[modelIndex].x = GeometryIndex;
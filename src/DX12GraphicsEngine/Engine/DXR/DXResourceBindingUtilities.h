@@ -45,7 +45,8 @@ public:
 
 		//each index into the array is a model index ie InstanceID. The value at each index is the number of
 		//meshes in the model ie the number of vertex buffers in the model.  For ex, if numberOfMeshes[0]=3,
-		//then model 0 has 3 unique mesh objects (ie 3 unique vertex buffers).
+		//then model 0 has 3 unique mesh objects (ie 3 unique vertex buffers).  A mesh with material subsets counts
+		//one mesh object per subset since each subset is its own BLAS geometry.
 
 		//CB arrays must have EACH element on 16 byte boundary, thus we are using XMUINT4
 		XMUINT4 numberOfMeshes[kShaderDataArraySize];  //only use x component
@@ -62,7 +63,13 @@ public:
 		//texture2D resource is accessed via diffuse_textures[1] ie diffuse_textures[texIndex].
 
 		//CB arrays must have EACH element on 16 byte boundary, thus we are using XMUINT4
-		XMUINT4 diffuseTextureIndexForMesh[kShaderDataArraySize]; //only use x component
+		XMUINT4 diffuseTextureIndexForMesh[kShaderDataArraySize]; //x = texture index, y = material index of the subset
+
+		//vertex buffer layout of each mesh so the hit shaders can decode compact vertices (see LoadVertex in
+		//Common_unbound.hlsl).  x = MeshVertexFormat, y = vertex stride in bytes.
+		XMUINT4 vertexFormatForMesh[kShaderDataArraySize];
+		XMFLOAT4 positionOffsetForMesh[kShaderDataArraySize]; //only use xyz components
+		XMFLOAT4 positionScaleForMesh[kShaderDataArraySize]; //only use xyz components
 	};
 
 protected:
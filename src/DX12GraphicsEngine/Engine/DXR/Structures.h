@@ -53,12 +53,31 @@ struct Material {
 	}
 };
 
+//triangles of one material, indexCount indices from startIndex
+struct ModelSubset
+{
+	uint32_t startIndex;
+	uint32_t indexCount;
+	uint32_t materialIndex;
+};
+
 struct Model
 {
 	vector<ModelVertex>									vertices;
 	vector<uint32_t>								indices;
+	vector<ModelSubset>								subsets;	//indices are grouped by material
 }; 
 
+//one material range of a D3DMesh.  each subset becomes its own BLAS geometry that reads the shared index buffer
+//from m_StartIndex, so GeometryIndex() in the hit shaders selects the subset and its material.
+struct D3DMeshSubset
+{
+	uint32_t m_StartIndex = 0;
+	uint32_t m_IndexCount = 0;
+	uint32_t m_MaterialIndex = 0;
+	uint32_t m_DiffuseTexIndex = 0;
+};
+
 //TODO make this a template that takes T=vertex type
 struct D3DMesh 
 {
@@ -69,6 +88,28 @@ struct D3DMesh
 	ComPtr< ID3D12Resource > m_pIndexBuffer;
 	D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
 	uint32_t m_DiffuseTexIndex = 0;
+
+	//vertex buffer layout, see DXVertexCompression.h.  compact positions are offset + unorm16 * scale.
+	uint32_t m_VertexFormat = 0; //MeshVertexFormat
+	uint32_t m_VertexStride = sizeof(ModelVertex);
+	XMFLOAT3 m_PositionOffset = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	XMFLOAT3 m_PositionScale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+
+	//material subsets of the index buffer, see DXGraphicsUtilities::CreateD3DMesh.  empty means one geometry
+	//over all of indices.
+	vector<D3DMeshSubset> m_Subsets;
+
+	//the BLAS geometries of this mesh, one per subset
+	vector<D3DMeshSubset> GetGeometries() const
+	{
+		if (m_Subsets.empty() == false)
+			return m_Subsets;
+
+		D3DMeshSubset whole;
+		whole.m_IndexCount = (uint32_t)indices.size();
+		whole.m_DiffuseTexIndex = m_DiffuseTexIndex;
+		return vector<D3DMeshSubset>(1, whole);
+	}
 };
 
 struct D3DModel
@@ -92,12 +133,30 @@ struct D3DModel
 
 	void SetTexture2DIndex(uint32_t i)
 	{
-		for (auto &mesh : m_vMeshObjects) { mesh.m_DiffuseTexIndex = i;}
+		for (uint32_t meshIndex = 0; meshIndex < m_vMeshObjects.size(); meshIndex++) { SetTexture2DIndexForMesh(meshIndex, i); }
 	}
 
 	void SetTexture2DIndexForMesh(uint32_t meshIndex, uint32_t tex_index) 
 	{
 		m_vMeshObjects[meshIndex].m_DiffuseTexIndex = tex_index;
+		for (auto &subset : m_vMeshObjects[meshIndex].m_Subsets) { subset.m_DiffuseTexIndex = tex_index; }
+	}
+
+	//set the texture for the subsets of a mesh that use materialIndex
+	void SetTexture2DIndexForMaterial(uint32_t meshIndex, uint32_t materialIndex, uint32_t tex_index)
+	{
+		for (auto &subset : m_vMeshObjects[meshIndex].m_Subsets)
+		{
+			if (subset.m_MaterialIndex == materialIndex) { subset.m_DiffuseTexIndex = tex_index; }
+		}
+	}
+
+	//number of BLAS geometries ie the sum of the mesh subsets
+	uint32_t GetNumGeometries() const
+	{
+		uint32_t numGeometries = 0;
+		for (const auto &mesh : m_vMeshObjects) { numGeometries += mesh.m_Subsets.empty() ? 1 : (uint32_t)mesh.m_Subsets.size(); }
+		return numGeometries;
 	}
 	
 
@@ -322,12 +381,14 @@ struct AccelerationStructureBuffer
 	ID3D12Resource* pScratch;
 	ID3D12Resource* pResult;
 	ID3D12Resource* pInstanceDesc;			// only used in top-level AS
+	ID3D12Resource* pTransforms;			// only used in bottom-level AS with compact vertices
 
 	AccelerationStructureBuffer()
 	{
 		pScratch = NULL;
 		pResult = NULL;
 		pInstanceDesc = NULL;
+		pTransforms = NULL;
 	}
 };
 
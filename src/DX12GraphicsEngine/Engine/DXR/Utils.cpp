@@ -3,6 +3,8 @@
 #include "stdafx.h"
 #include "DXRVertices.h"
 #include "Utils.h"
+#include "../DXObjParser.h"
+#include "../DXMeshWelder.h"
 
 #ifdef STB_IMAGE_IMPLEMENTATION
 #undef STB_IMAGE_IMPLEMENTATION
@@ -12,30 +14,6 @@
 #undef TINYOBJLOADER_IMPLEMENTATION
 #endif
 
-namespace std
-{
-	void hash_combine(size_t &seed, size_t hash)
-	{
-		hash += 0x9e3779b9 + (seed << 6) + (seed >> 2);
-		seed ^= hash;
-	}
-
-	template<> struct hash<ModelVertex> {
-		size_t operator()(ModelVertex const &vertex) const {
-			size_t seed = 0;
-			hash<float> hasher;
-			hash_combine(seed, hasher(vertex.position.x));
-			hash_combine(seed, hasher(vertex.position.y));
-			hash_combine(seed, hasher(vertex.position.z));
-
-			hash_combine(seed, hasher(vertex.uv.x));
-			hash_combine(seed, hasher(vertex.uv.y));
-
-			return seed;
-		}
-	};
-}
-
 namespace Utils
 {
 
@@ -142,65 +120,84 @@ vector<char> ReadFile(const string &filename)
 // Model Loading
 //--------------------------------------------------------------------------------------
 
-void LoadModel(string filepath, Model &model, Material &material, string mtl_basedir)
+void LoadModel(string filepath, Model &model, vector<Material> &materials, string mtl_basedir)
 {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string err;
-
-	// Load the OBJ and MTL files
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filepath.c_str(), mtl_basedir.c_str())) 
+	// Geometry goes through the multithreaded obj parser, tinyobj is only used for the material library
+	ObjMeshData objData;
+	if (!DXObjParser::ParseFile(filepath.c_str(), objData, false))
 	{
-		throw std::runtime_error(err);
+		throw std::runtime_error("Failed to load " + filepath);
 	}
 
-	// Get the first material
-	// Only support a single material right now
+	std::vector<ObjMaterial> libraryMaterials;
+	if (objData.materialLibrary.empty() == false)
+	{
+		DXObjParser::ParseMaterialLibrary((mtl_basedir + objData.materialLibrary).c_str(), libraryMaterials);
+	}
 
-	//BillF check for no material
-	if (materials.empty() == false)
+	// One material per usemtl name, the subsets index into materials.  A file without usemtl gets the first
+	// material of the library (or none).
+	materials.clear();
+	if (objData.materials.empty())
 	{
-		material.name = materials[0].name;
-		material.texturePath = materials[0].diffuse_texname;
+		Material material;
+		material.name = libraryMaterials.empty() ? "" : libraryMaterials[0].name;
+		material.texturePath = libraryMaterials.empty() ? "" : libraryMaterials[0].diffuseTexture;
+		materials.push_back(material);
 	}
-	else
+
+	for (const std::string& name : objData.materials)
 	{
-		material.name = "";
+		Material material;
+		material.name = name;
 		material.texturePath = "";
+
+		for (const ObjMaterial& libraryMaterial : libraryMaterials)
+		{
+			if (libraryMaterial.name == name)
+			{
+				material.texturePath = libraryMaterial.diffuseTexture;
+				break;
+			}
+		}
+
+		materials.push_back(material);
 	}
 
 
-	// Parse the model and store the unique vertices
-	unordered_map<ModelVertex, uint32_t> uniqueVertices = {};
-	for (const auto &shape : shapes) 
+	// Convert to the DXR vertex layout.  x and z are swapped and u is flipped.
+	std::vector<ModelVertex> cornerVertices;
+	DXObjParser::ExpandCorners(objData, cornerVertices);
+
+	for (size_t i = 0; i < cornerVertices.size(); i++)
 	{
-		for (const auto &index : shape.mesh.indices) 
+		ModelVertex &vertex = cornerVertices[i];
+		std::swap(vertex.position.x, vertex.position.z);
+		std::swap(vertex.normal.x, vertex.normal.z);
+
+		if (objData.corners[i].vt >= 0)
 		{
-			ModelVertex vertex = {};
-			vertex.position = 
-			{
-				attrib.vertices[3 * index.vertex_index + 2],				
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 0]								
-			};
+			vertex.uv.x = 1.f - vertex.uv.x;
+		}
+	}
 
-			vertex.uv = 
-			{
-				1.f - attrib.texcoords[2 * index.texcoord_index + 0],
-				attrib.texcoords[2 * index.texcoord_index + 1]
-			};
+	// Store the unique vertices and the index list
+	WeldStats weldStats;
+	DXMeshWelder::WeldVertices(cornerVertices.data(), cornerVertices.size(), WeldOptions(), model.vertices, model.indices, &weldStats);
 
-			// Fast find unique vertices using a hash
-			if (uniqueVertices.count(vertex) == 0) 
-			{
-				uniqueVertices[vertex] = static_cast<uint32_t>(model.vertices.size());
-				model.vertices.push_back(vertex);
-			}
+	// Group the triangles by material
+	std::vector<ObjSubset> subsets;
+	DXObjParser::SortByMaterial(objData, model.indices, subsets);
 
-			model.indices.push_back(uniqueVertices[vertex]);
-		}
+	model.subsets.clear();
+	for (const ObjSubset& subset : subsets)
+	{
+		ModelSubset modelSubset = { subset.startIndex, subset.indexCount, subset.material };
+		model.subsets.push_back(modelSubset);
 	}
+
+	printf("%s: welded %zu -> %zu vertices (%.2fx) in %.2f ms\n", filepath.c_str(), weldStats.numInputVertices,
+		weldStats.numOutputVertices, weldStats.GetReductionRatio(), weldStats.weldMs);
 }
 
 //--------------------------------------------------------------------------------------
@@ -15,7 +15,7 @@ namespace Utils
 
 	vector<char> ReadFile(const string &filename);
 
-	void LoadModel(string filepath, Model &model, Material &material, string mtl_basedir);
+	void LoadModel(string filepath, Model &model, vector<Material> &materials, string mtl_basedir);
 
 	void Validate(HRESULT hr, LPWSTR message);
 
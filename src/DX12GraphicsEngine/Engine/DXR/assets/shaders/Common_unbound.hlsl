@@ -1,3 +1,4 @@
+#include "../../../../assets/shaders/OctNormalFunctions.hlsl"
 
 
 // ---[ Structures ]---
@@ -44,7 +45,8 @@ cbuffer SceneShaderData : register(b2)
 
 	//each index into the array is a model index ie InstanceID. The value at each index is the number of
 	//meshes in the model ie the number of vertex buffers in the model.  For ex, if numberOfMeshes[0]=3,
-	//then model 0 has 3 unique mesh objects (ie 3 unique vertex buffers).
+	//then model 0 has 3 unique mesh objects (ie 3 unique vertex buffers).  A mesh with material subsets counts
+	//one mesh object per subset since each subset is its own BLAS geometry.
 
 	//CB arrays must have EACH element on 16 byte boundary, thus we are using uint4
 	uint4 numberOfMeshes[128];
@@ -59,7 +61,15 @@ cbuffer SceneTextureShaderData : register(b3)
 	//texture2D resource is accessed via diffuse_textures[1] ie diffuse_textures[texIndex].
 
 	//CB arrays must have EACH element on 16 byte boundary, thus we are using uint4
+	//y is the material index of the subset (into the materials of the mesh).
 	uint4 diffuseTextureIndexForMesh[128];
+
+	//vertex buffer layout of each mesh, indexed the same way.  x = MeshVertexFormat (0 = 32 byte float vertex,
+	//1 = 16 byte compact, 2 = 12 byte compact, see DXVertexCompression.h), y = vertex stride in bytes.
+	//compact positions are positionOffsetForMesh + unorm16 * positionScaleForMesh.
+	uint4 vertexFormatForMesh[128];
+	float4 positionOffsetForMesh[128];
+	float4 positionScaleForMesh[128];
 }
 
 // ---[ Resources ]---
@@ -131,9 +141,58 @@ uint GetMeshIndex()
 	return flatIndex;
 }
 
+//material of the geometry that was hit, each material subset of a mesh is its own geometry
+uint GetMaterialIndex()
+{
+	return diffuseTextureIndexForMesh[GetMeshIndex()].y;
+}
+
+//read vertex vertexIndex of the vertex buffer indices_and_verts[flatIndex + 1] that belongs to mesh meshIndex and
+//decode it if the mesh uses a compact layout
+VertexAttributes LoadVertex(uint flatIndex, uint meshIndex, uint vertexIndex)
+{
+	uint4 format = vertexFormatForMesh[meshIndex];
+	uint address = vertexIndex * format.y;
+
+	VertexAttributes v;
+
+	if (format.x == 0)
+	{
+		//8 floats: position, normal, uv
+		v.position = asfloat(indices_and_verts[flatIndex + 1].Load3(address));
+		v.normal = asfloat(indices_and_verts[flatIndex + 1].Load3(address + 12));
+		v.uv = asfloat(indices_and_verts[flatIndex + 1].Load2(address + 16 + 8));
+		return v;
+	}
+
+	//4 x 16 bit unorm position.  for the 12 byte layout the last 16 bits are the 2 x 8 bit normal
+	uint2 position = indices_and_verts[flatIndex + 1].Load2(address);
+	float3 unorm = float3(position.x & 0xffff, position.x >> 16, position.y & 0xffff) / 65535.0;
+	v.position = positionOffsetForMesh[meshIndex].xyz + unorm * positionScaleForMesh[meshIndex].xyz;
+
+	float2 oct;
+	uint uvBits;
+	if (format.x == 1)
+	{
+		uint2 normalAndUV = indices_and_verts[flatIndex + 1].Load2(address + 8);
+		oct = UnpackOctNormal16(normalAndUV.x);
+		uvBits = normalAndUV.y;
+	}
+	else
+	{
+		oct = UnpackOctNormal8(position.y >> 16);
+		uvBits = indices_and_verts[flatIndex + 1].Load(address + 8);
+	}
+
+	v.normal = OctDecode(oct);
+	v.uv = f16tof32(uint2(uvBits & 0xffff, uvBits >> 16));
+	return v;
+}
+
 VertexAttributes GetVertexAttributes(uint triangleIndex, float3 barycentrics)
 {
 	uint flatIndex = GetIndexBufferArrayIndex();
+	uint meshIndex = GetMeshIndex();
 
 	uint3 triIndices = GetIndices(triangleIndex, flatIndex); //get the indices for vertices for triangle from the index buffer
 	VertexAttributes v;
@@ -145,21 +204,11 @@ VertexAttributes GetVertexAttributes(uint triangleIndex, float3 barycentrics)
 	//where the weight for each vertex is its barycentric value.  Each vertex has 1 weight (a weight is a scalar float).
 	for (uint i = 0; i < 3; i++)
 	{
-		//start triangle vertex address.  This is simply an index into the byte array used to store vertices
-		//Each vertex is 8 floats and we have 4 bytes per float.
-		// Thus, we calculate a byte offset into the vertex buffer.  This is the address of the first vertex.
-		int address = (triIndices[i] * 8) * 4;
-		
-		//position of vertex is at beginning of address
-		v.position += asfloat(indices_and_verts[flatIndex +1].Load3(address)) * barycentrics[i]; //read 3 floats ie x,y,z of position
-		
-		//normal of vertex is 3 floats offset = 3*4=12 bytes offset from position data
-		address += (3 * 4); //3 floats x 4 bytes per float
-		v.normal+= asfloat(indices_and_verts[flatIndex +1].Load3(address)) * barycentrics[i]; //read 3 floats ie x,y,z of normal
-		
-		//uv of vertex is 3 floats offset from normal = 3*4=12 bytes offset from normal (6 floats from start)
-		address += (3 * 4);
-		v.uv += asfloat(indices_and_verts[flatIndex +1].Load2(address)) * barycentrics[i];//read 2 floats ie x,y of uc tex coord
+		VertexAttributes vertex = LoadVertex(flatIndex, meshIndex, triIndices[i]);
+
+		v.position += vertex.position * barycentrics[i];
+		v.normal += vertex.normal * barycentrics[i];
+		v.uv += vertex.uv * barycentrics[i];
 	}
 
 	return v;
@@ -15,28 +15,13 @@ void GetVertexAttributes(uint triangleIndex, out VertexAttributes Verts[3])
 	uint3 triIndices = GetIndices(triangleIndex, flatIndex); //get the indices for vertices for triangle from the index buffer
 
 
-	//loop through the vertex data for the triangle's 3 vertices. Calculate a weighted sum of each vertex attribute
-	//where the weight for each vertex is its barycentric value.  Each vertex has 1 weight (a weight is a scalar float).
+	uint meshIndex = GetMeshIndex();
+
+	//read the vertex data for the triangle's 3 vertices.  LoadVertex handles the 32 byte float layout as well as
+	//the compact layouts (see LoadVertex in Common_unbound.hlsl).
 	for (uint i = 0; i < 3; i++)
 	{
-		//address of vertex i.  This is simply an index into the byte array used to store vertices
-		//Each vertex is 8 floats and we have 4 bytes per float.
-		// Thus, we calculate a byte offset into the vertex buffer.  This is the address of the vertex.
-		int address = (triIndices[i] * 8) * 4;
-
-		//The actual vertex buffer for the triangle is indices_and_verts[flatIndex + 1] ie
-		//indices_and_verts[flatIndex + 1] is the Srv for the ByteAddressBuffer corresponding to the vb.
-
-		//position of vertex is at beginning of address
-		Verts[i].position = asfloat(indices_and_verts[flatIndex + 1].Load3(address)); //read 3 floats ie x,y,z of position
-
-		//normal of vertex is 3 floats offset = 3*4=12 bytes offset from position data
-		address += (3 * 4); //3 floats x 4 bytes per float
-		Verts[i].normal = asfloat(indices_and_verts[flatIndex + 1].Load3(address)); //read 3 floats ie x,y,z of normal
-
-		//uv of vertex is 3 floats offset from normal = 3*4=12 bytes offset from normal (6 floats from start)
-		address += (3 * 4);
-		Verts[i].uv = asfloat(indices_and_verts[flatIndex + 1].Load2(address));//read 2 floats ie x,y of uc tex coord
+		Verts[i] = LoadVertex(flatIndex, meshIndex, triIndices[i]);
 	}
 }
 
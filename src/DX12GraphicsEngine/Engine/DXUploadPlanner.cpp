@@ -0,0 +1,354 @@
+#include "stdafx.h"
+#include "DXUploadPlanner.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+DXUploadPlanner::DXUploadPlanner(uint64_t maxRingSize) :
+	m_MaxRingSize(maxRingSize)
+	, m_RingSize(0)
+	, m_NumBytes(0)
+	, m_Planned(false)
+{
+
+}
+
+uint32_t DXUploadPlanner::AddBuffer(const void* pData,
+	uint64_t size,
+	D3D12_RESOURCE_STATES finalState,
+	uint32_t alignment,
+	uint64_t destinationSize)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	Allocation allocation;
+	allocation.pData = pData;
+	allocation.size = size;
+	allocation.destinationSize = std::max(destinationSize, size);
+	allocation.alignment = alignment;
+	allocation.finalState = finalState;
+	allocation.batch = 0;
+	allocation.ringOffset = 0;
+
+	m_Allocations.push_back(allocation);
+	m_NumBytes += size;
+	m_Planned = false;
+
+	return static_cast<uint32_t>(m_Allocations.size() - 1);
+}
+
+void DXUploadPlanner::Plan()
+{
+	m_BatchSizes.clear();
+	m_RingSize = 0;
+
+	uint64_t batchSize = 0;
+	for (Allocation& allocation : m_Allocations)
+	{
+		uint64_t offset = AlignUp(batchSize, allocation.alignment);
+		if (batchSize > 0 && offset + allocation.size > m_MaxRingSize)
+		{
+			m_BatchSizes.push_back(batchSize);
+			offset = 0;
+		}
+
+		allocation.batch = static_cast<uint32_t>(m_BatchSizes.size());
+		allocation.ringOffset = offset;
+		batchSize = offset + allocation.size;
+	}
+
+	if (!m_Allocations.empty())
+	{
+		m_BatchSizes.push_back(batchSize);
+	}
+
+	for (uint64_t size : m_BatchSizes)
+	{
+		m_RingSize = std::max(m_RingSize, size);
+	}
+
+	m_Planned = true;
+}
+
+bool DXUploadPlanner::Execute(IUploadDevice& device) const
+{
+	assert(m_Planned);
+	if (!m_Planned)
+		return false;
+
+	for (uint32_t i = 0; i < m_Allocations.size(); ++i)
+	{
+		if (!device.CreateDestination(i, m_Allocations[i].destinationSize))
+			return false;
+	}
+
+	if (m_Allocations.empty())
+		return true;
+
+	//a ring of zero bytes can not be created, it happens when every buffer is empty
+	uint8_t* pRing = device.CreateUploadRing(std::max< uint64_t >(m_RingSize, kDefaultAlignment));
+	if (!pRing)
+		return false;
+
+	std::vector< uint32_t > destinations;
+	std::vector< D3D12_RESOURCE_STATES > states;
+
+	size_t first = 0;
+	for (uint32_t batch = 0; batch < m_BatchSizes.size(); ++batch)
+	{
+		if (!device.BeginBatch(batch))
+			return false;
+
+		destinations.clear();
+		states.clear();
+
+		size_t end = first;
+		for (; end < m_Allocations.size() && m_Allocations[end].batch == batch; ++end)
+		{
+			const Allocation& allocation = m_Allocations[end];
+			if (allocation.size > 0)
+			{
+				std::memcpy(pRing + allocation.ringOffset, allocation.pData, static_cast<size_t>(allocation.size));
+				device.CopyBuffer(static_cast<uint32_t>(end), allocation.ringOffset, allocation.size);
+			}
+
+			destinations.push_back(static_cast<uint32_t>(end));
+			states.push_back(allocation.finalState);
+		}
+
+		device.Transition(destinations.data(), states.data(), destinations.size());
+
+		if (!device.Submit())
+			return false;
+
+		first = end;
+	}
+
+	return true;
+}
+
+void DXUploadPlanner::Clear()
+{
+	m_Allocations.clear();
+	m_BatchSizes.clear();
+	m_RingSize = 0;
+	m_NumBytes = 0;
+	m_Planned = false;
+}
+
+DXD3D12UploadDevice::DXD3D12UploadDevice(ID3D12Device* pDevice,
+	ID3D12CommandQueue* pCommandQueue,
+	ID3D12CommandAllocator* pCommandAllocator,
+	ID3D12GraphicsCommandList* pCommandList) :
+	m_pDevice(pDevice)
+	, m_pCommandQueue(pCommandQueue)
+	, m_pCommandAllocator(pCommandAllocator)
+	, m_pCommandList(pCommandList)
+	, m_FenceValue(0)
+	, m_FenceEvent(nullptr)
+{
+
+}
+
+DXD3D12UploadDevice::~DXD3D12UploadDevice()
+{
+	if (m_pUploadRing)
+	{
+		m_pUploadRing->Unmap(0, nullptr);
+	}
+
+	if (m_FenceEvent)
+	{
+		CloseHandle(m_FenceEvent);
+	}
+}
+
+bool DXD3D12UploadDevice::CreateDestination(uint32_t destination, uint64_t size)
+{
+	if (destination >= m_Destinations.size())
+	{
+		m_Destinations.resize(destination + 1);
+	}
+
+	//a buffer can not be empty, keep the smallest one the shaders can bind
+	auto desc = CD3DX12_RESOURCE_DESC::Buffer(std::max< uint64_t >(size, 4));
+	auto defaultHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	HRESULT hr = m_pDevice->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+		IID_PPV_ARGS(&m_Destinations[destination]));
+
+	return SUCCEEDED(hr);
+}
+
+uint8_t* DXD3D12UploadDevice::CreateUploadRing(uint64_t size)
+{
+	auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+	auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	if (FAILED(m_pDevice->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+		IID_PPV_ARGS(&m_pUploadRing))))
+	{
+		return nullptr;
+	}
+
+	//upload heaps can stay mapped, the cpu only writes them
+	uint8_t* pRing = nullptr;
+	CD3DX12_RANGE noRead(0, 0);
+	if (FAILED(m_pUploadRing->Map(0, &noRead, reinterpret_cast<void**>(&pRing))))
+	{
+		m_pUploadRing.Reset();
+		return nullptr;
+	}
+
+	if (FAILED(m_pDevice->CreateFence(m_FenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_pFence))))
+		return nullptr;
+
+	m_FenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (m_FenceEvent == nullptr)
+		return nullptr;
+
+	return pRing;
+}
+
+bool DXD3D12UploadDevice::BeginBatch(uint32_t batchIndex)
+{
+	//the command list comes in open, it is only reset for the batches after the first one
+	if (batchIndex > 0)
+	{
+		if (FAILED(m_pCommandAllocator->Reset()))
+			return false;
+		if (FAILED(m_pCommandList->Reset(m_pCommandAllocator, nullptr)))
+			return false;
+	}
+
+	return true;
+}
+
+void DXD3D12UploadDevice::CopyBuffer(uint32_t destination, uint64_t ringOffset, uint64_t size)
+{
+	m_pCommandList->CopyBufferRegion(m_Destinations[destination].Get(), 0, m_pUploadRing.Get(), ringOffset, size);
+}
+
+void DXD3D12UploadDevice::Transition(const uint32_t* pDestinations, const D3D12_RESOURCE_STATES* pStates, size_t count)
+{
+	std::vector< D3D12_RESOURCE_BARRIER > barriers(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		barriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(m_Destinations[pDestinations[i]].Get(), D3D12_RESOURCE_STATE_COPY_DEST, pStates[i]);
+	}
+
+	if (!barriers.empty())
+	{
+		m_pCommandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+	}
+}
+
+bool DXD3D12UploadDevice::Submit()
+{
+	if (FAILED(m_pCommandList->Close()))
+		return false;
+
+	ID3D12CommandList* ppCommandLists[] = { m_pCommandList };
+	m_pCommandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+
+	m_FenceValue++;
+	if (FAILED(m_pCommandQueue->Signal(m_pFence.Get(), m_FenceValue)))
+		return false;
+
+	if (m_pFence->GetCompletedValue() < m_FenceValue)
+	{
+		if (FAILED(m_pFence->SetEventOnCompletion(m_FenceValue, m_FenceEvent)))
+			return false;
+		WaitForSingleObjectEx(m_FenceEvent, INFINITE, FALSE);
+	}
+
+	return true;
+}
+
+bool DXNullUploadDevice::CreateDestination(uint32_t destination, uint64_t size)
+{
+	if (destination >= m_DestinationSizes.size())
+	{
+		m_DestinationSizes.resize(destination + 1, 0);
+		m_NumCopies.resize(destination + 1, 0);
+		m_NumTransitions.resize(destination + 1, 0);
+	}
+
+	m_DestinationSizes[destination] = size;
+	numDestinations++;
+	return true;
+}
+
+uint8_t* DXNullUploadDevice::CreateUploadRing(uint64_t size)
+{
+	m_Failed |= ringSize != 0;
+	ringSize = size;
+	m_Ring.resize(static_cast<size_t>(size));
+	return m_Ring.data();
+}
+
+bool DXNullUploadDevice::BeginBatch(uint32_t batchIndex)
+{
+	m_Failed |= m_InBatch || batchIndex != numSubmits;
+	m_InBatch = true;
+	return true;
+}
+
+void DXNullUploadDevice::CopyBuffer(uint32_t destination, uint64_t ringOffset, uint64_t size)
+{
+	if (!m_InBatch || destination >= m_DestinationSizes.size() || ringOffset + size > ringSize || size > m_DestinationSizes[destination])
+	{
+		m_Failed = true;
+		return;
+	}
+
+	m_NumCopies[destination]++;
+	numCopies++;
+	bytesCopied += size;
+}
+
+void DXNullUploadDevice::Transition(const uint32_t* pDestinations, const D3D12_RESOURCE_STATES* pStates, size_t count)
+{
+	m_Failed |= !m_InBatch;
+	numBarrierCalls++;
+	numBarriers += count;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (pDestinations[i] >= m_NumTransitions.size())
+		{
+			m_Failed = true;
+			continue;
+		}
+		m_NumTransitions[pDestinations[i]]++;
+	}
+}
+
+bool DXNullUploadDevice::Submit()
+{
+	m_Failed |= !m_InBatch;
+	m_InBatch = false;
+	numSubmits++;
+	return true;
+}
+
+bool DXNullUploadDevice::IsValid() const
+{
+	if (m_Failed || m_InBatch)
+		return false;
+
+	for (size_t i = 0; i < m_DestinationSizes.size(); ++i)
+	{
+		//empty buffers are created and transitioned but have nothing to copy
+		if (m_NumCopies[i] > 1 || m_NumTransitions[i] != 1)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//What DXUploadPlanner::Execute needs from a device.  Destinations are referred to by the index AddBuffer returned.
+//DXD3D12UploadDevice records into a D3D12 command list, DXNullUploadDevice only checks and counts the calls so a
+//plan can be tested without a GPU.
+class IUploadDevice
+{
+public:
+	virtual ~IUploadDevice() {}
+
+	//a buffer of size bytes in the copy destination state
+	virtual bool CreateDestination(uint32_t destination, uint64_t size) = 0;
+
+	//the upload ring, called once with the size of the largest batch.  returns the cpu address of the ring.
+	virtual uint8_t* CreateUploadRing(uint64_t size) = 0;
+
+	//batchIndex > 0 comes after a Submit, the ring may be written again
+	virtual bool BeginBatch(uint32_t batchIndex) = 0;
+
+	virtual void CopyBuffer(uint32_t destination, uint64_t ringOffset, uint64_t size) = 0;
+
+	//one barrier call for every destination of a batch
+	virtual void Transition(const uint32_t* pDestinations, const D3D12_RESOURCE_STATES* pStates, size_t count) = 0;
+
+	//close and execute the recorded copies and wait for them
+	virtual bool Submit() = 0;
+};
+
+//Packs many buffer uploads into one upload ring.  Every buffer gets an aligned range of the ring, the copies and
+//barriers of all buffers are recorded into one command list and there is one wait for the GPU, no matter how many
+//buffers or meshes there are.  Only when the data is larger than the ring it is split into batches, a batch is as
+//much as fits into the ring and each batch is one submit and one wait.
+//
+//	DXUploadPlanner planner;
+//	uint32_t vb = planner.AddBuffer(vertices, vertexBytes, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+//	planner.Plan();
+//	DXD3D12UploadDevice uploadDevice(device, queue, alloc, cmdList);
+//	planner.Execute(uploadDevice);
+//	ComPtr<ID3D12Resource> vertexBuffer = uploadDevice.GetDestination(vb);
+class DXUploadPlanner
+{
+public:
+	static const uint32_t kDefaultAlignment = 16;              //D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT
+	static const uint32_t kConstantBufferAlignment = 256;      //D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+	static const uint64_t kDefaultRingSize = 256ull << 20;
+
+	struct Allocation
+	{
+		const void* pData;
+		uint64_t size;                     //bytes copied
+		uint64_t destinationSize;          //>= size, the destination buffer can be larger than the data
+		uint32_t alignment;
+		D3D12_RESOURCE_STATES finalState;
+		uint32_t batch;                    //set by Plan
+		uint64_t ringOffset;               //set by Plan, aligned to alignment
+	};
+
+	explicit DXUploadPlanner(uint64_t maxRingSize = kDefaultRingSize);
+
+	//the data must stay valid until Execute.  alignment is a power of two.  returns the destination index.
+	uint32_t AddBuffer(const void* pData,
+		uint64_t size,
+		D3D12_RESOURCE_STATES finalState,
+		uint32_t alignment = kDefaultAlignment,
+		uint64_t destinationSize = 0);
+
+	//assigns ring offsets and batches in the order the buffers were added.  a buffer larger than the maximum ring
+	//size gets a batch of its own and makes the ring that large.
+	void Plan();
+
+	//creates the destinations and the ring, copies the data and records and submits every batch.
+	//Plan must have been called.
+	bool Execute(IUploadDevice& device) const;
+
+	void Clear();
+
+	size_t GetNumBuffers() const { return m_Allocations.size(); }
+	uint32_t GetNumBatches() const { return static_cast<uint32_t>(m_BatchSizes.size()); }
+	uint64_t GetRingSize() const { return m_RingSize; }
+	uint64_t GetNumBytes() const { return m_NumBytes; }   //sum of the buffer sizes, padding not included
+	const Allocation& GetAllocation(uint32_t destination) const { return m_Allocations[destination]; }
+
+protected:
+	uint64_t m_MaxRingSize;
+	std::vector< Allocation > m_Allocations;
+	std::vector< uint64_t > m_BatchSizes;   //bytes of the ring used by each batch
+	uint64_t m_RingSize;
+	uint64_t m_NumBytes;
+	bool m_Planned;
+};
+
+//Committed default heap destinations, one committed upload buffer as the ring, the command list and allocator of
+//the caller and one fence.  The command list must be open, it is closed after the last batch.
+class DXD3D12UploadDevice : public IUploadDevice
+{
+public:
+	DXD3D12UploadDevice(ID3D12Device* pDevice,
+		ID3D12CommandQueue* pCommandQueue,
+		ID3D12CommandAllocator* pCommandAllocator,
+		ID3D12GraphicsCommandList* pCommandList);
+	~DXD3D12UploadDevice();
+
+	bool CreateDestination(uint32_t destination, uint64_t size) override;
+	uint8_t* CreateUploadRing(uint64_t size) override;
+	bool BeginBatch(uint32_t batchIndex) override;
+	void CopyBuffer(uint32_t destination, uint64_t ringOffset, uint64_t size) override;
+	void Transition(const uint32_t* pDestinations, const D3D12_RESOURCE_STATES* pStates, size_t count) override;
+	bool Submit() override;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> GetDestination(uint32_t destination) const { return m_Destinations[destination]; }
+
+protected:
+	ID3D12Device* m_pDevice;
+	ID3D12CommandQueue* m_pCommandQueue;
+	ID3D12CommandAllocator* m_pCommandAllocator;
+	ID3D12GraphicsCommandList* m_pCommandList;
+
+	std::vector< Microsoft::WRL::ComPtr<ID3D12Resource> > m_Destinations;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_pUploadRing;
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_pFence;
+	uint64_t m_FenceValue;
+	HANDLE m_FenceEvent;
+};
+
+//Records nothing.  Checks that every copy stays inside the ring and its destination, that every destination is
+//written once and transitioned once, and counts the calls.
+class DXNullUploadDevice : public IUploadDevice
+{
+public:
+	bool CreateDestination(uint32_t destination, uint64_t size) override;
+	uint8_t* CreateUploadRing(uint64_t size) override;
+	bool BeginBatch(uint32_t batchIndex) override;
+	void CopyBuffer(uint32_t destination, uint64_t ringOffset, uint64_t size) override;
+	void Transition(const uint32_t* pDestinations, const D3D12_RESOURCE_STATES* pStates, size_t count) override;
+	bool Submit() override;
+
+	//true when no check failed and every destination was copied to and transitioned
+	bool IsValid() const;
+
+	size_t numDestinations = 0;
+	size_t numCopies = 0;
+	size_t numBarrierCalls = 0;
+	size_t numBarriers = 0;
+	size_t numSubmits = 0;
+	uint64_t bytesCopied = 0;
+	uint64_t ringSize = 0;
+
+protected:
+	std::vector< uint64_t > m_DestinationSizes;
+	std::vector< uint32_t > m_NumCopies;
+	std::vector< uint32_t > m_NumTransitions;
+	std::vector< uint8_t > m_Ring;
+	bool m_InBatch = false;
+	bool m_Failed = false;
+};
@@ -0,0 +1,497 @@
+#include "stdafx.h"
+#include "DXVertexCompression.h"
+#include "DXParallel.h"
+
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace DXGraphicsUtilities;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	inline float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	inline uint16_t QuantizeUnorm16(float value, float offset, float scale)
+	{
+		float unorm = scale > 0.0f ? (value - offset) / scale : 0.0f;
+		unorm = std::min(std::max(unorm, 0.0f), 1.0f);
+		return static_cast<uint16_t>(unorm * 65535.0f + 0.5f);
+	}
+
+	inline float DequantizeUnorm16(uint16_t value, float offset, float scale)
+	{
+		return offset + (value / 65535.0f) * scale;
+	}
+
+	inline uint32_t QuantizeUnorm10(float value, float offset, float scale)
+	{
+		float unorm = scale > 0.0f ? (value - offset) / scale : 0.0f;
+		unorm = std::min(std::max(unorm, 0.0f), 1.0f);
+		return static_cast<uint32_t>(unorm * 1023.0f + 0.5f);
+	}
+
+	inline float DequantizeUnorm10(uint32_t value, float offset, float scale)
+	{
+		return offset + ((value & 0x3ff) / 1023.0f) * scale;
+	}
+
+	//rgba 0..255 to R8G8B8A8_UNORM
+	inline uint32_t PackColor(const vec4& color)
+	{
+		auto quantize = [](float value) { return static_cast<uint32_t>(std::min(std::max(value, 0.0f), 255.0f) + 0.5f); };
+		return quantize(color.x) | (quantize(color.y) << 8) | (quantize(color.z) << 16) | (quantize(color.w) << 24);
+	}
+
+	//rgba 0..1 to R8G8B8A8_UNORM
+	inline uint32_t PackUnitColor(const XMFLOAT4& color)
+	{
+		return PackColor(vec4{ color.x * 255.0f, color.y * 255.0f, color.z * 255.0f, color.w * 255.0f });
+	}
+
+	inline XMFLOAT4 UnpackColor(uint32_t color)
+	{
+		return XMFLOAT4((color & 0xff) / 255.0f, ((color >> 8) & 0xff) / 255.0f, ((color >> 16) & 0xff) / 255.0f, (color >> 24) / 255.0f);
+	}
+
+	//snorm rules of the input assembler: -maxValue..maxValue maps to -1..1, the extra negative value clamps to -1
+	inline float DequantizeSnorm(int value, float maxValue)
+	{
+		return std::max(value / maxValue, -1.0f);
+	}
+
+	//quantize an octahedral normal to snorm with maxValue (127 or 32767).  of the 4 neighbouring grid points
+	//the one that decodes closest to the input is used, plain rounding can be off by about a grid cell.
+	void QuantizeOctNormal(const XMFLOAT3& normal, float maxValue, int out_oct[2])
+	{
+		XMFLOAT2 oct = DXVertexCompression::OctEncode(normal);
+
+		int baseX = static_cast<int>(std::floor(oct.x * maxValue));
+		int baseY = static_cast<int>(std::floor(oct.y * maxValue));
+		int maxInt = static_cast<int>(maxValue);
+
+		float bestDot = -2.0f;
+		out_oct[0] = 0;
+		out_oct[1] = 0;
+
+		for (int dy = 0; dy < 2; ++dy)
+		{
+			for (int dx = 0; dx < 2; ++dx)
+			{
+				int qx = std::min(std::max(baseX + dx, -maxInt), maxInt);
+				int qy = std::min(std::max(baseY + dy, -maxInt), maxInt);
+
+				XMFLOAT3 decoded = DXVertexCompression::OctDecode(XMFLOAT2(DequantizeSnorm(qx, maxValue), DequantizeSnorm(qy, maxValue)));
+				float dot = decoded.x * normal.x + decoded.y * normal.y + decoded.z * normal.z;
+
+				if (dot > bestDot)
+				{
+					bestDot = dot;
+					out_oct[0] = qx;
+					out_oct[1] = qy;
+				}
+			}
+		}
+	}
+
+	XMFLOAT3 NormalizeOrZero(const XMFLOAT3& v)
+	{
+		float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		return length > 0.0f ? XMFLOAT3(v.x / length, v.y / length, v.z / length) : XMFLOAT3(0.0f, 0.0f, 1.0f);
+	}
+
+	double GetElapsedMs(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	void MeasureError(const MeshVertexPosNormUV0* pSource, const MeshVertexPosNormUV0* pDecoded, size_t numVertices,
+		VertexCompressionStats& stats)
+	{
+		float minNormalDot = 1.0f;
+
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			const MeshVertexPosNormUV0& a = pSource[i];
+			const MeshVertexPosNormUV0& b = pDecoded[i];
+
+			float positionError = std::max(std::max(std::fabs(a.position.x - b.position.x), std::fabs(a.position.y - b.position.y)),
+				std::fabs(a.position.z - b.position.z));
+			float uvError = std::max(std::fabs(a.uv.x - b.uv.x), std::fabs(a.uv.y - b.uv.y));
+
+			XMFLOAT3 n = NormalizeOrZero(a.normal);
+			float normalDot = n.x * b.normal.x + n.y * b.normal.y + n.z * b.normal.z;
+
+			stats.maxPositionError = std::max(stats.maxPositionError, positionError);
+			stats.maxUVError = std::max(stats.maxUVError, uvError);
+			minNormalDot = std::min(minNormalDot, normalDot);
+		}
+
+		minNormalDot = std::min(std::max(minNormalDot, -1.0f), 1.0f);
+		stats.maxNormalErrorDegrees = std::acos(minNormalDot) * 180.0f / 3.14159265f;
+	}
+
+	void MeasurePointError(const vec3* pPositions, const vec4* pColors, const CloudVertexPosColor* pDecoded, size_t numPoints,
+		PointCompressionStats& stats)
+	{
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			const vec3& a = pPositions[i];
+			const vec4& c = pColors[i];
+			const CloudVertexPosColor& b = pDecoded[i];
+
+			float positionError = std::max(std::max(std::fabs(a.x - b.Pos.x), std::fabs(a.y - b.Pos.y)), std::fabs(a.z - b.Pos.z));
+			float colorError = std::max(std::max(std::fabs(c.x - b.Color.x * 255.0f), std::fabs(c.y - b.Color.y * 255.0f)),
+				std::max(std::fabs(c.z - b.Color.z * 255.0f), std::fabs(c.w - b.Color.w * 255.0f)));
+
+			stats.maxPositionError = std::max(stats.maxPositionError, positionError);
+			stats.maxColorError = std::max(stats.maxColorError, colorError);
+		}
+	}
+}
+
+namespace DXVertexCompression
+{
+	UINT GetVertexStride(MeshVertexFormat format)
+	{
+		switch (format)
+		{
+		case kMeshVertexFormatCompact16: return sizeof(MeshVertexCompact16);
+		case kMeshVertexFormatCompact12: return sizeof(MeshVertexCompact12);
+		default: return sizeof(MeshVertexPosNormUV0);
+		}
+	}
+
+	VertexQuantization ComputeQuantization(const BoundingBox& bounds)
+	{
+		VertexQuantization quantization;
+		quantization.positionOffset = bounds.mMin;
+		quantization.positionScale = XMFLOAT3(bounds.mMax.x - bounds.mMin.x, bounds.mMax.y - bounds.mMin.y, bounds.mMax.z - bounds.mMin.z);
+		return quantization;
+	}
+
+	XMFLOAT2 OctEncode(const XMFLOAT3& normal)
+	{
+		float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+		if (l1 == 0.0f)
+			return XMFLOAT2(0.0f, 0.0f);
+
+		float x = normal.x / l1;
+		float y = normal.y / l1;
+
+		// fold the lower hemisphere over the diagonals
+		if (normal.z < 0.0f)
+		{
+			float foldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+			float foldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		return XMFLOAT2(x, y);
+	}
+
+	XMFLOAT3 OctDecode(const XMFLOAT2& oct)
+	{
+		XMFLOAT3 n(oct.x, oct.y, 1.0f - std::fabs(oct.x) - std::fabs(oct.y));
+
+		float t = std::max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+
+		return NormalizeOrZero(n);
+	}
+
+	void EncodeVertices(const MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		MeshVertexFormat format,
+		const VertexQuantization& quantization,
+		std::vector< uint8_t >& out_bytes,
+		VertexCompressionStats* pStats)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		out_bytes.resize(numVertices * GetVertexStride(format));
+
+		const XMFLOAT3& offset = quantization.positionOffset;
+		const XMFLOAT3& scale = quantization.positionScale;
+
+		if (format == kMeshVertexFormatFull)
+		{
+			memcpy(out_bytes.data(), pVertices, out_bytes.size());
+		}
+		else if (format == kMeshVertexFormatCompact16)
+		{
+			MeshVertexCompact16* pOut = reinterpret_cast<MeshVertexCompact16*>(out_bytes.data());
+			for (size_t i = 0; i < numVertices; ++i)
+			{
+				const MeshVertexPosNormUV0& v = pVertices[i];
+
+				int oct[2];
+				QuantizeOctNormal(NormalizeOrZero(v.normal), 32767.0f, oct);
+
+				pOut[i].position[0] = QuantizeUnorm16(v.position.x, offset.x, scale.x);
+				pOut[i].position[1] = QuantizeUnorm16(v.position.y, offset.y, scale.y);
+				pOut[i].position[2] = QuantizeUnorm16(v.position.z, offset.z, scale.z);
+				pOut[i].position[3] = 0;
+				pOut[i].normal[0] = static_cast<int16_t>(oct[0]);
+				pOut[i].normal[1] = static_cast<int16_t>(oct[1]);
+				pOut[i].uv[0] = XMConvertFloatToHalf(v.uv.x);
+				pOut[i].uv[1] = XMConvertFloatToHalf(v.uv.y);
+			}
+		}
+		else
+		{
+			MeshVertexCompact12* pOut = reinterpret_cast<MeshVertexCompact12*>(out_bytes.data());
+			for (size_t i = 0; i < numVertices; ++i)
+			{
+				const MeshVertexPosNormUV0& v = pVertices[i];
+
+				int oct[2];
+				QuantizeOctNormal(NormalizeOrZero(v.normal), 127.0f, oct);
+
+				pOut[i].position[0] = QuantizeUnorm16(v.position.x, offset.x, scale.x);
+				pOut[i].position[1] = QuantizeUnorm16(v.position.y, offset.y, scale.y);
+				pOut[i].position[2] = QuantizeUnorm16(v.position.z, offset.z, scale.z);
+				pOut[i].normal[0] = static_cast<int8_t>(oct[0]);
+				pOut[i].normal[1] = static_cast<int8_t>(oct[1]);
+				pOut[i].uv[0] = XMConvertFloatToHalf(v.uv.x);
+				pOut[i].uv[1] = XMConvertFloatToHalf(v.uv.y);
+			}
+		}
+
+		if (pStats)
+		{
+			pStats->encodeMs = GetElapsedMs(start);
+			pStats->numVertices = numVertices;
+			pStats->sourceBytes = numVertices * sizeof(MeshVertexPosNormUV0);
+			pStats->compressedBytes = out_bytes.size();
+
+			std::vector< MeshVertexPosNormUV0 > decoded(numVertices);
+			auto decodeStart = std::chrono::high_resolution_clock::now();
+			DecodeVertices(out_bytes.data(), numVertices, format, quantization, decoded.data());
+			pStats->decodeMs = GetElapsedMs(decodeStart);
+
+			MeasureError(pVertices, decoded.data(), numVertices, *pStats);
+		}
+	}
+
+	void DecodeVertices(const uint8_t* pBytes,
+		size_t numVertices,
+		MeshVertexFormat format,
+		const VertexQuantization& quantization,
+		MeshVertexPosNormUV0* pOutVertices)
+	{
+		const XMFLOAT3& offset = quantization.positionOffset;
+		const XMFLOAT3& scale = quantization.positionScale;
+
+		if (format == kMeshVertexFormatFull)
+		{
+			memcpy(pOutVertices, pBytes, numVertices * sizeof(MeshVertexPosNormUV0));
+		}
+		else if (format == kMeshVertexFormatCompact16)
+		{
+			const MeshVertexCompact16* pIn = reinterpret_cast<const MeshVertexCompact16*>(pBytes);
+			for (size_t i = 0; i < numVertices; ++i)
+			{
+				MeshVertexPosNormUV0& v = pOutVertices[i];
+				v.position = XMFLOAT3(DequantizeUnorm16(pIn[i].position[0], offset.x, scale.x),
+					DequantizeUnorm16(pIn[i].position[1], offset.y, scale.y),
+					DequantizeUnorm16(pIn[i].position[2], offset.z, scale.z));
+				v.normal = OctDecode(XMFLOAT2(DequantizeSnorm(pIn[i].normal[0], 32767.0f), DequantizeSnorm(pIn[i].normal[1], 32767.0f)));
+				v.uv = XMFLOAT2(XMConvertHalfToFloat(pIn[i].uv[0]), XMConvertHalfToFloat(pIn[i].uv[1]));
+			}
+		}
+		else
+		{
+			const MeshVertexCompact12* pIn = reinterpret_cast<const MeshVertexCompact12*>(pBytes);
+			for (size_t i = 0; i < numVertices; ++i)
+			{
+				MeshVertexPosNormUV0& v = pOutVertices[i];
+				v.position = XMFLOAT3(DequantizeUnorm16(pIn[i].position[0], offset.x, scale.x),
+					DequantizeUnorm16(pIn[i].position[1], offset.y, scale.y),
+					DequantizeUnorm16(pIn[i].position[2], offset.z, scale.z));
+				v.normal = OctDecode(XMFLOAT2(DequantizeSnorm(pIn[i].normal[0], 127.0f), DequantizeSnorm(pIn[i].normal[1], 127.0f)));
+				v.uv = XMFLOAT2(XMConvertHalfToFloat(pIn[i].uv[0]), XMConvertHalfToFloat(pIn[i].uv[1]));
+			}
+		}
+	}
+
+	UINT GetPointStride(PointVertexFormat format)
+	{
+		switch (format)
+		{
+		case kPointVertexFormatCompact12: return sizeof(PointVertexCompact12);
+		case kPointVertexFormatCompact8: return sizeof(PointVertexCompact8);
+		default: return sizeof(CloudVertexPosColor);
+		}
+	}
+
+	void EncodePoints(const vec3* pPositions,
+		const vec4* pColors,
+		size_t numPoints,
+		PointVertexFormat format,
+		const VertexQuantization& quantization,
+		std::vector< uint8_t >& out_bytes,
+		PointCompressionStats* pStats,
+		uint32_t numThreads)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		out_bytes.resize(numPoints * GetPointStride(format));
+
+		const XMFLOAT3& offset = quantization.positionOffset;
+		const XMFLOAT3& scale = quantization.positionScale;
+
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			if (format == kPointVertexFormatFull)
+			{
+				CloudVertexPosColor* pOut = reinterpret_cast<CloudVertexPosColor*>(out_bytes.data());
+				for (size_t i = begin; i < end; ++i)
+				{
+					const vec3& p = pPositions[i];
+					const vec4& c = pColors[i];
+					pOut[i].Pos = XMFLOAT3(p.x, p.y, p.z);
+					pOut[i].Color = XMFLOAT4(c.x / 255.0f, c.y / 255.0f, c.z / 255.0f, c.w / 255.0f);
+				}
+			}
+			else if (format == kPointVertexFormatCompact12)
+			{
+				PointVertexCompact12* pOut = reinterpret_cast<PointVertexCompact12*>(out_bytes.data());
+				for (size_t i = begin; i < end; ++i)
+				{
+					const vec3& p = pPositions[i];
+					pOut[i].position[0] = QuantizeUnorm16(p.x, offset.x, scale.x);
+					pOut[i].position[1] = QuantizeUnorm16(p.y, offset.y, scale.y);
+					pOut[i].position[2] = QuantizeUnorm16(p.z, offset.z, scale.z);
+					pOut[i].position[3] = 0;
+					pOut[i].color = PackColor(pColors[i]);
+				}
+			}
+			else
+			{
+				PointVertexCompact8* pOut = reinterpret_cast<PointVertexCompact8*>(out_bytes.data());
+				for (size_t i = begin; i < end; ++i)
+				{
+					const vec3& p = pPositions[i];
+					pOut[i].position = QuantizeUnorm10(p.x, offset.x, scale.x) | (QuantizeUnorm10(p.y, offset.y, scale.y) << 10) |
+						(QuantizeUnorm10(p.z, offset.z, scale.z) << 20);
+					pOut[i].color = PackColor(pColors[i]);
+				}
+			}
+		}, numThreads);
+
+		if (pStats)
+		{
+			pStats->encodeMs = GetElapsedMs(start);
+			pStats->numPoints = numPoints;
+			pStats->sourceBytes = numPoints * sizeof(CloudVertexPosColor);
+			pStats->compressedBytes = out_bytes.size();
+			pStats->maxPositionError = 0.0f;
+			pStats->maxColorError = 0.0f;
+
+			std::vector< CloudVertexPosColor > decoded(numPoints);
+			auto decodeStart = std::chrono::high_resolution_clock::now();
+			DecodePoints(out_bytes.data(), numPoints, format, quantization, decoded.data(), numThreads);
+			pStats->decodeMs = GetElapsedMs(decodeStart);
+
+			MeasurePointError(pPositions, pColors, decoded.data(), numPoints, *pStats);
+		}
+	}
+
+	void EncodePoints(const CloudVertexPosColor* pPoints,
+		size_t numPoints,
+		PointVertexFormat format,
+		const VertexQuantization& quantization,
+		uint8_t* pOutBytes,
+		uint32_t numThreads)
+	{
+		const XMFLOAT3& offset = quantization.positionOffset;
+		const XMFLOAT3& scale = quantization.positionScale;
+
+		if (format == kPointVertexFormatFull)
+		{
+			memcpy(pOutBytes, pPoints, numPoints * sizeof(CloudVertexPosColor));
+			return;
+		}
+
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			if (format == kPointVertexFormatCompact12)
+			{
+				PointVertexCompact12* pOut = reinterpret_cast<PointVertexCompact12*>(pOutBytes);
+				for (size_t i = begin; i < end; ++i)
+				{
+					const XMFLOAT3& p = pPoints[i].Pos;
+					pOut[i].position[0] = QuantizeUnorm16(p.x, offset.x, scale.x);
+					pOut[i].position[1] = QuantizeUnorm16(p.y, offset.y, scale.y);
+					pOut[i].position[2] = QuantizeUnorm16(p.z, offset.z, scale.z);
+					pOut[i].position[3] = 0;
+					pOut[i].color = PackUnitColor(pPoints[i].Color);
+				}
+			}
+			else
+			{
+				PointVertexCompact8* pOut = reinterpret_cast<PointVertexCompact8*>(pOutBytes);
+				for (size_t i = begin; i < end; ++i)
+				{
+					const XMFLOAT3& p = pPoints[i].Pos;
+					pOut[i].position = QuantizeUnorm10(p.x, offset.x, scale.x) | (QuantizeUnorm10(p.y, offset.y, scale.y) << 10) |
+						(QuantizeUnorm10(p.z, offset.z, scale.z) << 20);
+					pOut[i].color = PackUnitColor(pPoints[i].Color);
+				}
+			}
+		}, numThreads);
+	}
+
+	void DecodePoints(const uint8_t* pBytes,
+		size_t numPoints,
+		PointVertexFormat format,
+		const VertexQuantization& quantization,
+		CloudVertexPosColor* pOutPoints,
+		uint32_t numThreads)
+	{
+		const XMFLOAT3& offset = quantization.positionOffset;
+		const XMFLOAT3& scale = quantization.positionScale;
+
+		if (format == kPointVertexFormatFull)
+		{
+			memcpy(pOutPoints, pBytes, numPoints * sizeof(CloudVertexPosColor));
+			return;
+		}
+
+		DXParallel::ParallelForRange(numPoints, DXParallel::kMinRangePoints, [&](size_t begin, size_t end)
+		{
+			if (format == kPointVertexFormatCompact12)
+			{
+				const PointVertexCompact12* pIn = reinterpret_cast<const PointVertexCompact12*>(pBytes);
+				for (size_t i = begin; i < end; ++i)
+				{
+					pOutPoints[i].Pos = XMFLOAT3(DequantizeUnorm16(pIn[i].position[0], offset.x, scale.x),
+						DequantizeUnorm16(pIn[i].position[1], offset.y, scale.y),
+						DequantizeUnorm16(pIn[i].position[2], offset.z, scale.z));
+					pOutPoints[i].Color = UnpackColor(pIn[i].color);
+				}
+			}
+			else
+			{
+				const PointVertexCompact8* pIn = reinterpret_cast<const PointVertexCompact8*>(pBytes);
+				for (size_t i = begin; i < end; ++i)
+				{
+					uint32_t position = pIn[i].position;
+					pOutPoints[i].Pos = XMFLOAT3(DequantizeUnorm10(position, offset.x, scale.x),
+						DequantizeUnorm10(position >> 10, offset.y, scale.y),
+						DequantizeUnorm10(position >> 20, offset.z, scale.z));
+					pOutPoints[i].Color = UnpackColor(pIn[i].color);
+				}
+			}
+		}, numThreads);
+	}
+}
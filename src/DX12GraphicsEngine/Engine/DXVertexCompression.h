@@ -0,0 +1,142 @@
+#pragma once
+
+#include "DXGraphicsUtilities.h"
+#include <vector>
+
+//Vertex layouts a DXMesh can upload.  The compact layouts store positions as 16 bit unorm relative to the mesh
+//bounds, normals octahedral encoded and uvs as half floats.
+enum MeshVertexFormat
+{
+	kMeshVertexFormatFull,         //MeshVertexPosNormUV0, 32 bytes
+	kMeshVertexFormatCompact16,    //MeshVertexCompact16, 16 bytes
+	kMeshVertexFormatCompact12     //MeshVertexCompact12, 12 bytes
+};
+
+//position R16G16B16A16_UNORM (w unused), normal R16G16_SNORM octahedral, uv R16G16_FLOAT
+struct MeshVertexCompact16
+{
+	uint16_t position[4];
+	int16_t normal[2];
+	uint16_t uv[2];
+};
+
+//position R16G16B16A16_UNORM where the w slot holds the normal as 2 x 8 bit snorm octahedral (x in the low byte),
+//uv R16G16_FLOAT
+struct MeshVertexCompact12
+{
+	uint16_t position[3];
+	int8_t normal[2];
+	uint16_t uv[2];
+};
+
+//position = offset + unorm * scale, per axis.  scale is the extent of the bounds.
+struct VertexQuantization
+{
+	DirectX::XMFLOAT3 positionOffset = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 positionScale = { 1.0f, 1.0f, 1.0f };
+};
+
+//largest difference between the source vertices and the decoded compact vertices
+struct VertexCompressionStats
+{
+	size_t numVertices = 0;
+	size_t sourceBytes = 0;
+	size_t compressedBytes = 0;
+	float maxPositionError = 0.0f;      //object space units
+	float maxNormalErrorDegrees = 0.0f;
+	float maxUVError = 0.0f;
+	double encodeMs = 0.0;
+	double decodeMs = 0.0;
+};
+
+//Vertex layouts a DXPointCloud can upload.  The compact layouts store positions as unorm relative to the cloud
+//bounds and the color as RGBA8 unorm.
+enum PointVertexFormat
+{
+	kPointVertexFormatFull,        //CloudVertexPosColor, 28 bytes
+	kPointVertexFormatCompact12,   //PointVertexCompact12, 12 bytes
+	kPointVertexFormatCompact8     //PointVertexCompact8, 8 bytes
+};
+
+//position R16G16B16A16_UNORM (w unused), color R8G8B8A8_UNORM (r in the low byte)
+struct PointVertexCompact12
+{
+	uint16_t position[4];
+	uint32_t color;
+};
+
+//position R10G10B10A2_UNORM (x in the low bits, a unused), color R8G8B8A8_UNORM
+struct PointVertexCompact8
+{
+	uint32_t position;
+	uint32_t color;
+};
+
+//largest difference between the source points and the decoded compact points
+struct PointCompressionStats
+{
+	size_t numPoints = 0;
+	size_t sourceBytes = 0;             //as CloudVertexPosColor
+	size_t compressedBytes = 0;
+	float maxPositionError = 0.0f;      //object space units
+	float maxColorError = 0.0f;         //0..255 units
+	double encodeMs = 0.0;
+	double decodeMs = 0.0;
+};
+
+namespace DXVertexCompression
+{
+	UINT GetVertexStride(MeshVertexFormat format);
+
+	VertexQuantization ComputeQuantization(const DXGraphicsUtilities::BoundingBox& bounds);
+
+	//octahedral mapping of a unit vector to [-1,1]^2 and back
+	DirectX::XMFLOAT2 OctEncode(const DirectX::XMFLOAT3& normal);
+	DirectX::XMFLOAT3 OctDecode(const DirectX::XMFLOAT2& oct);
+
+	//encode into GetVertexStride(format) * numVertices bytes.  kMeshVertexFormatFull copies the vertices.  if pStats
+	//is set the vertices are decoded again to measure the error.
+	void EncodeVertices(const DXGraphicsUtilities::MeshVertexPosNormUV0* pVertices,
+		size_t numVertices,
+		MeshVertexFormat format,
+		const VertexQuantization& quantization,
+		std::vector< uint8_t >& out_bytes,
+		VertexCompressionStats* pStats = nullptr);
+
+	void DecodeVertices(const uint8_t* pBytes,
+		size_t numVertices,
+		MeshVertexFormat format,
+		const VertexQuantization& quantization,
+		DXGraphicsUtilities::MeshVertexPosNormUV0* pOutVertices);
+
+	UINT GetPointStride(PointVertexFormat format);
+
+	//encode into GetPointStride(format) * numPoints bytes on numThreads threads.  the colors are 0..255 like
+	//DXPlyParser returns them, kPointVertexFormatFull writes CloudVertexPosColor with 0..1 colors.  if pStats is set
+	//the points are decoded again to measure the error.
+	void EncodePoints(const DXGraphicsUtilities::vec3* pPositions,
+		const DXGraphicsUtilities::vec4* pColors,
+		size_t numPoints,
+		PointVertexFormat format,
+		const VertexQuantization& quantization,
+		std::vector< uint8_t >& out_bytes,
+		PointCompressionStats* pStats = nullptr,
+		uint32_t numThreads = 0);
+
+	//encode CloudVertexPosColor points with 0..1 colors, as DXPointStreamer pages them, into
+	//GetPointStride(format) * numPoints bytes at pOutBytes
+	void EncodePoints(const DXGraphicsUtilities::CloudVertexPosColor* pPoints,
+		size_t numPoints,
+		PointVertexFormat format,
+		const VertexQuantization& quantization,
+		uint8_t* pOutBytes,
+		uint32_t numThreads = 0);
+
+	//the colors of the decoded points are 0..1
+	void DecodePoints(const uint8_t* pBytes,
+		size_t numPoints,
+		PointVertexFormat format,
+		const VertexQuantization& quantization,
+		DXGraphicsUtilities::CloudVertexPosColor* pOutPoints,
+		uint32_t numThreads = 0);
+}
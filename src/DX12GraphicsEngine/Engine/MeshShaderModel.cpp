@@ -13,11 +13,15 @@
 
 //#include "DXSampleHelper.h"
 
-#include <fstream>
+#include "DXMeshletBuilder.h"
+#include "DXUploadPlanner.h"
+#include "DXMesh.h"
+
 #include <unordered_set>
 
 using namespace DirectX;
 using namespace Microsoft::WRL;
+using namespace MeshletFile;
 
 namespace
 {
@@ -39,53 +43,6 @@ namespace
         12, // Bitangent
     };
 
-    const uint32_t c_prolog = 'MSHL';
-
-    enum FileVersion
-    {
-        FILE_VERSION_INITIAL = 0,
-        CURRENT_FILE_VERSION = FILE_VERSION_INITIAL
-    };
-
-    struct FileHeader
-    {
-        uint32_t Prolog;
-        uint32_t Version;
-
-        uint32_t MeshCount;
-        uint32_t AccessorCount;
-        uint32_t BufferViewCount;
-        uint32_t BufferSize;
-    };
-
-    struct MeshHeader
-    {
-        uint32_t Indices;
-        uint32_t IndexSubsets;
-        uint32_t Attributes[Attribute::Count];
-
-        uint32_t Meshlets;
-        uint32_t MeshletSubsets;
-        uint32_t UniqueVertexIndices;
-        uint32_t PrimitiveIndices;
-        uint32_t CullData;
-    };
-
-    struct BufferView
-    {
-        uint32_t Offset;
-        uint32_t Size;
-    };
-
-    struct Accessor
-    {
-        uint32_t BufferView;
-        uint32_t Offset;
-        uint32_t Size;
-        uint32_t Stride;
-        uint32_t Count;
-    };
-
     uint32_t GetFormatSize(DXGI_FORMAT format)
     { 
         switch(format)
@@ -111,77 +68,64 @@ namespace
         const size_t alignedSize = (size + alignment - 1) & ~(alignment - 1);
         return alignedSize;
     }
-}
 
-HRESULT MeshShaderModel::LoadFromFile(const wchar_t* filename)
-{
-    std::ifstream stream(filename, std::ios::binary);
-    if (!stream.is_open())
+    // every accessor the meshes use must point at a buffer view inside the buffer
+    bool ValidateMetadata(const std::vector<MeshHeader>& meshes, const std::vector<Accessor>& accessors,
+        const std::vector<BufferView>& bufferViews, uint32_t bufferSize)
     {
-        return E_INVALIDARG;
-    }
+        for (auto& view : bufferViews)
+        {
+            if (view.Offset > bufferSize || view.Size > bufferSize - view.Offset)
+                return false;
+        }
 
-    std::vector<MeshHeader> meshes;
-    std::vector<BufferView> bufferViews;
-    std::vector<Accessor> accessors;
+        for (auto& accessor : accessors)
+        {
+            if (accessor.BufferView >= bufferViews.size())
+                return false;
+        }
 
-    FileHeader header;
-    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+        for (auto& mesh : meshes)
+        {
+            const uint32_t required[] = { mesh.Indices, mesh.IndexSubsets, mesh.Meshlets, mesh.MeshletSubsets,
+                mesh.UniqueVertexIndices, mesh.PrimitiveIndices, mesh.CullData };
+            for (uint32_t index : required)
+            {
+                if (index >= accessors.size())
+                    return false;
+            }
 
-    if (header.Prolog != c_prolog)
-    {
-        return E_FAIL; // Incorrect file format.
-    }
+            for (uint32_t index : mesh.Attributes)
+            {
+                if (index != uint32_t(-1) && index >= accessors.size())
+                    return false;
+            }
+        }
 
-    if (header.Version != CURRENT_FILE_VERSION)
-    {
-        return E_FAIL; // Version mismatch between export and import serialization code.
+        return true;
     }
 
-    // Read mesh metdata
-    meshes.resize(header.MeshCount);
-    stream.read(reinterpret_cast<char*>(meshes.data()), meshes.size() * sizeof(meshes[0]));
-    
-    accessors.resize(header.AccessorCount);
-    stream.read(reinterpret_cast<char*>(accessors.data()), accessors.size() * sizeof(accessors[0]));
-
-    bufferViews.resize(header.BufferViewCount);
-    stream.read(reinterpret_cast<char*>(bufferViews.data()), bufferViews.size() * sizeof(bufferViews[0]));
-
-    m_buffer.resize(header.BufferSize);
-    stream.read(reinterpret_cast<char*>(m_buffer.data()), header.BufferSize);
-
-    char eofbyte;
-    stream.read(&eofbyte, 1); // Read last byte to hit the eof bit
-
-    assert(stream.eof()); // There's a problem if we didn't completely consume the file contents.
-
-    stream.close();
-
-    // Populate mesh data from binary data and metadata.
-    m_meshes.resize(meshes.size());
-    for (uint32_t i = 0; i < static_cast<uint32_t>(meshes.size()); ++i)
+    // Points the spans of a mesh at its data, pBuffer is what the buffer view offsets are relative to.
+    void ReadMesh(const MeshHeader& meshView, const std::vector<Accessor>& accessors,
+        const std::vector<BufferView>& bufferViews, uint8_t* pBuffer, Mesh& mesh)
     {
-        auto& meshView = meshes[i];
-        auto& mesh = m_meshes[i];
-
         // Index data
         {
-            Accessor& accessor = accessors[meshView.Indices];
-            BufferView& bufferView = bufferViews[accessor.BufferView];
+            const Accessor& accessor = accessors[meshView.Indices];
+            const BufferView& bufferView = bufferViews[accessor.BufferView];
 
             mesh.IndexSize = accessor.Size;
             mesh.IndexCount = accessor.Count;
 
-            mesh.Indices = MakeSpan(m_buffer.data() + bufferView.Offset, bufferView.Size);
+            mesh.Indices = MakeSpan(pBuffer + bufferView.Offset, bufferView.Size);
         }
 
         // Index Subset data
         {
-            Accessor& accessor = accessors[meshView.IndexSubsets];
-            BufferView& bufferView = bufferViews[accessor.BufferView];
+            const Accessor& accessor = accessors[meshView.IndexSubsets];
+            const BufferView& bufferView = bufferViews[accessor.BufferView];
 
-            mesh.IndexSubsets = MakeSpan(reinterpret_cast<Subset*>(m_buffer.data() + bufferView.Offset), accessor.Count);
+            mesh.IndexSubsets = MakeSpan(reinterpret_cast<Subset*>(pBuffer + bufferView.Offset), accessor.Count);
         }
 
         // Vertex data & layout metadata
@@ -199,8 +143,8 @@ HRESULT MeshShaderModel::LoadFromFile(const wchar_t* filename)
             if (meshView.Attributes[j] == -1)
                 continue;
 
-            Accessor& accessor = accessors[meshView.Attributes[j]];
-            
+            const Accessor& accessor = accessors[meshView.Attributes[j]];
+        
             auto it = std::find(vbMap.begin(), vbMap.end(), accessor.BufferView);
             if (it != vbMap.end())
             {
@@ -209,9 +153,9 @@ HRESULT MeshShaderModel::LoadFromFile(const wchar_t* filename)
 
             // New buffer view encountered; add to list and copy vertex data
             vbMap.push_back(accessor.BufferView);
-            BufferView& bufferView = bufferViews[accessor.BufferView];
+            const BufferView& bufferView = bufferViews[accessor.BufferView];
 
-            Span<uint8_t> verts = MakeSpan(m_buffer.data() + bufferView.Offset, bufferView.Size);
+            Span<uint8_t> verts = MakeSpan(pBuffer + bufferView.Offset, bufferView.Size);
 
             mesh.VertexStrides.push_back(accessor.Stride);
             mesh.Vertices.push_back(verts);
@@ -224,7 +168,7 @@ HRESULT MeshShaderModel::LoadFromFile(const wchar_t* filename)
             if (meshView.Attributes[j] == -1)
                 continue;
 
-            Accessor& accessor = accessors[meshView.Attributes[j]];
+            const Accessor& accessor = accessors[meshView.Attributes[j]];
 
             // Determine which vertex buffer index holds this attribute's data
             auto it = std::find(vbMap.begin(), vbMap.end(), accessor.BufferView);
@@ -237,50 +181,47 @@ HRESULT MeshShaderModel::LoadFromFile(const wchar_t* filename)
 
         // Meshlet data
         {
-            Accessor& accessor = accessors[meshView.Meshlets];
-            BufferView& bufferView = bufferViews[accessor.BufferView];
+            const Accessor& accessor = accessors[meshView.Meshlets];
+            const BufferView& bufferView = bufferViews[accessor.BufferView];
 
-            mesh.Meshlets = MakeSpan(reinterpret_cast<Meshlet*>(m_buffer.data() + bufferView.Offset), accessor.Count);
+            mesh.Meshlets = MakeSpan(reinterpret_cast<Meshlet*>(pBuffer + bufferView.Offset), accessor.Count);
         }
 
         // Meshlet Subset data
         {
-            Accessor& accessor = accessors[meshView.MeshletSubsets];
-            BufferView& bufferView = bufferViews[accessor.BufferView];
+            const Accessor& accessor = accessors[meshView.MeshletSubsets];
+            const BufferView& bufferView = bufferViews[accessor.BufferView];
 
-            mesh.MeshletSubsets = MakeSpan(reinterpret_cast<Subset*>(m_buffer.data() + bufferView.Offset), accessor.Count);
+            mesh.MeshletSubsets = MakeSpan(reinterpret_cast<Subset*>(pBuffer + bufferView.Offset), accessor.Count);
         }
 
         // Unique Vertex Index data
         {
-            Accessor& accessor = accessors[meshView.UniqueVertexIndices];
-            BufferView& bufferView = bufferViews[accessor.BufferView];
+            const Accessor& accessor = accessors[meshView.UniqueVertexIndices];
+            const BufferView& bufferView = bufferViews[accessor.BufferView];
 
-            mesh.UniqueVertexIndices = MakeSpan(m_buffer.data() + bufferView.Offset, bufferView.Size);
+            mesh.UniqueVertexIndices = MakeSpan(pBuffer + bufferView.Offset, bufferView.Size);
         }
 
         // Primitive Index data
         {
-            Accessor& accessor = accessors[meshView.PrimitiveIndices];
-            BufferView& bufferView = bufferViews[accessor.BufferView];
+            const Accessor& accessor = accessors[meshView.PrimitiveIndices];
+            const BufferView& bufferView = bufferViews[accessor.BufferView];
 
-            mesh.PrimitiveIndices = MakeSpan(reinterpret_cast<PackedTriangle*>(m_buffer.data() + bufferView.Offset), accessor.Count);
+            mesh.PrimitiveIndices = MakeSpan(reinterpret_cast<PackedTriangle*>(pBuffer + bufferView.Offset), accessor.Count);
         }
 
         // Cull data
         {
-            Accessor& accessor = accessors[meshView.CullData];
-            BufferView& bufferView = bufferViews[accessor.BufferView];
+            const Accessor& accessor = accessors[meshView.CullData];
+            const BufferView& bufferView = bufferViews[accessor.BufferView];
 
-            mesh.CullingData = MakeSpan(reinterpret_cast<CullData*>(m_buffer.data() + bufferView.Offset), accessor.Count);
+            mesh.CullingData = MakeSpan(reinterpret_cast<CullData*>(pBuffer + bufferView.Offset), accessor.Count);
         }
-     }
+    }
 
-    // Build bounding spheres for each mesh
-    for (uint32_t i = 0; i < static_cast<uint32_t>(m_meshes.size()); ++i)
+    void ComputeBoundingSphere(Mesh& m)
     {
-        auto& m = m_meshes[i];
-
         uint32_t vbIndexPos = 0;
 
         // Find the index of the vertex buffer of the position attribute
@@ -315,208 +256,374 @@ HRESULT MeshShaderModel::LoadFromFile(const wchar_t* filename)
         uint32_t stride = m.VertexStrides[vbIndexPos];
 
         BoundingSphere::CreateFromPoints(m.BoundingSphere, m.VertexCount, v0, stride);
+    }
+}
 
-        if (i == 0)
-        {
-            m_boundingSphere = m.BoundingSphere;
-        }
-        else
-        {
-            BoundingSphere::CreateMerged(m_boundingSphere, m_boundingSphere, m.BoundingSphere);
-        }
+HRESULT MeshShaderModel::LoadFromFile(const wchar_t* filename)
+{
+    m_buffer.clear();
+    m_file.Close();
+
+    if (!m_file.Open(filename))
+    {
+        return E_INVALIDARG;
     }
 
-     return S_OK;
+    // Pages of the file are only read when a span is used.
+    return Parse(reinterpret_cast<uint8_t*>(const_cast<char*>(m_file.GetData())), m_file.GetSize());
 }
 
-HRESULT MeshShaderModel::UploadGpuResources(ID3D12Device* device, ID3D12CommandQueue* cmdQueue, ID3D12CommandAllocator* cmdAlloc, ID3D12GraphicsCommandList* cmdList)
+HRESULT MeshShaderModel::LoadFromOBJ(const char* filename, const MeshletBuildOptions& options)
 {
-    for (uint32_t i = 0; i < m_meshes.size(); ++i)
+    // welded, optimized and grouped by material
+    DXMesh mesh;
+    mesh.SetOptimizeMesh(true);
+
+    DXMeshData meshData;
+    if (!mesh.LoadMeshData(filename, false, meshData))
     {
-        // m is a "Mesh" struct
-        auto& m = m_meshes[i];
+        return E_INVALIDARG;
+    }
 
-        // Span<Meshlet>              Meshlets; thus "Meshlets" is an array of Meshlets.  For ex, a sphere1.bin has 33 meshlets.
-        /*The meshlets are stored in an array.  The array used is a Span<Meshlet>.  Thus, data[0]=meshlet 0, data[1]=meshlet 1 etc.  An examplefor each
-        element in the Meshlet array is:
-        data[0].VertCount=63 data[0].VertOffset=0  data[0].PrimCount=21  data[0].PrimOffset=0
-        data[1].VertCount=64 data[1].VertOffset=63  data[1].PrimCount=30  data[1].PrimOffset=21
-        data[2].VertCount=64 data[2].VertOffset=127  data[2].PrimCount=32  data[2].PrimOffset=51
-        data[3].VertCount=64 data[3].VertOffset=191  data[3].PrimCount=32  data[3].PrimOffset=83
-        etc
-        */
+    std::vector<Subset> indexSubsets;
+    for (auto& submesh : meshData.submeshes)
+    {
+        indexSubsets.push_back({ submesh.startIndex, submesh.indexCount });
+    }
 
-        // Create committed D3D resources of proper sizes
-        auto indexDesc       = CD3DX12_RESOURCE_DESC::Buffer(m.Indices.size());
-        auto meshletDesc     = CD3DX12_RESOURCE_DESC::Buffer(m.Meshlets.size() * sizeof(m.Meshlets[0]));
-        auto cullDataDesc    = CD3DX12_RESOURCE_DESC::Buffer(m.CullingData.size() * sizeof(m.CullingData[0]));
-        auto vertexIndexDesc = CD3DX12_RESOURCE_DESC::Buffer(DivRoundUp(m.UniqueVertexIndices.size(), 4) * 4);
-        auto primitiveDesc   = CD3DX12_RESOURCE_DESC::Buffer(m.PrimitiveIndices.size() * sizeof(m.PrimitiveIndices[0]));
-        auto meshInfoDesc    = CD3DX12_RESOURCE_DESC::Buffer(sizeof(MeshInfo));
+    MeshletData meshlets;
+    MeshletStats stats;
+    DXMeshletBuilder::BuildMeshlets(&meshData.pVertices[0].position, sizeof(DXGraphicsUtilities::MeshVertexPosNormUV0),
+        meshData.numVertices, meshData.pIndices, meshData.numIndices, indexSubsets, options, meshlets, &stats);
 
-        auto defaultHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-        ThrowIfFailed(device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &indexDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m.IndexResource)));
-        ThrowIfFailed(device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &meshletDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m.MeshletResource)));
-        ThrowIfFailed(device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &cullDataDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m.CullDataResource)));
-        ThrowIfFailed(device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &vertexIndexDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m.UniqueVertexIndexResource)));
-        ThrowIfFailed(device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &primitiveDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m.PrimitiveIndexResource)));
-        ThrowIfFailed(device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &meshInfoDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m.MeshInfoResource)));
+    printf("  %zu meshlets in %.2f ms, %.1f%% vertex fill, %.1f%% primitive fill\n", stats.numMeshlets, stats.buildMs,
+        stats.GetVertexFill() * 100.0f, stats.GetPrimitiveFill() * 100.0f);
 
+    std::vector<uint8_t> file;
+    DXMeshletBuilder::SerializeMesh(meshData.pVertices, meshData.numVertices, meshData.pIndices, meshData.numIndices,
+        indexSubsets, meshlets, file);
 
-        m.IBView.BufferLocation = m.IndexResource->GetGPUVirtualAddress();
-        m.IBView.Format         = m.IndexSize == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
-        m.IBView.SizeInBytes    = m.IndexCount * m.IndexSize;
+    return LoadFromMemory(std::move(file));
+}
 
+HRESULT MeshShaderModel::LoadFromMemory(std::vector<uint8_t>&& file)
+{
+    m_file.Close();
+    m_buffer = std::move(file);
 
-        // Mesh::std::vector<Span<uint8_t>> Vertices;
-        //Mesh:: std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> VertexResources;
-        m.VertexResources.resize(m.Vertices.size());
-        m.VBViews.resize(m.Vertices.size());
+    return Parse(m_buffer.data(), m_buffer.size());
+}
 
-        //Make the vertex buffer/s in the  m.VertexResources[j] D3D Resources.  At this point, they are empty resources until the data gets uploaded into them
-        for (uint32_t j = 0; j < m.Vertices.size(); ++j)
-        {
-            auto vertexDesc = CD3DX12_RESOURCE_DESC::Buffer(m.Vertices[j].size());
-            device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &vertexDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m.VertexResources[j]));
+HRESULT MeshShaderModel::Parse(uint8_t* pData, size_t size)
+{
+    m_pData = pData;
+    m_dataSize = size;
+    m_meshes.clear();
+    m_meshTable.clear();
+    m_meshLoaded.clear();
 
-            m.VBViews[j].BufferLocation = m.VertexResources[j]->GetGPUVirtualAddress();
-            m.VBViews[j].SizeInBytes    = static_cast<uint32_t>(m.Vertices[j].size());
-            m.VBViews[j].StrideInBytes  = m.VertexStrides[j];
-        }
+    if (size < sizeof(FileHeader))
+    {
+        return E_FAIL;
+    }
 
-        // Create upload resources
-        std::vector<ComPtr<ID3D12Resource>> vertexUploads;
-        ComPtr<ID3D12Resource>              indexUpload;
-        ComPtr<ID3D12Resource>              meshletUpload;
-        ComPtr<ID3D12Resource>              cullDataUpload;
-        ComPtr<ID3D12Resource>              uniqueVertexIndexUpload;
-        ComPtr<ID3D12Resource>              primitiveIndexUpload;
-        ComPtr<ID3D12Resource>              meshInfoUpload;
-
-        auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        ThrowIfFailed(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &indexDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&indexUpload)));
-        ThrowIfFailed(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &meshletDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&meshletUpload)));
-        ThrowIfFailed(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &cullDataDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&cullDataUpload)));
-        ThrowIfFailed(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &vertexIndexDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uniqueVertexIndexUpload)));
-        ThrowIfFailed(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &primitiveDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&primitiveIndexUpload)));
-        ThrowIfFailed(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &meshInfoDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&meshInfoUpload)));
-
-        // Map & copy memory to upload heap
-        vertexUploads.resize(m.Vertices.size());
-        for (uint32_t j = 0; j < m.Vertices.size(); ++j)
-        {
-            auto vertexDesc = CD3DX12_RESOURCE_DESC::Buffer(m.Vertices[j].size());
-            ThrowIfFailed(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &vertexDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&vertexUploads[j])));
+    FileHeader header;
+    memcpy(&header, pData, sizeof(header));
 
-            uint8_t* memory = nullptr;
-            vertexUploads[j]->Map(0, nullptr, reinterpret_cast<void**>(&memory));
-            std::memcpy(memory, m.Vertices[j].data(), m.Vertices[j].size());
-            vertexUploads[j]->Unmap(0, nullptr);
-        }
+    if (header.Prolog != c_prolog)
+    {
+        return E_FAIL; // Incorrect file format.
+    }
 
+    switch (header.Version)
+    {
+    case FILE_VERSION_INITIAL:
+        return ParseVersion0(pData, size);
+    case FILE_VERSION_MESH_TABLE:
+        return ParseMeshTable(pData, size);
+    default:
+        return E_FAIL; // Version mismatch between export and import serialization code.
+    }
+}
+
+HRESULT MeshShaderModel::ParseVersion0(uint8_t* pData, size_t size)
+{
+    std::vector<MeshHeader> meshes;
+    std::vector<BufferView> bufferViews;
+    std::vector<Accessor> accessors;
+
+    FileHeader header;
+    memcpy(&header, pData, sizeof(header));
+
+    // The metadata is followed by the buffer, there's a problem if the two don't cover the file exactly.
+    size_t metadataSize = sizeof(FileHeader) + size_t(header.MeshCount) * sizeof(MeshHeader) +
+        size_t(header.AccessorCount) * sizeof(Accessor) + size_t(header.BufferViewCount) * sizeof(BufferView);
+    if (metadataSize + header.BufferSize != size)
+    {
+        return E_FAIL;
+    }
+
+    // Read mesh metdata
+    const uint8_t* pMetadata = pData + sizeof(FileHeader);
+
+    meshes.resize(header.MeshCount);
+    memcpy(meshes.data(), pMetadata, meshes.size() * sizeof(meshes[0]));
+    pMetadata += meshes.size() * sizeof(meshes[0]);
+
+    accessors.resize(header.AccessorCount);
+    memcpy(accessors.data(), pMetadata, accessors.size() * sizeof(accessors[0]));
+    pMetadata += accessors.size() * sizeof(accessors[0]);
+
+    bufferViews.resize(header.BufferViewCount);
+    memcpy(bufferViews.data(), pMetadata, bufferViews.size() * sizeof(bufferViews[0]));
+
+    if (!ValidateMetadata(meshes, accessors, bufferViews, header.BufferSize))
+    {
+        return E_FAIL;
+    }
+
+    uint8_t* pBuffer = pData + metadataSize;
+
+    // Populate mesh data from binary data and metadata.
+    m_meshes.resize(meshes.size());
+    m_meshLoaded.assign(meshes.size(), 1);
+    for (uint32_t i = 0; i < static_cast<uint32_t>(meshes.size()); ++i)
+    {
+        ReadMesh(meshes[i], accessors, bufferViews, pBuffer, m_meshes[i]);
+    }
+
+    // Build bounding spheres for each mesh
+    for (uint32_t i = 0; i < static_cast<uint32_t>(m_meshes.size()); ++i)
+    {
+        ComputeBoundingSphere(m_meshes[i]);
+
+        if (i == 0)
         {
-            uint8_t* memory = nullptr;
-            indexUpload->Map(0, nullptr, reinterpret_cast<void**>(&memory));
-            std::memcpy(memory, m.Indices.data(), m.Indices.size());
-            indexUpload->Unmap(0, nullptr);
+            m_boundingSphere = m_meshes[i].BoundingSphere;
         }
-
+        else
         {
-            uint8_t* memory = nullptr;
-            meshletUpload->Map(0, nullptr, reinterpret_cast<void**>(&memory));
-            std::memcpy(memory, m.Meshlets.data(), m.Meshlets.size() * sizeof(m.Meshlets[0]));
-            meshletUpload->Unmap(0, nullptr);
+            BoundingSphere::CreateMerged(m_boundingSphere, m_boundingSphere, m_meshes[i].BoundingSphere);
         }
+    }
+
+    return S_OK;
+}
+
+HRESULT MeshShaderModel::ParseMeshTable(uint8_t* pData, size_t size)
+{
+    if (size < sizeof(MeshTableHeader))
+    {
+        return E_FAIL;
+    }
+
+    MeshTableHeader header;
+    memcpy(&header, pData, sizeof(header));
+
+    if (header.FileSize != size || header.TableOffset < sizeof(MeshTableHeader) ||
+        header.TableOffset + uint64_t(header.MeshCount) * sizeof(MeshEntry) > size)
+    {
+        return E_FAIL;
+    }
 
+    m_meshTable.resize(header.MeshCount);
+    memcpy(m_meshTable.data(), pData + header.TableOffset, m_meshTable.size() * sizeof(MeshEntry));
+
+    // Only the table is read here, the mesh blocks stay untouched until LoadMesh.
+    m_meshes.resize(header.MeshCount);
+    m_meshLoaded.assign(header.MeshCount, 0);
+    for (uint32_t i = 0; i < header.MeshCount; ++i)
+    {
+        const MeshEntry& entry = m_meshTable[i];
+        if (entry.Offset > size || entry.Size > size - entry.Offset)
         {
-            uint8_t* memory = nullptr;
-            cullDataUpload->Map(0, nullptr, reinterpret_cast<void**>(&memory));
-            std::memcpy(memory, m.CullingData.data(), m.CullingData.size() * sizeof(m.CullingData[0]));
-            cullDataUpload->Unmap(0, nullptr);
+            return E_FAIL;
         }
 
+        auto& mesh = m_meshes[i];
+        mesh.BoundingSphere.Center = XMFLOAT3(entry.BoundingSphere[0], entry.BoundingSphere[1], entry.BoundingSphere[2]);
+        mesh.BoundingSphere.Radius = entry.BoundingSphere[3];
+
+        if (i == 0)
         {
-            uint8_t* memory = nullptr;
-            uniqueVertexIndexUpload->Map(0, nullptr, reinterpret_cast<void**>(&memory));
-            std::memcpy(memory, m.UniqueVertexIndices.data(), m.UniqueVertexIndices.size());
-            uniqueVertexIndexUpload->Unmap(0, nullptr);
+            m_boundingSphere = mesh.BoundingSphere;
         }
-
+        else
         {
-            uint8_t* memory = nullptr;
-            primitiveIndexUpload->Map(0, nullptr, reinterpret_cast<void**>(&memory));
-            std::memcpy(memory, m.PrimitiveIndices.data(), m.PrimitiveIndices.size() * sizeof(m.PrimitiveIndices[0]));
-            primitiveIndexUpload->Unmap(0, nullptr);
+            BoundingSphere::CreateMerged(m_boundingSphere, m_boundingSphere, mesh.BoundingSphere);
         }
+    }
 
-        {
-            MeshInfo info = {};
-            info.IndexSize            = m.IndexSize;
-            info.MeshletCount         = static_cast<uint32_t>(m.Meshlets.size());
-            info.LastMeshletVertCount = m.Meshlets.back().VertCount;
-            info.LastMeshletPrimCount = m.Meshlets.back().PrimCount;
+    return S_OK;
+}
 
+HRESULT MeshShaderModel::LoadMesh(uint32_t i)
+{
+    if (i >= m_meshes.size())
+    {
+        return E_INVALIDARG;
+    }
 
-            uint8_t* memory = nullptr;
-            meshInfoUpload->Map(0, nullptr, reinterpret_cast<void**>(&memory));
-            std::memcpy(memory, &info, sizeof(MeshInfo));
-            meshInfoUpload->Unmap(0, nullptr);
-        }
+    if (m_meshLoaded[i])
+    {
+        return S_OK;
+    }
 
-        // Populate our command list
-        //cmdList->Reset(cmdAlloc, nullptr);
+    const MeshEntry& entry = m_meshTable[i];
+    size_t metadataSize = sizeof(MeshHeader) + size_t(entry.AccessorCount) * sizeof(Accessor) +
+        size_t(entry.BufferViewCount) * sizeof(BufferView);
+    if (metadataSize > entry.Size)
+    {
+        return E_FAIL;
+    }
 
-        // Mesh::std::vector<Span<uint8_t>> Vertices;
-        //Mesh:: std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> VertexResources;
-        //Copy from the Vertex data from Upload Heap to the Default Resource Heap.  This populates the final VBs
-        for (uint32_t j = 0; j < m.Vertices.size(); ++j)
+    uint8_t* pBlock = m_pData + entry.Offset;
+    const uint8_t* pMetadata = pBlock;
+
+    std::vector<MeshHeader> meshes(1);
+    memcpy(meshes.data(), pMetadata, sizeof(MeshHeader));
+    pMetadata += sizeof(MeshHeader);
+
+    std::vector<Accessor> accessors(entry.AccessorCount);
+    memcpy(accessors.data(), pMetadata, accessors.size() * sizeof(accessors[0]));
+    pMetadata += accessors.size() * sizeof(accessors[0]);
+
+    std::vector<BufferView> bufferViews(entry.BufferViewCount);
+    memcpy(bufferViews.data(), pMetadata, bufferViews.size() * sizeof(bufferViews[0]));
+
+    // Buffer views are relative to the block, they may not reach into the next one.
+    if (entry.Size > UINT32_MAX || !ValidateMetadata(meshes, accessors, bufferViews, static_cast<uint32_t>(entry.Size)))
+    {
+        return E_FAIL;
+    }
+
+    // The bounding sphere of the table is kept, it is the one the model bounds were merged from.
+    BoundingSphere bounds = m_meshes[i].BoundingSphere;
+    ReadMesh(meshes[0], accessors, bufferViews, pBlock, m_meshes[i]);
+    m_meshes[i].BoundingSphere = bounds;
+
+    m_meshLoaded[i] = 1;
+    return S_OK;
+}
+
+HRESULT MeshShaderModel::LoadAllMeshes()
+{
+    for (uint32_t i = 0; i < static_cast<uint32_t>(m_meshes.size()); ++i)
+    {
+        HRESULT hr = LoadMesh(i);
+        if (FAILED(hr))
         {
-            cmdList->CopyResource(m.VertexResources[j].Get(), vertexUploads[j].Get()); //CopyResource(dest*, source*)
-            const auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(m.VertexResources[j].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            cmdList->ResourceBarrier(1, &barrier);
+            return hr;
         }
+    }
 
-        D3D12_RESOURCE_BARRIER postCopyBarriers[6];
+    return S_OK;
+}
 
-        cmdList->CopyResource(m.IndexResource.Get(), indexUpload.Get());
-        postCopyBarriers[0] = CD3DX12_RESOURCE_BARRIER::Transition(m.IndexResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+HRESULT MeshShaderModel::UploadGpuResources(ID3D12Device* device, ID3D12CommandQueue* cmdQueue, ID3D12CommandAllocator* cmdAlloc, ID3D12GraphicsCommandList* cmdList)
+{
+    // Only the loaded meshes go to the GPU, a version 2 file keeps the meshes nobody used on disk.  Every buffer
+    // of those meshes goes through one upload ring, the copies and barriers are recorded into cmdList and there is
+    // a single wait for the GPU (see DXUploadPlanner).
+    struct MeshBuffers
+    {
+        uint32_t Index;
+        uint32_t Meshlet;
+        uint32_t CullData;
+        uint32_t UniqueVertexIndex;
+        uint32_t PrimitiveIndex;
+        uint32_t MeshInfo;
+        uint32_t FirstVertex;
+    };
+
+    std::vector<MeshBuffers> buffers(m_meshes.size());
+    std::vector<MeshInfo>    infos(m_meshes.size());
+
+    const D3D12_RESOURCE_STATES srvState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
 
-        cmdList->CopyResource(m.MeshletResource.Get(), meshletUpload.Get());
-        postCopyBarriers[1] = CD3DX12_RESOURCE_BARRIER::Transition(m.MeshletResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    std::vector<uint32_t> uploadMeshes;
+    for (uint32_t i = 0; i < m_meshes.size(); ++i)
+    {
+        if (IsMeshLoaded(i) && !IsMeshUploaded(i))
+        {
+            uploadMeshes.push_back(i);
+        }
+    }
 
-        cmdList->CopyResource(m.CullDataResource.Get(), cullDataUpload.Get());
-        postCopyBarriers[2] = CD3DX12_RESOURCE_BARRIER::Transition(m.CullDataResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    DXUploadPlanner planner;
+    for (uint32_t i : uploadMeshes)
+    {
+        // m is a "Mesh" struct
+        auto& m = m_meshes[i];
 
-        cmdList->CopyResource(m.UniqueVertexIndexResource.Get(), uniqueVertexIndexUpload.Get());
-        postCopyBarriers[3] = CD3DX12_RESOURCE_BARRIER::Transition(m.UniqueVertexIndexResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        // Span<Meshlet>              Meshlets; thus "Meshlets" is an array of Meshlets.  For ex, a sphere1.bin has 33 meshlets.
+        /*The meshlets are stored in an array.  The array used is a Span<Meshlet>.  Thus, data[0]=meshlet 0, data[1]=meshlet 1 etc.  An examplefor each
+        element in the Meshlet array is:
+        data[0].VertCount=63 data[0].VertOffset=0  data[0].PrimCount=21  data[0].PrimOffset=0
+        data[1].VertCount=64 data[1].VertOffset=63  data[1].PrimCount=30  data[1].PrimOffset=21
+        data[2].VertCount=64 data[2].VertOffset=127  data[2].PrimCount=32  data[2].PrimOffset=51
+        data[3].VertCount=64 data[3].VertOffset=191  data[3].PrimCount=32  data[3].PrimOffset=83
+        etc
+        */
 
-        cmdList->CopyResource(m.PrimitiveIndexResource.Get(), primitiveIndexUpload.Get());
-        postCopyBarriers[4] = CD3DX12_RESOURCE_BARRIER::Transition(m.PrimitiveIndexResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        auto& info = infos[i];
+        info.IndexSize            = m.IndexSize;
+        info.MeshletCount         = static_cast<uint32_t>(m.Meshlets.size());
+        info.LastMeshletVertCount = m.Meshlets.size() ? m.Meshlets.back().VertCount : 0;
+        info.LastMeshletPrimCount = m.Meshlets.size() ? m.Meshlets.back().PrimCount : 0;
+
+        // The unique vertex indices are read as uints by the shader, their buffer is rounded up to 4 bytes.
+        auto& b = buffers[i];
+        b.Index             = planner.AddBuffer(m.Indices.data(), m.Indices.size(), srvState);
+        b.Meshlet           = planner.AddBuffer(m.Meshlets.data(), m.Meshlets.size() * sizeof(m.Meshlets[0]), srvState);
+        b.CullData          = planner.AddBuffer(m.CullingData.data(), m.CullingData.size() * sizeof(m.CullingData[0]), srvState);
+        b.UniqueVertexIndex = planner.AddBuffer(m.UniqueVertexIndices.data(), m.UniqueVertexIndices.size(), srvState,
+                                                DXUploadPlanner::kDefaultAlignment, DivRoundUp(m.UniqueVertexIndices.size(), 4) * 4);
+        b.PrimitiveIndex    = planner.AddBuffer(m.PrimitiveIndices.data(), m.PrimitiveIndices.size() * sizeof(m.PrimitiveIndices[0]), srvState);
+        b.MeshInfo          = planner.AddBuffer(&info, sizeof(MeshInfo), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+                                                DXUploadPlanner::kConstantBufferAlignment);
+
+        b.FirstVertex = static_cast<uint32_t>(planner.GetNumBuffers());
+        for (uint32_t j = 0; j < m.Vertices.size(); ++j)
+        {
+            planner.AddBuffer(m.Vertices[j].data(), m.Vertices[j].size(), srvState);
+        }
+    }
 
-        cmdList->CopyResource(m.MeshInfoResource.Get(), meshInfoUpload.Get());
-        postCopyBarriers[5] = CD3DX12_RESOURCE_BARRIER::Transition(m.MeshInfoResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    planner.Plan();
 
-        cmdList->ResourceBarrier(ARRAYSIZE(postCopyBarriers), postCopyBarriers);
+    DXD3D12UploadDevice uploadDevice(device, cmdQueue, cmdAlloc, cmdList);
+    if (!planner.Execute(uploadDevice))
+    {
+        return E_FAIL;
+    }
 
-        ThrowIfFailed(cmdList->Close());
+    for (uint32_t i : uploadMeshes)
+    {
+        auto& m = m_meshes[i];
+        auto& b = buffers[i];
 
-        ID3D12CommandList* ppCommandLists[] = { cmdList };
-        cmdQueue->ExecuteCommandLists(1, ppCommandLists);
+        m.IndexResource             = uploadDevice.GetDestination(b.Index);
+        m.MeshletResource           = uploadDevice.GetDestination(b.Meshlet);
+        m.CullDataResource          = uploadDevice.GetDestination(b.CullData);
+        m.UniqueVertexIndexResource = uploadDevice.GetDestination(b.UniqueVertexIndex);
+        m.PrimitiveIndexResource    = uploadDevice.GetDestination(b.PrimitiveIndex);
+        m.MeshInfoResource          = uploadDevice.GetDestination(b.MeshInfo);
 
-        // Create our sync fence
-        ComPtr<ID3D12Fence> fence;
-        ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+        m.IBView.BufferLocation = m.IndexResource->GetGPUVirtualAddress();
+        m.IBView.Format         = m.IndexSize == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+        m.IBView.SizeInBytes    = m.IndexCount * m.IndexSize;
 
-        cmdQueue->Signal(fence.Get(), 1);
+        m.VertexResources.resize(m.Vertices.size());
+        m.VBViews.resize(m.Vertices.size());
 
-        // Wait for GPU
-        if (fence->GetCompletedValue() != 1)
+        for (uint32_t j = 0; j < m.Vertices.size(); ++j)
         {
-            HANDLE event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-            fence->SetEventOnCompletion(1, event);
+            m.VertexResources[j] = uploadDevice.GetDestination(b.FirstVertex + j);
 
-            WaitForSingleObjectEx(event, INFINITE, false);
-            CloseHandle(event);
+            m.VBViews[j].BufferLocation = m.VertexResources[j]->GetGPUVirtualAddress();
+            m.VBViews[j].SizeInBytes    = static_cast<uint32_t>(m.Vertices[j].size());
+            m.VBViews[j].StrideInBytes  = m.VertexStrides[j];
         }
     }
 
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "Span.h"
+#include "DXMemoryMappedFile.h"
 
 #include <DirectXCollision.h>
 
@@ -67,6 +68,95 @@ struct CullData
     float             ApexOffset;     // apex = center - axis * offset
 };
 
+// Layout of the MSHL meshlet file, version 0:
+//   FileHeader | MeshHeader[MeshCount] | Accessor[AccessorCount] | BufferView[BufferViewCount] | buffer[BufferSize]
+// The MeshHeader fields are accessor indices, accessors point into buffer views, buffer view offsets are relative
+// to the start of the buffer.  Written by the offline converter and by DXMeshletBuilder::SerializeMesh.
+//
+// Version 2 puts every mesh in its own block so one mesh can be read without touching the others:
+//   MeshTableHeader | padding | MeshEntry[MeshCount] at TableOffset | mesh blocks, each at a multiple of c_meshAlignment
+// A mesh block is MeshHeader | Accessor[AccessorCount] | BufferView[BufferViewCount] | data, with the accessor
+// indices local to the block and the buffer view offsets relative to the start of the block.  Written by
+// DXMeshletBuilder::WriteMeshPack.
+namespace MeshletFile
+{
+    const uint32_t c_prolog = 'MSHL';
+    const uint32_t c_meshAlignment = 4096;   // a page, a mesh block never shares one with another mesh
+    const uint32_t c_tableAlignment = 64;
+
+    enum FileVersion
+    {
+        FILE_VERSION_INITIAL = 0,
+        FILE_VERSION_MESH_TABLE = 2,
+        CURRENT_FILE_VERSION = FILE_VERSION_MESH_TABLE
+    };
+
+    struct FileHeader
+    {
+        uint32_t Prolog;
+        uint32_t Version;
+
+        uint32_t MeshCount;
+        uint32_t AccessorCount;
+        uint32_t BufferViewCount;
+        uint32_t BufferSize;
+    };
+
+    struct MeshHeader
+    {
+        uint32_t Indices;
+        uint32_t IndexSubsets;
+        uint32_t Attributes[Attribute::Count];
+
+        uint32_t Meshlets;
+        uint32_t MeshletSubsets;
+        uint32_t UniqueVertexIndices;
+        uint32_t PrimitiveIndices;
+        uint32_t CullData;
+    };
+
+    struct BufferView
+    {
+        uint32_t Offset;
+        uint32_t Size;
+    };
+
+    struct Accessor
+    {
+        uint32_t BufferView;
+        uint32_t Offset;
+        uint32_t Size;
+        uint32_t Stride;
+        uint32_t Count;
+    };
+
+    // Version 2.  Prolog and Version are where FileHeader has them.
+    struct MeshTableHeader
+    {
+        uint32_t Prolog;
+        uint32_t Version;
+
+        uint32_t MeshCount;
+        uint32_t TableOffset;
+        uint64_t FileSize;
+    };
+
+    struct MeshEntry
+    {
+        uint64_t Offset;            // of the mesh block from the start of the file
+        uint64_t Size;
+        uint32_t AccessorCount;
+        uint32_t BufferViewCount;
+        float    BoundingSphere[4]; // center, radius.  the model bounds are known without reading any mesh.
+        uint32_t Reserved[2];
+    };
+
+    static_assert(sizeof(MeshTableHeader) == 24, "MeshTableHeader is part of the file format");
+    static_assert(sizeof(MeshEntry) == 48, "MeshEntry is part of the file format");
+}
+
+struct MeshletBuildOptions;
+
 struct Mesh
 {
     D3D12_INPUT_ELEMENT_DESC   LayoutElems[Attribute::Count];
@@ -137,11 +227,31 @@ struct Mesh
 class MeshShaderModel
 {
 public:
+    // Maps the file, the spans of the meshes point into the mapping.  The meshes of a version 2 file are read on
+    // first use (GetMesh, LoadMesh), until then only their bounding spheres are known.
     HRESULT LoadFromFile(const wchar_t* filename);
+
+    // Takes over the contents of an MSHL file, the spans of the meshes point into it.
+    HRESULT LoadFromMemory(std::vector<uint8_t>&& file);
+
+    // Builds the meshlets of an obj file in the engine (see DXMeshletBuilder) instead of loading a converted file.
+    // The welded mesh comes from the .dxmesh cache when it is up to date.
+    HRESULT LoadFromOBJ(const char* filename, const MeshletBuildOptions& options);
+
+    // Uploads the meshes that are loaded and not on the GPU yet.  The meshes of a version 2 file that were never
+    // used stay on disk, load the ones to draw (LoadMesh, LoadAllMeshes) first.  Can be called again after more
+    // meshes were loaded.
     HRESULT UploadGpuResources(ID3D12Device* device, ID3D12CommandQueue* cmdQueue, ID3D12CommandAllocator* cmdAlloc, ID3D12GraphicsCommandList* cmdList);
 
     uint32_t GetMeshCount() const { return static_cast<uint32_t>(m_meshes.size()); }
-    const Mesh& GetMesh(uint32_t i) const { return m_meshes[i]; }
+
+    // Loads the mesh if it has not been used yet, throws if its block is invalid (LoadMesh returns the HRESULT).
+    Mesh& GetMesh(uint32_t i) { ThrowIfFailed(LoadMesh(i)); return m_meshes[i]; }
+
+    HRESULT LoadMesh(uint32_t i);
+    HRESULT LoadAllMeshes();
+    bool IsMeshLoaded(uint32_t i) const { return m_meshLoaded[i] != 0; }
+    bool IsMeshUploaded(uint32_t i) const { return m_meshes[i].IndexResource != nullptr; }
 
     const DirectX::BoundingSphere& GetBoundingSphere() const { return m_boundingSphere; }
 
@@ -150,8 +260,20 @@ public:
     auto end() { return m_meshes.end(); }
 
 private:
+    HRESULT Parse(uint8_t* pData, size_t size);
+    HRESULT ParseVersion0(uint8_t* pData, size_t size);
+    HRESULT ParseMeshTable(uint8_t* pData, size_t size);
+
     std::vector<Mesh>                      m_meshes;
     DirectX::BoundingSphere                m_boundingSphere;
 
+    // The file is either mapped (LoadFromFile) or held in m_buffer, m_pData points at it.  The mapping is read
+    // only, nothing may write through the spans.
+    DXMemoryMappedFile                     m_file;
     std::vector<uint8_t>                   m_buffer;
+    uint8_t*                               m_pData = nullptr;
+    size_t                                 m_dataSize = 0;
+
+    std::vector<MeshletFile::MeshEntry>    m_meshTable;    // version 2 only
+    std::vector<uint8_t>                   m_meshLoaded;
 };
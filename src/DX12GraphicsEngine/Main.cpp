@@ -15,13 +15,29 @@
 #include "D3D12PointCloudApp_4.h"
 #include "DX12Raytracing_Inline_1.h"
 #include "DX12MeshShader_1.h"
+#include "./Engine/DXAssetBenchmarks.h"
 
 
 _Use_decl_annotations_
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow)
 {
     uint32_t appIndex = 2;
 
+    //-meshletreport writes the meshlet quality numbers to meshlet_report.json and exits, for tracking them in CI
+    if (lpCmdLine && strstr(lpCmdLine, "-meshletreport"))
+    {
+        DXAssetBenchmarks::RunMeshletReport();
+        return 0;
+    }
+
+    //run the CPU asset pipeline benchmarks instead of a sample app
+    bool bRunAssetBenchmarks = false;
+    if (bRunAssetBenchmarks)
+    {
+        DXAssetBenchmarks::RunAll();
+        return 0;
+    }
+
     if (appIndex == 0)
     {
         D3D12PointCloudApp_4 sample(1024, 1024, L"D3D12 Point Cloud Test 4");
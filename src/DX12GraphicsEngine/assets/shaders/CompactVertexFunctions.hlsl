@@ -0,0 +1,37 @@
+// Vertex shader entry points for the compact vertex layouts (see DXVertexCompression.h).  The including shader
+// declares VS_INPUT, PS_INPUT and VSMain before the include, the entry points decode the vertex and call VSMain.
+// The position is 16 bit unorm relative to the mesh bounds, the dequantization is folded into the matrices by
+// DXMesh::Render.
+#include "OctNormalFunctions.hlsl"
+
+struct VS_INPUT_COMPACT
+{
+	float4 vPosition : POSITION;
+	float2 vOctNormal : NORMAL;     //R16G16_SNORM octahedral
+	float2 vUVCoords : TEXCOORD0;   //R16G16_FLOAT
+};
+
+// 12 byte layout, the w slot of the position holds the normal as 2 x 8 bit snorm octahedral
+struct VS_INPUT_COMPACT_PACKED
+{
+	float4 vPosition : POSITION;
+	float2 vUVCoords : TEXCOORD0;
+};
+
+PS_INPUT VSMainCompact( VS_INPUT_COMPACT i )
+{
+	VS_INPUT full;
+	full.vPosition = i.vPosition.xyz;
+	full.vNormal = OctDecode(i.vOctNormal);
+	full.vUVCoords = i.vUVCoords;
+	return VSMain(full);
+}
+
+PS_INPUT VSMainCompactPacked( VS_INPUT_COMPACT_PACKED i )
+{
+	VS_INPUT full;
+	full.vPosition = i.vPosition.xyz;
+	full.vNormal = OctDecode(UnpackOctNormal8(i.vPosition.w));
+	full.vUVCoords = i.vUVCoords;
+	return VSMain(full);
+}
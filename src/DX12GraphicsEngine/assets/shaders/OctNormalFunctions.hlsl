@@ -0,0 +1,30 @@
+// Octahedral normal decoding for the compact vertex layouts (see DXVertexCompression.h), shared by the raster
+// shaders and the DXR hit shaders.
+
+float3 OctDecode(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+//2 x 16 bit snorm in the 32 bits, x in the low half
+float2 UnpackOctNormal16(uint bits)
+{
+	int2 oct = int2(int(bits << 16) >> 16, int(bits) >> 16);
+	return max(float2(oct) / 32767.0, -1.0);
+}
+
+//2 x 8 bit snorm in the low 16 bits, x in the low byte
+float2 UnpackOctNormal8(uint bits)
+{
+	int2 oct = int2(int(bits << 24) >> 24, int(bits << 16) >> 24);
+	return max(float2(oct) / 127.0, -1.0);
+}
+
+//the 16 bits read as unorm, the w slot of the 12 byte layout
+float2 UnpackOctNormal8(float w)
+{
+	return UnpackOctNormal8((uint)(w * 65535.0 + 0.5));
+}
@@ -35,6 +35,15 @@ cbuffer ObjectConstantBuffer : register(b0)
 	float4x4 gInvView;
 	float4 gEyePosW;
 	float4 gQuadSize; //only uses first 2 floats
+	float4 gPositionOffset; //the compact point formats store unorm positions, center = offset + position * scale
+	float4 gPositionScale;
+};
+
+//Size of the quads of the current draw, root constants.  The ranges of a point cloud with level of detail are drawn
+//with the spacing of their level.
+cbuffer DrawConstantBuffer : register(b1)
+{
+	float4 gDrawQuadSize; //only uses first 2 floats
 };
 
 SamplerState g_SamplerState : register(s0);
@@ -46,9 +55,9 @@ VertexOut VSMain(VS_INPUT i)
 {
 	//Vertex shader just passes through vertex data.  The projection is done in the geo shader
 	VertexOut o;
-	o.CenterW = i.CenterW;// mul(float4(i.CenterW, 1.0), g_WVPMatrix);
+	o.CenterW = gPositionOffset.xyz + i.CenterW * gPositionScale.xyz;// mul(float4(i.CenterW, 1.0), g_WVPMatrix);
 	o.vColor = i.vColor;
-	o.SizeW = float2(gQuadSize.x, gQuadSize.y);
+	o.SizeW = float2(gDrawQuadSize.x, gDrawQuadSize.y);
 
 	return o;
 }
@@ -36,6 +36,8 @@ PS_INPUT VSMain( VS_INPUT i )
 	return o;
 }
 
+#include "CompactVertexFunctions.hlsl"
+
 float4 PSMain( PS_INPUT i ) : SV_TARGET
 {
 	float3 vNormal = i.vNormal;
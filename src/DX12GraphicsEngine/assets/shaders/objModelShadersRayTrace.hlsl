@@ -46,6 +46,8 @@ PS_INPUT VSMain( VS_INPUT i )
 	return o;
 }
 
+#include "CompactVertexFunctions.hlsl"
+
 float4 CastRay(float3 worldPos)
 {
 	float4 final = float4(1, 1, 1, 1);